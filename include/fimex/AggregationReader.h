@@ -25,16 +25,23 @@
 #define FIMEX_AGGREGATIONREADER_H_
 
 #include "fimex/CDMReader.h"
+#include "fimex/MutexLock.h"
 
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace MetNoFimex {
 
 /**
  * A CDM-Reader reading data from several-files.
+ *
+ * Members added with addReaders() are only kept open while they are among the
+ * recently used members, see setMaxOpenReaders(), and reopened on demand.
  */
 class AggregationReader : public CDMReader
 {
@@ -45,6 +52,17 @@ public:
         AGG_JOIN_NEW,
     } AggType;
 
+    //! function opening a member of the aggregation, called again each time the member has to be reopened
+    typedef std::function<CDMReader_p()> ReaderOpener;
+
+    //! a member of the aggregation which is opened on demand
+    struct LazyReader
+    {
+        ReaderOpener open;
+        std::string id;
+        std::string coordValue;
+    };
+
 public:
     AggregationReader(const std::string& aggregationType);
     ~AggregationReader();
@@ -53,7 +71,25 @@ public:
 
     void joinNewVars(const std::string& jnd, const std::set<std::string>& jnv) { joinNewDim = jnd; joinVars = jnv; } // jnd=ncml dimName; knv=ncml variableAgg
 
+    //! add a member which is kept open for the lifetime of the aggregation
     void addReader(CDMReader_p reader, const std::string& id, const std::string& coordValue);
+
+    /**
+     * Add members which are opened on demand.
+     *
+     * The members are opened in parallel to read their structure, and closed
+     * again. Members which are not among the recently used ones are closed
+     * when data is read from other members.
+     *
+     * @param readers the members, in aggregation order
+     * @param skipUnreadable if true, members which cannot be opened are logged and skipped, else the exception is passed on
+     */
+    void addReaders(const std::vector<LazyReader>& readers, bool skipUnreadable);
+
+    //! maximum number of members added with addReaders() kept open at the same time, at least 1
+    void setMaxOpenReaders(size_t maxOpenReaders);
+    size_t getMaxOpenReaders() const;
+
     void initAggregation();
 
     using CDMReader::getDataSlice;
@@ -63,28 +99,50 @@ public:
     static AggType aggTypeFromText(const std::string& aggType);
 
 private:
+    struct Member
+    {
+        std::string id;
+        //! structure of the member, kept while the member is closed
+        std::shared_ptr<const CDM> cdm;
+        //! null for members which are kept open
+        ReaderOpener open;
+        //! the reader, null if closed
+        CDMReader_p reader;
+        //! values of the unlimited coordinate variable, read once for joinExisting
+        DataPtr unLimCoord;
+    };
+
     void extendJoinedUnLimDimBy(size_t len, const std::string& coordValue);
 
-    void addFirstReader(CDMReader_p reader, const std::string& id, const std::string& coordValue);
-    void addOtherReader(CDMReader_p reader, const std::string& id, const std::string& coordValue);
+    void addMember(Member& member, const std::string& coordValue);
+    void addFirstReader(const CDM& rCdm, const std::string& id, const std::string& coordValue);
+    void addOtherReader(const CDM& rCdm, const std::string& id, const std::string& coordValue);
+    DataPtr readUnLimCoord(CDMReader_p reader) const;
 
-    CDMReader_p findJoinReader(size_t& unLimDimPos) const;
-    bool checkJoinExistingDims(CDMReader_p reader, const std::string& varName) const;
-    bool checkJoinNewDims(CDMReader_p reader, const std::string& varName) const;
+    CDMReader_p memberReader(size_t memberIdx);
 
-    CDMReader_p findUnionReader(const std::string& varName) const;
+    bool findJoinMember(size_t& unLimDimPos, size_t& memberIdx) const;
+    bool checkJoinExistingDims(const CDM& rCdm, const std::string& varName) const;
+    bool checkJoinNewDims(const CDM& rCdm, const std::string& varName) const;
+
+    CDMReader_p findUnionReader(const std::string& varName);
 
 private:
     AggType aggType_;
 
-    //! the readers as ordered in the aggregation
-    std::vector<std::pair<std::string, CDMReader_p>> readers_;
+    //! the members as ordered in the aggregation
+    std::vector<Member> members_;
+
+    //! indices of open members with an opener, most recently used first
+    std::list<size_t> openMembers_;
+    size_t maxOpenReaders_;
+    OmpMutex openMembersMutex_;
 
     std::string joinNewDim; // from ncml dimName
     std::vector<std::string> joinCoordValues;
     std::set<std::string> joinVars;
 
-    //! accumulated length of unlimited dimension for readers_
+    //! accumulated length of unlimited dimension for members_
     std::vector<size_t> readerUdimPos_;
 
     //! varName -> readerId, for "union" variables
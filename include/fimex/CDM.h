@@ -28,6 +28,7 @@
 #include "fimex/CDMDimension.h"
 #include "fimex/CDMVariable.h"
 #include "fimex/CDMconstants.h"
+#include "fimex/coordSys/CoordSysDecl.h"
 #include "fimex/coordSys/Projection.h"
 #include "fimex/deprecated.h"
 
@@ -76,6 +77,9 @@ public:
     /**
      * @brief get a reference of a variable
      *
+     * The variable may be changed through the reference, so this changes the
+     * structure version. Use the const version for reading.
+     *
      * @param varName name of the variable
      * @throw CDMException if varName doesn't exist
      */
@@ -162,6 +166,9 @@ public:
     /**
      * @brief get a reference to a dimension
      *
+     * The dimension may be changed through the reference, so this changes the
+     * structure version. Use the const version for reading.
+     *
      * @param dimName name of the dimension
      * @throw CDMException if dimension doesn't exist
      */
@@ -270,6 +277,35 @@ public:
      */
     const StrAttrVecMap& getAttributes() const;
 
+    /**
+     * @brief version of the structure of the CDM
+     *
+     * The version changes whenever dimensions, variables or attributes are added,
+     * removed or renamed, and whenever a non-const reference to a dimension, variable
+     * or attribute is requested. A copy of a CDM keeps the version of the original.
+     */
+    unsigned long getStructureVersion() const;
+
+    /**
+     * @brief get the coordinate systems cached by listCoordinateSystems()
+     *
+     * The cache is valid as long as the structure version is unchanged. The cache
+     * is not copied with the CDM.
+     *
+     * @param withReader true for coordinate systems found with a CDMReader, false for those found from the CDM alone
+     * @param coordSys set to the cached coordinate systems
+     * @return true if valid coordinate systems were cached
+     */
+    bool getCachedCoordinateSystems(bool withReader, CoordinateSystem_cp_v& coordSys) const;
+
+    /**
+     * @brief cache coordinate systems found by listCoordinateSystems() for the current structure
+     *
+     * @param withReader see getCachedCoordinateSystems()
+     * @param coordSys the coordinate systems
+     */
+    void setCachedCoordinateSystems(bool withReader, const CoordinateSystem_cp_v& coordSys);
+
     /**
      * @brief get the attributes of an variable
      * @param varName name of variable
@@ -279,6 +315,9 @@ public:
     /**
      * @brief get an attribute
      *
+     * The attribute may be changed through the reference, so this changes the
+     * structure version. Use the const version for reading.
+     *
      * @param varName name of variable
      * @param attrName name of attribute
      * @throw CDMException if varName attrName combination doesn't exists
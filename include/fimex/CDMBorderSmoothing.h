@@ -61,6 +61,21 @@ public:
 
         virtual double operator()(size_t curX, size_t curY, double valueI, double valueO) = 0;
 
+        /**
+         * Check if the smoothing is a position-dependent linear
+         * combination (1-w)*valueI + w*valueO, with w from weight(). Such
+         * smoothings are applied with a weight field computed once per
+         * horizontal size instead of calling operator() for each value.
+         */
+        virtual bool isLinear() const { return false; }
+
+        /**
+         * Weight of the outer value at a horizontal position, 0 for the
+         * inner value only, 1 for the outer value only. Only used if
+         * isLinear() returns true.
+         */
+        virtual double weight(size_t /*curX*/, size_t /*curY*/) const { return 0; }
+
         virtual ~Smoothing() {}
 
     protected:
@@ -43,6 +43,8 @@ public:
     CDMBorderSmoothing_Linear(size_t transitionWidth, size_t borderWidth)
         : transitionWidth_(transitionWidth), borderWidth_(borderWidth) { }
     virtual double operator()(size_t curX, size_t curY, double valueI, double valueO);
+    bool isLinear() const override { return true; }
+    double weight(size_t curX, size_t curY) const override;
 
 private:
     size_t transitionWidth_, borderWidth_;
@@ -48,12 +48,12 @@ private:
 
     /**
      * Helper functions to read slices of slices from the input-reader. Slices might be build with reduce-dimension
-     * or similar, and then reduced further through the getDataSlice(string, SliceBuilder) interface. The slices should be
-     * joined before returning with the joinSlices static function.
+     * or similar, and then reduced further through the getDataSlice(string, SliceBuilder) interface. Nearby positions
+     * are merged into chunks, the chunks are read in parallel and copied directly into the returned data.
      *
      * @param varName the variable name to fetch data from
      * @param sb the request of the dataslice
-     * @return slices return value, list of subslices building all data requested
+     * @return all data requested
      */
     DataPtr getDataSlice_(const std::string& varName, const SliceBuilder& sb);
 
@@ -66,6 +66,8 @@ public:
 
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos = 0) override;
     DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
+    /// chunk shape of the source, clipped to the reduced dimensions
+    std::vector<std::size_t> getChunkShape(const std::string& varName) const override;
 
     /**
      * @brief Remove a variable from the CDM
@@ -31,6 +31,7 @@
 #include "fimex/CrossSectionDefinition.h"
 #include "fimex/coordSys/CoordSysDecl.h"
 #include "fimex/deprecated.h"
+#include "fimex/mifi_constants.h"
 
 #include <map>
 #include <vector>
@@ -55,9 +56,13 @@ private:
     float relaxCrit_;
     float corrEff_;
     size_t maxLoop_;
+    int method_;
 public:
-    InterpolatorFill2d(float relaxCrit, float corrEff, size_t maxLoop)
-        : relaxCrit_(relaxCrit), corrEff_(corrEff), maxLoop_(maxLoop) {}
+    /**
+     * @param method one of MIFI_FILL2D_SOR, MIFI_FILL2D_REDBLACK or MIFI_FILL2D_MULTIGRID
+     */
+    InterpolatorFill2d(float relaxCrit, float corrEff, size_t maxLoop, int method = MIFI_FILL2D_SOR)
+        : relaxCrit_(relaxCrit), corrEff_(corrEff), maxLoop_(maxLoop), method_(method) {}
     void operator()(float* array, size_t nx, size_t ny) override;
 };
 
@@ -274,6 +279,30 @@ public:
      * @param dist distance in meter
      */
     virtual void setDistanceOfInterest(double dist);
+    /**
+     * set the minimum number of input points per kd-tree of the coord_kdtree
+     * interpolation. The input points are split into one kd-tree per thread,
+     * but only into parts of at least this size. The result does not depend
+     * on the number of parts. To have effect, this function must be set
+     * before calling changeProjection().
+     *
+     * @param partSize minimum number of points per kd-tree, default 65536
+     */
+    void setKDTreePartSize(std::size_t partSize);
+    /**
+     * set a directory to keep the geometry of interpolations (positions of
+     * the output points in the input grid, vector reprojection matrices)
+     * between runs. To have effect, this function must be set before calling
+     * changeProjection(). The default is taken from the environment variable
+     * FIMEX_INTERPOLATION_CACHE_DIR.
+     *
+     * @param directory cache directory, empty to disable the cache
+     */
+    void setGeometryCacheDirectory(const std::string& directory);
+    /**
+     * @return the directory set with setGeometryCacheDirectory(), or an empty string
+     */
+    std::string getGeometryCacheDirectory() const;
     /**
      * add a process to the internal list of preprocesses, run on fields before interpolation
      *
@@ -103,6 +103,7 @@ public:
 
     using CDMReader::getDataSlice;
     virtual DataPtr getDataSlice(const std::string &varName, std::size_t unLimDimPos);
+    virtual DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb);
 
 private:
     std::unique_ptr<CDMMergerPrivate> p;
@@ -60,6 +60,8 @@ public:
 
     using CDMReader::getDataSlice;
     virtual DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos = 0);
+    virtual DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb);
+    virtual std::vector<std::size_t> getChunkShape(const std::string& varName) const;
 
 private:
     CDMReader_p dataReader_;
@@ -92,6 +92,14 @@ public:
     void rotateDirectionToLatLon(bool toLatLon, const std::vector<std::string>& varNames);
     using CDMReader::getDataSlice;
     virtual DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos);
+    /**
+     * @brief retrieve data from the underlying dataReader, reading only the region requested by sb
+     */
+    virtual DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb);
+    /**
+     * @brief chunk shape of the variable in the underlying dataReader, if it exists there with the same rank
+     */
+    virtual std::vector<std::size_t> getChunkShape(const std::string& varName) const;
 
 private:
     struct CDMProcessorImpl;
@@ -73,6 +73,15 @@ public:
      * Read and manipulate the data
      */
     virtual DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos = 0);
+    /**
+     * Read and manipulate the data, reading only the region of sb from the
+     * data and status variables when the status-flags allow it
+     */
+    virtual DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb);
+    /**
+     * Chunk shape of the data-source, the shape of the variables is unchanged
+     */
+    virtual std::vector<std::size_t> getChunkShape(const std::string& varName) const;
     /**
      * Read the internals of statusVariable. This code is mainly thought for testing/debugging.
      */
@@ -86,6 +95,16 @@ public:
      */
     const std::map<std::string, std::vector<double> >& getVariableValues() const {return variableValues;}
 private:
+    /**
+     * Set data to the fill-value where statusData is not valid.
+     * @param undefinedLength length of the returned undefined data if both data and statusData are empty
+     */
+    DataPtr applyStatus(const std::string& varName, DataPtr data, DataPtr statusData, const CDM& cdmS, size_t undefinedLength);
+    /**
+     * Check if the status of varName can be evaluated on subsets of the data.
+     */
+    bool isStatusSliceable(const std::string& varName, const CDM& cdmS, const std::string& statusVar) const;
+
     const CDMReader_p dataReader;
     /* map of variableName to the variable which contains the flags */
     std::map<std::string, std::string> statusVariable;
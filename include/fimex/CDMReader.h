@@ -131,6 +131,18 @@ public:
      */
     virtual DataPtr getData(const std::string& varName);
 
+    /**
+     * @brief chunk shape of a variable in the underlying storage
+     *
+     * Reading slices aligned to the chunk boundaries avoids decompressing
+     * chunks several times, e.g. when setting up a SliceBuilder.
+     *
+     * @param varName name of the variable
+     * @return chunk size for each dimension of the variable, in the order of the variable-shape,
+     *   or an empty vector if the storage is not chunked or the chunking is unknown
+     */
+    virtual std::vector<std::size_t> getChunkShape(const std::string& varName) const;
+
     /**
      * @brief read and scale a dataslice
      *
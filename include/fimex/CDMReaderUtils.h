@@ -94,6 +94,21 @@ std::size_t estimateCDMDataSize(const CDM& cdm);
  */
 bool compareCDMVarShapes(const CDM& cdm1, const std::string& varName1, const CDM& cdm2, const std::string& varName2);
 
+/**
+ * chunk shape of a variable of a reader which reads the data of the variable from another reader,
+ * for implementing CDMReader::getChunkShape
+ *
+ * The chunk shape is clipped to the dimension lengths of the variable in cdm, i.e. when dimensions
+ * have been reduced. Dimensions are matched by position, so they may be renamed.
+ *
+ * @param source the reader providing the data
+ * @param sourceVarName name of the variable in the source
+ * @param cdm the CDM of the forwarding reader
+ * @param varName name of the variable in cdm
+ * @return the chunk shape, or an empty vector if unknown or if the number of dimensions differs
+ */
+std::vector<std::size_t> forwardChunkShape(const CDMReader& source, const std::string& sourceVarName, const CDM& cdm, const std::string& varName);
+
 
 /**
  * find a unique variable and dimension name, starting with baseVar
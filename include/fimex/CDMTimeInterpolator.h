@@ -54,6 +54,20 @@ public:
      */
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos = 0) override;
 
+    /**
+     * @brief retrieve data from the underlying dataReader and interpolate the values of the time-steps selected in sb
+     *
+     * Only the region selected in sb is read from the original time-steps, and original
+     * time-steps shared by several new time-steps are read only once.
+     *
+     * @param varName name of variable
+     * @param sb slice of the output, with time-positions as set in #changeTimeAxis
+     */
+    DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
+
+    /// chunk shape of the source, clipped to the new time dimension
+    std::vector<std::size_t> getChunkShape(const std::string& varName) const override;
+
     /**
      * change the time-axis from from the one given to a new specification
      * @param timeSpec string of time-specification
@@ -63,6 +77,8 @@ public:
     virtual void changeTimeAxis(const std::string& timeSpec);
 
 private:
+    bool isTimeAxisChanged(const std::string& timeAxis) const;
+
     CDMReader_p dataReader_;
 
     // map each new time-position to the closest time-positions in the old times
@@ -55,6 +55,18 @@ namespace MetNoFimex
 class CDMVerticalInterpolator: public MetNoFimex::CDMReader
 {
 public:
+    /// counters for the cache of vertical fields
+    struct CacheStatistics
+    {
+        CacheStatistics();
+        /// number of vertical field requests
+        size_t requests;
+        /// number of vertical field requests served from the cache
+        size_t hits;
+        /// number of vertical fields removed to keep the cache bounded
+        size_t evictions;
+    };
+
     /**
      * Initialize a vertical interpolator.
      *
@@ -72,6 +84,17 @@ public:
     void interpolateToAxis(const std::string& vAxis);
     void interpolateByTemplateVariable(const std::string& tv);
 
+    /**
+     * Set the maximum number of vertical fields (e.g. the 3d pressure for
+     * one coordinate system and time step) kept in memory. The fields are
+     * shared by all variables with the same coordinate system. Default is 8,
+     * 0 disables the cache.
+     */
+    void setVerticalCacheSize(size_t maxFields);
+
+    /// get a copy of the current counters of the vertical field cache
+    CacheStatistics getCacheStatistics() const;
+
     using CDMReader::getDataSlice;
     /**
      * retrieve data from the underlying dataReader and interpolate the values to the new vertical levels
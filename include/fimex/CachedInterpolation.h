@@ -30,6 +30,8 @@
 
 #include "fimex/SharedArray.h"
 
+#include <vector>
+
 namespace MetNoFimex
 {
 
@@ -126,7 +128,17 @@ class CachedInterpolation : public CachedInterpolationInterface
 private:
     shared_array<double> pointsOnXAxis;
     shared_array<double> pointsOnYAxis;
-    int (*func)(const float* infield, float* outvalues, const double x, const double y, const int ix, const int iy, const int iz);
+    int funcType;
+
+    // stencil of each output point in the input layer, structure of arrays;
+    // bilinear: 4 indices and weights for x and y, bicubic: index of the
+    // first of 4x4 points and the 4 weights for x and y
+    std::vector<size_t> stencilIndex[4];
+    std::vector<float> bilinearWeightX[2];
+    std::vector<float> bilinearWeightY[2];
+    std::vector<double> bicubicWeightX[4];
+    std::vector<double> bicubicWeightY[4];
+
 public:
     /**
      * @param funcType {@link interpolation.h} interpolation method
@@ -155,6 +167,12 @@ private:
      * It should be run immediately after creating the CachedInterpolation.
      */
     void createReducedDomain(const std::string& xDimName, const std::string& yDimName);
+
+    /**
+     * Compute the stencil indices and weights from pointsOnXAxis and pointsOnYAxis,
+     * giving the same results as mifi_get_values_bilinear_f and mifi_get_values_bicubic_f.
+     */
+    void createStencils();
 };
 
 /**
@@ -57,6 +57,18 @@ public:
      */
     void reprojectDirectionValues(shared_array<float>& angles, size_t size) const;
 
+    /**
+     * Create a reprojection for a rectangular part of the spatial plane,
+     * e.g. to reproject values read with a SliceBuilder.
+     *
+     * @param xStart first position in x-direction
+     * @param xSize number of positions in x-direction
+     * @param yStart first position in y-direction
+     * @param ySize number of positions in y-direction
+     * @throw CDMException if the part is outside of the spatial plane
+     */
+    std::shared_ptr<CachedVectorReprojection> subset(size_t xStart, size_t xSize, size_t yStart, size_t ySize) const;
+
     // @return size of the spatial plane in x-direction
     size_t getXSize() const {return ox;}
 
@@ -176,6 +176,17 @@ public:
      */
 DataPtr createData(CDMDataType datatype, size_t length, double val = 0);
 
+/**
+ * @brief create a Data-pointer of the datatype without initializing the values
+ *
+ * Use only if all values are set before the data is used.
+ *
+ * @param datatype
+ * @param length of the data array
+ * @return Base-Class ptr of the DataImpl belonging to the datatype
+ */
+DataPtr createDataUninitialized(CDMDataType datatype, size_t length);
+
 /**
      * @brief create a Data-pointer of type CDM_DOUBLE
      *
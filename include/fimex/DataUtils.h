@@ -30,6 +30,8 @@
 #include "fimex/CDMDataType.h"
 #include "fimex/DataDecl.h"
 
+#include <algorithm>
+
 namespace MetNoFimex {
 
 /**
@@ -59,8 +61,32 @@ public:
         // => ((oldScale_*in + oldOffsetMinusNewOffset_)*newScaleInv_);
         // => oldScaleNewScale_ * in + oldOffsetMinusNewOffsetNewScale_
     }
+
+    IN oldFill() const { return oldFill_; }
+    /// combined scale, out = scale() * in + offset()
+    double scale() const { return oldScaleNewScaleInv_; }
+    /// combined offset, out = scale() * in + offset()
+    double offset() const { return oldOffsetMinusNewOffsetNewScaleInv_; }
+    OUT newFill() const { return newFill_; }
 };
 
+/**
+ * Scale the values in [begin, end) to out, as std::transform with ScaleValue.
+ *
+ * The overloads for common type-pairs use vectorized loops, compiled also for
+ * avx2 with runtime dispatch where the compiler supports it.
+ */
+template <typename IN, typename OUT>
+void scaleValues(const IN* begin, const IN* end, OUT* out, const ScaleValue<IN, OUT>& sv)
+{
+    std::transform(begin, end, out, sv);
+}
+void scaleValues(const short* begin, const short* end, float* out, const ScaleValue<short, float>& sv);
+void scaleValues(const short* begin, const short* end, double* out, const ScaleValue<short, double>& sv);
+void scaleValues(const float* begin, const float* end, double* out, const ScaleValue<float, double>& sv);
+void scaleValues(const double* begin, const double* end, float* out, const ScaleValue<double, float>& sv);
+void scaleValues(const float* begin, const float* end, short* out, const ScaleValue<float, short>& sv);
+
 /**
  * Scale a value using fill, offset and scale, and a units-converter
  */
@@ -92,6 +118,28 @@ public:
         return (in == oldFill_ || mifi_isnan<IN>(in)) ? newFill_
                                                       : data_caster<OUT, double>()((uconv_->convert(oldScale_ * in + oldOffset_) - newOffset_) * newScaleInv_);
     }
+
+    /**
+     * Scale the values in [begin, end) to out. The units are converted
+     * in blocks, calling the units-converter once per block.
+     */
+    void operator()(const IN* begin, const IN* end, OUT* out) const
+    {
+        const size_t BLOCK = 4096;
+        double values[BLOCK];
+        while (begin < end) {
+            const size_t n = std::min(BLOCK, static_cast<size_t>(end - begin));
+            for (size_t i = 0; i < n; ++i)
+                values[i] = oldScale_ * begin[i] + oldOffset_;
+            uconv_->convert(values, values, n);
+            for (size_t i = 0; i < n; ++i) {
+                const IN& in = begin[i];
+                out[i] = (in == oldFill_ || mifi_isnan<IN>(in)) ? newFill_ : data_caster<OUT, double>()((values[i] - newOffset_) * newScaleInv_);
+            }
+            begin += n;
+            out += n;
+        }
+    }
 };
 
 /**
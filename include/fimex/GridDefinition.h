@@ -115,6 +115,9 @@ public:
     double getLatStart() const { return latStart_; }
     void setLatStart(double latStart) { latStart_ = latStart; }
 
+    /// resolution in degree used to compare lon/lat start, negative if the start is compared with the x/y start
+    double getLonLatResolution() const { return lonLatResolution_; }
+
     Orientation getScanMode() const { return orientation_; }
     void setScanMode(Orientation orient) { orientation_ = orient; }
 
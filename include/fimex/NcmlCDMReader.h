@@ -118,6 +118,10 @@ public:
      * reading the data from the required source with SliceBuilder
      */
     virtual DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb);
+    /**
+     * chunk shape of the variable in the source, for renamed variables, too
+     */
+    virtual std::vector<std::size_t> getChunkShape(const std::string& varName) const;
 
 
 private:
@@ -28,6 +28,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace MetNoFimex {
 
@@ -48,6 +49,8 @@ namespace MetNoFimex {
 class TimeUnit
 {
     std::shared_ptr<void> pUnit; // pointer to unit implementation
+    std::shared_ptr<void> pToSeconds; // converter from unit to udunits calendar seconds
+    std::shared_ptr<void> pFromSeconds; // converter from udunits calendar seconds to unit
     double epochOffset;
     double epochSlope;
 public:
@@ -75,6 +78,22 @@ public:
      */
     double fimexTime2unitTime(const FimexTime& fiTime, double invalidValue) const;
 
+    /// calculate the calendar form of n times in the current unit
+    std::vector<FimexTime> unitTimes2fimexTimes(const double* unitTimes, size_t n) const;
+
+    /// calculate the calendar form of times in the current unit
+    std::vector<FimexTime> unitTimes2fimexTimes(const std::vector<double>& unitTimes) const;
+
+    /*! calculate the times in the current unit from the calendar form
+     * \returns NaN for invalid times
+     */
+    std::vector<double> fimexTimes2unitTimes(const std::vector<FimexTime>& fiTimes) const;
+
+    /*! calculate the times in the current unit from the calendar form
+     * \returns invalidValue for invalid times
+     */
+    std::vector<double> fimexTimes2unitTimes(const std::vector<FimexTime>& fiTimes, double invalidValue) const;
+
 private:
     void init(const std::string& timeUnitString = "seconds since 1970-01-01 00:00:00");
 };
@@ -28,6 +28,8 @@
 
 #include "fimex/UnitsConverterDecl.h"
 
+#include <cstddef>
+
 namespace MetNoFimex
 {
 
@@ -48,6 +50,19 @@ public:
     virtual double convert(double from) = 0;
     virtual float convert(float from) = 0;
 
+    /**
+     * convert an array of values from the input unit to an output-unit
+     *
+     * The default implementation converts value by value, implementations should
+     * override this to convert the whole block at once.
+     *
+     * @param from values in the 'from' unit
+     * @param to output array for values in the 'to' unit, may be the same as from
+     * @param count number of values
+     */
+    virtual void convert(const double* from, double* to, size_t count);
+    virtual void convert(const float* from, float* to, size_t count);
+
     /**
      * check if the converter is linear (representable by scale & offset)
      */
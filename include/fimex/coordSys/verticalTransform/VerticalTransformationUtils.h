@@ -119,6 +119,8 @@ ArrayDims makeArrayDims(const SliceBuilder& sb);
 VerticalConverter_p verticalConverter(CoordinateSystem_cp cs, CDMReader_p reader, int verticalType);
 DataPtr verticalData4D(VerticalConverter_p converter, const CDM& cdm, size_t unLimDimPos);
 DataPtr verticalData4D(CoordinateSystem_cp cs, CDMReader_p reader, size_t unLimDimPos, int verticalType);
+DataPtr verticalData4D(VerticalConverter_p converter, const CDM& cdm, const SliceBuilder& sb);
+DataPtr verticalData4D(CoordinateSystem_cp cs, CDMReader_p reader, const SliceBuilder& sb, int verticalType);
 
 DataPtr checkSize(DataPtr data, size_t expected, const std::string& what);
 DataPtr checkData(DataPtr data, size_t expected, const std::string& what);
@@ -252,6 +252,44 @@ extern int mifi_points2position(double* points, const int n, const double* axis,
  */
 extern int mifi_fill2d_f(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop, size_t* nChanged);
 
+/**
+ * @brief Method to fill undefined values in a 2d field, parallel version
+ *
+ * Same as mifi_fill2d_f, but relaxing the field in red-black (checkerboard)
+ * order, which allows to use several threads for one field. The results
+ * differ from mifi_fill2d_f within the relaxation criteria.
+ *
+ * @param nx size of field in x-direction
+ * @param ny size of field in x-direction
+ * @param field the data-field to be filled (input/output)
+ * @param relaxCrit relaxation criteria. Usually 4 orders of magnitude lower than data in field.
+ * @param corrEff Coef. of overrelaxation, between +1.2 and +2.0
+ * @param maxLoop Max. allowed no. of scans in relaxation procedure.
+ * @param nChanged number of changed values (output)
+ * @return error-code, usually MIFI_OK
+ */
+extern int mifi_fill2d_redblack_f(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop, size_t* nChanged);
+
+/**
+ * @brief Method to fill undefined values in a 2d field, multigrid version
+ *
+ * Same as mifi_fill2d_redblack_f, but the relaxation is preceded by
+ * multigrid V-cycles, correcting the smooth part of the error on grids
+ * of halved resolution. Large undefined areas then need only a fraction
+ * of the relaxation scans, and the result is usually closer to the
+ * converged solution than with mifi_fill2d_f.
+ *
+ * @param nx size of field in x-direction
+ * @param ny size of field in x-direction
+ * @param field the data-field to be filled (input/output)
+ * @param relaxCrit relaxation criteria. Usually 4 orders of magnitude lower than data in field.
+ * @param corrEff Coef. of overrelaxation, between +1.2 and +2.0
+ * @param maxLoop Max. allowed no. of V-cycles and of scans in the final relaxation procedure.
+ * @param nChanged number of changed values (output)
+ * @return error-code, usually MIFI_OK
+ */
+extern int mifi_fill2d_multigrid_f(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop, size_t* nChanged);
+
 /**
  * @brief Method to fill undefined values in a 2d field in stable time.
  *
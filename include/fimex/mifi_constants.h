@@ -159,6 +159,25 @@ enum mifi_interpol_method {
  */
 #define MIFI_VECTOR_RESIZE    1
 
+/**
+ * @brief fill2d method
+ *
+ * relaxation row by row, see mifi_fill2d_f
+ */
+#define MIFI_FILL2D_SOR 0
+/**
+ * @brief fill2d method
+ *
+ * parallel relaxation in red-black order, see mifi_fill2d_redblack_f
+ */
+#define MIFI_FILL2D_REDBLACK 1
+/**
+ * @brief fill2d method
+ *
+ * multigrid V-cycles followed by red-black relaxation, see mifi_fill2d_multigrid_f
+ */
+#define MIFI_FILL2D_MULTIGRID 2
+
 
 /**
  * @brief vertical interpolation type
@@ -32,7 +32,9 @@
 #include "fimex/StringUtils.h"
 #include "fimex/Type2String.h"
 
+#include <algorithm>
 #include <cassert>
+#include <exception>
 #include <memory>
 #include <regex>
 
@@ -42,6 +44,8 @@ namespace {
 
 Logger_p logger = getLogger("fimex.AggregationReader");
 
+const size_t DEFAULT_MAX_OPEN_READERS = 32;
+
 } // namespace
 
 AggregationReader::AggType AggregationReader::aggTypeFromText(const std::string& aggType)
@@ -59,6 +63,7 @@ AggregationReader::AggType AggregationReader::aggTypeFromText(const std::string&
 
 AggregationReader::AggregationReader(const std::string& aggregationType)
     : aggType_(aggTypeFromText(aggregationType))
+    , maxOpenReaders_(DEFAULT_MAX_OPEN_READERS)
 {
 }
 
@@ -90,23 +95,137 @@ getData
 
 void AggregationReader::addReader(CDMReader_p reader, const std::string& id, const std::string& coordValue)
 {
-    auto id_ = id;
+    Member member;
+    member.id = id;
+    member.cdm = std::shared_ptr<const CDM>(reader, &reader->getCDM());
+    member.reader = reader;
+    member.unLimCoord = readUnLimCoord(reader);
+    addMember(member, coordValue);
+}
+
+void AggregationReader::addReaders(const std::vector<LazyReader>& readers, bool skipUnreadable)
+{
+    // open all members in parallel to read their structure
+    const long nReaders = readers.size();
+    std::vector<Member> members(nReaders);
+    std::vector<std::exception_ptr> errors(nReaders);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (long i = 0; i < nReaders; ++i) {
+        try {
+            CDMReader_p reader = readers[i].open();
+            if (!reader)
+                throw CDMException("cannot open aggregation member '" + readers[i].id + "'");
+            members[i].cdm = std::make_shared<const CDM>(reader->getCDM());
+            members[i].unLimCoord = readUnLimCoord(reader);
+            // the reader is closed here and reopened when data is read
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
+
+    for (long i = 0; i < nReaders; ++i) {
+        if (errors[i]) {
+            if (!skipUnreadable)
+                std::rethrow_exception(errors[i]);
+            try {
+                std::rethrow_exception(errors[i]);
+            } catch (CDMException& ex) {
+                LOG4FIMEX(logger, Logger::ERROR, "cannot open aggregation member '" << readers[i].id << "': " << ex.what());
+                continue;
+            }
+        }
+        members[i].id = readers[i].id;
+        members[i].open = readers[i].open;
+        addMember(members[i], readers[i].coordValue);
+    }
+}
+
+void AggregationReader::setMaxOpenReaders(size_t maxOpenReaders)
+{
+    OmpScopedLock lock(openMembersMutex_);
+    maxOpenReaders_ = std::max(maxOpenReaders, size_t(1));
+    while (openMembers_.size() > maxOpenReaders_) {
+        members_[openMembers_.back()].reader = nullptr;
+        openMembers_.pop_back();
+    }
+}
+
+size_t AggregationReader::getMaxOpenReaders() const
+{
+    return maxOpenReaders_;
+}
+
+DataPtr AggregationReader::readUnLimCoord(CDMReader_p reader) const
+{
+    // the joined coordinate is collected once, instead of opening all members when it is read
+    if (aggType_ == AGG_JOIN_EXISTING) {
+        const CDM& rCdm = reader->getCDM();
+        if (const auto* rUdim = rCdm.getUnlimitedDim()) {
+            if (rCdm.hasVariable(rUdim->getName()))
+                return reader->getData(rUdim->getName());
+        }
+    }
+    return nullptr;
+}
+
+void AggregationReader::addMember(Member& member, const std::string& coordValue)
+{
+    auto id_ = member.id;
     if (!id_.empty()) {
-        id_ = "reader_" + type2string(readers_.size());
+        id_ = "reader_" + type2string(members_.size());
     }
-    readers_.push_back(std::make_pair(id, reader));
+    members_.push_back(member);
 
-    if (readers_.size() == 1) {
-        addFirstReader(reader, id_, coordValue);
+    const CDM& rCdm = *members_.back().cdm;
+    if (members_.size() == 1) {
+        addFirstReader(rCdm, id_, coordValue);
     } else {
-        addOtherReader(reader, id_, coordValue);
+        addOtherReader(rCdm, id_, coordValue);
     }
 }
 
-void AggregationReader::addFirstReader(CDMReader_p reader, const std::string& id, const std::string& coordValue)
+CDMReader_p AggregationReader::memberReader(size_t memberIdx)
+{
+    Member& member = members_.at(memberIdx);
+    {
+        OmpScopedLock lock(openMembersMutex_);
+        if (member.reader) {
+            if (member.open) {
+                const auto it = std::find(openMembers_.begin(), openMembers_.end(), memberIdx);
+                if (it != openMembers_.end())
+                    openMembers_.splice(openMembers_.begin(), openMembers_, it);
+            }
+            return member.reader;
+        }
+    }
+
+    // open outside the lock, opening may be slow on network filesystems
+    LOG4FIMEX(logger, Logger::DEBUG, "opening aggregation member '" << member.id << "'");
+    CDMReader_p reader = member.open();
+    if (!reader)
+        throw CDMException("cannot open aggregation member '" + member.id + "'");
+
+    OmpScopedLock lock(openMembersMutex_);
+    if (member.reader) {
+        // opened by another thread meanwhile
+        return member.reader;
+    }
+    member.reader = reader;
+    openMembers_.push_front(memberIdx);
+    while (openMembers_.size() > maxOpenReaders_) {
+        // readers still in use keep their files open until they are done
+        members_[openMembers_.back()].reader = nullptr;
+        openMembers_.pop_back();
+    }
+    return reader;
+}
+
+void AggregationReader::addFirstReader(const CDM& rCdm, const std::string& id, const std::string& coordValue)
 {
     // start out with CDM of first reader
-    *cdm_ = readers_.front().second->getCDM();
+    *cdm_ = rCdm;
 
     if (aggType_ == AGG_JOIN_EXISTING) {
         if (const auto* uDim = cdm_->getUnlimitedDim()) {
@@ -195,12 +314,11 @@ void copyVar(const CDM& from, const CDMVariable& fromVar, CDM& to)
 
 } // namespace
 
-void AggregationReader::addOtherReader(CDMReader_p reader, const std::string& id, const std::string& coordValue)
+void AggregationReader::addOtherReader(const CDM& rCdm, const std::string& id, const std::string& coordValue)
 {
     CDM& aCdm = *cdm_;
     auto* aUdim = aCdm.getUnlimitedDim();
 
-    auto& rCdm = reader->getCDM();
     auto* rUdim = rCdm.getUnlimitedDim();
 
     if (aggType_ == AGG_JOIN_EXISTING) {
@@ -273,7 +391,7 @@ void AggregationReader::addOtherReader(CDMReader_p reader, const std::string& id
 
     // remaining variables are treated as for "union"
 
-    const size_t readerIndex = readers_.size() - 1;
+    const size_t readerIndex = members_.size() - 1;
     for (const auto& rVar : rCdm.getVariables()) {
         const auto& rVarName = rVar.getName();
 
@@ -318,6 +436,23 @@ void AggregationReader::addOtherReader(CDMReader_p reader, const std::string& id
 void AggregationReader::initAggregation()
 {
     if (joinCoordValues.empty()) {
+        if (aggType_ == AGG_JOIN_EXISTING && cdm_->getUnlimitedDim()) {
+            // join the coordinate values collected when adding the members
+            const auto& joinName = cdm_->getUnlimitedDim()->getName();
+            if (cdm_->hasVariable(joinName) && joinVars.count(joinName)) {
+                auto& joinVar = cdm_->getVariable(joinName);
+                DataPtr joinData = createData(joinVar.getDataType(), readerUdimPos_.back(), cdm_->getFillValue(joinName));
+                for (size_t i = 0; i < members_.size(); ++i) {
+                    const size_t before = (i == 0) ? 0 : readerUdimPos_[i - 1];
+                    const DataPtr& coord = members_[i].unLimCoord;
+                    if (coord && coord->size() == readerUdimPos_[i] - before && checkJoinExistingDims(*members_[i].cdm, joinName))
+                        joinData->setValues(before, *coord);
+                }
+                joinVar.setData(joinData);
+            }
+        }
+        for (auto& member : members_)
+            member.unLimCoord = nullptr;
         return;
     }
     if (aggType_ == AGG_JOIN_NEW) {
@@ -343,36 +478,35 @@ void AggregationReader::initAggregation()
     }
 }
 
-CDMReader_p AggregationReader::findJoinReader(size_t& unLimDimPos) const
+bool AggregationReader::findJoinMember(size_t& unLimDimPos, size_t& memberIdx) const
 {
     const auto it = std::upper_bound(readerUdimPos_.begin(), readerUdimPos_.end(), unLimDimPos);
     if (it == readerUdimPos_.end()) {
         // out of bounds for unlimited dim
-        return nullptr;
+        return false;
     }
 
-    const size_t idx = std::distance(readerUdimPos_.begin(), it);
+    memberIdx = std::distance(readerUdimPos_.begin(), it);
     const size_t before = it == readerUdimPos_.begin() ? 0 : *(it - 1);
     unLimDimPos -= before;
-    return readers_[idx].second;
+    return true;
 }
 
-bool AggregationReader::checkJoinExistingDims(CDMReader_p reader, const std::string& varName) const
+bool AggregationReader::checkJoinExistingDims(const CDM& rCdm, const std::string& varName) const
 {
-    const auto& rCdm = reader->getCDM();
     if (!rCdm.hasVariable(varName)) {
         return false;
     }
 
     const auto& rShape = rCdm.getVariable(varName).getShape();
-    if (rShape != cdm_->getVariable(varName).getShape()) {
+    if (rShape != getCDM().getVariable(varName).getShape()) {
         return false;
     }
 
     const auto& rUdim = rCdm.getUnlimitedDim();
     for (const auto& dim : rShape) {
         if (!rUdim || dim != rUdim->getName()) {
-            if (cdm_->getDimension(dim).getLength() != rCdm.getDimension(dim).getLength()) {
+            if (getCDM().getDimension(dim).getLength() != rCdm.getDimension(dim).getLength()) {
                 return false;
             }
         }
@@ -381,14 +515,13 @@ bool AggregationReader::checkJoinExistingDims(CDMReader_p reader, const std::str
     return true;
 }
 
-bool AggregationReader::checkJoinNewDims(CDMReader_p reader, const std::string& varName) const
+bool AggregationReader::checkJoinNewDims(const CDM& rCdm, const std::string& varName) const
 {
-    const auto& rCdm = reader->getCDM();
     if (!rCdm.hasVariable(varName)) {
         return false;
     }
 
-    auto aShape = cdm_->getVariable(varName).getShape();
+    auto aShape = getCDM().getVariable(varName).getShape();
     aShape.pop_back();
 
     const auto& rShape = rCdm.getVariable(varName).getShape();
@@ -397,7 +530,7 @@ bool AggregationReader::checkJoinNewDims(CDMReader_p reader, const std::string&
     }
 
     for (const auto& dim : rShape) {
-        if (cdm_->getDimension(dim).getLength() != rCdm.getDimension(dim).getLength()) {
+        if (getCDM().getDimension(dim).getLength() != rCdm.getDimension(dim).getLength()) {
             return false;
         }
     }
@@ -405,12 +538,11 @@ bool AggregationReader::checkJoinNewDims(CDMReader_p reader, const std::string&
     return true;
 }
 
-CDMReader_p AggregationReader::findUnionReader(const std::string& varName) const
+CDMReader_p AggregationReader::findUnionReader(const std::string& varName)
 {
     const auto it = unionReaders_.find(varName);
     if (it != unionReaders_.end()) {
-        const auto& id_rd = readers_.at(it->second);
-        return id_rd.second;
+        return memberReader(it->second);
     }
     return nullptr;
 }
@@ -418,36 +550,38 @@ CDMReader_p AggregationReader::findUnionReader(const std::string& varName) const
 DataPtr AggregationReader::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "getDataSlice(var,uDim): (" << varName << "," << unLimDimPos << ")");
-    const CDMVariable& aVar = cdm_->getVariable(varName);
+    const CDMVariable& aVar = getCDM().getVariable(varName);
     if (aVar.hasData()) {
         return getDataSliceFromMemory(aVar, unLimDimPos);
     }
 
     if (joinVars.count(varName)) {
-        if (auto rd = findJoinReader(unLimDimPos)) {
+        size_t memberIdx;
+        if (findJoinMember(unLimDimPos, memberIdx)) {
+            const CDM& rCdm = *members_[memberIdx].cdm;
             if (aggType_ == AGG_JOIN_EXISTING) {
-                if (checkJoinExistingDims(rd, varName)) {
-                    return rd->getDataSlice(varName, unLimDimPos);
+                if (checkJoinExistingDims(rCdm, varName)) {
+                    return memberReader(memberIdx)->getDataSlice(varName, unLimDimPos);
                 } else {
                     auto aUdim = cdm_->getUnlimitedDim();
                     size_t unLimSliceSize = 1;
                     for (const auto& dim : aVar.getShape()) {
                         if (!aUdim || dim != aUdim->getName()) {
-                            unLimSliceSize *= cdm_->getDimension(dim).getLength();
+                            unLimSliceSize *= getCDM().getDimension(dim).getLength();
                         }
                     }
                     return createData(aVar.getDataType(), unLimSliceSize, cdm_->getFillValue(varName));
                 }
             } else if (aggType_ == AGG_JOIN_NEW) {
-                if (checkJoinNewDims(rd, varName)) {
+                if (checkJoinNewDims(rCdm, varName)) {
                     // read everything
-                    SliceBuilder sb(rd->getCDM(), varName);
-                    return rd->getDataSlice(varName, sb);
+                    SliceBuilder sb(rCdm, varName);
+                    return memberReader(memberIdx)->getDataSlice(varName, sb);
                 } else {
                     // set everything to fillValue
                     size_t unLimSliceSize = 1;
                     for (const auto& dim : aVar.getShape()) {
-                        unLimSliceSize *= cdm_->getDimension(dim).getLength();
+                        unLimSliceSize *= getCDM().getDimension(dim).getLength();
                     }
                     return createData(aVar.getDataType(), unLimSliceSize, cdm_->getFillValue(varName));
                 }
@@ -469,7 +603,7 @@ DataPtr AggregationReader::getDataSlice(const std::string& varName, size_t unLim
 DataPtr AggregationReader::getDataSlice(const std::string& varName, const SliceBuilder& sb)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "getDataSlice(var,sb): (" << varName << ", sb)");
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData())
         return getDataSliceFromMemory(variable, sb);
 
@@ -503,11 +637,13 @@ DataPtr AggregationReader::getDataSlice(const std::string& varName, const SliceB
         DataPtr retData = createData(variable.getDataType(), unLimSliceSize * unLimDimSize, cdm_->getFillValue(varName));
         for (size_t i = 0; i < unLimDimSize; ++i) {
             size_t unLimDimPos = unLimDimStart + i;
-            if (auto reader = findJoinReader(unLimDimPos)) {
+            size_t memberIdx;
+            if (findJoinMember(unLimDimPos, memberIdx)) {
+                const CDM& rCdm = *members_[memberIdx].cdm;
                 DataPtr sliceData;
                 if (aggType_ == AGG_JOIN_EXISTING) {
-                    if (checkJoinExistingDims(reader, varName)) {
-                        SliceBuilder sbi(reader->getCDM(), varName);
+                    if (checkJoinExistingDims(rCdm, varName)) {
+                        SliceBuilder sbi(rCdm, varName);
                         for (size_t j = 0; j < dimNames.size(); ++j) {
                             if (dimNames[j] == uDimName) {
                                 sbi.setStartAndSize(dimNames[j], unLimDimPos, 1);
@@ -515,17 +651,17 @@ DataPtr AggregationReader::getDataSlice(const std::string& varName, const SliceB
                                 sbi.setStartAndSize(dimNames[j], dimStart[j], dimSize[j]);
                             }
                         }
-                        sliceData = reader->getDataSlice(varName, sbi);
+                        sliceData = memberReader(memberIdx)->getDataSlice(varName, sbi);
                     }
                 } else if (aggType_ == AGG_JOIN_NEW) {
-                    if (checkJoinNewDims(reader, varName)) {
-                        SliceBuilder sbi(reader->getCDM(), varName);
+                    if (checkJoinNewDims(rCdm, varName)) {
+                        SliceBuilder sbi(rCdm, varName);
                         for (size_t j = 0; j < dimNames.size(); ++j) {
                             if (dimNames[j] != uDimName) {
                                 sbi.setStartAndSize(dimNames[j], dimStart[j], dimSize[j]);
                             }
                         }
-                        sliceData = reader->getDataSlice(varName, sbi);
+                        sliceData = memberReader(memberIdx)->getDataSlice(varName, sbi);
                     }
                 }
                 if (sliceData && sliceData->size() != 0) {
@@ -27,6 +27,7 @@
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
 #include "fimex/MathUtils.h"
+#include "fimex/MutexLock.h"
 #include "fimex/Units.h"
 #include "fimex/coordSys/CoordinateSystem.h"
 #include "fimex/coordSys/Projection.h"
@@ -35,9 +36,11 @@
 #include "fimex/reproject.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <regex>
 #include <set>
+#include <unordered_map>
 
 namespace MetNoFimex
 {
@@ -97,30 +100,100 @@ public:
     }
 };
 
+struct CoordSysCache {
+    bool valid;
+    unsigned long version;
+    CoordinateSystem_cp_v coordSystems;
+
+    CoordSysCache()
+        : valid(false)
+        , version(0)
+    {
+    }
+};
+
+typedef std::unordered_map<std::string, size_t> NameIndex;
+
 struct CDMImpl {
     CDM::StrAttrVecMap attributes;
     CDM::VarVec variables;
     CDM::DimVec dimensions;
-    bool coordsInitialized;
-    CoordinateSystem_cp_v coordSystems;
+    // name -> position in variables/dimensions, names must only change through rename*
+    NameIndex variableIndex;
+    NameIndex dimensionIndex;
+    std::atomic<unsigned long> version;
+    // coordinate systems found from the CDM alone [0] and with a CDMReader [1]
+    CoordSysCache coordSysCache[2];
 
     CDMImpl()
-        : coordsInitialized(false)
+        : version(0)
+    {
+    }
+
+    // copies start with an empty coordinate system cache
+    CDMImpl(const CDMImpl& rhs)
+        : attributes(rhs.attributes)
+        , variables(rhs.variables)
+        , dimensions(rhs.dimensions)
+        , variableIndex(rhs.variableIndex)
+        , dimensionIndex(rhs.dimensionIndex)
+        , version(rhs.version.load())
     {
     }
 };
 
-static void enhance(CDMImpl* pimpl, const CDM& cdm)
+namespace {
+
+std::atomic<unsigned long> nextStructureVersion(0);
+
+// protects the coordinate system caches of all CDMs
+OmpMutex coordSysCacheMutex;
+
+void structureChanged(CDMImpl* pimpl)
 {
-    if (!pimpl->coordsInitialized) {
-        // TODO: all functions requiring the 'enhance' step should be deprecated
-        //       since 'enhancing' cannot be done by the CDM alone and it is a source
-        //       for race-conditions...
-        pimpl->coordSystems = listCoordinateSystems(cdm);
-        pimpl->coordsInitialized = true;
-    }
+    pimpl->version = ++nextStructureVersion;
+}
+
+template <class T>
+void rebuildIndex(const std::vector<T>& entities, NameIndex& index)
+{
+    index.clear();
+    for (size_t i = 0; i < entities.size(); ++i)
+        index[entities[i].getName()] = i;
+}
+
+template <class T>
+const T* findByName(const std::vector<T>& entities, const NameIndex& index, const std::string& name)
+{
+    const NameIndex::const_iterator it = index.find(name);
+    if (it == index.end())
+        return nullptr;
+    assert(it->second < entities.size() && entities[it->second].getName() == name);
+    return &entities[it->second];
+}
+
+const CDMAttribute* findAttribute(const CDMImpl* pimpl, const std::string& varName, const std::string& attrName)
+{
+    CDM::StrAttrVecMap::const_iterator varIt = pimpl->attributes.find(varName);
+    if (varIt == pimpl->attributes.end())
+        return nullptr;
+    // attributes per variable are few, a linear search is fine
+    CDM::AttrVec::const_iterator attrIt = find_if(varIt->second.begin(), varIt->second.end(), CDMNameEqual(attrName));
+    if (attrIt == varIt->second.end())
+        return nullptr;
+    return &*attrIt;
 }
 
+// cached by listCoordinateSystems
+CoordinateSystem_cp_v coordinateSystems(const CDM& cdm)
+{
+    // TODO: all functions requiring the coordinate systems should be deprecated
+    //       since they cannot be detected by the CDM alone
+    return listCoordinateSystems(cdm);
+}
+
+} // namespace
+
 CDM::CDM()
     : pimpl_(new CDMImpl())
 {
@@ -145,8 +218,9 @@ CDM& CDM::operator=(const CDM& rhs)
 void CDM::addVariable(const CDMVariable& var)
 {
     // TODO: check var.dims for existence!!!
-    pimpl_->coordsInitialized = false;
+    structureChanged(pimpl_.get());
     if (!hasVariable(var.getName())) {
+        pimpl_->variableIndex[var.getName()] = pimpl_->variables.size();
         pimpl_->variables.push_back(var);
     } else {
         throw CDMException("cannot add variable: " + var.getName() + " already exists");
@@ -154,20 +228,21 @@ void CDM::addVariable(const CDMVariable& var)
 }
 bool CDM::hasVariable(const std::string& varName) const
 {
-    return (find_if(pimpl_->variables.begin(), pimpl_->variables.end(), CDMNameEqual(varName)) != pimpl_->variables.end());
+    return pimpl_->variableIndex.find(varName) != pimpl_->variableIndex.end();
 }
 
 const CDMVariable& CDM::getVariable(const std::string& varName) const
 {
-    VarVec::const_iterator varPos = find_if(pimpl_->variables.begin(), pimpl_->variables.end(), CDMNameEqual(varName));
-    if (varPos != pimpl_->variables.end()) {
-        return *varPos;
+    if (const CDMVariable* var = findByName(pimpl_->variables, pimpl_->variableIndex, varName)) {
+        return *var;
     } else {
         throw CDMException("cannot find variable: '" + varName + "'");
     }
 }
 CDMVariable& CDM::getVariable(const std::string& varName)
 {
+    // the variable might be changed through the reference
+    structureChanged(pimpl_.get());
     // call constant version and cast
     return const_cast<CDMVariable&>(
             static_cast<const CDM&>(*this).getVariable(varName)
@@ -184,12 +259,14 @@ std::vector<std::string> CDM::findVariables(const std::string& attrName, const s
 
 bool CDM::renameVariable(const std::string& oldName, const std::string& newName)
 {
-    pimpl_->coordsInitialized = false;
+    structureChanged(pimpl_.get());
     // change variable in VarVec variables and variableNames as keys in StrAttrVecMap attributes
     try {
         removeVariable(newName); // make sure none of the same name exists
         CDMVariable& var = getVariable(oldName);
         var.setName(newName);
+        pimpl_->variableIndex[newName] = pimpl_->variableIndex[oldName];
+        pimpl_->variableIndex.erase(oldName);
         // working in places, addVariable(newName); not needed
         std::vector<CDMAttribute> attrs = getAttributes(oldName);
         for (std::vector<CDMAttribute>::iterator it = attrs.begin(); it != attrs.end(); ++it) {
@@ -244,16 +321,21 @@ std::vector<std::string> CDM::findVariables(const std::map<std::string, std::str
 
 void CDM::removeVariable(const std::string& variableName)
 {
-    pimpl_->coordsInitialized = false;
-    pimpl_->variables.erase(remove_if(pimpl_->variables.begin(), pimpl_->variables.end(), CDMNameEqual(variableName)), pimpl_->variables.end());
+    structureChanged(pimpl_.get());
+    const NameIndex::iterator it = pimpl_->variableIndex.find(variableName);
+    if (it != pimpl_->variableIndex.end()) {
+        pimpl_->variables.erase(pimpl_->variables.begin() + it->second);
+        rebuildIndex(pimpl_->variables, pimpl_->variableIndex);
+    }
     pimpl_->attributes.erase(variableName);
 }
 
 
 void CDM::addDimension(const CDMDimension& dim)
 {
-    pimpl_->coordsInitialized = false;
+    structureChanged(pimpl_.get());
     if (!hasDimension(dim.getName())) {
+        pimpl_->dimensionIndex[dim.getName()] = pimpl_->dimensions.size();
         pimpl_->dimensions.push_back(dim);
     } else {
         throw CDMException("cannot add dimension: " + dim.getName() + " already exists");
@@ -262,14 +344,13 @@ void CDM::addDimension(const CDMDimension& dim)
 
 bool CDM::hasDimension(const std::string& dimName) const
 {
-    return (find_if(pimpl_->dimensions.begin(), pimpl_->dimensions.end(), CDMNameEqual(dimName)) != pimpl_->dimensions.end());
+    return pimpl_->dimensionIndex.find(dimName) != pimpl_->dimensionIndex.end();
 }
 
 const CDMDimension& CDM::getDimension(const std::string& dimName) const
 {
-    DimVec::const_iterator dimIt = find_if(pimpl_->dimensions.begin(), pimpl_->dimensions.end(), CDMNameEqual(dimName));
-    if (dimIt != pimpl_->dimensions.end()) {
-        return *dimIt;
+    if (const CDMDimension* dim = findByName(pimpl_->dimensions, pimpl_->dimensionIndex, dimName)) {
+        return *dim;
     } else {
         throw CDMException("cannot find dimension: " + dimName);
     }
@@ -277,6 +358,8 @@ const CDMDimension& CDM::getDimension(const std::string& dimName) const
 
 CDMDimension& CDM::getDimension(const std::string& dimName)
 {
+    // the dimension might be changed through the reference
+    structureChanged(pimpl_.get());
     return const_cast<CDMDimension&>(
             static_cast<const CDM&>(*this).getDimension(dimName)
             );
@@ -301,7 +384,7 @@ bool CDM::renameDimension(const std::string& oldName, const std::string& newName
 
 bool CDM::renameDimension(const std::string& oldName, const std::string& newName, bool ignoreInUse)
 {
-    pimpl_->coordsInitialized = false;
+    structureChanged(pimpl_.get());
     if (!hasDimension(oldName)) return false;
     if (hasDimension(newName)) {
         if (!ignoreInUse && testDimensionInUse(newName)) {
@@ -312,6 +395,8 @@ bool CDM::renameDimension(const std::string& oldName, const std::string& newName
     }
     CDMDimension& dim = getDimension(oldName);
     dim.setName(newName);
+    pimpl_->dimensionIndex[newName] = pimpl_->dimensionIndex[oldName];
+    pimpl_->dimensionIndex.erase(oldName);
     /* change the shape of all variables having the dimensions */
     for (VarVec::iterator it = pimpl_->variables.begin(); it != pimpl_->variables.end(); ++it) {
         if (it->checkDimension(oldName)) {
@@ -338,13 +423,15 @@ bool CDM::removeDimension(const std::string& name, bool ignoreInUse)
     if (!ignoreInUse && testDimensionInUse(name)) {
         throw CDMException("Cannot remove dimension "+name+". Dimension in use and ignoring this is disabled.");
     } else {
-        DimVec::iterator it = remove_if(pimpl_->dimensions.begin(), pimpl_->dimensions.end(), CDMNameEqual(name));
-        if (it != pimpl_->dimensions.end()) {
-            pimpl_->dimensions.erase(it, pimpl_->dimensions.end());
+        const NameIndex::iterator it = pimpl_->dimensionIndex.find(name);
+        if (it != pimpl_->dimensionIndex.end()) {
+            pimpl_->dimensions.erase(pimpl_->dimensions.begin() + it->second);
+            rebuildIndex(pimpl_->dimensions, pimpl_->dimensionIndex);
             didErase = true;
         }
     }
-    if (didErase) pimpl_->coordsInitialized = false;
+    if (didErase)
+        structureChanged(pimpl_.get());
     return didErase;
 }
 
@@ -372,7 +459,7 @@ bool CDM::hasUnlimitedDim(const CDMVariable& var) const
 
 void CDM::addAttribute(const std::string& varName, const CDMAttribute& attr)
 {
-    pimpl_->coordsInitialized = false;
+    structureChanged(pimpl_.get());
     if ((varName != globalAttributeNS ()) && !hasVariable(varName)) {
         throw CDMException("cannot add attribute: variable " + varName + " does not exist");
     } else {
@@ -387,7 +474,7 @@ void CDM::addAttribute(const std::string& varName, const CDMAttribute& attr)
 
 void CDM::addOrReplaceAttribute(const std::string& varName, const CDMAttribute& attr)
 {
-    pimpl_->coordsInitialized = false;
+    structureChanged(pimpl_.get());
     if ((varName != globalAttributeNS ()) && !hasVariable(varName)) {
         throw CDMException("cannot add attribute: variable " + varName + " does not exist");
     } else {
@@ -398,7 +485,7 @@ void CDM::addOrReplaceAttribute(const std::string& varName, const CDMAttribute&
 
 void CDM::removeAttribute(const std::string& varName, const std::string& attrName)
 {
-    pimpl_->coordsInitialized = false;
+    structureChanged(pimpl_.get());
     StrAttrVecMap::iterator varIt = pimpl_->attributes.find(varName);
     if (varIt != pimpl_->attributes.end()) {
         AttrVec& attrVec = varIt->second;
@@ -409,19 +496,20 @@ void CDM::removeAttribute(const std::string& varName, const std::string& attrNam
 
 const CDMAttribute& CDM::getAttribute(const std::string& varName, const std::string& attrName) const
 {
-    StrAttrVecMap::const_iterator varIt = pimpl_->attributes.find(varName);
-    if (varIt == pimpl_->attributes.end())
+    if (pimpl_->attributes.find(varName) == pimpl_->attributes.end())
         throw CDMException("Variable " + varName + " not found");
 
-    AttrVec::const_iterator attrIt = find_if(varIt->second.begin(), varIt->second.end(), CDMNameEqual(attrName));
-    if (attrIt == (varIt->second).end())
+    const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, attrName);
+    if (!attr)
         throw CDMException("Attribute " + attrName + " not found for variable: " + varName);
 
-    return *attrIt;
+    return *attr;
 }
 
 CDMAttribute& CDM::getAttribute(const std::string& varName, const std::string& attrName)
 {
+    // the attribute might be changed through the reference
+    structureChanged(pimpl_.get());
     return const_cast<CDMAttribute&>(
             static_cast<const CDM&>(*this).getAttribute(varName, attrName)
             );
@@ -429,22 +517,17 @@ CDMAttribute& CDM::getAttribute(const std::string& varName, const std::string& a
 
 bool CDM::getAttribute(const std::string& varName, const std::string& attrName, CDMAttribute& retAttribute) const
 {
-    StrAttrVecMap::const_iterator varIt = pimpl_->attributes.find(varName);
-    if (varIt == pimpl_->attributes.end())
+    const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, attrName);
+    if (!attr)
         return false;
 
-    AttrVec::const_iterator attrIt = find_if(varIt->second.begin(), varIt->second.end(), CDMNameEqual(attrName));
-    if (attrIt == (varIt->second).end())
-        return false;
-
-    retAttribute = *attrIt;
+    retAttribute = *attr;
     return true;
 }
 
 bool CDM::hasAttribute(const std::string& varName, const std::string& attrName) const
 {
-    CDMAttribute attr;
-    return getAttribute(varName, attrName, attr);
+    return findAttribute(pimpl_.get(), varName, attrName) != nullptr;
 }
 
 std::vector<CDMAttribute> CDM::getAttributes(const std::string& varName) const
@@ -476,16 +559,18 @@ static double defaultFillValue_(CDMDataType dt)
 
 double CDM::getFillValue(const std::string& varName) const
 {
-    CDMAttribute attr;
-    if (getAttribute(varName, "_FillValue", attr) || getAttribute(varName, "missing_value", attr)) {
-        CDMVariable var = getVariable(varName);
-        if (var.getDataType() != attr.getDataType())
+    const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "_FillValue");
+    if (!attr)
+        attr = findAttribute(pimpl_.get(), varName, "missing_value");
+    if (attr) {
+        const CDMVariable& var = getVariable(varName);
+        if (var.getDataType() != attr->getDataType())
             throw CDMException("variable '" + varName + "' has type " + datatype2string(var.getDataType())
-                               + " and FillValue type " + datatype2string(attr.getDataType()));
-        return attr.getData()->asDouble()[0];
+                               + " and FillValue type " + datatype2string(attr->getDataType()));
+        return attr->getData()->asDouble()[0];
     }
-    if (hasVariable(varName)) {
-        return defaultFillValue_(getVariable(varName).getDataType());
+    if (const CDMVariable* var = findByName(pimpl_->variables, pimpl_->variableIndex, varName)) {
+        return defaultFillValue_(var->getDataType());
     } else {
         return MIFI_UNDEFINED_D;
     }
@@ -493,22 +578,20 @@ double CDM::getFillValue(const std::string& varName) const
 
 double CDM::getValidMin(const std::string& varName) const
 {
-    CDMAttribute attr;
-    if (getAttribute(varName, "valid_min", attr)) {
-        return attr.getData()->asDouble()[0];
-    } else if (getAttribute(varName, "valid_range", attr)) {
-        return attr.getData()->asDouble()[0];
+    if (const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "valid_min")) {
+        return attr->getData()->asDouble()[0];
+    } else if (const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "valid_range")) {
+        return attr->getData()->asDouble()[0];
     }
     return MIFI_UNDEFINED_D;
 }
 
 double CDM::getValidMax(const std::string& varName) const
 {
-    CDMAttribute attr;
-    if (getAttribute(varName, "valid_max", attr)) {
-        return attr.getData()->asDouble()[0];
-    } else if (getAttribute(varName, "valid_range", attr)) {
-        DataPtr data = attr.getData();
+    if (const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "valid_max")) {
+        return attr->getData()->asDouble()[0];
+    } else if (const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "valid_range")) {
+        DataPtr data = attr->getData();
         if (data->size() > 1) {
             return data->asDouble()[1];
         }
@@ -518,9 +601,8 @@ double CDM::getValidMax(const std::string& varName) const
 
 double CDM::getAddOffset(const std::string& varName) const
 {
-    CDMAttribute attr;
-    if (getAttribute(varName, "add_offset", attr)) {
-        return attr.getData()->asDouble()[0];
+    if (const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "add_offset")) {
+        return attr->getData()->asDouble()[0];
     } else {
         return 0;
     }
@@ -528,9 +610,8 @@ double CDM::getAddOffset(const std::string& varName) const
 
 double CDM::getScaleFactor(const std::string& varName) const
 {
-    CDMAttribute attr;
-    if (getAttribute(varName, "scale_factor", attr)) {
-        return attr.getData()->asDouble()[0];
+    if (const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "scale_factor")) {
+        return attr->getData()->asDouble()[0];
     } else {
         return 1;
     }
@@ -538,9 +619,8 @@ double CDM::getScaleFactor(const std::string& varName) const
 
 std::string CDM::getUnits(const std::string& varName) const
 {
-    CDMAttribute attr;
-    if (getAttribute(varName, "units", attr))
-        return attr.getStringValue();
+    if (const CDMAttribute* attr = findAttribute(pimpl_.get(), varName, "units"))
+        return attr->getStringValue();
     else
         return "";
 }
@@ -588,6 +668,30 @@ const CDM::StrAttrVecMap& CDM::getAttributes() const
     return pimpl_->attributes;
 }
 
+unsigned long CDM::getStructureVersion() const
+{
+    return pimpl_->version;
+}
+
+bool CDM::getCachedCoordinateSystems(bool withReader, CoordinateSystem_cp_v& coordSys) const
+{
+    OmpScopedLock lock(coordSysCacheMutex);
+    const CoordSysCache& cache = pimpl_->coordSysCache[withReader ? 1 : 0];
+    if (!cache.valid || cache.version != pimpl_->version)
+        return false;
+    coordSys = cache.coordSystems;
+    return true;
+}
+
+void CDM::setCachedCoordinateSystems(bool withReader, const CoordinateSystem_cp_v& coordSys)
+{
+    OmpScopedLock lock(coordSysCacheMutex);
+    CoordSysCache& cache = pimpl_->coordSysCache[withReader ? 1 : 0];
+    cache.valid = true;
+    cache.version = pimpl_->version;
+    cache.coordSystems = coordSys;
+}
+
 
 bool CDM::getProjectionAndAxesUnits(std::string& projectionName, std::string& xAxis, std::string& yAxis, std::string& xAxisUnits, std::string& yAxisUnits) const
 {
@@ -703,17 +807,14 @@ void CDM::generateProjectionCoordinates(Projection_cp projection, const std::str
 
 Projection_cp CDM::getProjectionOf(std::string varName) const
 {
-    enhance(pimpl_.get(), *this);
-    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(pimpl_->coordSystems, varName))
+    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(coordinateSystems(*this), varName))
         return cs->getProjection();
     return nullptr;
 }
 
 std::string CDM::getHorizontalXAxis(std::string varName) const
 {
-    enhance(pimpl_.get(), *this);
-
-    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(pimpl_->coordSystems, varName)) {
+    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(coordinateSystems(*this), varName)) {
         if (CoordinateAxis_cp axis = cs->getGeoXAxis())
             return axis->getName();
     }
@@ -722,9 +823,7 @@ std::string CDM::getHorizontalXAxis(std::string varName) const
 
 std::string CDM::getHorizontalYAxis(std::string varName) const
 {
-    enhance(pimpl_.get(), *this);
-
-    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(pimpl_->coordSystems, varName)) {
+    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(coordinateSystems(*this), varName)) {
         if (CoordinateAxis_cp axis = cs->getGeoYAxis())
             return axis->getName();
     }
@@ -733,9 +832,7 @@ std::string CDM::getHorizontalYAxis(std::string varName) const
 
 bool CDM::getLatitudeLongitude(std::string varName, std::string& latitude, std::string& longitude) const
 {
-    enhance(pimpl_.get(), *this);
-
-    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(pimpl_->coordSystems, varName)) {
+    if (CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(coordinateSystems(*this), varName)) {
         CoordinateAxis_cp latAxis = cs->findAxisOfType(CoordinateAxis::Lat);
         CoordinateAxis_cp lonAxis = cs->findAxisOfType(CoordinateAxis::Lon);
         if (latAxis && lonAxis) {
@@ -749,9 +846,7 @@ bool CDM::getLatitudeLongitude(std::string varName, std::string& latitude, std::
 
 std::string CDM::getTimeAxis(std::string varName) const
 {
-    enhance(pimpl_.get(), *this);
-
-    const CoordinateSystem_cp_v& csList = pimpl_->coordSystems;
+    const CoordinateSystem_cp_v csList = coordinateSystems(*this);
 
     // check if variable is its own axis (coord-axis don't have coordinate system)
     for (CoordinateSystem_cp cs : csList) {
@@ -770,9 +865,7 @@ std::string CDM::getTimeAxis(std::string varName) const
 
 std::string CDM::getVerticalAxis(std::string varName) const
 {
-    enhance(pimpl_.get(), *this);
-
-    const CoordinateSystem_cp_v& csList = pimpl_->coordSystems;
+    const CoordinateSystem_cp_v csList = coordinateSystems(*this);
 
     // check if variable is its own axis (coord-axis don't have coordinate system)
     for (CoordinateSystem_cp cs : csList) {
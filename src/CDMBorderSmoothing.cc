@@ -35,10 +35,14 @@
 #include "fimex/DataIndex.h"
 #include "fimex/Logger.h"
 #include "fimex/MathUtils.h"
+#include "fimex/MutexLock.h"
 #include "fimex/StringUtils.h"
 
 #include "CDMMergeUtils.h"
 
+#include <algorithm>
+#include <map>
+
 using namespace MetNoFimex;
 using namespace std;
 
@@ -46,8 +50,56 @@ namespace MetNoFimex {
 
 static Logger_p logger(getLogger("fimex.CDMBorderSmoothing"));
 
+namespace {
+
+//! number of values merged in one task
+const size_t TILE_SIZE = 16384;
+
+/**
+ * Merge inner and outer values as (1-w)*valueI + w*valueO. The weights
+ * are repeated for each layer of layerSize values.
+ */
+void mergeLinear(const double* valuesI, const double* valuesO, double* merged, const double* weights, size_t layerSize, size_t layers,
+                 bool useOuterIfInnerUndefined)
+{
+    const size_t tiles = (layerSize + TILE_SIZE - 1) / TILE_SIZE;
+    const long long tasks = tiles * layers;
+#ifdef _OPENMP
+#pragma omp parallel for default(shared) if (tasks > 1)
+#endif
+    for (long long t = 0; t < tasks; ++t) {
+        const size_t l = t / tiles, i0 = (t % tiles) * TILE_SIZE;
+        const size_t i1 = std::min(i0 + TILE_SIZE, layerSize);
+        const double* vI = &valuesI[l * layerSize];
+        const double* vO = &valuesO[l * layerSize];
+        double* m = &merged[l * layerSize];
+        for (size_t i = i0; i < i1; ++i) {
+            m[i] = (1 - weights[i]) * vI[i] + weights[i] * vO[i];
+        }
+        // undefined values only appear if one of the inputs is undefined
+        for (size_t i = i0; i < i1; ++i) {
+            if (mifi_isnan(m[i])) {
+                if (mifi_isnan(vI[i]))
+                    m[i] = useOuterIfInnerUndefined ? vO[i] : MIFI_UNDEFINED_D;
+                else
+                    m[i] = vI[i];
+            }
+        }
+    }
+}
+
+} // namespace
+
 // ========================================================================
 
+//! weights of the outer values in one layer of a variable's data slice
+struct SmoothingWeights
+{
+    std::vector<size_t> layerSizes;
+    std::vector<double> weights;
+};
+typedef std::shared_ptr<const SmoothingWeights> SmoothingWeights_cp;
+
 struct CDMBorderSmoothingPrivate {
     CDMReader_p readerI;
     CDMReader_p readerO;
@@ -59,7 +111,11 @@ struct CDMBorderSmoothingPrivate {
     CDMBorderSmoothing::SmoothingFactory_p smoothingFactory;
     int gridInterpolationMethod;
 
+    OmpMutex weightsMutex;
+    std::map<std::string, SmoothingWeights_cp> weights;
+
     CDM makeCDM();
+    SmoothingWeights_cp getWeights(const std::string& varName, CDMBorderSmoothing::Smoothing_p smoothing, const std::vector<size_t>& dimSizes, int shapeIdxX, int shapeIdxY);
 };
 
 // ========================================================================
@@ -84,6 +140,8 @@ CDMBorderSmoothing::~CDMBorderSmoothing() {}
 void CDMBorderSmoothing::setSmoothing(SmoothingFactory_p smoothingFactory)
 {
     p->smoothingFactory = smoothingFactory;
+    OmpScopedLock lock(p->weightsMutex);
+    p->weights.clear();
 }
 
 // ------------------------------------------------------------------------
@@ -121,7 +179,7 @@ DataPtr CDMBorderSmoothing::getDataSlice(const std::string &varName, size_t unLi
         sliceO = p->interpolatedO->getScaledDataSliceInUnit(varName, unitsI, unLimDimPos);
     }
 
-    const vector<string> &shape = cdm_->getVariable(varName).getShape();
+    const vector<string> &shape = getCDM().getVariable(varName).getShape();
     vector<size_t> dimSizes;
     int shapeIdxX = -1, shapeIdxY = -1;
     for(size_t i=0; i<shape.size(); ++i) {
@@ -130,7 +188,7 @@ DataPtr CDMBorderSmoothing::getDataSlice(const std::string &varName, size_t unLi
         else if (p->nameY == shape[i])
             shapeIdxY = i;
 
-        const CDMDimension& dim = cdm_->getDimension(shape[i]);
+        const CDMDimension& dim = getCDM().getDimension(shape[i]);
         if (not dim.isUnlimited())
             dimSizes.push_back(dim.getLength());
     }
@@ -139,7 +197,26 @@ DataPtr CDMBorderSmoothing::getDataSlice(const std::string &varName, size_t unLi
         return sliceI;
 
     Smoothing_p smoothing = (*p->smoothingFactory)(varName);
-    smoothing->setHorizontalSizes(dimSizes[shapeIdxX], dimSizes[shapeIdxY]);
+    if (smoothing)
+        smoothing->setHorizontalSizes(dimSizes[shapeIdxX], dimSizes[shapeIdxY]);
+
+    double scale=1, offset=0;
+    getScaleAndOffsetOf(varName, scale, offset);
+
+    if ((not smoothing or smoothing->isLinear()) and shapeIdxX >= 0 and shapeIdxY >= 0) {
+        SmoothingWeights_cp w = p->getWeights(varName, smoothing, dimSizes, shapeIdxX, shapeIdxY);
+        const size_t layerSize = w->weights.size();
+        const size_t size = sliceI->size();
+        if (layerSize > 0 && sliceO->size() == size && size % layerSize == 0) {
+            shared_array<double> valuesI = sliceI->asDouble();
+            shared_array<double> valuesO = sliceO->asDouble();
+            shared_array<double> merged = make_shared_array<double>(size);
+            mergeLinear(valuesI.get(), valuesO.get(), merged.get(), &w->weights[0], layerSize, size / layerSize, p->useOuterIfInnerUndefined);
+            return createData(size, merged)->convertDataType(MIFI_UNDEFINED_D, 1, 0,
+                getCDM().getVariable(varName).getDataType(),
+                cdm_->getFillValue(varName), scale, offset);
+        }
+    }
 
     const DataIndex idx(dimSizes);
     
@@ -172,10 +249,8 @@ DataPtr CDMBorderSmoothing::getDataSlice(const std::string &varName, size_t unLi
             break;
     }
 
-    double scale=1, offset=0;
-    getScaleAndOffsetOf(varName, scale, offset);
     return sliceO->convertDataType(MIFI_UNDEFINED_D, 1, 0,
-        cdm_->getVariable(varName).getDataType(),
+        getCDM().getVariable(varName).getDataType(),
         cdm_->getFillValue(varName), scale, offset);
 }
 
@@ -186,6 +261,38 @@ CDM CDMBorderSmoothingPrivate::makeCDM()
     return makeMergedCDM(readerI, readerO, gridInterpolationMethod, interpolatedO, nameX, nameY);
 }
 
+SmoothingWeights_cp CDMBorderSmoothingPrivate::getWeights(const std::string& varName, CDMBorderSmoothing::Smoothing_p smoothing, const std::vector<size_t>& dimSizes, int shapeIdxX,
+                                                          int shapeIdxY)
+{
+    // the weights are repeated over all dimensions after x and y
+    const size_t layerDims = std::max(shapeIdxX, shapeIdxY) + 1;
+    const std::vector<size_t> layerSizes(dimSizes.begin(), dimSizes.begin() + std::min(layerDims, dimSizes.size()));
+
+    OmpScopedLock lock(weightsMutex);
+    SmoothingWeights_cp& cached = weights[varName];
+    if (cached && cached->layerSizes == layerSizes)
+        return cached;
+
+    std::shared_ptr<SmoothingWeights> w = std::make_shared<SmoothingWeights>();
+    w->layerSizes = layerSizes;
+    size_t layerSize = 1, strideX = 1, strideY = 1;
+    for (size_t i = 0; i < layerSizes.size(); ++i) {
+        if (int(i) < shapeIdxX)
+            strideX *= layerSizes[i];
+        if (int(i) < shapeIdxY)
+            strideY *= layerSizes[i];
+        layerSize *= layerSizes[i];
+    }
+    w->weights.resize(layerSize, 0);
+    if (smoothing) {
+        const size_t sizeX = layerSizes[shapeIdxX], sizeY = layerSizes[shapeIdxY];
+        for (size_t i = 0; i < layerSize; ++i)
+            w->weights[i] = smoothing->weight((i / strideX) % sizeX, (i / strideY) % sizeY);
+    }
+    cached = w;
+    return cached;
+}
+
 // ########################################################################
 
 CDMBorderSmoothing::SmoothingFactory_p createSmoothingFactory(const std::string& specification)
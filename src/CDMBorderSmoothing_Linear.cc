@@ -41,9 +41,15 @@ inline double dist(double dx, double dy) {
 namespace MetNoFimex {
 
 double CDMBorderSmoothing_Linear::operator()(size_t curX, size_t curY, double valueI, double valueO)
+{
+    const double alpha = weight(curX, curY);
+    return (1 - alpha) * valueI + alpha * valueO;
+}
+
+double CDMBorderSmoothing_Linear::weight(size_t curX, size_t curY) const
 {
     if( sizeX_ == 0 or sizeY_ == 0 )
-        return valueO;
+        return 1;
 
     const size_t xmin1 = borderWidth_, xmax1 = xmin1+transitionWidth_;
     const size_t ymin1 = borderWidth_, ymax1 = ymin1+transitionWidth_;
@@ -52,12 +58,9 @@ double CDMBorderSmoothing_Linear::operator()(size_t curX, size_t curY, double va
 
     const size_t x = curX, y = curY;
     if( x < xmin1 or x >= xmax2 or y < ymin1 or y >= ymax2 )
-        return valueO;
+        return 1;
     if( x >= xmax1 and x < xmin2 and y >= ymax1 and y < ymin2 )
-        return valueI;
-    const double diff = (valueO - valueI);
-    if( diff == 0 )
-        return valueO;
+        return 0;
     double alpha = 0; // 0 => valueI, >= 1 => valueO
     if( x < xmax1 ) {
         if( y < ymax1 )
@@ -83,7 +86,7 @@ double CDMBorderSmoothing_Linear::operator()(size_t curX, size_t curY, double va
       alpha = 1;
     else if (alpha < 0)
       alpha = 0;
-    return valueI + alpha*diff;
+    return alpha;
 }
 
 // ========================================================================
@@ -41,6 +41,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <exception>
 #include <functional>
 #include <iterator>
 #include <numeric>
@@ -62,118 +63,231 @@ CDMExtractor::~CDMExtractor()
 {
 }
 
-// join SliceBuilder request and build a big dataPtr
-// the slices need to come in a logical order of the data
-DataPtr joinSlices(CDMReader_p reader, std::string varName, const std::vector<SliceBuilder>& slices)
+namespace {
+
+// largest number of unwanted positions read between two wanted positions of a dimension,
+// to replace two requests by one larger request
+const size_t MAX_CHUNK_GAP = 4;
+
+// unwanted elements read for the gaps of a chunk must stay below the wanted elements of the chunk,
+// or below this number of elements
+const size_t MIN_CHUNK_OVERREAD = 64;
+
+// positions of one dimension read in one request
+struct DimChunk
 {
-    const CDMVariable& var = reader->getCDM().getVariable(varName);
-    // handle trivial cases
-    if (slices.size() == 0)
-        return createData(var.getDataType(), 0, 0.);
-    if (slices.size() == 1)
-        return reader->getDataSlice(varName, slices.front());
-
-    // calculate total slice size
-    std::vector<std::size_t> sliceSizes(slices.size());
-    size_t totalSize = 0;
-    for (size_t i = 0; i < slices.size(); i++) {
-        const SliceBuilder& sb = slices[i];
-        sliceSizes[i] = product(sb.getDimensionSizes());
-        totalSize += sliceSizes[i];
+    size_t start;  // first position read
+    size_t size;   // number of positions read
+    size_t outPos; // output position of the first kept value, kept positions are continuous in the output
+    std::vector<size_t> keep; // offsets of the kept positions in the chunk, increasing
+};
+
+typedef std::vector<DimChunk> DimChunks;
+
+/**
+ * Group positions into chunks, merging chunks with small gaps.
+ *
+ * One position of this dimension reads innerRead elements of the faster dimensions,
+ * of which innerKept are wanted. Gaps are only merged while the unwanted elements
+ * read for them stay below the wanted elements of the chunk, so merging in slow
+ * dimensions, e.g. time, does not read many unwanted (large) slices.
+ */
+DimChunks makeChunks(const std::vector<size_t>& positions, size_t first, size_t count, size_t innerRead, size_t innerKept)
+{
+    DimChunks chunks;
+    for (size_t i = first; i < first + count; ++i) {
+        const size_t pos = positions.at(i);
+        if (!chunks.empty()) {
+            DimChunk& c = chunks.back();
+            const size_t last = c.start + c.size - 1;
+            if (pos > last && pos - last - 1 <= MAX_CHUNK_GAP) {
+                const size_t size = pos - c.start + 1, kept = c.keep.size() + 1;
+                const size_t overRead = (size - kept) * innerRead;
+                if (overRead < std::max(kept * innerKept, MIN_CHUNK_OVERREAD)) {
+                    c.keep.push_back(pos - c.start);
+                    c.size = size;
+                    continue;
+                }
+            }
+        }
+        DimChunk c;
+        c.start = pos;
+        c.size = 1;
+        c.outPos = i - first;
+        c.keep.push_back(0);
+        chunks.push_back(c);
     }
+    return chunks;
+}
 
-    DataPtr retData = createData(var.getDataType(), totalSize, reader->getCDM().getFillValue(varName));
+// continuous runs (offset, length) in the kept positions of a chunk
+std::vector<std::pair<size_t, size_t>> keptRuns(const DimChunk& c)
+{
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t k : c.keep) {
+        if (!runs.empty() && runs.back().first + runs.back().second == k)
+            runs.back().second += 1;
+        else
+            runs.push_back(std::make_pair(k, 1));
+    }
+    return runs;
+}
 
-    // add the data
-    size_t dataPos = 0;
-    for (size_t i = 0; i < slices.size(); i++) {
-        if (DataPtr sliceData = reader->getDataSlice(varName, slices[i])) {
-            assert(sliceData->size() == sliceSizes[i]);
-            if (sliceData->size() > 0)
-                retData->setValues(dataPos, *sliceData);
+/**
+ * Read the chunks of all dimensions from the reader and copy the kept values
+ * into the preallocated output. The reads are independent and run in parallel.
+ */
+DataPtr readChunks(CDMReader_p reader, const std::string& varName, const SliceBuilder& orgSb, const std::vector<std::string>& dims,
+                   const std::vector<DimChunks>& dimChunks)
+{
+    const CDM& orgCDM = reader->getCDM();
+    const CDMDataType dataType = orgCDM.getVariable(varName).getDataType();
+    const size_t nDims = dims.size();
+
+    // output layout, first dimension changes fastest
+    std::vector<size_t> outStride(nDims, 1);
+    size_t totalSize = 1, nReads = 1;
+    for (size_t d = 0; d < nDims; ++d) {
+        outStride[d] = totalSize;
+        const DimChunk& lastChunk = dimChunks[d].back();
+        totalSize *= lastChunk.outPos + lastChunk.keep.size();
+        nReads *= dimChunks[d].size();
+    }
+    if (totalSize == 0)
+        return createData(dataType, 0);
+    if (nReads == 1) {
+        bool exact = true; // no unwanted positions in any dimension
+        for (size_t d = 0; d < nDims && exact; ++d)
+            exact = (dimChunks[d].front().keep.size() == dimChunks[d].front().size);
+        if (exact) {
+            SliceBuilder sb = orgSb;
+            for (size_t d = 0; d < nDims; ++d)
+                sb.setStartAndSize(dims[d], dimChunks[d].front().start, dimChunks[d].front().size);
+            return reader->getDataSlice(varName, sb);
         }
-        dataPos += sliceSizes[i];
     }
+
+    DataPtr retData = createDataUninitialized(dataType, totalSize);
+    const double fillValue = orgCDM.getFillValue(varName);
+
+    std::exception_ptr error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (nReads > 1)
+#endif
+    for (long long r = 0; r < static_cast<long long>(nReads); ++r) {
+        try {
+            // chunk of each dimension for this read, and the read layout
+            std::vector<const DimChunk*> chunks(nDims);
+            std::vector<size_t> inStride(nDims, 1);
+            SliceBuilder sb = orgSb;
+            size_t rr = r, readSize = 1;
+            for (size_t d = 0; d < nDims; ++d) {
+                chunks[d] = &dimChunks[d][rr % dimChunks[d].size()];
+                rr /= dimChunks[d].size();
+                sb.setStartAndSize(dims[d], chunks[d]->start, chunks[d]->size);
+                inStride[d] = readSize;
+                readSize *= chunks[d]->size;
+            }
+
+            DataPtr sliceData = reader->getDataSlice(varName, sb);
+            if (!sliceData || sliceData->size() == 0) {
+                sliceData = createData(dataType, readSize, fillValue);
+            } else if (sliceData->size() != readSize) {
+                throw CDMException("unexpected size of slice of " + varName + ": " + type2string(sliceData->size()) + " != " + type2string(readSize));
+            } else if (sliceData->getDataType() != dataType) {
+                sliceData = createDataSlice(dataType, *sliceData, 0, readSize);
+            }
+
+            // copy runs of the fastest dimension for all kept positions of the other dimensions
+            const std::vector<std::pair<size_t, size_t>> runs = keptRuns(*chunks[0]);
+            std::vector<size_t> idx(nDims, 0); // index into keep of each dimension > 0
+            while (true) {
+                size_t inPos = 0, outPos = chunks[0]->outPos;
+                for (size_t d = 1; d < nDims; ++d) {
+                    inPos += chunks[d]->keep[idx[d]] * inStride[d];
+                    outPos += (chunks[d]->outPos + idx[d]) * outStride[d];
+                }
+                size_t outOffset = 0;
+                for (const std::pair<size_t, size_t>& run : runs) {
+                    retData->setValues(outPos + outOffset, *sliceData, inPos + run.first, inPos + run.first + run.second);
+                    outOffset += run.second;
+                }
+                size_t d = 1;
+                for (; d < nDims; ++d) {
+                    if (++idx[d] < chunks[d]->keep.size())
+                        break;
+                    idx[d] = 0;
+                }
+                if (d >= nDims)
+                    break;
+            }
+        } catch (...) {
+#ifdef _OPENMP
+#pragma omp critical(CDMExtractorReadChunks)
+#endif
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
     return retData;
 }
 
+} // namespace
+
 DataPtr CDMExtractor::getDataSlice_(const std::string& varName, const SliceBuilder& sb)
 {
-    std::vector<SliceBuilder> slices;
     // translate slice-variable size where dimensions have been transformed, (via data.slice)
     const CDM& orgCDM = dataReader_->getCDM();
-    slices.push_back(SliceBuilder(orgCDM, varName));
-
-    const std::vector<std::string> dims = slices.front().getDimensionNames(); // make a copy, we might replace slices[0] in the following loop
-
-    // loop over variables dimensions and see which to reduce
-    // revert the dimensions to match joining, unlimit is last in slicebuilder, but slowest changing
+    const SliceBuilder orgSb(orgCDM, varName);
+    const std::vector<std::string> dims = orgSb.getDimensionNames();
+
+    // positions to read for each dimension, grouped into chunks
+    std::vector<DimChunks> dimChunks;
+    dimChunks.reserve(dims.size());
+    // elements read and wanted for one position of the current dimension, the first dimension changes fastest
+    size_t innerRead = 1, innerKept = 1;
     for (const std::string& dimName : dims) {
-        const CDMDimension& dim = orgCDM.getDimension(dimName);
-        DimSlicesMap::iterator foundDim = dimSlices_.find(dim.getName());
         size_t sbStart, sbSize;
         sb.getStartAndSize(dimName, sbStart, sbSize);
+        DimSlicesMap::const_iterator foundDim = dimSlices_.find(dimName);
         if (foundDim == dimSlices_.end()) {
             // handle pure sb changes
-            for (SliceBuilder& sliceb : slices)
-                sliceb.setStartAndSize(dim.getName(), sbStart, sbSize);
-        } else if (foundDim->second.empty()) {
-            for (SliceBuilder& sliceb : slices)
-                sliceb.setStartAndSize(dim.getName(), sbStart, 0);
+            DimChunk c;
+            c.start = sbStart;
+            c.size = sbSize;
+            c.outPos = 0;
+            for (size_t i = 0; i < sbSize; ++i)
+                c.keep.push_back(i);
+            dimChunks.push_back(DimChunks(1, c));
         } else {
-            // handle slices in chunks
             const std::vector<std::size_t>& positions = foundDim->second;
-            assert(positions.size() > sbStart);
-            assert(positions.size() - sbStart >= sbSize);
-            if (slices.size() <= 1) {
-                // make chunks as large as possible for efficiency
-                std::vector < std::pair<size_t, size_t> > chunks; // start,size
-                size_t start = positions.at(sbStart), last = start;
-                for (size_t i = sbStart + 1; i < sbStart + sbSize; ++i) {
-                    const size_t positions_i = positions.at(i);
-                    if (positions_i == last + 1) {
-                        // make a larger continuous chunk
-                        last = positions_i;
-                    } else {
-                        chunks.push_back(std::make_pair(start, last - start + 1));
-                        start = last = positions_i;
-                    }
-                }
-                chunks.push_back(std::make_pair(start, last - start + 1)); // chunks with start and size
-                // create one slice for each chunk
-                std::vector<SliceBuilder> newSlices;
-                for (std::vector<std::pair<size_t, size_t> >::iterator chunksIt =
-                        chunks.begin(); chunksIt != chunks.end(); ++chunksIt) {
-                    for (SliceBuilder& sliceb : slices) {
-                        SliceBuilder lsb = sliceb; // make a copy
-                        lsb.setStartAndSize(dim.getName(), chunksIt->first, chunksIt->second);
-                        newSlices.push_back(lsb);
-                    }
-                }
-                slices = std::move(newSlices);
-            } else {
-                // chunks already splitted up, just add the relevant slices one by one
-                std::vector<SliceBuilder> newSlices;
-                for (size_t i = sbStart; i < sbStart + sbSize; ++i) {
-                    for (SliceBuilder& sliceb : slices) {
-                        SliceBuilder lsb = sliceb; // make a copy
-                        lsb.setStartAndSize(dim.getName(), positions.at(i), 1);
-                        newSlices.push_back(lsb);
-                    }
-                }
-                slices = std::move(newSlices);
+            assert(positions.size() >= sbStart + sbSize);
+            if (sbSize == 0 || positions.empty()) {
+                return createData(orgCDM.getVariable(varName).getDataType(), 0);
             }
+            dimChunks.push_back(makeChunks(positions, sbStart, sbSize, innerRead, innerKept));
         }
+        if (dimChunks.back().front().keep.empty())
+            return createData(orgCDM.getVariable(varName).getDataType(), 0);
+        size_t dimRead = 0;
+        for (const DimChunk& c : dimChunks.back())
+            dimRead += c.size;
+        innerRead *= dimRead;
+        innerKept *= sbSize;
     }
-    // read
-    DataPtr data = joinSlices(dataReader_, varName, slices);
-    return data;
-}
+    if (dims.empty())
+        return dataReader_->getDataSlice(varName, orgSb);
 
+    return readChunks(dataReader_, varName, orgSb, dims, dimChunks);
+}
 
 DataPtr CDMExtractor::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         // remove dimension makes sure that variables with dimensions requiring slicing
         // don't have in local in memory data, so return the memory data is save here
@@ -188,7 +302,7 @@ DataPtr CDMExtractor::getDataSlice(const std::string& varName, size_t unLimDimPo
         SliceBuilder sb(getCDM(), varName);
         const std::vector<std::string>& dimNames = sb.getDimensionNames();
         for (const std::string& dimName : dimNames) {
-            const CDMDimension& dim = cdm_->getDimension(dimName);
+            const CDMDimension& dim = getCDM().getDimension(dimName);
             if (dim.isUnlimited()) {
                 sb.setStartAndSize(dimName, unLimDimPos, 1);
             }
@@ -201,7 +315,7 @@ DataPtr CDMExtractor::getDataSlice(const std::string& varName, size_t unLimDimPo
 
 DataPtr CDMExtractor::getDataSlice(const std::string& varName, const SliceBuilder& sb)
 {
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         LOG4FIMEX(logger, Logger::DEBUG, "fetching data from memory");
         DataPtr data = variable.getData();
@@ -219,6 +333,11 @@ DataPtr CDMExtractor::getDataSlice(const std::string& varName, const SliceBuilde
     return getDataSlice_(varName, sb);
 }
 
+std::vector<std::size_t> CDMExtractor::getChunkShape(const std::string& varName) const
+{
+    return forwardChunkShape(*dataReader_, varName, getCDM(), varName);
+}
+
 void CDMExtractor::removeVariable(const std::string& variable)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "removing variable "<< variable);
@@ -41,6 +41,7 @@
 #include <algorithm>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <regex>
 
 #include "fimex_config.h"
@@ -59,7 +60,7 @@ namespace {
 
 Logger_p logger = getLogger("fimex.CDMFileReaderFactory");
 
-static bool haveScannedForIoPlugins = false;
+std::once_flag scannedForIoPlugins;
 
 std::vector<std::string> getIoPluginsDirs()
 {
@@ -73,13 +74,8 @@ std::vector<std::string> getIoPluginsDirs()
     return tokenize(iopp, ":");
 }
 
-// static
-void scanForIoPlugins()
+void scanForIoPluginsOnce()
 {
-    if (haveScannedForIoPlugins)
-        return;
-    haveScannedForIoPlugins = true;
-
     static const std::regex re_plugin_so("libfimex-io-([a-z0-9]+)" FIMEX_IO_PLUGINS_VERSION "\\.so");
     static const auto plugin_dirs = getIoPluginsDirs();
     for (const auto& pd : plugin_dirs) {
@@ -106,6 +102,12 @@ void scanForIoPlugins()
     }
 }
 
+// thread-safe, all threads wait until the plugins are installed
+void scanForIoPlugins()
+{
+    std::call_once(scannedForIoPlugins, scanForIoPluginsOnce);
+}
+
 IoFactory_pm& ioFactories()
 {
     return IoFactory::factories();
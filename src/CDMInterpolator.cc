@@ -28,6 +28,8 @@
 // fimex
 //
 #include "CachedForwardInterpolation.h"
+#include "InterpolationGeometryCache.h"
+#include "VectorPairCache.h"
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
 #include "fimex/CDMFileReaderFactory.h"
@@ -53,6 +55,7 @@
 // standard
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <functional>
@@ -76,7 +79,17 @@ InterpolatorProcess2d::~InterpolatorProcess2d() {}
 void InterpolatorFill2d::operator()(float* array, size_t nx, size_t ny)
 {
     size_t nChanged;
-    mifi_fill2d_f(nx, ny, array, relaxCrit_, corrEff_, maxLoop_, &nChanged);
+    switch (method_) {
+    case MIFI_FILL2D_REDBLACK:
+        mifi_fill2d_redblack_f(nx, ny, array, relaxCrit_, corrEff_, maxLoop_, &nChanged);
+        break;
+    case MIFI_FILL2D_MULTIGRID:
+        mifi_fill2d_multigrid_f(nx, ny, array, relaxCrit_, corrEff_, maxLoop_, &nChanged);
+        break;
+    default:
+        mifi_fill2d_f(nx, ny, array, relaxCrit_, corrEff_, maxLoop_, &nChanged);
+        break;
+    }
 }
 
 void InterpolatorCreepFill2d::operator()(float* array, size_t nx, size_t ny)
@@ -95,6 +108,7 @@ struct CDMInterpolator::Impl
 {
     CDMReader_p dataReader;
     double maxDistance; // negative = undefined
+    size_t kdTreePartSize; // minimum number of input points per kd-tree
     std::string latitudeName;
     std::string longitudeName;
     std::vector<InterpolatorProcess2d_p> preprocesses;
@@ -108,6 +122,30 @@ struct CDMInterpolator::Impl
     // horizontalId, cachedVectorReprojection
     typedef map<string, CachedVectorReprojection_p> cachedVectorReprojection_t;
     cachedVectorReprojection_t cachedVectorReprojection;
+    // interpolated and rotated counterparts of recently requested vector components
+    VectorPairCache rotatedCounterparts;
+    // null if the geometry should not be cached on disk
+    std::unique_ptr<InterpolationGeometryCache> geometryCache;
+
+    bool loadPoints(const InterpolationGeometryCache::Key& key, size_t size, shared_array<double>& pointsOnXAxis, shared_array<double>& pointsOnYAxis) const
+    {
+        return geometryCache && geometryCache->loadPoints(key, size, pointsOnXAxis, pointsOnYAxis);
+    }
+    void storePoints(const InterpolationGeometryCache::Key& key, size_t size, const shared_array<double>& pointsOnXAxis,
+                     const shared_array<double>& pointsOnYAxis) const
+    {
+        if (geometryCache)
+            geometryCache->storePoints(key, size, pointsOnXAxis, pointsOnYAxis);
+    }
+    reproject::Matrix_cp loadMatrix(const InterpolationGeometryCache::Key& key) const
+    {
+        return geometryCache ? geometryCache->loadMatrix(key) : reproject::Matrix_cp();
+    }
+    void storeMatrix(const InterpolationGeometryCache::Key& key, reproject::Matrix_cp matrix) const
+    {
+        if (geometryCache)
+            geometryCache->storeMatrix(key, matrix);
+    }
 };
 
 namespace {
@@ -126,8 +164,11 @@ CDMInterpolator::CDMInterpolator(CDMReader_p dataReader)
 {
     p_->dataReader = dataReader;
     p_->maxDistance = -1;
+    p_->kdTreePartSize = 65536;
     p_->latitudeName = "lat";
     p_->longitudeName = "lon";
+    if (const char* cacheDir = getenv("FIMEX_INTERPOLATION_CACHE_DIR"))
+        setGeometryCacheDirectory(cacheDir);
     enhanceVectorProperties(p_->dataReader); // set spatial-vectors
     listCoordinateSystems(p_->dataReader); // add eventually needed information to cdm (e.g. Time-axis in WRF)
     *cdm_ = p_->dataReader->getCDM();
@@ -201,7 +242,7 @@ shared_array<double> clone(shared_array<double> orig, size_t size)
 DataPtr CDMInterpolator::getDataSlice(const std::string& varName, const SliceBuilder& sb)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "interpolating '"<< varName << "' with sliceBuilder" );
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData())
         return getDataSliceFromMemory(variable, sb);
 
@@ -217,6 +258,31 @@ DataPtr CDMInterpolator::getDataSlice(const std::string& varName, const SliceBui
         throw CDMException("no cached interpolation for " + varName + "(" + horizontalId + ")");
 
     CachedInterpolationInterface_p ci = itCI->second;
+
+    // vector in x/y direction, rotated together with its counterpart
+    std::string counterpart;
+    CachedVectorReprojection_p cvr;
+    bool isVectorX = false;
+    if (variable.isSpatialVector()) {
+        const CDMVariable::SpatialVectorDirection dir = variable.getSpatialVectorDirection();
+        if (dir == CDMVariable::SPATIAL_VECTOR_X || dir == CDMVariable::SPATIAL_VECTOR_Y) {
+            isVectorX = (dir == CDMVariable::SPATIAL_VECTOR_X);
+            counterpart = variable.getSpatialVectorCounterpart();
+            Impl::projectionVariables_t::const_iterator itC = p_->projectionVariables.find(counterpart);
+            if (itC != p_->projectionVariables.end() && horizontalId == itC->second) {
+                Impl::cachedVectorReprojection_t::iterator itV = p_->cachedVectorReprojection.find(horizontalId);
+                if (itV != p_->cachedVectorReprojection.end())
+                    cvr = itV->second;
+            }
+            if (!cvr) {
+                LOG4FIMEX(logger, Logger::WARN, "Cannot reproject vector " << variable.getName());
+            } else if (DataPtr rotated = p_->rotatedCounterparts.take(varName, VectorPairCache::sliceKey(sb))) {
+                LOG4FIMEX(logger, Logger::DEBUG, "interpolated and rotated with counterpart: " << varName << "(slicebuilder)");
+                return rotated;
+            }
+        }
+    }
+
     DataPtr data = ci->getInputDataSlice(p_->dataReader, varName, sb);
     if (data->size() == 0)
         return data;
@@ -229,33 +295,21 @@ DataPtr CDMInterpolator::getDataSlice(const std::string& varName, const SliceBui
     LOG4FIMEX(logger, Logger::DEBUG, "interpolateValues for: " << varName << "(slicebuilder)");
     auto iArray = ci->interpolateValues(array, data->size(), newSize);
 
-    if (variable.isSpatialVector()) {
-        // vector in x/y direction
-        const CDMVariable::SpatialVectorDirection dir = variable.getSpatialVectorDirection();
-        if (dir == CDMVariable::SPATIAL_VECTOR_X || dir == CDMVariable::SPATIAL_VECTOR_Y) {
-            bool can_reproject = false;
-            const std::string& counterpart = variable.getSpatialVectorCounterpart();
-            Impl::projectionVariables_t::const_iterator itC = p_->projectionVariables.find(counterpart);
-            if (itC != p_->projectionVariables.end() && horizontalId == itC->second) {
-                Impl::cachedVectorReprojection_t::iterator itV = p_->cachedVectorReprojection.find(horizontalId);
-                if (itV != p_->cachedVectorReprojection.end()) {
-                    CachedVectorReprojection_p cvr = itV->second;
-                    // fetch and transpose vector-data
-                    // transposing needed once for each direction (or caching, but that needs to much memory)
-                    auto counterPartArray = data2InterpolationArray(ci->getInputDataSlice(p_->dataReader, counterpart, sb), cdm_->getFillValue(counterpart));
-                    processArray_(p_->preprocesses, counterPartArray.get(), data->size(), ci->getInX(), ci->getInY());
-                    LOG4FIMEX(logger, Logger::DEBUG, "implicit interpolateValues for: " << counterpart << "(slicebuilder)");
-                    auto counterpartiArray = ci->interpolateValues(counterPartArray, data->size(), newSize);
-                    if (dir == CDMVariable::SPATIAL_VECTOR_X)
-                        cvr->reprojectValues(iArray, counterpartiArray, newSize);
-                    else
-                        cvr->reprojectValues(counterpartiArray, iArray, newSize);
-                    can_reproject = true;
-                }
-            }
-            if (!can_reproject)
-                LOG4FIMEX(logger, Logger::WARN, "Cannot reproject vector " << variable.getName());
-        }
+    if (cvr) {
+        // fetch and interpolate the counterpart, which is kept for its own request after rotation
+        auto counterPartArray = data2InterpolationArray(ci->getInputDataSlice(p_->dataReader, counterpart, sb), cdm_->getFillValue(counterpart));
+        processArray_(p_->preprocesses, counterPartArray.get(), data->size(), ci->getInX(), ci->getInY());
+        LOG4FIMEX(logger, Logger::DEBUG, "implicit interpolateValues for: " << counterpart << "(slicebuilder)");
+        auto counterpartiArray = ci->interpolateValues(counterPartArray, data->size(), newSize);
+        if (isVectorX)
+            cvr->reprojectValues(iArray, counterpartiArray, newSize);
+        else
+            cvr->reprojectValues(counterpartiArray, iArray, newSize);
+
+        processArray_(p_->postprocesses, counterpartiArray.get(), newSize, ci->getOutX(), ci->getOutY());
+        const double counterpartBadValue = cdm_->getFillValue(counterpart);
+        DataPtr counterpartData = interpolationArray2Data(getCDM().getVariable(counterpart).getDataType(), counterpartiArray, newSize, counterpartBadValue);
+        p_->rotatedCounterparts.put(counterpart, VectorPairCache::sliceKey(sb), ci->getOutputDataSlice(counterpartData, sb));
     }
 
     processArray_(p_->postprocesses, iArray.get(), newSize, ci->getOutX(), ci->getOutY());
@@ -265,7 +319,7 @@ DataPtr CDMInterpolator::getDataSlice(const std::string& varName, const SliceBui
 
 DataPtr CDMInterpolator::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData())
         return getDataSliceFromMemory(variable, unLimDimPos);
 
@@ -292,6 +346,21 @@ const std::string& CDMInterpolator::getLongitudeName() const {
 void CDMInterpolator::setDistanceOfInterest(double dist) {
     p_->maxDistance = dist;
 }
+void CDMInterpolator::setKDTreePartSize(size_t partSize)
+{
+    p_->kdTreePartSize = std::max<size_t>(1, partSize);
+}
+void CDMInterpolator::setGeometryCacheDirectory(const std::string& directory)
+{
+    if (directory.empty())
+        p_->geometryCache.reset();
+    else
+        p_->geometryCache.reset(new InterpolationGeometryCache(directory));
+}
+std::string CDMInterpolator::getGeometryCacheDirectory() const
+{
+    return p_->geometryCache ? p_->geometryCache->getDirectory() : std::string();
+}
 double CDMInterpolator::getMaxDistanceOfInterest(const vector<double>& out_x_axis, const vector<double>& out_y_axis) const
 {
     if (p_->maxDistance > 0)
@@ -430,6 +499,7 @@ void CDMInterpolator::changeProjection(int method, const string& proj_input, con
         throw CDMException("axis type of interpolation not well defined");
     }
     *cdm_ = p_->dataReader->getCDM(); // reset previous changes
+    p_->rotatedCounterparts.clear();
     p_->projectionVariables.clear(); // reset variables
     switch (method) {
     case MIFI_INTERPOL_NEAREST_NEIGHBOR:
@@ -625,6 +695,7 @@ void CDMInterpolator::changeProjection(int method, CDMReader_p tmplReader, const
     LOG4FIMEX(logger, Logger::DEBUG, "changing projection to template");
 
     *cdm_ = p_->dataReader->getCDM(); // reset previous changes
+    p_->rotatedCounterparts.clear();
     p_->projectionVariables.clear();  // reset variables
     p_->cachedInterpolation.clear();
     p_->cachedVectorReprojection.clear();
@@ -950,78 +1021,222 @@ struct PointCloud
         }
 };
 
+typedef nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Simple_Adaptor<double, PointCloud<double>>, PointCloud<double>, 3 /* dim */> PointCloudKDTree;
+
+//! kd-tree over a part of the input points
+struct PointCloudKDTreePart
+{
+    PointCloud<double> cloud;
+    //! position in the input grid of each point in the cloud
+    std::vector<size_t> positions;
+    //! bounding box of the cloud
+    double minPt[3];
+    double maxPt[3];
+    std::unique_ptr<PointCloudKDTree> index;
+
+    double bboxDistance2(const double* pt) const
+    {
+        double d2 = 0;
+        for (int d = 0; d < 3; ++d) {
+            const double dd = (pt[d] < minPt[d]) ? (minPt[d] - pt[d]) : ((pt[d] > maxPt[d]) ? (pt[d] - maxPt[d]) : 0);
+            d2 += dd * dd;
+        }
+        return d2;
+    }
+};
+
+double pointCoordinate(const PointCloud<double>::Point& p, int dim)
+{
+    return (dim == 0) ? p.x : ((dim == 1) ? p.y : p.z);
+}
+
+PointCloud<double>::Point lonLatToUnitSphere(double lon_deg, double lat_deg)
+{
+    const double lat_rad = deg_to_rad(lat_deg);
+    const double lon_rad = deg_to_rad(lon_deg);
+    const double cosLat = cos(lat_rad);
+    PointCloud<double>::Point p;
+    p.x = cosLat * cos(lon_rad);
+    p.y = cosLat * sin(lon_rad);
+    p.z = sin(lat_rad);
+    return p;
+}
+
+/**
+ * Split order[begin,end) into parts by recursive median splits along the
+ * dimension with the largest extent, ranges are appended to parts.
+ */
+void splitPointParts(const std::vector<PointCloud<double>::Point>& pts, std::vector<size_t>& order, size_t begin, size_t end, size_t nParts,
+                     std::vector<std::pair<size_t, size_t>>& parts)
+{
+    if (nParts <= 1 || end - begin < 2) {
+        parts.push_back(std::make_pair(begin, end));
+        return;
+    }
+    int splitDim = 0;
+    double maxExtent = -1;
+    for (int d = 0; d < 3; ++d) {
+        double minV = pointCoordinate(pts[order[begin]], d), maxV = minV;
+        for (size_t i = begin + 1; i < end; ++i)
+            minimaximize(minV, maxV, pointCoordinate(pts[order[i]], d));
+        if (maxV - minV > maxExtent) {
+            maxExtent = maxV - minV;
+            splitDim = d;
+        }
+    }
+    const size_t leftParts = nParts / 2;
+    const size_t mid = begin + (end - begin) * leftParts / nParts;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [&pts, splitDim](size_t a, size_t b) { return pointCoordinate(pts[a], splitDim) < pointCoordinate(pts[b], splitDim); });
+    splitPointParts(pts, order, begin, mid, leftParts, parts);
+    splitPointParts(pts, order, mid, end, nParts - leftParts, parts);
+}
+
 void flannTranslatePointsToClosestInputCell(double maxDist, shared_array<double> pointsOnXAxis /* degrees */, shared_array<double> pointsOnYAxis /* degrees */,
                                             size_t pointsSize, const double* lonVals /* degrees */, const double* latVals /* degrees */, size_t orgXDimSize,
-                                            size_t orgYDimSize)
+                                            size_t orgYDimSize, size_t minPartSize /* input points per kd-tree */)
 {
-    // pointsOnXAxis and pointsOnYAxis as well as lonVals and latVals are now represented in rad
-
-    using namespace nanoflann;
     LOG4FIMEX(logger, Logger::DEBUG, "maximum allowed distance from cell-center: " << maxDist);
     assert(maxDist != 0);
 
     // all calculations on a sphere with unit 1
     maxDist /= MIFI_EARTH_RADIUS_M;
+    // using square since kd-tree distance is not sqrt
+    const double search_radius = maxDist * maxDist;
 
     time_t start = time(0);
-    PointCloud<double> cloud;
-    cloud.pts.resize(orgXDimSize*orgYDimSize);
-    for (size_t ix = 0; ix < orgXDimSize; ix++) {
-        for (size_t iy = 0; iy < orgYDimSize; iy++) {
-            const size_t pos = ix + iy * orgXDimSize;
-            if (!(std::isnan(latVals[pos]) || std::isnan(lonVals[pos]))) {
-                const double lat_rad = deg_to_rad(latVals[pos]);
-                const double lon_rad = deg_to_rad(lonVals[pos]);
-                const double sinLat = sin(lat_rad);
-                const double cosLat = cos(lat_rad);
-                const double sinLon = sin(lon_rad);
-                const double cosLon = cos(lon_rad);
-                cloud.pts[pos].x = cosLat * cosLon;
-                cloud.pts[pos].y = cosLat * sinLon;
-                cloud.pts[pos].z = sinLat;
-            } else {
-                cloud.pts[pos].x = MIFI_UNDEFINED_D;
-                cloud.pts[pos].y = MIFI_UNDEFINED_D;
-                cloud.pts[pos].z = MIFI_UNDEFINED_D;
+
+    // output points on the unit sphere, and their bounding box extended by the search distance
+    std::vector<PointCloud<double>::Point> queries(pointsSize);
+    double minQuery[3] = {1, 1, 1}, maxQuery[3] = {-1, -1, -1};
+#ifdef _OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+        double minQ[3] = {1, 1, 1}, maxQ[3] = {-1, -1, -1};
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+        for (long long i = 0; i < (long long)pointsSize; i++) {
+            queries[i] = lonLatToUnitSphere(pointsOnXAxis[i], pointsOnYAxis[i]);
+            if (!std::isnan(queries[i].x + queries[i].y + queries[i].z)) {
+                for (int d = 0; d < 3; ++d) {
+                    const double v = pointCoordinate(queries[i], d);
+                    minQ[d] = std::min(minQ[d], v);
+                    maxQ[d] = std::max(maxQ[d], v);
+                }
             }
         }
+#ifdef _OPENMP
+#pragma omp critical (cdminterpolator_flannquerybbox)
+#endif
+        for (int d = 0; d < 3; ++d) {
+            minQuery[d] = std::min(minQuery[d], minQ[d]);
+            maxQuery[d] = std::max(maxQuery[d], maxQ[d]);
+        }
+    }
+    for (int d = 0; d < 3; ++d) {
+        minQuery[d] -= maxDist;
+        maxQuery[d] += maxDist;
     }
-    // construct a kd-tree index:
-    typedef KDTreeSingleIndexAdaptor<L2_Simple_Adaptor<double, PointCloud<double> > ,
-                                     PointCloud<double>,
-                                     3 /* dim */> my_kd_tree_t;
-    my_kd_tree_t index(3 /*dim*/, cloud, KDTreeSingleIndexAdaptorParams(12 /* max leaf */) );
-    index.buildIndex();
-    LOG4FIMEX(logger, Logger::DEBUG, "finished loading kdTree after " << (time(0) - start) << "s");
 
-    // using square since distance is not sqrt
-    const double search_radius = maxDist * maxDist;
-    nanoflann::SearchParams params;
-    params.sorted = true;
-    for (size_t i = 0; i < pointsSize; i++) {
-        const double lat_rad = deg_to_rad(pointsOnYAxis[i]);
-        const double lon_rad = deg_to_rad(pointsOnXAxis[i]);
-        const double sinLat = sin(lat_rad);
-        const double cosLat = cos(lat_rad);
-        const double sinLon = sin(lon_rad);
-        const double cosLon = cos(lon_rad);
-        const double query_pt[3] = { cosLat * cosLon,
-                                     cosLat * sinLon,
-                                     sinLat };
-
-        std::vector<std::pair<size_t,double> > ret_matches;
-        const size_t nMatches = index.radiusSearch(&query_pt[0], search_radius, ret_matches, params);
-        if (nMatches > 0) {
-            size_t pos = ret_matches.at(0).first; // pos = ix+orgXDimSize*iy =>
-            size_t ix = pos % orgXDimSize;
-            size_t iy = pos / orgXDimSize;
-            //LOG4FIMEX(logger, Logger::DEBUG, "found (" << RAD_TO_DEG*pointsOnXAxis[i] << "," << RAD_TO_DEG*pointsOnYAxis[i] << ") at (" << ix << "," << iy << ") dist: " << ret_matches.at(0).second);
-            pointsOnXAxis[i] = ix;
-            pointsOnYAxis[i] = iy;
-        } else {
-            // set to any value outside the axes (0 - x/y-size)
-            pointsOnXAxis[i] = -1000;
-            pointsOnYAxis[i] = -1000;
+    // input points on the unit sphere, only valid points within reach of the output points
+    const size_t orgSize = orgXDimSize * orgYDimSize;
+    std::vector<PointCloud<double>::Point> pts(orgSize);
+    std::vector<char> usePoint(orgSize, 0);
+#ifdef _OPENMP
+#pragma omp parallel for default(shared)
+#endif
+    for (long long pos = 0; pos < (long long)orgSize; pos++) {
+        if (std::isnan(latVals[pos]) || std::isnan(lonVals[pos]))
+            continue;
+        const PointCloud<double>::Point p = lonLatToUnitSphere(lonVals[pos], latVals[pos]);
+        pts[pos] = p;
+        usePoint[pos] = (p.x >= minQuery[0] && p.x <= maxQuery[0] && p.y >= minQuery[1] && p.y <= maxQuery[1] && p.z >= minQuery[2] && p.z <= maxQuery[2]);
+    }
+    std::vector<size_t> order;
+    for (size_t pos = 0; pos < orgSize; pos++) {
+        if (usePoint[pos])
+            order.push_back(pos);
+    }
+    LOG4FIMEX(logger, Logger::DEBUG, "using " << order.size() << " of " << orgSize << " input points in reach of the output");
+
+    // split the input points, and build one kd-tree per part in parallel
+#ifdef _OPENMP
+    const size_t maxParts = omp_get_max_threads();
+#else
+    const size_t maxParts = 1;
+#endif
+    const size_t nParts = std::max<size_t>(1, std::min(maxParts, order.size() / minPartSize));
+    std::vector<std::pair<size_t, size_t>> partRanges;
+    if (!order.empty())
+        splitPointParts(pts, order, 0, order.size(), nParts, partRanges);
+    std::vector<std::unique_ptr<PointCloudKDTreePart>> parts(partRanges.size());
+#ifdef _OPENMP
+#pragma omp parallel for default(shared) schedule(dynamic)
+#endif
+    for (long long ip = 0; ip < (long long)partRanges.size(); ip++) {
+        std::unique_ptr<PointCloudKDTreePart> part(new PointCloudKDTreePart);
+        const size_t begin = partRanges[ip].first, end = partRanges[ip].second;
+        part->positions.assign(order.begin() + begin, order.begin() + end);
+        part->cloud.pts.reserve(end - begin);
+        for (size_t pos : part->positions)
+            part->cloud.pts.push_back(pts[pos]);
+        for (int d = 0; d < 3; ++d) {
+            part->minPt[d] = part->maxPt[d] = pointCoordinate(part->cloud.pts[0], d);
+            for (const auto& p : part->cloud.pts)
+                minimaximize(part->minPt[d], part->maxPt[d], pointCoordinate(p, d));
+        }
+        part->index.reset(new PointCloudKDTree(3 /*dim*/, part->cloud, nanoflann::KDTreeSingleIndexAdaptorParams(12 /* max leaf */)));
+        part->index->buildIndex();
+        parts[ip] = std::move(part);
+    }
+    LOG4FIMEX(logger, Logger::DEBUG, "finished loading " << parts.size() << " kdTree(s) after " << (time(0) - start) << "s");
+
+    // closest input point, ties resolved by the smaller input position such that the result
+    // does not depend on the splitting into parts, i.e. the number of threads
+#ifdef _OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+        std::vector<std::pair<size_t, double>> matches;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 4096)
+#endif
+        for (long long i = 0; i < (long long)pointsSize; i++) {
+            const double query_pt[3] = {queries[i].x, queries[i].y, queries[i].z};
+            double bestDist = search_radius;
+            size_t bestPos = orgSize;
+            if (!std::isnan(query_pt[0] + query_pt[1] + query_pt[2])) {
+                for (const auto& part : parts) {
+                    if (part->bboxDistance2(query_pt) > bestDist)
+                        continue;
+                    size_t index;
+                    double dist;
+                    part->index->knnSearch(&query_pt[0], 1, &index, &dist);
+                    if (dist > bestDist)
+                        continue;
+                    // knnSearch returns any of several equally close points, collect all of them;
+                    // the radius is slightly larger to be safe from rounding in the tree traversal
+                    part->index->radiusSearch(&query_pt[0], dist * (1 + 1e-9) + 1e-18, matches, nanoflann::SearchParams(32, 0, false));
+                    for (const auto& m : matches) {
+                        const size_t pos = part->positions[m.first];
+                        if (m.second < bestDist || (m.second == bestDist && bestPos != orgSize && pos < bestPos)) {
+                            bestDist = m.second;
+                            bestPos = pos;
+                        }
+                    }
+                }
+            }
+            if (bestPos != orgSize) {
+                // pos = ix+orgXDimSize*iy
+                pointsOnXAxis[i] = bestPos % orgXDimSize;
+                pointsOnYAxis[i] = bestPos / orgXDimSize;
+            } else {
+                // set to any value outside the axes (0 - x/y-size)
+                pointsOnXAxis[i] = -1000;
+                pointsOnYAxis[i] = -1000;
+            }
         }
     }
     LOG4FIMEX(logger, Logger::DEBUG, "finished flannKDTranslatePointsToClosestInputCell");
@@ -1257,14 +1472,20 @@ void CDMInterpolator::changeProjectionByForwardInterpolation(int method, const s
             orgXYSize = orgLonSize;
         }
 
-        // translate all input points to output-coordinates, stored in lonVals and latVals
-        LOG4FIMEX(logger, Logger::DEBUG, "start reprojection of coordinates");
-        reproject::reproject_values(LAT_LON_PROJSTR, proj_input, &orgLonVals[0], &orgLatVals[0], orgXYSize);
-
-        // translate the converted input-coordinates (lonvals and latvals) to cell-positions in output
-        LOG4FIMEX(logger, Logger::DEBUG, "start calculating positions");
-        mifi_points2position(&orgLonVals[0], orgXYSize, &out_x_axis[0], out_x_axis.size(), miupXAxis);
-        mifi_points2position(&orgLatVals[0], orgXYSize, &out_y_axis[0], out_y_axis.size(), miupYAxis);
+        InterpolationGeometryCache::Key key("forward");
+        key.add(method).add(proj_input).add(out_x_axis).add(out_y_axis).add(miupXAxis).add(miupYAxis);
+        key.add(orgLonVals.get(), orgXYSize).add(orgLatVals.get(), orgXYSize);
+        if (!p_->loadPoints(key, orgXYSize, orgLonVals, orgLatVals)) {
+            // translate all input points to output-coordinates, stored in lonVals and latVals
+            LOG4FIMEX(logger, Logger::DEBUG, "start reprojection of coordinates");
+            reproject::reproject_values(LAT_LON_PROJSTR, proj_input, &orgLonVals[0], &orgLatVals[0], orgXYSize);
+
+            // translate the converted input-coordinates (lonvals and latvals) to cell-positions in output
+            LOG4FIMEX(logger, Logger::DEBUG, "start calculating positions");
+            mifi_points2position(&orgLonVals[0], orgXYSize, &out_x_axis[0], out_x_axis.size(), miupXAxis);
+            mifi_points2position(&orgLatVals[0], orgXYSize, &out_y_axis[0], out_y_axis.size(), miupYAxis);
+            p_->storePoints(key, orgXYSize, orgLonVals, orgLatVals);
+        }
 
         // store the interpolation
         LOG4FIMEX(logger, Logger::DEBUG, "creating cached forward interpolation matrix " << orgXDimSize << "x" << orgYDimSize << " => " << out_x_axis.size() << "x" << out_y_axis.size());
@@ -1300,6 +1521,8 @@ void CDMInterpolator::changeProjectionByCoordinates(int method, const string& pr
         size_t latSize, lonSize;
         extractValues(p_->dataReader->getScaledData(latitude), latVals, latSize);
         extractValues(p_->dataReader->getScaledData(longitude), lonVals, lonSize);
+        InterpolationGeometryCache::Key key("coordinates");
+        key.add(lonVals.get(), lonSize).add(latVals.get(), latSize);
 
         string orgXDimName, orgYDimName;
         const bool latLonProj = (cs->hasProjection() && (cs->getProjection()->getName() == "latitude_longitude"));
@@ -1323,23 +1546,34 @@ void CDMInterpolator::changeProjectionByCoordinates(int method, const string& pr
             lonLatVals2Matrix(lonVals, latVals, orgXDimSize, orgYDimSize);
         }
 
-        // get output axes expressed in latitude, longitude
-        const size_t fieldSize = out_x_axis.size() * out_y_axis.size();
-        auto pointsOnXAxis = make_shared_array<double>(fieldSize);
-        auto pointsOnYAxis = make_shared_array<double>(fieldSize);
-        reproject::reproject_axes(proj_input, LAT_LON_PROJSTR, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
-                                  &pointsOnYAxis[0]);
-        // here, pointOnX/YAxis is in degrees
-        if (method == MIFI_INTERPOL_COORD_NN) {
-            fastTranslatePointsToClosestInputCell(pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize, orgYDimSize);
-        } else if (method == MIFI_INTERPOL_COORD_NN_KD) {
-            double maxDistance = getMaxDistanceOfInterest(out_x_axis, out_y_axis);
+        if (method != MIFI_INTERPOL_COORD_NN && method != MIFI_INTERPOL_COORD_NN_KD) {
+            throw CDMException("unkown interpolation method for coordinates: " + type2string(method));
+        }
+        double maxDistance = 0;
+        if (method == MIFI_INTERPOL_COORD_NN_KD) {
+            maxDistance = getMaxDistanceOfInterest(out_x_axis, out_y_axis);
             if (isDegree) {
                 maxDistance *= MIFI_EARTH_RADIUS_M;
             }
-            flannTranslatePointsToClosestInputCell(maxDistance, pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize, orgYDimSize);
-        } else {
-            throw CDMException("unkown interpolation method for coordinates: " + type2string(method));
+        }
+
+        // get output axes expressed in latitude, longitude
+        const size_t fieldSize = out_x_axis.size() * out_y_axis.size();
+        key.add(method).add(proj_input).add(out_x_axis).add(out_y_axis).add(maxDistance).add(orgXDimSize).add(orgYDimSize);
+        shared_array<double> pointsOnXAxis, pointsOnYAxis;
+        if (!p_->loadPoints(key, fieldSize, pointsOnXAxis, pointsOnYAxis)) {
+            pointsOnXAxis = make_shared_array<double>(fieldSize);
+            pointsOnYAxis = make_shared_array<double>(fieldSize);
+            reproject::reproject_axes(proj_input, LAT_LON_PROJSTR, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
+                                      &pointsOnYAxis[0]);
+            // here, pointOnX/YAxis is in degrees
+            if (method == MIFI_INTERPOL_COORD_NN) {
+                fastTranslatePointsToClosestInputCell(pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize, orgYDimSize);
+            } else {
+                flannTranslatePointsToClosestInputCell(maxDistance, pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize,
+                                                       orgYDimSize, p_->kdTreePartSize);
+            }
+            p_->storePoints(key, fieldSize, pointsOnXAxis, pointsOnYAxis);
         }
 
         LOG4FIMEX(logger, Logger::DEBUG,
@@ -1383,20 +1617,27 @@ void CDMInterpolator::changeProjectionByProjectionParameters(int method, const s
 
         // calculate the mapping from the new projection points to the original axes pointsOnXAxis(x_new, y_new), pointsOnYAxis(x_new, y_new)
         const size_t fieldSize = out_x_axis.size() * out_y_axis.size();
-        auto pointsOnXAxis = make_shared_array<double>(fieldSize);
-        auto pointsOnYAxis = make_shared_array<double>(fieldSize);
         const std::string orgProjStr = cs->getProjection()->getProj4String();
-        reproject::reproject_axes(proj_input, orgProjStr, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
-                                  &pointsOnYAxis[0]);
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "mifi_project_axes: " << proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => " << pointsOnXAxis[0] << ","
-                                        << pointsOnYAxis[0]);
-
-        const int miupXAxis = isDegree ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
-        const int miupYAxis = isDegree ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
-        // translate coordinates (in deg or m) to indices
-        mifi_points2position(&pointsOnXAxis[0], fieldSize, orgXAxisValsArray.get(), orgXAxisSize, miupXAxis);
-        mifi_points2position(&pointsOnYAxis[0], fieldSize, orgYAxisValsArray.get(), orgYAxisSize, miupYAxis);
+        InterpolationGeometryCache::Key key("projection");
+        key.add(method).add(proj_input).add(out_x_axis).add(out_y_axis).add(orgProjStr);
+        key.add(orgXAxisValsArray.get(), orgXAxisSize).add(orgYAxisValsArray.get(), orgYAxisSize);
+        shared_array<double> pointsOnXAxis, pointsOnYAxis;
+        if (!p_->loadPoints(key, fieldSize, pointsOnXAxis, pointsOnYAxis)) {
+            pointsOnXAxis = make_shared_array<double>(fieldSize);
+            pointsOnYAxis = make_shared_array<double>(fieldSize);
+            reproject::reproject_axes(proj_input, orgProjStr, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
+                                      &pointsOnYAxis[0]);
+            LOG4FIMEX(logger, Logger::DEBUG,
+                      "mifi_project_axes: " << proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => " << pointsOnXAxis[0]
+                                            << "," << pointsOnYAxis[0]);
+
+            const int miupXAxis = isDegree ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
+            const int miupYAxis = isDegree ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
+            // translate coordinates (in deg or m) to indices
+            mifi_points2position(&pointsOnXAxis[0], fieldSize, orgXAxisValsArray.get(), orgXAxisSize, miupXAxis);
+            mifi_points2position(&pointsOnYAxis[0], fieldSize, orgYAxisValsArray.get(), orgYAxisSize, miupYAxis);
+            p_->storePoints(key, fieldSize, pointsOnXAxis, pointsOnYAxis);
+        }
 
         LOG4FIMEX(logger, Logger::DEBUG,
                   "creating cached projection interpolation matrix " << orgXAxisSize << "x" << orgYAxisSize << " => " << out_x_axis.size() << "x"
@@ -1410,8 +1651,14 @@ void CDMInterpolator::changeProjectionByProjectionParameters(int method, const s
             LOG4FIMEX(logger, Logger::DEBUG,
                       "creating cached vector projection interpolation matrix " << orgXAxisSize << "x" << orgYAxisSize << " => " << out_x_axis.size() << "x"
                                                                                 << out_y_axis.size());
-            reproject::Matrix_cp matrix = reproject::get_vector_reproject_matrix(orgProjStr, proj_input, &out_x_axis[0], &out_y_axis[0], outXAxisType,
-                                                                                 outYAxisType, out_x_axis.size(), out_y_axis.size());
+            InterpolationGeometryCache::Key vectorKey("vector");
+            vectorKey.add(orgProjStr).add(proj_input).add(out_x_axis).add(out_y_axis).add(outXAxisType).add(outYAxisType);
+            reproject::Matrix_cp matrix = p_->loadMatrix(vectorKey);
+            if (!matrix) {
+                matrix = reproject::get_vector_reproject_matrix(orgProjStr, proj_input, &out_x_axis[0], &out_y_axis[0], outXAxisType, outYAxisType,
+                                                                out_x_axis.size(), out_y_axis.size());
+                p_->storeMatrix(vectorKey, matrix);
+            }
             LOG4FIMEX(logger, Logger::DEBUG, "creating vector reprojection");
             p_->cachedVectorReprojection[csIt->first] = std::make_shared<CachedVectorReprojection>(matrix);
         }
@@ -1638,27 +1885,34 @@ void CDMInterpolator::changeProjectionByProjectionParametersToLatLonTemplate(int
 
         const std::string& orgProjStr = csp->getProj4String();
 
-        // store projection changes to be used in data-section
-        auto latY = clone(lat_deg, tmplLatVals->size());
-        auto lonX = clone(lon_deg, tmplLonVals->size());
-
-        // calculate the mapping from the new projection points to the original axes pointsOnXAxis(x_new, y_new), pointsOnYAxis(x_new, y_new)
-
-        // projects lat / lon from template to axis-projection found in model file
-        // we want to get template lat/long expressed in terms of the original projection
-        reproject::reproject_values(tmpl_proj_input, orgProjStr, &lonX[0], &latY[0], tmplLatVals->size());
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "mifi_project_values: " << tmpl_proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => " << lonX[0] << ","
-                                          << latY[0]);
+        InterpolationGeometryCache::Key key("template");
+        key.add(method).add(tmpl_proj_input).add(orgProjStr).add(lon_deg.get(), tmplLonVals->size()).add(lat_deg.get(), tmplLatVals->size());
+        key.add(orgXAxisArray.get(), def.xAxisData->size()).add(orgYAxisArray.get(), def.yAxisData->size());
+        shared_array<double> latY, lonX;
+        if (!p_->loadPoints(key, tmplLatVals->size(), lonX, latY)) {
+            // store projection changes to be used in data-section
+            latY = clone(lat_deg, tmplLatVals->size());
+            lonX = clone(lon_deg, tmplLonVals->size());
 
-        // now latVals and lonVals are given in original-input coordinates
-        // check if we have to translate original axes from deg2rad
-        const int miupXAxis = csp->isDegree() ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
-        const int miupYAxis = csp->isDegree() ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
+            // calculate the mapping from the new projection points to the original axes pointsOnXAxis(x_new, y_new), pointsOnYAxis(x_new, y_new)
 
-        // translate coordinates (in degrees) to indices
-        mifi_points2position(&latY[0], tmplLatVals->size(), orgYAxisArray.get(), def.yAxisData->size(), miupYAxis);
-        mifi_points2position(&lonX[0], tmplLonVals->size(), orgXAxisArray.get(), def.xAxisData->size(), miupXAxis);
+            // projects lat / lon from template to axis-projection found in model file
+            // we want to get template lat/long expressed in terms of the original projection
+            reproject::reproject_values(tmpl_proj_input, orgProjStr, &lonX[0], &latY[0], tmplLatVals->size());
+            LOG4FIMEX(logger, Logger::DEBUG,
+                      "mifi_project_values: " << tmpl_proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => " << lonX[0]
+                                              << "," << latY[0]);
+
+            // now latVals and lonVals are given in original-input coordinates
+            // check if we have to translate original axes from deg2rad
+            const int miupXAxis = csp->isDegree() ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
+            const int miupYAxis = csp->isDegree() ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
+
+            // translate coordinates (in degrees) to indices
+            mifi_points2position(&latY[0], tmplLatVals->size(), orgYAxisArray.get(), def.yAxisData->size(), miupYAxis);
+            mifi_points2position(&lonX[0], tmplLonVals->size(), orgXAxisArray.get(), def.xAxisData->size(), miupXAxis);
+            p_->storePoints(key, tmplLatVals->size(), lonX, latY);
+        }
 
         LOG4FIMEX(logger, Logger::DEBUG,
                   "creating cached projection interpolation matrix (" << csi.first << ") " << def.xAxisData->size() << "x" << def.yAxisData->size() << " => "
@@ -1673,8 +1927,13 @@ void CDMInterpolator::changeProjectionByProjectionParametersToLatLonTemplate(int
             LOG4FIMEX(logger, Logger::DEBUG, "creating cached vector projection interpolation matrix");
             const size_t outSize = tmplLatVals->size();
             // prepare interpolation of vectors
-            reproject::Matrix_cp matrix =
-                reproject::get_vector_reproject_matrix_points(orgProjStr, LAT_LON_PROJSTR, csp->isDegree() ? 0 : 1, &lon_deg[0], &lat_deg[0], outSize, 1);
+            InterpolationGeometryCache::Key vectorKey("template_vector");
+            vectorKey.add(orgProjStr).add(csp->isDegree() ? 0 : 1).add(lon_deg.get(), outSize).add(lat_deg.get(), outSize);
+            reproject::Matrix_cp matrix = p_->loadMatrix(vectorKey);
+            if (!matrix) {
+                matrix = reproject::get_vector_reproject_matrix_points(orgProjStr, LAT_LON_PROJSTR, csp->isDegree() ? 0 : 1, &lon_deg[0], &lat_deg[0], outSize, 1);
+                p_->storeMatrix(vectorKey, matrix);
+            }
             p_->cachedVectorReprojection[csi.first] = std::make_shared<CachedVectorReprojection>(matrix);
         }
     }
@@ -1746,12 +2005,14 @@ void CDMInterpolator::addPreprocess(InterpolatorProcess2d_p process)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "adding interpolation preprocess");
     p_->preprocesses.push_back(process);
+    p_->rotatedCounterparts.clear();
 }
 
 void CDMInterpolator::addPostprocess(InterpolatorProcess2d_p process)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "adding interpolation postprocess");
     p_->postprocesses.push_back(process);
+    p_->rotatedCounterparts.clear();
 }
 
 } // namespace MetNoFimex
@@ -220,6 +220,14 @@ DataPtr CDMMerger::getDataSlice(const std::string &varName, size_t unLimDimPos)
     return p->readerOverlay->getDataSlice(varName, unLimDimPos);
 }
 
+DataPtr CDMMerger::getDataSlice(const std::string& varName, const SliceBuilder& sb)
+{
+    if (not p->readerOverlay)
+        THROW("must call setTargetGrid or setTargetGridFromInner before getDataSlice");
+
+    return p->readerOverlay->getDataSlice(varName, sb);
+}
+
 // ========================================================================
 
 CDM CDMMergerPrivate::makeCDM(const string& proj, const values_v& tx, const values_v& ty,
@@ -32,6 +32,8 @@
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
 #include "fimex/MathUtils.h"
+#include "fimex/SliceBuilder.h"
+#include "fimex/coordSys/verticalTransform/VerticalTransformationUtils.h"
 
 #include "CDMMergeUtils.h"
 
@@ -89,25 +91,40 @@ DataPtr overlayDataSlices(T fillT, T fillB, DataPtr sliceT, DataPtr sliceB)
 } // namespace
 
 DataPtr CDMOverlay::getDataSlice(const std::string &varName, size_t unLimDimPos)
+{
+    const CDMVariable& variable = getCDM().getVariable(varName);
+    SliceBuilder sb(*cdm_, varName);
+    if (const CDMDimension* unlimDim = cdm_->getUnlimitedDim()) {
+        if (cdm_->hasUnlimitedDim(variable))
+            sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
+    }
+    return getDataSlice(varName, sb);
+}
+
+DataPtr CDMOverlay::getDataSlice(const std::string& varName, const SliceBuilder& sb)
 {
     const CDM& cdmT = p->readerT->getCDM();
+    const CDM& cdmB = p->interpolatedB->getCDM();
 
     // use cdmB if not defined in cdmT
     // get simple coordinate variables from readerT
     if (cdm_->hasDimension(varName) && cdmT.hasVariable(varName)) {
         // read dimension variables from top
-        return p->readerT->getDataSlice(varName, unLimDimPos); // not scaled
+        return p->readerT->getDataSlice(varName, adaptSliceBuilder(cdmT, varName, sb)); // not scaled
     }
 
     if (!cdmT.hasVariable(varName)) {
         // use complete base-data
-        return p->interpolatedB->getDataSlice(varName, unLimDimPos);
+        return p->interpolatedB->getDataSlice(varName, adaptSliceBuilder(cdmB, varName, sb));
     }
 
-    const CDM& cdmB = p->interpolatedB->getCDM();
     if (not cdmB.hasVariable(varName))
         THROW("variable '" << varName << "' unknown in base");
 
+    // base and top may differ in dimensions of length 1
+    const SliceBuilder sbT = adaptSliceBuilder(cdmT, varName, sb);
+    const SliceBuilder sbB = adaptSliceBuilder(cdmB, varName, sb);
+
     const std::string unitsT = cdmT.getUnits(varName);
     const std::string unitsB = cdmB.getUnits(varName);
 
@@ -119,8 +136,8 @@ DataPtr CDMOverlay::getDataSlice(const std::string &varName, size_t unLimDimPos)
         && cdmT.getScaleFactor(varName) == cdmB.getScaleFactor(varName)
         && cdmT.getAddOffset(varName) == cdmB.getAddOffset(varName))
     {
-        DataPtr sliceT = p->readerT->getDataSlice(varName, unLimDimPos);
-        DataPtr sliceB = p->interpolatedB->getDataSlice(varName, unLimDimPos);
+        DataPtr sliceT = p->readerT->getDataSlice(varName, sbT);
+        DataPtr sliceB = p->interpolatedB->getDataSlice(varName, sbB);
         if (dtT == CDM_FLOAT) {
             LOG4FIMEX(logger, Logger::DEBUG, "overlay using float without scaling");
             return overlayDataSlices<float>(cdmT.getFillValue(varName), cdmB.getFillValue(varName), sliceT, sliceB);
@@ -132,17 +149,17 @@ DataPtr CDMOverlay::getDataSlice(const std::string &varName, size_t unLimDimPos)
 
     // getScaledDataSlice always returns DataPtr with CDM_DOUBLE
     const bool emptyUnits = unitsT.empty() || unitsB.empty();
-    DataPtr sliceT = p->readerT->getScaledDataSlice(varName, unLimDimPos);
+    DataPtr sliceT = p->readerT->getScaledDataSlice(varName, sbT);
     DataPtr sliceB;
     if (emptyUnits || unitsT == unitsB) {
         if (emptyUnits) {
             LOG4FIMEX(logger, Logger::WARN,
                       "no unit conversion for variable '" << varName << "': units '" << unitsT << "' in top and '" << unitsB << "' in base");
         }
-        sliceB = p->interpolatedB->getScaledDataSlice(varName, unLimDimPos);
+        sliceB = p->interpolatedB->getScaledDataSlice(varName, sbB);
     } else {
         LOG4FIMEX(logger, Logger::INFO, "unit conversion for variable '" << varName << "' from '" << unitsB << "' in base to '" << unitsT << "' in top");
-        sliceB = p->interpolatedB->getScaledDataSliceInUnit(varName, unitsT, unLimDimPos);
+        sliceB = p->interpolatedB->getScaledDataSliceInUnit(varName, unitsT, sbB);
     }
 
     for (size_t i=0; i<sliceB->size(); ++i) {
@@ -154,7 +171,7 @@ DataPtr CDMOverlay::getDataSlice(const std::string &varName, size_t unLimDimPos)
     double scale=1, offset=0;
     getScaleAndOffsetOf(varName, scale, offset);
     return sliceB->convertDataType(MIFI_UNDEFINED_D, 1, 0,
-        cdm_->getVariable(varName).getDataType(),
+        getCDM().getVariable(varName).getDataType(),
         cdm_->getFillValue(varName), scale, offset);
 }
 
@@ -30,9 +30,11 @@
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
 #include "fimex/CDMReader.h"
+#include "fimex/CDMReaderUtils.h"
 #include "fimex/CDMVerticalInterpolator.h"
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
+#include "fimex/SliceBuilder.h"
 #include "fimex/coordSys/CoordinateSystem.h"
 #include "fimex/coordSys/verticalTransform/ToVLevelConverter.h"
 #include "fimex/coordSys/verticalTransform/VerticalTransformation.h"
@@ -104,7 +106,10 @@ public:
     const std::string& getName() const
         { return varName_; }
 
-    virtual DataPtr getDataSlice(size_t unLimDimPos) = 0;
+    /**
+     * @param sb slice of the converted variable
+     */
+    virtual DataPtr getDataSlice(const SliceBuilder& sb) = 0;
 
 private:
     std::string varName_;
@@ -209,7 +214,7 @@ public:
     {
     }
 
-    DataPtr getDataSlice(size_t unLimDimPos);
+    DataPtr getDataSlice(const SliceBuilder& sb);
 
 private:
     CDMReader_p reader_;
@@ -217,14 +222,14 @@ private:
     const std::string& theta_;
 };
 
-DataPtr ThetaTemperatureConverter::getDataSlice(size_t unLimDimPos)
+DataPtr ThetaTemperatureConverter::getDataSlice(const SliceBuilder& sb)
 {
-    DataPtr pressureData = verticalData4D(cs_, reader_, unLimDimPos, MIFI_VINT_PRESSURE);
+    DataPtr pressureData = verticalData4D(cs_, reader_, sb, MIFI_VINT_PRESSURE);
     auto pressureValues = dataAs<VerticalData_t>(pressureData);
     const size_t size = pressureData->size();
 
     const float add_offset = reader_->getCDM().getAddOffset(theta_);
-    auto thetaValues = checkData(reader_->getDataSlice(theta_, unLimDimPos), size, theta_)->asFloat();
+    auto thetaValues = checkData(reader_->getDataSlice(theta_, adaptSliceBuilder(reader_->getCDM(), theta_, sb)), size, theta_)->asFloat();
 
     const float cp = 1004.; // J/kgK
     const float R = MIFI_GAS_CONSTANT / MIFI_MOLAR_MASS_DRY_AIR; // J/K
@@ -301,7 +306,7 @@ public:
     {
     }
 
-    DataPtr getDataSlice(size_t unLimDimPos);
+    DataPtr getDataSlice(const SliceBuilder& sb);
 
 private:
     CDMReader_p reader_;
@@ -310,14 +315,14 @@ private:
     std::string temperature_;
 };
 
-DataPtr HumidityConverter::getDataSlice(size_t unLimDimPos)
+DataPtr HumidityConverter::getDataSlice(const SliceBuilder& sb)
 {
-    DataPtr pressureData = verticalData4D(cs_, reader_, unLimDimPos, MIFI_VINT_PRESSURE);
+    DataPtr pressureData = verticalData4D(cs_, reader_, sb, MIFI_VINT_PRESSURE);
     auto pressureValues = dataAs<VerticalData_t>(pressureData);
     const size_t size = pressureData->size();
 
-    auto shValues = checkData(reader_->getScaledDataSliceInUnit(specific_, "1", unLimDimPos), size, specific_)->asFloat();
-    auto airtValues = checkData(reader_->getScaledDataSliceInUnit(temperature_, "K", unLimDimPos), size, temperature_)->asFloat();
+    auto shValues = checkData(getSliceData(reader_, sb, specific_, "1"), size, specific_)->asFloat();
+    auto airtValues = checkData(getSliceData(reader_, sb, temperature_, "K"), size, temperature_)->asFloat();
     auto rhValues = make_shared_array<short>(size);
     for (size_t i = 0; i < size; i++) {
         // we have pressure in hPa and need Pa for
@@ -411,7 +416,7 @@ public:
     {
     }
 
-    DataPtr getDataSlice(size_t unLimDimPos);
+    DataPtr getDataSlice(const SliceBuilder& sb);
 
 private:
     CDMReader_p reader_;
@@ -420,13 +425,13 @@ private:
     std::string temperature_;
 };
 
-DataPtr OmegaVerticalConverter::getDataSlice(size_t unLimDimPos)
+DataPtr OmegaVerticalConverter::getDataSlice(const SliceBuilder& sb)
 {
-    DataPtr pressureData = verticalData4D(cs_, reader_, unLimDimPos, MIFI_VINT_PRESSURE);
+    DataPtr pressureData = verticalData4D(cs_, reader_, sb, MIFI_VINT_PRESSURE);
     auto pressureValues = dataAs<VerticalData_t>(pressureData); // unit: hPa
     const size_t size = pressureData->size();
-    VerticalDataArray airtempValues = dataAs<VerticalData_t>(checkData(reader_->getScaledDataSliceInUnit(temperature_, "K", unLimDimPos), size, temperature_));
-    VerticalDataArray omegaValues = dataAs<VerticalData_t>(checkData(reader_->getScaledDataSliceInUnit(omega_, "hPa/s", unLimDimPos), size, omega_));
+    VerticalDataArray airtempValues = dataAs<VerticalData_t>(checkData(getSliceData(reader_, sb, temperature_, "K"), size, temperature_));
+    VerticalDataArray omegaValues = dataAs<VerticalData_t>(checkData(getSliceData(reader_, sb, omega_, "hPa/s"), size, omega_));
 
     convert_omega_to_vertical_wind(size, omegaValues.get(), pressureValues.get(), airtempValues.get(), omegaValues.get());
     return createData(size, omegaValues);
@@ -498,7 +503,7 @@ public:
     {
     }
 
-    DataPtr getDataSlice(size_t unLimDimPos);
+    DataPtr getDataSlice(const SliceBuilder& sb);
 
 private:
     CDMReader_p reader_;
@@ -506,10 +511,10 @@ private:
     std::vector<std::string> shape4d_;
 };
 
-DataPtr AddPressure4DConverter::getDataSlice(size_t unLimDimPos)
+DataPtr AddPressure4DConverter::getDataSlice(const SliceBuilder& sb)
 {
     const CDM& rcdm = reader_->getCDM();
-    DataPtr vcdata = verticalData4D(vc_, rcdm, unLimDimPos);
+    DataPtr vcdata = verticalData4D(vc_, rcdm, sb);
     if (vc_->getShape() != shape4d_) {
         LOG4FIMEX(logger, Logger::WARN, "4d pressure shape change not implemented, results are probably wrong");
         // FIXME vcdata = reshape(rcdm, vc_->getShape(), shape4d_, vcdata);
@@ -695,9 +700,29 @@ DataPtr CDMPressureConversions::getDataSlice(const std::string& varName, size_t
     std::map<std::string, Converter_p>::const_iterator itC = p_->converters.find(varName);
     if (itC == p_->converters.end()) {
         return dataReader_->getDataSlice(varName, unLimDimPos);
+    }
+
+    SliceBuilder sb(*cdm_, varName);
+    if (const CDMDimension* unlimDim = cdm_->getUnlimitedDim()) {
+        if (cdm_->hasUnlimitedDim(getCDM().getVariable(varName)))
+            sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
+    }
+    return (itC->second)->getDataSlice(sb);
+}
+
+DataPtr CDMPressureConversions::getDataSlice(const std::string& varName, const SliceBuilder& sb)
+{
+    std::map<std::string, Converter_p>::const_iterator itC = p_->converters.find(varName);
+    if (itC == p_->converters.end()) {
+        return dataReader_->getDataSlice(varName, sb);
     } else {
-        return (itC->second)->getDataSlice(unLimDimPos);
+        return (itC->second)->getDataSlice(sb);
     }
 }
 
+std::vector<std::size_t> CDMPressureConversions::getChunkShape(const std::string& varName) const
+{
+    return forwardChunkShape(*dataReader_, varName, getCDM(), varName);
+}
+
 }
@@ -34,13 +34,19 @@
 #include "fimex/CachedVectorReprojection.h"
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
+#include "fimex/MathUtils.h"
+#include "fimex/MutexLock.h"
+#include "fimex/SliceBuilder.h"
 #include "fimex/Type2String.h"
 #include "fimex/coordSys/CoordinateAxis.h"
 #include "fimex/coordSys/CoordinateSystem.h"
 #include "fimex/coordSys/verticalTransform/HybridSigmaPressure1.h"
 #include "fimex/coordSys/verticalTransform/VerticalConverter.h"
+#include "fimex/coordSys/verticalTransform/VerticalTransformationUtils.h"
 #include "fimex/interpolation.h"
 
+#include "VectorPairCache.h"
+
 #include "fimex/reproject.h"
 
 #include <algorithm>
@@ -48,6 +54,10 @@
 #include <functional>
 #include <set>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace MetNoFimex
 {
 
@@ -62,10 +72,12 @@ typedef map<string, CoordinateSystem_cp> CoordSysMap;
 
 typedef std::shared_ptr<CachedVectorReprojection> CachedVectorReprojection_p;
 
-struct SliceCache {
-    string varName;
-    size_t ulimDimPos;
-    DataPtr data;
+//! state of accumulation and deaccumulation of one variable along the unlimited dimension
+struct UnlimitedSliceCache {
+    //! sums of the original slices [0, pos) by pos, undefined values in slice 0 replaced with 0
+    map<size_t, DataPtr> sums;
+    //! original slices by pos
+    map<size_t, DataPtr> slices;
 };
 
 struct VerticalVelocityComps {
@@ -103,12 +115,20 @@ struct CDMProcessor::CDMProcessorImpl
     map<string, pair<string, string> > rotateLatLonVectorY;
     // horizontalId -> cachedVectorReprojection
     map<string, CachedVectorReprojection_p> cachedVectorReprojection;
-    SliceCache sliceCache;
+    // rotated counterparts of recently requested vector components
+    VectorPairCache rotatedCounterparts;
+    // variable -> accumulation/deaccumulation cache, accessed from parallel getDataSlice calls
+    OmpMutex unlimitedSliceCacheMutex;
+    map<string, UnlimitedSliceCache> unlimitedSliceCache;
     VerticalVelocityComps vvComp;
 
     VerticalConverter_p altitudeConverter;
     string geopotentialHeightTemperatureVar;
     string geopotentialHeightVar;
+
+    bool isRotatedPair(const string& varName, const string& counterpart) const;
+    DataPtr accumulateSlice(const string& varName, size_t unLimDimPos, DataPtr data);
+    DataPtr deaccumulateSlice(const string& varName, size_t unLimDimPos, DataPtr data, DataPtr original);
 };
 
 CachedVectorReprojection_p makeCachedVectorReprojection(CDMReader_p dataReader, CoordinateSystem_cp cs, bool toLatLon)
@@ -383,6 +403,7 @@ void CDMProcessor::addVerticalVelocity()
 
 void CDMProcessor::accumulate(const std::string& varName)
 {
+    p_->rotatedCounterparts.clear();
     const CDMVariable& variable = cdm_->getVariable(varName);
     if (cdm_->hasUnlimitedDim(variable)) {
         p_->accumulateVars.insert(varName);
@@ -393,6 +414,7 @@ void CDMProcessor::accumulate(const std::string& varName)
 
 void CDMProcessor::deAccumulate(const std::string& varName)
 {
+    p_->rotatedCounterparts.clear();
     const CDMVariable& variable = cdm_->getVariable(varName);
     if (cdm_->hasUnlimitedDim(variable)) {
         p_->deaccumulateVars.insert(varName);
@@ -437,6 +459,7 @@ void CDMProcessor::rotateVectorToLatLon(bool toLatLon, const std::vector<std::st
     }
     if (varNameX.empty())
         return;
+    p_->rotatedCounterparts.clear();
 
     CoordSysMap coordSysMap;
     map<string, string> projectionVariables;
@@ -486,6 +509,7 @@ void CDMProcessor::rotateDirectionToLatLon(bool toLatLon, const std::vector<std:
 {
     if (varNames.empty())
         return;
+    p_->rotatedCounterparts.clear();
 
     CoordSysMap coordSysMap;
     map<string, string> projectionVariables;
@@ -532,32 +556,314 @@ struct UnScaleOffset
     }
 };
 
-static void replaceNanWith0(shared_array<double> dp, size_t n)
+namespace {
+
+// number of sums or slices kept per variable, such that each thread can continue its own sequence
+size_t maxCachedUnlimitedSlices()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads() + 1;
+#else
+    return 2;
+#endif
+}
+
+void insertUnlimitedSlice(map<size_t, DataPtr>& cache, size_t pos, DataPtr data)
+{
+    cache[pos] = data;
+    while (cache.size() > maxCachedUnlimitedSlices())
+        cache.erase(cache.begin());
+}
+
+// add slice to sum, allocating sum for the first non-empty slice; in step 0, undef is replaced with 0
+void addSliceToSum(shared_array<double>& sum, size_t& sumSize, DataPtr slice, bool firstTimeStep)
+{
+    const size_t size = slice->size();
+    if (size == 0)
+        return;
+    if (!sum) {
+        sumSize = size;
+        sum = make_shared_array<double>(sumSize);
+        std::fill(&sum[0], &sum[0] + sumSize, 0.);
+    } else if (size != sumSize) {
+        throw CDMException("cannot accumulate slices of different size " + type2string(size) + " and " + type2string(sumSize));
+    }
+    auto s = slice->asDouble();
+    for (size_t i = 0; i < size; ++i)
+        sum[i] += (firstTimeStep && mifi_isnan(s[i])) ? 0 : s[i];
+}
+
+} // namespace
+
+// the rotated counterpart only equals a separate request if neither component is modified otherwise
+bool CDMProcessor::CDMProcessorImpl::isRotatedPair(const string& varName, const string& counterpart) const
+{
+    for (const string& v : {varName, counterpart}) {
+        if (accumulateVars.count(v) || deaccumulateVars.count(v) || rotateLatLonDirection.count(v) || v == geopotentialHeightVar)
+            return false;
+    }
+    return true;
+}
+
+DataPtr CDMProcessor::CDMProcessorImpl::accumulateSlice(const string& varName, size_t unLimDimPos, DataPtr data)
+{
+    // continue from the latest sum at or before unLimDimPos; a sum exactly at unLimDimPos
+    // is taken over, as in-order access will not need it again, other sums are copied
+    size_t start = 0;
+    shared_array<double> sum;
+    size_t sumSize = 0;
+    {
+        OmpScopedLock lock(unlimitedSliceCacheMutex);
+        map<size_t, DataPtr>& sums = unlimitedSliceCache[varName].sums;
+        map<size_t, DataPtr>::iterator it = sums.upper_bound(unLimDimPos);
+        if (it != sums.begin()) {
+            --it;
+            start = it->first;
+            if ((sumSize = it->second->size()) != 0) {
+                if (start == unLimDimPos) {
+                    sum = it->second->asDouble();
+                } else {
+                    auto c = it->second->asDouble();
+                    sum = make_shared_array<double>(sumSize);
+                    std::copy(&c[0], &c[0] + sumSize, &sum[0]);
+                }
+            }
+            if (start == unLimDimPos)
+                sums.erase(it);
+        }
+    }
+    for (size_t i = start; i < unLimDimPos; ++i)
+        addSliceToSum(sum, sumSize, dataReader->getDataSlice(varName, i), i == 0);
+
+    DataPtr accumulated = data;
+    if (unLimDimPos > 0 && sum) { // cannot accumulate first
+        if (data->size() != 0 && data->size() != sumSize)
+            throw CDMException("cannot accumulate slices of different size " + type2string(data->size()) + " and " + type2string(sumSize));
+        auto out = make_shared_array<double>(sumSize);
+        if (data->size() != 0) {
+            auto d = data->asDouble();
+            for (size_t i = 0; i < sumSize; ++i)
+                out[i] = d[i] + sum[i];
+        } else {
+            std::copy(&sum[0], &sum[0] + sumSize, &out[0]);
+        }
+        accumulated = createData(sumSize, out);
+    }
+
+    // the sum for the next slice
+    addSliceToSum(sum, sumSize, data, unLimDimPos == 0);
+    {
+        OmpScopedLock lock(unlimitedSliceCacheMutex);
+        insertUnlimitedSlice(unlimitedSliceCache[varName].sums, unLimDimPos + 1, sum ? createData(sumSize, sum) : createData(CDM_DOUBLE, 0));
+    }
+    return accumulated;
+}
+
+DataPtr CDMProcessor::CDMProcessorImpl::deaccumulateSlice(const string& varName, size_t unLimDimPos, DataPtr data, DataPtr original)
 {
-    mifi_nand2bad(&dp[0], &dp[0]+n, 0);
+    DataPtr previous;
+    {
+        OmpScopedLock lock(unlimitedSliceCacheMutex);
+        map<size_t, DataPtr>& slices = unlimitedSliceCache[varName].slices;
+        if (unLimDimPos > 0) {
+            map<size_t, DataPtr>::const_iterator it = slices.find(unLimDimPos - 1);
+            if (it != slices.end())
+                previous = it->second;
+        }
+        insertUnlimitedSlice(slices, unLimDimPos, original);
+    }
+    if (unLimDimPos == 0) // cannot deaccumulate first
+        return data;
+    if (!previous)
+        previous = dataReader->getDataSlice(varName, unLimDimPos - 1);
+
+    const size_t size = data->size();
+    if (size == 0 || previous->size() == 0)
+        return data;
+    if (size != previous->size())
+        throw CDMException("cannot deaccumulate slices of different size " + type2string(size) + " and " + type2string(previous->size()));
+    auto d = data->asDouble();
+    auto dp = previous->asDouble();
+    auto out = make_shared_array<double>(size);
+    // in step 0, replace undef with 0
+    const bool firstTimeStep = (unLimDimPos == 1);
+    for (size_t i = 0; i < size; ++i)
+        out[i] = d[i] - ((firstTimeStep && mifi_isnan(dp[i])) ? 0 : dp[i]);
+    return createData(size, out);
+}
+
+// accumulate and/or deaccumulate the slices [start, start+size) along the unlimited dimension,
+// raw contains the original slices [rawStart, start+size)
+static DataPtr accumulateSlices(DataPtr raw, size_t rawStart, size_t start, size_t size, bool accumulate, bool deaccumulate)
+{
+    const size_t rawSize = start + size - rawStart;
+    if (raw->size() == 0 || rawSize == 0)
+        return raw;
+    const size_t sliceSize = raw->size() / rawSize;
+    auto r = raw->asDouble();
+    auto out = make_shared_array<double>(size * sliceSize);
+    // sum of all previous slices, in step 0, undef is replaced with 0
+    vector<double> sum(accumulate ? sliceSize : 0, 0.);
+    for (size_t t = rawStart; t < start + size; ++t) {
+        const double* rt = &r[(t - rawStart) * sliceSize];
+        if (t >= start) {
+            double* ot = &out[(t - start) * sliceSize];
+            for (size_t i = 0; i < sliceSize; ++i)
+                ot[i] = (accumulate && t > 0) ? rt[i] + sum[i] : rt[i];
+            if (deaccumulate && t > 0) {
+                const double* rp = rt - sliceSize;
+                for (size_t i = 0; i < sliceSize; ++i)
+                    ot[i] -= (t == 1 && mifi_isnan(rp[i])) ? 0 : rp[i];
+            }
+        }
+        if (accumulate) {
+            for (size_t i = 0; i < sliceSize; ++i)
+                sum[i] += (t == 0 && mifi_isnan(rt[i])) ? 0 : rt[i];
+        }
+    }
+    return createData(size * sliceSize, out);
+}
+
+// restrict the vector reprojection to the horizontal part of sb, requires x and y to be the first dimensions
+static CachedVectorReprojection_p subsetVectorReprojection(CachedVectorReprojection_p cvr, const CDM& cdm, const CDMVariable& variable, const SliceBuilder& sb)
+{
+    const vector<string>& shape = variable.getShape();
+    if (shape.size() < 2 || cdm.getDimension(shape[0]).getLength() != cvr->getXSize() || cdm.getDimension(shape[1]).getLength() != cvr->getYSize())
+        return CachedVectorReprojection_p();
+
+    size_t xStart, xSize, yStart, ySize;
+    sb.getStartAndSize(shape[0], xStart, xSize);
+    sb.getStartAndSize(shape[1], yStart, ySize);
+    if (xStart == 0 && xSize == cvr->getXSize() && yStart == 0 && ySize == cvr->getYSize())
+        return cvr;
+    return cvr->subset(xStart, xSize, yStart, ySize);
 }
 
-// add d2 to d1 and return d1
-static void addDataP2Data(DataPtr& data, DataPtr& dataP, bool addingFirstTimeStep) {
-    if ((data->size() != 0) && (dataP->size() != 0)) {
-        assert(data->size() == dataP->size());
-        auto d = data->asDouble();
-        auto dp = dataP->asDouble();
-        if (addingFirstTimeStep) {
-            // in step 0, replace undef with 0
-            replaceNanWith0(dp, dataP->size());
+DataPtr CDMProcessor::getDataSlice(const std::string& varName, const SliceBuilder& sb)
+{
+    LOG4FIMEX(logger, Logger::DEBUG, "getDataSlice for '" << varName << "' with sliceBuilder");
+    const CDMVariable& variable = getCDM().getVariable(varName);
+    if (varName == "upward_air_velocity_ml" && p_->vvComp.xWind != "") {
+        // requires horizontal derivatives of the complete field
+        return CDMReader::getDataSlice(varName, sb);
+    }
+
+    // vector and direction rotation, restricted to the requested horizontal region
+    map<string, pair<string, string> >::const_iterator itRotX = p_->rotateLatLonVectorX.find(varName);
+    map<string, pair<string, string> >::const_iterator itRotY = p_->rotateLatLonVectorY.find(varName);
+    map<string, string>::const_iterator itDir = p_->rotateLatLonDirection.find(varName);
+    CachedVectorReprojection_p cvrVector, cvrDirection;
+    if (itRotX != p_->rotateLatLonVectorX.end() || itRotY != p_->rotateLatLonVectorY.end()) {
+        const string& csId = (itRotX != p_->rotateLatLonVectorX.end()) ? itRotX->second.second : itRotY->second.second;
+        cvrVector = subsetVectorReprojection(p_->cachedVectorReprojection[csId], *cdm_, variable, sb);
+        if (!cvrVector)
+            return CDMReader::getDataSlice(varName, sb);
+    }
+    if (itDir != p_->rotateLatLonDirection.end()) {
+        cvrDirection = subsetVectorReprojection(p_->cachedVectorReprojection[itDir->second], *cdm_, variable, sb);
+        if (!cvrDirection)
+            return CDMReader::getDataSlice(varName, sb);
+    }
+    string counterpart;
+    bool pairedVector = false;
+    if (cvrVector) {
+        counterpart = (itRotX != p_->rotateLatLonVectorX.end()) ? itRotX->second.first : itRotY->second.first;
+        pairedVector = p_->isRotatedPair(varName, counterpart);
+        if (pairedVector) {
+            if (DataPtr rotated = p_->rotatedCounterparts.take(varName, VectorPairCache::sliceKey(sb)))
+                return rotated;
+        }
+    }
+
+    // extend the request along the unlimited dimension if previous slices are required
+    const bool accumulate = p_->accumulateVars.find(varName) != p_->accumulateVars.end();
+    const bool deaccumulate = p_->deaccumulateVars.find(varName) != p_->deaccumulateVars.end();
+    SliceBuilder sbRead(sb);
+    size_t unLimStart = 0, unLimSize = 0, readStart = 0;
+    if (accumulate || deaccumulate) {
+        const CDMDimension* unLimDimPtr = cdm_->getUnlimitedDim();
+        if (!unLimDimPtr)
+            throw CDMException("cannot (de)accumulate '" + varName + "' without unlimited dimension");
+        const std::string& unLimDim = unLimDimPtr->getName();
+        sb.getStartAndSize(unLimDim, unLimStart, unLimSize);
+        readStart = accumulate ? 0 : ((unLimStart > 0) ? unLimStart - 1 : 0);
+        sbRead.setStartAndSize(unLimDim, readStart, unLimStart + unLimSize - readStart);
+    }
+
+    DataPtr data;
+    if (varName == p_->geopotentialHeightVar && p_->altitudeConverter != nullptr) {
+        data = p_->altitudeConverter->getDataSlice(sbRead);
+    } else {
+        data = p_->dataReader->getDataSlice(varName, sbRead);
+    }
+
+    if (accumulate || deaccumulate) {
+        LOG4FIMEX(logger, Logger::DEBUG, varName << " at slices " << unLimStart << "+" << unLimSize << " (de)accumulate");
+        data = accumulateSlices(data, readStart, unLimStart, unLimSize, accumulate, deaccumulate);
+    }
+
+    if (cvrVector) {
+        if (deaccumulate) {
+            LOG4FIMEX(logger, Logger::WARN, varName << " deaccumulate and rotated, this won't work as expected");
+        }
+        const bool xIsFirst = (itRotX != p_->rotateLatLonVectorX.end());
+        DataPtr counterpartData = p_->dataReader->getDataSlice(counterpart, adaptSliceBuilder(p_->dataReader->getCDM(), counterpart, sb));
+        if (data->size() != counterpartData->size()) {
+            throw CDMException("xData != yData in vectorInterpolation");
+        }
+        auto array = data2InterpolationArray(data, getCDM().getFillValue(varName));
+        auto counterpartArray = data2InterpolationArray(counterpartData, getCDM().getFillValue(counterpart));
+        if (xIsFirst) {
+            cvrVector->reprojectValues(array, counterpartArray, data->size());
+        } else {
+            cvrVector->reprojectValues(counterpartArray, array, data->size());
+        }
+        if (pairedVector) {
+            p_->rotatedCounterparts.put(counterpart, VectorPairCache::sliceKey(sb),
+                                        interpolationArray2Data(getCDM().getVariable(counterpart).getDataType(), counterpartArray, data->size(),
+                                                                getCDM().getFillValue(counterpart)));
+        }
+        data = interpolationArray2Data(variable.getDataType(), array, data->size(), getCDM().getFillValue(varName));
+    }
+
+    if (cvrDirection) {
+        if (deaccumulate) {
+            LOG4FIMEX(logger, Logger::WARN, varName << " deaccumulate and rotated, this won't work as expected");
         }
-        // this might modify the original data in the reader
-        std::transform(&d[0], &d[0]+data->size(), &dp[0], &d[0], std::plus<double>());
-        data = createData(data->size(), d);
-    } else if (dataP->size() != 0) {
-        data = dataP; // data->size was 0
+        auto array = data2InterpolationArray(data, getCDM().getFillValue(varName));
+        double addOffset = 0.;
+        double scaleFactor = 1.;
+        getScaleAndOffsetOf(varName, scaleFactor, addOffset);
+        transform(&array[0], &array[0] + data->size(), &array[0], ScaleOffset<float>(scaleFactor, addOffset));
+        cvrDirection->reprojectDirectionValues(array, data->size());
+        transform(&array[0], &array[0] + data->size(), &array[0], UnScaleOffset<float>(scaleFactor, addOffset));
+        data = interpolationArray2Data(variable.getDataType(), array, data->size(), getCDM().getFillValue(varName));
     }
+
+    return data;
+}
+
+std::vector<std::size_t> CDMProcessor::getChunkShape(const std::string& varName) const
+{
+    return forwardChunkShape(*p_->dataReader, varName, getCDM(), varName);
 }
 
 DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "getDataSlice for '" << varName << "' at " << unLimDimPos);
+    // counterpart of a vector rotated in a previous request
+    map<string, pair<string, string> >::const_iterator itRotX = p_->rotateLatLonVectorX.find(varName);
+    map<string, pair<string, string> >::const_iterator itRotY = p_->rotateLatLonVectorY.find(varName);
+    bool pairedVector = false;
+    if (itRotX != p_->rotateLatLonVectorX.end() || itRotY != p_->rotateLatLonVectorY.end()) {
+        const string& counterpart = (itRotX != p_->rotateLatLonVectorX.end()) ? itRotX->second.first : itRotY->second.first;
+        pairedVector = p_->isRotatedPair(varName, counterpart);
+        if (pairedVector) {
+            if (DataPtr rotated = p_->rotatedCounterparts.take(varName, VectorPairCache::sliceKey(unLimDimPos)))
+                return rotated;
+        }
+    }
+
     DataPtr data;
     if (varName == "upward_air_velocity_ml" && p_->vvComp.xWind != "") {
         CDMReader_p reader = p_->dataReader;
@@ -596,7 +902,7 @@ DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPo
         // create a slice-builder from unLimDimPos
         SliceBuilder sb(*cdm_, p_->geopotentialHeightTemperatureVar);
         if (const CDMDimension* unlimDim = cdm_->getUnlimitedDim()) {
-            if (cdm_->getVariable(p_->geopotentialHeightTemperatureVar).checkDimension(unlimDim->getName()))
+            if (getCDM().getVariable(p_->geopotentialHeightTemperatureVar).checkDimension(unlimDim->getName()))
                 sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
         }
         data = p_->altitudeConverter->getDataSlice(sb);
@@ -604,50 +910,15 @@ DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPo
         data = p_->dataReader->getDataSlice(varName, unLimDimPos);
     }
 
-    // accumulation
+    // accumulation and deaccumulation
+    const DataPtr original = data;
     if (p_->accumulateVars.find(varName) != p_->accumulateVars.end()) {
         LOG4FIMEX(logger, Logger::DEBUG, varName << " at slice " << unLimDimPos << " accumulate");
-        if (unLimDimPos > 0) { // cannot accumulate first
-            size_t start = 0;
-            if (p_->sliceCache.varName == varName && p_->sliceCache.ulimDimPos <= unLimDimPos) {
-                start = p_->sliceCache.ulimDimPos + 1;
-                if (p_->sliceCache.ulimDimPos == unLimDimPos) {
-                    data = p_->sliceCache.data;
-                } else {
-                    DataPtr dataP = p_->sliceCache.data;
-                    addDataP2Data(data, dataP, false);
-                }
-            }
-            // data contains last slice + eventually cache
-            for (size_t i = start; i <= unLimDimPos-1; ++i) {
-                DataPtr dataP = p_->dataReader->getDataSlice(varName, i);
-                addDataP2Data(data, dataP, i == 0);
-            }
-            // fill the cache
-            p_->sliceCache.varName = varName;
-            p_->sliceCache.ulimDimPos = unLimDimPos;
-            p_->sliceCache.data = data;
-        }
+        data = p_->accumulateSlice(varName, unLimDimPos, data);
     }
-
-    // deaccumulation
     if (p_->deaccumulateVars.find(varName) != p_->deaccumulateVars.end()) {
         LOG4FIMEX(logger, Logger::DEBUG, varName << " at slice " << unLimDimPos << " deaccumulate");
-        if (unLimDimPos != 0) { // cannot deaccumulate first
-            DataPtr dataP = p_->dataReader->getDataSlice(varName, unLimDimPos-1);
-            if ((data->size() != 0) && (dataP->size() != 0)) {
-                assert(data->size() == dataP->size());
-                auto d = data->asDouble();
-                auto dp = dataP->asDouble();
-                if (unLimDimPos == 1) {
-                    // in step 0, replace undef with 0
-                    replaceNanWith0(dp, dataP->size());
-                }
-                // this might modify the original data in the reader
-                std::transform(&d[0], &d[0]+data->size(), &dp[0], &d[0], std::minus<double>());
-                data = createData(data->size(), d);
-            }
-        }
+        data = p_->deaccumulateSlice(varName, unLimDimPos, data, original);
     }
 
     if (p_->rotateLatLonVectorX.find(varName) != p_->rotateLatLonVectorX.end()
@@ -682,6 +953,12 @@ DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPo
             throw CDMException("xData != yData in vectorInterpolation");
         }
         cvr->reprojectValues(xArray, yArray, xData->size());
+        const string& counterpart = xIsFirst ? yVar : xVar;
+        if (pairedVector) {
+            p_->rotatedCounterparts.put(counterpart, VectorPairCache::sliceKey(unLimDimPos),
+                                        interpolationArray2Data(getCDM().getVariable(counterpart).getDataType(), xIsFirst ? yArray : xArray, xData->size(),
+                                                                getCDM().getFillValue(counterpart)));
+        }
         CDMDataType type = getCDM().getVariable(varName).getDataType();
         if (xIsFirst) {
             data = interpolationArray2Data(type, xArray, xData->size(), getCDM().getFillValue(xVar));
@@ -27,13 +27,17 @@
 #include "fimex/CDMQualityExtractor.h"
 #include "fimex/CDM.h"
 #include "fimex/CDMFileReaderFactory.h"
+#include "fimex/CDMReaderUtils.h"
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
+#include "fimex/MathUtils.h"
+#include "fimex/SliceBuilder.h"
 #include "fimex/String2Type.h"
 #include "fimex/TokenizeDotted.h"
 #include "fimex/XMLDoc.h"
 #include "fimex/XMLUtils.h"
 #include "fimex/mifi_constants.h"
+#include "fimex/coordSys/verticalTransform/VerticalTransformationUtils.h"
 
 #include <algorithm>
 #include <regex>
@@ -259,131 +263,222 @@ DataPtr CDMQualityExtractor::getDataSlice(const std::string& varName, size_t unL
             }
         }
 
-        const CDM& cdmS = readerS->getCDM();
-        const size_t sizeD = data->size(), sizeS = statusData->size();
-        if (sizeD == 0 && sizeS == 0) {
-            // special case: only undefined data
-            const CDMVariable& var = cdm_->getVariable(varName);
-            const vector<string>& shape = var.getShape();
-            size_t length = 1;
-            size_t sliceDims = cdm_->hasUnlimitedDim(var) ? shape.size()-1 : shape.size();
-            for (size_t i = 0; i < sliceDims; ++i) {
-                length *= cdm_->getDimension(shape.at(i)).getLength();
-            }
+        // special case of only undefined data: the length of a complete slice
+        const CDMVariable& var = getCDM().getVariable(varName);
+        const vector<string>& shape = var.getShape();
+        size_t length = 1;
+        size_t sliceDims = cdm_->hasUnlimitedDim(var) ? shape.size()-1 : shape.size();
+        for (size_t i = 0; i < sliceDims; ++i) {
+            length *= getCDM().getDimension(shape.at(i)).getLength();
+        }
+        data = applyStatus(varName, data, statusData, readerS->getCDM(), length);
+    }
+    return data;
+}
+
+bool CDMQualityExtractor::isStatusSliceable(const std::string& varName, const CDM& cdmS, const std::string& statusVar) const
+{
+    // highest/lowest are determined from the complete status slice
+    std::map<std::string, std::string>::const_iterator fit = variableFlags.find(varName);
+    if (fit != variableFlags.end() && (fit->second == "highest" || fit->second == "lowest"))
+        return false;
+
+    // the status shape must be the leading (fastest) part of the variable shape
+    const vector<string>& shape = getCDM().getVariable(varName).getShape();
+    const CDMVariable& varS = cdmS.getVariable(statusVar);
+    vector<string> shapeS = varS.getShape();
+    if (cdmS.hasUnlimitedDim(varS))
+        shapeS.pop_back();
+    if (shapeS.size() > shape.size())
+        return false;
+    return std::equal(shapeS.begin(), shapeS.end(), shape.begin());
+}
 
-            // return undefined data with new fill-value
-            return createData(cdm_->getVariable(varName).getDataType(), length, variableFill[varName]);
+DataPtr CDMQualityExtractor::getDataSlice(const std::string& varName, const SliceBuilder& sb)
+{
+    // no change in cdm-data in CDMQualityExtractor, so no need to check for in-memory data
+
+    std::map<std::string, std::string>::const_iterator svit = statusVariable.find(varName);
+    if (svit == statusVariable.end())
+        return dataReader->getDataSlice(varName, sb);
+
+    const string& statusVar = svit->second;
+    const std::map<std::string, CDMReader_p>::const_iterator sit = statusReaders.find(varName);
+    const CDMReader_p readerS = (sit != statusReaders.end()) ? sit->second : dataReader;
+    const CDM& cdmS = readerS->getCDM();
+    if (!isStatusSliceable(varName, cdmS, statusVar))
+        return CDMReader::getDataSlice(varName, sb);
+
+    // status data might only be available for the first unlimited position, so process each position separately
+    const CDMVariable& var = getCDM().getVariable(varName);
+    size_t unLimStart = 0, unLimSize = 1;
+    std::string unLimDim;
+    if (cdm_->hasUnlimitedDim(var)) {
+        unLimDim = cdm_->getUnlimitedDim()->getName();
+        sb.getStartAndSize(unLimDim, unLimStart, unLimSize);
+    }
+    const CDM& cdmStatus = (sit != statusReaders.end()) ? cdmS : *cdm_;
+    const CDMDimension* unLimDimS = cdmStatus.getUnlimitedDim();
+    const bool statusHasUnLim = unLimDimS && cdmStatus.hasUnlimitedDim(cdmStatus.getVariable(statusVar));
+
+    vector<DataPtr> slices;
+    slices.reserve(unLimSize);
+    SliceBuilder sbPos(sb);
+    for (size_t pos = unLimStart; pos < unLimStart + unLimSize; ++pos) {
+        if (!unLimDim.empty())
+            sbPos.setStartAndSize(unLimDim, pos, 1);
+        DataPtr data = dataReader->getDataSlice(varName, sbPos);
+        DataPtr statusData;
+        if (statusVar == varName) {
+            // reuse data in case of own status data
+            statusData = data;
+        } else {
+            SliceBuilder sbS = adaptSliceBuilder(cdmStatus, statusVar, sbPos);
+            // reading statusData after applying QualityExtractor if not from a separate reader
+            CDMReader& statusReader = (sit != statusReaders.end()) ? *readerS : static_cast<CDMReader&>(*this);
+            statusData = statusReader.getDataSlice(statusVar, sbS);
+            if (statusData->size() == 0 && statusHasUnLim) {
+                sbS.setStartAndSize(unLimDimS->getName(), 0, 1); // get the default slice
+                statusData = statusReader.getDataSlice(statusVar, sbS);
+            }
         }
-        const double sizeRatio = double(sizeD)/sizeS;
-        if (sizeRatio == int(sizeRatio) && sizeRatio >= 1) {
-            auto sd = statusData->asDouble();
-            vector<double> useVals;
-            if (variableValues.find(varName) != variableValues.end()) {
-                useVals = variableValues[varName];
-                sort(useVals.begin(), useVals.end());
-            } else if (variableFlags.find(varName) != variableFlags.end()) {
-                const string& flag = variableFlags[varName];
-                double statusFill = cdmS.getFillValue(statusVar);
-                double minFlag = MIFI_UNDEFINED_D;
-                double maxFlag = MIFI_UNDEFINED_D;
-                CDMAttribute attr;
-                if (cdmS.getAttribute(statusVar, "valid_min", attr)) {
-                    minFlag = attr.getData()->asDouble()[0];
-                }
-                if (cdmS.getAttribute(statusVar, "valid_max", attr)) {
-                    maxFlag = attr.getData()->asDouble()[0];
-                }
-                if (cdmS.getAttribute(statusVar, "valid_range", attr)) {
-                    minFlag = attr.getData()->asDouble()[0];
-                    maxFlag = attr.getData()->asDouble()[1];
-                }
-                if (!std::isnan(minFlag)) {
-                    double* sdIt = &sd[0];
-                    while (sdIt != &sd[sizeS]) {
-                        if (*sdIt < minFlag) {
-                            *sdIt = MIFI_UNDEFINED_D;
-                        }
-                        sdIt++;
+        slices.push_back(applyStatus(varName, data, statusData, cdmS, product(sbPos.getDimensionSizes())));
+    }
+    if (slices.size() == 1)
+        return slices.front();
+
+    const size_t sliceSize = product(sbPos.getDimensionSizes());
+    DataPtr data = createData(var.getDataType(), slices.size() * sliceSize, variableFill[varName]);
+    for (size_t i = 0; i < slices.size(); ++i) {
+        if (slices[i]->size() == sliceSize)
+            data->setValues(i * sliceSize, *slices[i]);
+    }
+    return data;
+}
+
+std::vector<std::size_t> CDMQualityExtractor::getChunkShape(const std::string& varName) const
+{
+    return forwardChunkShape(*dataReader, varName, getCDM(), varName);
+}
+
+DataPtr CDMQualityExtractor::applyStatus(const std::string& varName, DataPtr data, DataPtr statusData, const CDM& cdmS, size_t undefinedLength)
+{
+    const string& statusVar = statusVariable[varName];
+    const size_t sizeD = data->size(), sizeS = statusData->size();
+    if (sizeD == 0 && sizeS == 0) {
+        // special case: only undefined data
+        // return undefined data with new fill-value
+        return createData(getCDM().getVariable(varName).getDataType(), undefinedLength, variableFill[varName]);
+    }
+    const double sizeRatio = double(sizeD)/sizeS;
+    if (sizeRatio == int(sizeRatio) && sizeRatio >= 1) {
+        auto sd = statusData->asDouble();
+        vector<double> useVals;
+        if (variableValues.find(varName) != variableValues.end()) {
+            useVals = variableValues[varName];
+            sort(useVals.begin(), useVals.end());
+        } else if (variableFlags.find(varName) != variableFlags.end()) {
+            const string& flag = variableFlags[varName];
+            double statusFill = cdmS.getFillValue(statusVar);
+            double minFlag = MIFI_UNDEFINED_D;
+            double maxFlag = MIFI_UNDEFINED_D;
+            CDMAttribute attr;
+            if (cdmS.getAttribute(statusVar, "valid_min", attr)) {
+                minFlag = attr.getData()->asDouble()[0];
+            }
+            if (cdmS.getAttribute(statusVar, "valid_max", attr)) {
+                maxFlag = attr.getData()->asDouble()[0];
+            }
+            if (cdmS.getAttribute(statusVar, "valid_range", attr)) {
+                minFlag = attr.getData()->asDouble()[0];
+                maxFlag = attr.getData()->asDouble()[1];
+            }
+            if (!std::isnan(minFlag)) {
+                double* sdIt = &sd[0];
+                while (sdIt != &sd[sizeS]) {
+                    if (*sdIt < minFlag) {
+                        *sdIt = MIFI_UNDEFINED_D;
                     }
+                    sdIt++;
                 }
-                if (!std::isnan(maxFlag)) {
-                    double* sdIt = &sd[0];
-                    while (sdIt != &sd[sizeS]) {
-                        if (*sdIt > maxFlag) {
-                            *sdIt = MIFI_UNDEFINED_D;
-                        }
-                        sdIt++;
+            }
+            if (!std::isnan(maxFlag)) {
+                double* sdIt = &sd[0];
+                while (sdIt != &sd[sizeS]) {
+                    if (*sdIt > maxFlag) {
+                        *sdIt = MIFI_UNDEFINED_D;
                     }
+                    sdIt++;
                 }
-                if (!std::isnan(statusFill)) {
-                    double* sdIt = &sd[0];
-                    while (sdIt != &sd[sizeS]) {
-                        if (*sdIt == statusFill) {
-                            *sdIt = MIFI_UNDEFINED_D;
-                        }
-                        sdIt++;
+            }
+            if (!std::isnan(statusFill)) {
+                double* sdIt = &sd[0];
+                while (sdIt != &sd[sizeS]) {
+                    if (*sdIt == statusFill) {
+                        *sdIt = MIFI_UNDEFINED_D;
                     }
+                    sdIt++;
                 }
-                std::smatch match;
-                if (flag == "all") {
-                    // no more to do
-                } else if (std::regex_match(flag, match, std::regex("max:(.+)"))) {
-                    double max = string2type<double>(match[1]);
-                    LOG4FIMEX(logger, Logger::DEBUG, "using max="<<max<<" for statusVar "<<statusVar<< " on var "<< varName);
-                    double* sdIt = &sd[0];
-                    while (sdIt != &sd[sizeS]) {
-                        if (*sdIt > max) {
-                            *sdIt = MIFI_UNDEFINED_D;
-                        }
-                        sdIt++;
-                    }
-                } else if (std::regex_match(flag, match, std::regex("min:(.+)"))) {
-                    double min = string2type<double>(match[1]);
-                    double* sdIt = &sd[0];
-                    size_t count = 0;
-                    while (sdIt != &sd[sizeS]) {
-                        if (*sdIt < min) {
-                            *sdIt = MIFI_UNDEFINED_D;
-                            ++count;
-                        }
-                        sdIt++;
+            }
+            std::smatch match;
+            if (flag == "all") {
+                // no more to do
+            } else if (std::regex_match(flag, match, std::regex("max:(.+)"))) {
+                double max = string2type<double>(match[1]);
+                LOG4FIMEX(logger, Logger::DEBUG, "using max="<<max<<" for statusVar "<<statusVar<< " on var "<< varName);
+                double* sdIt = &sd[0];
+                while (sdIt != &sd[sizeS]) {
+                    if (*sdIt > max) {
+                        *sdIt = MIFI_UNDEFINED_D;
                     }
-                    LOG4FIMEX(logger, Logger::DEBUG, "using min="<<min<<" for statusVar "<<statusVar<< " on var "<< varName << ": removed points: " << count);
-                } else if (flag == "highest") {
-                    double testVal = findDefinedExtreme(&sd[0], &sd[sizeS], &max<double>);
-                    if (!std::isnan(testVal))
-                        useVals.push_back(testVal);
-                } else if (flag == "lowest") {
-                    double testVal = findDefinedExtreme(&sd[0], &sd[sizeS], &min<double>);
-                    if (!std::isnan(testVal))
-                        useVals.push_back(testVal);
-                } else {
-                    throw CDMException("undefined quality-flag: "+flag+" for variable: "+varName);
+                    sdIt++;
                 }
-            }
-            if (useVals.size() > 0) {
-                // useVals are externally given flag-values or internally derived min/max
+            } else if (std::regex_match(flag, match, std::regex("min:(.+)"))) {
+                double min = string2type<double>(match[1]);
                 double* sdIt = &sd[0];
+                size_t count = 0;
                 while (sdIt != &sd[sizeS]) {
-                    if (!binary_search(useVals.begin(), useVals.end(), *sdIt)) {
+                    if (*sdIt < min) {
                         *sdIt = MIFI_UNDEFINED_D;
+                        ++count;
                     }
                     sdIt++;
                 }
+                LOG4FIMEX(logger, Logger::DEBUG, "using min="<<min<<" for statusVar "<<statusVar<< " on var "<< varName << ": removed points: " << count);
+            } else if (flag == "highest") {
+                double testVal = findDefinedExtreme(&sd[0], &sd[sizeS], &max<double>);
+                if (!std::isnan(testVal))
+                    useVals.push_back(testVal);
+            } else if (flag == "lowest") {
+                double testVal = findDefinedExtreme(&sd[0], &sd[sizeS], &min<double>);
+                if (!std::isnan(testVal))
+                    useVals.push_back(testVal);
+            } else {
+                throw CDMException("undefined quality-flag: "+flag+" for variable: "+varName);
             }
-            double fillValue = variableFill[varName];
-            for(size_t iD = 0; iD < sizeD; ) {
-                double *sdIt = &sd[0];
-                for (size_t iS = 0; iS < sizeS; ++iS, ++iD) {
-                    if (std::isnan(*sdIt)) {
-                        data->setValue(iD, fillValue);
-                    }
-                    ++sdIt;
+        }
+        if (useVals.size() > 0) {
+            // useVals are externally given flag-values or internally derived min/max
+            double* sdIt = &sd[0];
+            while (sdIt != &sd[sizeS]) {
+                if (!binary_search(useVals.begin(), useVals.end(), *sdIt)) {
+                    *sdIt = MIFI_UNDEFINED_D;
                 }
+                sdIt++;
             }
-        } else {
-            LOG4FIMEX(logger, Logger::WARN, "incompatible size in data of variable and statusVariable at slice "<< unLimDimPos << ": "<<varName << ","<<statusVar<<": "<< data->size() << "<>" << statusData->size());
         }
+        double fillValue = variableFill[varName];
+        for(size_t iD = 0; iD < sizeD; ) {
+            double *sdIt = &sd[0];
+            for (size_t iS = 0; iS < sizeS; ++iS, ++iD) {
+                if (std::isnan(*sdIt)) {
+                    data->setValue(iD, fillValue);
+                }
+                ++sdIt;
+            }
+        }
+    } else {
+        LOG4FIMEX(logger, Logger::WARN, "incompatible size in data of variable and statusVariable: "<<varName << ","<<statusVar<<": "<< data->size() << "<>" << statusData->size());
     }
     return data;
 }
@@ -91,7 +91,7 @@ DataPtr CDMReader::getDataSlice(const std::string& varName, const SliceBuilder&
 {
     using namespace std;
     DataPtr retData;
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         retData = variable.getData()->slice(sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
     } else {
@@ -147,7 +147,7 @@ DataPtr CDMReader::getDataSlice(const std::string& varName, const SliceBuilder&
 
 DataPtr CDMReader::getData(const std::string& varName)
 {
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         return variable.getData()->clone();
     } else {
@@ -167,6 +167,11 @@ DataPtr CDMReader::getData(const std::string& varName)
     }
 }
 
+std::vector<std::size_t> CDMReader::getChunkShape(const std::string&) const
+{
+    return std::vector<std::size_t>();
+}
+
 void CDMReader::getScaleAndOffsetOf(const std::string& varName, double& scale, double& offset) const
 {
     scale = cdm_->getScaleFactor(varName);
@@ -36,6 +36,7 @@
 #include "fimex/coordSys/CoordinateSystem.h"
 #include "fimex/coordSys/Projection.h"
 
+#include <algorithm>
 #include <cassert>
 #include <map>
 #include <memory>
@@ -57,11 +58,8 @@ FimexTime getUniqueForecastReferenceTimeFT(CDMReader_p reader)
         TimeUnit tu(units);
         DataPtr timeData = reader->getData(varname);
         auto times = timeData->asDouble();
-        const double* tPtr = &times[0];
-        const double* end = tPtr + timeData->size();
-        while (tPtr != end) {
-            refTimes.insert(tu.unitTime2fimexTime(*tPtr++));
-        }
+        const vector<FimexTime> fiTimes = tu.unitTimes2fimexTimes(times.get(), timeData->size());
+        refTimes.insert(fiTimes.begin(), fiTimes.end());
     }
     if (refTimes.empty()) {
         // try WRF-Convention SIMULATION_START_DATE attribute
@@ -160,6 +158,26 @@ bool compareCDMVarShapes(const CDM& cdm1, const string& varName1, const CDM& cdm
     return true;
 }
 
+vector<size_t> forwardChunkShape(const CDMReader& source, const string& sourceVarName, const CDM& cdm, const string& varName)
+{
+    const CDM& sourceCDM = source.getCDM();
+    if (!cdm.hasVariable(varName) || !sourceCDM.hasVariable(sourceVarName))
+        return vector<size_t>();
+    const vector<string>& shape = cdm.getVariable(varName).getShape();
+    if (sourceCDM.getVariable(sourceVarName).getShape().size() != shape.size())
+        return vector<size_t>();
+
+    vector<size_t> chunkShape = source.getChunkShape(sourceVarName);
+    if (chunkShape.size() != shape.size())
+        return vector<size_t>();
+    for (size_t i = 0; i < shape.size(); i++) {
+        const CDMDimension& dim = cdm.getDimension(shape[i]);
+        if (!dim.isUnlimited())
+            chunkShape[i] = std::max(size_t(1), std::min(chunkShape[i], dim.getLength()));
+    }
+    return chunkShape;
+}
+
 string findUniqueDimVarName(const CDM& cdm, const string& baseVar)
 {
     if (!(cdm.hasVariable(baseVar) || cdm.hasDimension(baseVar)))
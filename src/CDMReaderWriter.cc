@@ -66,7 +66,7 @@ DataPtr CDMReaderWriter::unscaleDataOf(const std::string& varName, DataPtr data,
     double scale, offset;
     getScaleAndOffsetOf(varName, scale, offset);
     const double outFillValue = cdm_->getFillValue(varName);
-    return data->convertDataType(MIFI_UNDEFINED_D, unitScale, unitOffset, cdm_->getVariable(varName).getDataType(), outFillValue, scale, offset);
+    return data->convertDataType(MIFI_UNDEFINED_D, unitScale, unitOffset, getCDM().getVariable(varName).getDataType(), outFillValue, scale, offset);
 }
 
 DataPtr CDMReaderWriter::unscaleDataOf(const std::string& varName, DataPtr data, UnitsConverter_p uc)
@@ -75,7 +75,7 @@ DataPtr CDMReaderWriter::unscaleDataOf(const std::string& varName, DataPtr data,
     double scale, offset;
     getScaleAndOffsetOf(varName, scale, offset);
     const double outFillValue = cdm_->getFillValue(varName);
-    return data->convertDataType(MIFI_UNDEFINED_D, 1., 0., uc, cdm_->getVariable(varName).getDataType(), outFillValue, scale, offset);
+    return data->convertDataType(MIFI_UNDEFINED_D, 1., 0., uc, getCDM().getVariable(varName).getDataType(), outFillValue, scale, offset);
 }
 
 
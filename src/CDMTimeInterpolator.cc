@@ -28,9 +28,11 @@
 
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
+#include "fimex/CDMReaderUtils.h"
 #include "fimex/Data.h"
 #include "fimex/DataUtils.h"
 #include "fimex/Logger.h"
+#include "fimex/SliceBuilder.h"
 #include "fimex/TimeSpec.h"
 #include "fimex/Units.h"
 #include "fimex/coordSys/CoordinateSystem.h"
@@ -88,56 +90,131 @@ CDMTimeInterpolator::~CDMTimeInterpolator()
 {
 }
 
+// interpolate between d1 and d2, or use the defined one, or return undefined
+static DataPtr interpolateTimeSlice(const std::string& varName, DataPtr d1, DataPtr d2, double d1Time, double d2Time, double currentTime)
+{
+    LOG4FIMEX(logger, Logger::DEBUG, "interpolation between " << d1Time << " and " << d2Time << " at " << currentTime);
+    if (d1->size() == 0) {
+        return d2;
+    } else if (d2->size() == 0) {
+        return d1;
+    } else if (d1->size() == d2->size()) {
+        auto out = make_shared_array<float>(d1->size());
+        mifi_get_values_linear_weak_extrapol_f(d1->asFloat().get(), d2->asFloat().get(), out.get(), d1->size(), d1Time, d2Time, currentTime);
+        return createData(d1->size(), out);
+    } else {
+        throw CDMException("getDataSlice for " + varName + ": got slices with different size");
+    }
+}
+
+bool CDMTimeInterpolator::isTimeAxisChanged(const std::string& timeAxis) const
+{
+    if (timeAxis.empty())
+        return false;
+    std::map<std::string, std::vector<double> >::const_iterator it = dataReaderTimesInNewUnits_.find(timeAxis);
+    return (it != dataReaderTimesInNewUnits_.end() && !it->second.empty());
+}
+
 DataPtr CDMTimeInterpolator::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
     const std::string timeAxis = getTimeAxis(coordSystems_, varName);
     LOG4FIMEX(logger, Logger::DEBUG, "getting time-interpolated data-slice for " << varName << " with time-axis: " << timeAxis);
-    if (timeAxis.empty() || (dataReaderTimesInNewUnits_.find(timeAxis)->second.size() == 0)) {
+    if (!isTimeAxisChanged(timeAxis)) {
         // not time-axis or "changeTimeAxis" never called
         // no changes, simply forward
         return dataReader_->getDataSlice(varName, unLimDimPos);
     }
 
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         return getDataSliceFromMemory(variable, unLimDimPos);
     }
 
-    // interpolate the data
-    DataPtr data;
+    SliceBuilder sb(*cdm_, varName);
+    if (const CDMDimension* unlimDim = cdm_->getUnlimitedDim()) {
+        if (cdm_->hasUnlimitedDim(variable))
+            sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
+    }
+    return getDataSlice(varName, sb);
+}
+
+DataPtr CDMTimeInterpolator::getDataSlice(const std::string& varName, const SliceBuilder& sb)
+{
+    const std::string timeAxis = getTimeAxis(coordSystems_, varName);
+    LOG4FIMEX(logger, Logger::DEBUG, "getting time-interpolated data-slice for " << varName << " with time-axis: " << timeAxis << " and sliceBuilder");
+    if (!isTimeAxisChanged(timeAxis)) {
+        return dataReader_->getDataSlice(varName, sb);
+    }
 
-    // if unlimdim = time-axis, fetch all needed original slices
-    const CDMDimension& timeDim = cdm_->getDimension(timeAxis);
-    if (timeDim.isUnlimited()) {
-        double currentTime = getDataSliceFromMemory(cdm_->getVariable(timeAxis), unLimDimPos)->asDouble()[0];
-        // interpolate and return the time-slices
-        pair<size_t, size_t> orgTimes = timeChangeMap_.find(timeAxis)->second.at(unLimDimPos);
-        double d1Time = dataReaderTimesInNewUnits_.find(timeDim.getName())->second.at(orgTimes.first);
-        double d2Time = dataReaderTimesInNewUnits_.find(timeDim.getName())->second.at(orgTimes.second);
-        DataPtr d1 = dataReader_->getDataSlice(varName, orgTimes.first);
-        DataPtr d2 = dataReader_->getDataSlice(varName, orgTimes.second);
-        LOG4FIMEX(logger, Logger::DEBUG, "interpolation between " << d1Time << " and " << d2Time << " at " << currentTime);
-        // convert if both slices are defined, otherwise, simply use the defined one or return undefined
-        if (d1->size() == 0) {
-            data = d2;
-        } else if (d2->size() == 0) {
-            data = d1;
-        } else if (d1->size() == d2->size()) {
-            auto out = make_shared_array<float>(d1->size());
-            mifi_get_values_linear_weak_extrapol_f(d1->asFloat().get(), d2->asFloat().get(), out.get(), d1->size(), d1Time, d2Time, currentTime);
-            data = createData(d1->size(), out);
-        } else {
-            throw CDMException("getDataSlice for " + varName + ": got slices with different size");
-        }
-    } else {
+    const CDMVariable& variable = getCDM().getVariable(varName);
+    if (variable.hasData()) {
+        return getDataSliceFromMemory(variable, sb);
+    }
+
+    const CDMDimension& timeDim = getCDM().getDimension(timeAxis);
+    if (!timeDim.isUnlimited()) {
         // TODO
         // else get original slice, subslice the needed time-slices
         // interpolate and return the time-slices
         throw CDMException("TimeDimension != unlimited dimension not implemented yet in CDMTimeInterpolator");
     }
+
+    // same region in the original data, time is set for each original step
+    SliceBuilder orgSb(dataReader_->getCDM(), varName);
+    size_t timeStart = 0, timeSize = 0;
+    const vector<string> dimNames = sb.getDimensionNames();
+    for (size_t i = 0; i < dimNames.size(); ++i) {
+        if (dimNames[i] == timeAxis) {
+            timeStart = sb.getDimensionStartPositions().at(i);
+            timeSize = sb.getDimensionSizes().at(i);
+        } else {
+            orgSb.setStartAndSize(dimNames[i], sb.getDimensionStartPositions().at(i), sb.getDimensionSizes().at(i));
+        }
+    }
+
+    const vector<pair<size_t, size_t> >& timeMapping = timeChangeMap_.find(timeAxis)->second;
+    const vector<double>& orgTimes = dataReaderTimesInNewUnits_.find(timeAxis)->second;
+    DataPtr currentTimeData = getCDM().getVariable(timeAxis).getData()->slice(vector<size_t>(1, timeDim.getLength()), vector<size_t>(1, timeStart), vector<size_t>(1, timeSize));
+    auto newTimes = currentTimeData->asDouble();
+
+    // original slices are shared between consecutive new time-steps
+    map<size_t, DataPtr> orgSlices;
+    vector<DataPtr> slices(timeSize);
+    size_t sliceSize = 0;
+    for (size_t t = 0; t < timeSize; ++t) {
+        const pair<size_t, size_t>& orgPos = timeMapping.at(timeStart + t);
+        DataPtr orgData[2];
+        const size_t orgPositions[2] = {orgPos.first, orgPos.second};
+        for (int i = 0; i < 2; ++i) {
+            DataPtr& d = orgSlices[orgPositions[i]];
+            if (!d) {
+                orgSb.setStartAndSize(timeAxis, orgPositions[i], 1);
+                d = dataReader_->getDataSlice(varName, orgSb);
+            }
+            orgData[i] = d;
+        }
+        slices[t] = interpolateTimeSlice(varName, orgData[0], orgData[1], orgTimes.at(orgPos.first), orgTimes.at(orgPos.second), newTimes[t]);
+        sliceSize = std::max(sliceSize, slices[t]->size());
+        // the last original steps might still be needed for the next new time-step
+        orgSlices.erase(orgSlices.begin(), orgSlices.lower_bound(orgPos.first));
+    }
+    if (timeSize == 1 || sliceSize == 0) {
+        return slices.empty() ? createData(CDM_FLOAT, 0) : slices.front();
+    }
+
+    DataPtr data = createData(CDM_FLOAT, timeSize * sliceSize, cdm_->getFillValue(varName));
+    for (size_t t = 0; t < timeSize; ++t) {
+        if (slices[t]->size() == sliceSize)
+            data->setValues(t * sliceSize, *slices[t]);
+    }
     return data;
 }
 
+std::vector<std::size_t> CDMTimeInterpolator::getChunkShape(const std::string& varName) const
+{
+    return forwardChunkShape(*dataReader_, varName, getCDM(), varName);
+}
+
 void CDMTimeInterpolator::changeTimeAxis(const string& timeSpec)
 {
     // changing time-axes
@@ -152,11 +229,9 @@ void CDMTimeInterpolator::changeTimeAxis(const string& timeSpec)
             DataPtr times = dataReader_->getScaledData(timeDimName);
             string unit = cdm_->getUnits(timeDimName);
             const TimeUnit tu(unit);
-            vector<FimexTime> oldTimes;
             auto oldTimesPtr = times->asDouble();
             size_t nEl = times->size();
-            std::transform(oldTimesPtr.get(), oldTimesPtr.get() + nEl, std::back_inserter(oldTimes),
-                           std::bind(std::mem_fn(&TimeUnit::unitTime2fimexTime), tu, std::placeholders::_1));
+            vector<FimexTime> oldTimes = tu.unitTimes2fimexTimes(oldTimesPtr.get(), nEl);
             const TimeSpec ts(timeSpec, oldTimes[0], oldTimes[nEl - 1]);
 
             // create mapping of new time value positions to old time values (per time-axis)
@@ -193,7 +268,8 @@ void CDMTimeInterpolator::changeTimeAxis(const string& timeSpec)
             cdm_->addOrReplaceAttribute(timeDimName, CDMAttribute("units", ts.getUnitString()));
             auto timeData = make_shared_array<double>(newTimes.size());
             const TimeUnit newTU(ts.getUnitString());
-            std::transform(newTimes.begin(), newTimes.end(), timeData.get(), [newTU](const FimexTime& ft) { return newTU.fimexTime2unitTime(ft); });
+            const vector<double> newUnitTimes = newTU.fimexTimes2unitTimes(newTimes);
+            std::copy(newUnitTimes.begin(), newUnitTimes.end(), timeData.get());
             auto& timeVar = cdm_->getVariable(timeDimName);
             timeVar.setDataType(CDM_DOUBLE);
             timeVar.setData(createData(newTimes.size(), timeData));
@@ -32,7 +32,9 @@
 #include "fimex/Data.h"
 #include "fimex/FindNeighborElements.h"
 #include "fimex/Logger.h"
+#include "fimex/MutexLock.h"
 #include "fimex/StringUtils.h"
+#include "fimex/Type2String.h"
 #include "fimex/coordSys/CoordinateAxis.h"
 #include "fimex/coordSys/verticalTransform/ToVLevelConverter.h"
 #include "fimex/interpolation.h"
@@ -41,18 +43,16 @@
 #include "coordSys/CoordSysUtils.h"
 
 #include "fimex/ArrayLoop.h"
-#include "leap_iterator.h"
 #include "fimex/coordSys/verticalTransform/VerticalTransformationUtils.h"
 
 #include <algorithm>
 #include <iterator>
+#include <list>
+#include <map>
 #include <regex>
 #include <string>
 #include <vector>
 
-// define to enable debug logging statements inside loops in getLevelDataSlice (slow)
-// #define ENABLE_LOG_DEBUG_IN_LOOPS 1
-
 namespace MetNoFimex {
 
 namespace {
@@ -118,6 +118,132 @@ void replaceZaxis(CDM& cdm, CoordinateSystem_cp cs, const std::string& varName,
     }
 }
 
+typedef int (*VerticalInterpolationFunc)(const float* infieldA, const float* infieldB, float* outfield, const size_t n, const double a, const double b,
+                                         const double x);
+
+/**
+ * Neighbor search in a contiguous column of vertical values.
+ *
+ * Returns the same positions as find_closest_neighbor_distinct_elements. For
+ * strictly monotonic columns, the search walks from the result of the previous
+ * call, so that consecutive (monotonic) output levels are found in a single sweep
+ * through the column.
+ */
+class ColumnNeighbors
+{
+public:
+    ColumnNeighbors(const float* values, size_t n)
+        : v_(values)
+        , n_(n)
+        , order_(0)
+        , hint_(0)
+    {
+        if (n_ < 2)
+            return;
+        bool increasing = true, decreasing = true;
+        for (size_t i = 1; i < n_; ++i) {
+            increasing &= (v_[i - 1] < v_[i]);
+            decreasing &= (v_[i - 1] > v_[i]);
+        }
+        order_ = increasing ? 1 : (decreasing ? -1 : 0);
+    }
+
+    std::pair<size_t, size_t> find(float x)
+    {
+        // x == v_[0] is left to find_closest_neighbor_distinct_elements, which has no neighbors in that case
+        if (order_ > 0 && x > v_[0] && x < v_[n_ - 1]) {
+            // v_[hint_] <= x < v_[hint_+1]
+            while (v_[hint_] > x)
+                --hint_;
+            while (v_[hint_ + 1] <= x)
+                ++hint_;
+            return std::make_pair(hint_, hint_ + 1);
+        } else if (order_ < 0 && x >= v_[n_ - 1] && x < v_[0]) {
+            // v_[hint_] > x >= v_[hint_+1]
+            while (v_[hint_] <= x)
+                --hint_;
+            while (v_[hint_ + 1] > x)
+                ++hint_;
+            return std::make_pair(hint_ + 1, hint_);
+        }
+        // not monotonic, or extrapolating
+        return find_closest_neighbor_distinct_elements(v_, v_ + n_, x);
+    }
+
+private:
+    const float* v_;
+    size_t n_;
+    int order_;
+    size_t hint_;
+};
+
+//! input and output of the vertical interpolation of all columns of one slice
+struct ColumnInterpolation
+{
+    size_t nzi, nzo;
+    size_t idataZdelta, iverticalZdelta, odataZdelta, overticalZdelta;
+    const float* iData;
+    const float* iVertical;
+    const float* oVertical; // 0 if interpolating to level1
+    const double* level1;
+    const double* valueMin; // 0 if no minimum
+    const double* valueMax; // 0 if no maximum
+    float* oData;
+
+    //! start indexes of each column, arrayCount values per column
+    std::vector<size_t> columns;
+    size_t arrayCount;
+    size_t IN, IN_VERTICAL, OUT, OUT_VERTICAL, VALID_MIN, VALID_MAX;
+};
+
+template <VerticalInterpolationFunc intFunc>
+void interpolateColumns(const ColumnInterpolation& ci)
+{
+    const size_t nColumns = ci.columns.size() / ci.arrayCount;
+#ifdef _OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+        std::vector<float> iVerticalColumn(ci.nzi);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (size_t c = 0; c < nColumns; c++) {
+            const size_t* loop = &ci.columns[c * ci.arrayCount];
+
+            // copy the strided input column to contiguous memory
+            const float* iv = &ci.iVertical[loop[ci.IN_VERTICAL]];
+            for (size_t ki = 0; ki < ci.nzi; ki++)
+                iVerticalColumn[ki] = iv[ki * ci.iverticalZdelta];
+            ColumnNeighbors neighbors(&iVerticalColumn[0], ci.nzi);
+
+            const double vMin = ci.valueMin ? ci.valueMin[loop[ci.VALID_MIN]] : 0;
+            const double vMax = ci.valueMax ? ci.valueMax[loop[ci.VALID_MAX]] : 0;
+            for (size_t k = 0; k < ci.nzo; k++) {
+                const size_t verticalOutIdx = loop[ci.OUT_VERTICAL] + k * ci.overticalZdelta;
+                const double verticalOut = ci.oVertical ? ci.oVertical[verticalOutIdx] : ci.level1[verticalOutIdx];
+                float* interpolated = &ci.oData[loop[ci.OUT] + k * ci.odataZdelta];
+
+                if ((ci.valueMin && !(verticalOut >= vMin)) || (ci.valueMax && !(verticalOut <= vMax))) {
+                    // not a valid z
+                    *interpolated = MIFI_UNDEFINED_F;
+                    continue;
+                }
+
+                const std::pair<size_t, size_t> pos = neighbors.find(verticalOut);
+                if (pos.first != pos.second) {
+                    const float valueI0 = ci.iData[loop[ci.IN] + ci.idataZdelta * pos.first];
+                    const float valueI1 = ci.iData[loop[ci.IN] + ci.idataZdelta * pos.second];
+                    intFunc(&valueI0, &valueI1, interpolated, 1, iVerticalColumn[pos.first], iVerticalColumn[pos.second], verticalOut);
+                } else {
+                    // find_closest_neighbor_distinct_elements failed
+                    *interpolated = MIFI_UNDEFINED_F;
+                }
+            }
+        }
+    }
+}
+
 } // namespace
 
 using namespace std;
@@ -139,13 +265,100 @@ struct CDMVerticalInterpolator::Impl
     bool ignoreValidityMin;
     bool ignoreValidityMax;
 
+    // cache of converters and vertical fields, shared by all variables
+    mutable OmpMutex cacheMutex;
+    // coordinate systems of the interpolated cdm, for interpolateToAxis
+    bool haveOutputCoordSys;
+    CoordinateSystem_cp_v outputCoordSys;
+    // converters by side and coordinate-system id
+    map<string, VerticalConverter_p> converters;
+    // vertical fields by side, coordinate-system id and unlimited position, most recently used first
+    list<pair<string, DataPtr>> verticalFields;
+    size_t maxVerticalFields;
+    CacheStatistics stats;
+
     Impl();
+
+    CoordinateSystem_cp_v getOutputCoordSys(CDMReader_p self);
+    VerticalConverter_p getConverter(const string& side, CoordinateSystem_cp cs, CDMReader_p reader);
+    DataPtr getVerticalData(const string& side, CoordinateSystem_cp cs, VerticalConverter_p converter, const CDM& cdm, size_t unLimDimPos);
 };
 
 CDMVerticalInterpolator::Impl::Impl()
     : interpolateToAxis(false)
     , ignoreValidityMin(false)
     , ignoreValidityMax(false)
+    , haveOutputCoordSys(false)
+    , maxVerticalFields(8)
+{
+}
+
+CoordinateSystem_cp_v CDMVerticalInterpolator::Impl::getOutputCoordSys(CDMReader_p self)
+{
+    OmpScopedLock lock(cacheMutex);
+    if (!haveOutputCoordSys) {
+        outputCoordSys = listCoordinateSystems(self);
+        haveOutputCoordSys = true;
+    }
+    return outputCoordSys;
+}
+
+VerticalConverter_p CDMVerticalInterpolator::Impl::getConverter(const string& side, CoordinateSystem_cp cs, CDMReader_p reader)
+{
+    const string key = side + ":" + cs->id();
+    {
+        OmpScopedLock lock(cacheMutex);
+        map<string, VerticalConverter_p>::const_iterator it = converters.find(key);
+        if (it != converters.end())
+            return it->second;
+    }
+
+    // create the converter without holding the lock, it may read data
+    VerticalConverter_p converter = verticalConverter(cs, reader, verticalType);
+
+    OmpScopedLock lock(cacheMutex);
+    return converters.insert(make_pair(key, converter)).first->second;
+}
+
+DataPtr CDMVerticalInterpolator::Impl::getVerticalData(const string& side, CoordinateSystem_cp cs, VerticalConverter_p converter, const CDM& cdm,
+                                                       size_t unLimDimPos)
+{
+    const string key = side + ":" + cs->id() + ":" + type2string(unLimDimPos);
+    {
+        OmpScopedLock lock(cacheMutex);
+        stats.requests += 1;
+        for (list<pair<string, DataPtr>>::iterator it = verticalFields.begin(); it != verticalFields.end(); ++it) {
+            if (it->first == key) {
+                stats.hits += 1;
+                verticalFields.splice(verticalFields.begin(), verticalFields, it);
+                return it->second;
+            }
+        }
+    }
+
+    // compute the field without holding the lock; concurrent requests for
+    // the same field might compute it twice, but only one copy is kept
+    DataPtr data = verticalData4D(converter, cdm, unLimDimPos);
+
+    OmpScopedLock lock(cacheMutex);
+    if (maxVerticalFields == 0)
+        return data;
+    for (list<pair<string, DataPtr>>::const_iterator it = verticalFields.begin(); it != verticalFields.end(); ++it) {
+        if (it->first == key)
+            return it->second;
+    }
+    verticalFields.push_front(make_pair(key, data));
+    while (verticalFields.size() > maxVerticalFields) {
+        verticalFields.pop_back();
+        stats.evictions += 1;
+    }
+    return data;
+}
+
+CDMVerticalInterpolator::CacheStatistics::CacheStatistics()
+    : requests(0)
+    , hits(0)
+    , evictions(0)
 {
 }
 
@@ -206,6 +419,22 @@ void CDMVerticalInterpolator::ignoreValidityMax(bool ignore)
     pimpl_->ignoreValidityMax = ignore;
 }
 
+void CDMVerticalInterpolator::setVerticalCacheSize(size_t maxFields)
+{
+    OmpScopedLock lock(pimpl_->cacheMutex);
+    pimpl_->maxVerticalFields = maxFields;
+    while (pimpl_->verticalFields.size() > maxFields) {
+        pimpl_->verticalFields.pop_back();
+        pimpl_->stats.evictions += 1;
+    }
+}
+
+CDMVerticalInterpolator::CacheStatistics CDMVerticalInterpolator::getCacheStatistics() const
+{
+    OmpScopedLock lock(pimpl_->cacheMutex);
+    return pimpl_->stats;
+}
+
 void CDMVerticalInterpolator::interpolateToFixed(const std::vector<double>& level1)
 {
     pimpl_->level1 = level1;
@@ -340,7 +569,7 @@ void CDMVerticalInterpolator::interpolateByTemplateVariable(const std::string& t
 
 DataPtr CDMVerticalInterpolator::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         return getDataSliceFromMemory(variable, unLimDimPos);
     }
@@ -360,31 +589,20 @@ DataPtr CDMVerticalInterpolator::getLevelDataSlice(CoordinateSystem_cp csI, cons
         throw CDMException(varName + " has no vertical transformation");
     }
 
-    VerticalConverter_p iConverter = verticalConverter(csI, dataReader_, pimpl_->verticalType);
-    DataPtr iVerticalData = verticalData4D(iConverter, dataReader_->getCDM(), unLimDimPos);
+    VerticalConverter_p iConverter = pimpl_->getConverter("in", csI, dataReader_);
+    DataPtr iVerticalData = pimpl_->getVerticalData("in", csI, iConverter, dataReader_->getCDM(), unLimDimPos);
 
     VerticalConverter_p oConverter;
     DataPtr oVerticalData;
     if (pimpl_->interpolateToAxis) {
         CDMReader_p self(this, [](CDMReader*) { }); // FIXME hack to avoid adding enable_shared_from_this
-        const CoordinateSystem_cp_v coordSys = listCoordinateSystems(self);
+        const CoordinateSystem_cp_v coordSys = pimpl_->getOutputCoordSys(self);
         const auto cs = findCompleteCoordinateSystemFor(coordSys, varName);
-        oConverter = verticalConverter(cs, self, pimpl_->verticalType);
-        oVerticalData = verticalData4D(oConverter, *cdm_, unLimDimPos);
+        oConverter = pimpl_->getConverter("out", cs, self);
+        oVerticalData = pimpl_->getVerticalData("out", cs, oConverter, *cdm_, unLimDimPos);
     } else if (pimpl_->templateCS) {
-        oConverter = verticalConverter(pimpl_->templateCS, dataReader_, pimpl_->verticalType);
-        oVerticalData = verticalData4D(oConverter, dataReader_->getCDM(), unLimDimPos);
-    }
-
-    int (*intFunc)(const float* infieldA, const float* infieldB, float* outfield, const size_t n, const double a, const double b, const double x) = 0;
-    switch (pimpl_->verticalInterpolationMethod) {
-    case MIFI_VINT_METHOD_LIN: intFunc = &mifi_get_values_linear_f; break;
-    case MIFI_VINT_METHOD_LIN_WEAK_EXTRA: intFunc = &mifi_get_values_linear_weak_extrapol_f; break;
-    case MIFI_VINT_METHOD_LIN_NO_EXTRA: intFunc = &mifi_get_values_linear_no_extrapol_f; break;
-    case MIFI_VINT_METHOD_LIN_CONST_EXTRA: intFunc = &mifi_get_values_linear_const_extrapol_f; break;
-    case MIFI_VINT_METHOD_LOG: intFunc = &mifi_get_values_log_f; break;
-    case MIFI_VINT_METHOD_LOGLOG: intFunc = &mifi_get_values_log_log_f; break;
-    case MIFI_VINT_METHOD_NN: intFunc = &mifi_get_values_nearest_f; break;
+        oConverter = pimpl_->getConverter("template", pimpl_->templateCS, dataReader_);
+        oVerticalData = pimpl_->getVerticalData("template", pimpl_->templateCS, oConverter, dataReader_->getCDM(), unLimDimPos);
     }
 
     const std::string& geoZi = csI->getGeoZAxis()->getName();
@@ -485,69 +703,46 @@ DataPtr CDMVerticalInterpolator::getLevelDataSlice(CoordinateSystem_cp csI, cons
     if (oVerticalData)
         oVerticalValues = oVerticalData->asFloat();
 
-#ifdef _OPENMP
-#pragma omp parallel for default(shared)
-#endif
-    for (size_t k = 0; k < nzo; k++) {
-#ifdef ENABLE_LOG_DEBUG_IN_LOOPS
-        LOG4FIMEX(logger, Logger::DEBUG, "k=" << k);
-        size_t loopi = 0;
-#endif
+    ColumnInterpolation ci;
+    ci.nzi = nzi;
+    ci.nzo = nzo;
+    ci.idataZdelta = idataZdelta;
+    ci.iverticalZdelta = iverticalZdelta;
+    ci.odataZdelta = odataZdelta;
+    ci.overticalZdelta = overticalZdelta;
+    ci.iData = iData.get();
+    ci.iVertical = iVerticalValues.get();
+    ci.oVertical = oVerticalValues.get();
+    ci.level1 = pimpl_->level1.empty() ? 0 : &pimpl_->level1[0];
+    ci.valueMin = valueMin.get();
+    ci.valueMax = valueMax.get();
+    ci.oData = oData.get();
+    ci.arrayCount = group.arrayCount();
+    ci.IN = IN;
+    ci.IN_VERTICAL = IN_VERTICAL;
+    ci.OUT = OUT;
+    ci.OUT_VERTICAL = OUT_VERTICAL;
+    ci.VALID_MIN = VALID_MIN;
+    ci.VALID_MAX = VALID_MAX;
+    {
+        // collect the start of all columns, sharedVolume() == 1 because we called minimizeShared before
         Loop loop(group);
-        do { // sharedVolume() == 1 because we called minimizeShared before
-#ifdef ENABLE_LOG_DEBUG_IN_LOOPS
-            LOG4FIMEX(logger, Logger::DEBUG, "loopi=" << loopi++);
-#endif
-            const size_t verticalOutIdx = loop[OUT_VERTICAL] + k * overticalZdelta;
-            const double verticalOut = oVerticalValues ? oVerticalValues[verticalOutIdx] : pimpl_->level1[verticalOutIdx];
-            float* interpolated = &oData[loop[OUT] + k*odataZdelta];
-
-            bool range = true;
-            if (valueMin && valueMax) {
-                range = (verticalOut >= valueMin[loop[VALID_MIN]]) && (verticalOut <= valueMax[loop[VALID_MAX]]);
-#ifdef ENABLE_LOG_DEBUG_IN_LOOPS
-                LOG4FIMEX(logger, Logger::DEBUG, "verticalOut= " << verticalOut
-                          << " min[" << loop[VALID_MIN] << "]=" << valueMin[loop[VALID_MIN]]
-                          << " max[" << loop[VALID_MAX] << "]=" << valueMax[loop[VALID_MAX]]
-                          << " range=" << range);
-#endif
-            } else if (valueMin) {
-                range = (verticalOut >= valueMin[loop[VALID_MIN]]);
-#ifdef ENABLE_LOG_DEBUG_IN_LOOPS
-                LOG4FIMEX(logger, Logger::DEBUG, "verticalOut= " << verticalOut
-                          << " min[" << loop[VALID_MIN] << "]=" << valueMin[loop[VALID_MIN]]
-                          << " range=" << range);
-#endif
-            } else if (valueMax) {
-                range = (verticalOut <= valueMax[loop[VALID_MAX]]);
-#ifdef ENABLE_LOG_DEBUG_IN_LOOPS
-                LOG4FIMEX(logger, Logger::DEBUG, "verticalOut= " << verticalOut
-                          << " max[" << loop[VALID_MAX] << "]=" << valueMax[loop[VALID_MAX]]
-                          << " range=" << range);
-#endif
-            }
-
-            if (range) {
-                const leap_iterator<const float*> ivertical0(&iVerticalValues[loop[IN_VERTICAL]], iverticalZdelta);
-                const leap_iterator<const float*> ivertical1 = ivertical0 + nzi;
-                const pair<size_t, size_t> pos = find_closest_neighbor_distinct_elements(ivertical0, ivertical1, verticalOut);
-                if (pos.first != pos.second) {
-                    const size_t idataZ0  = loop[IN] + idataZdelta * pos.first;
-                    const size_t idataZ1  = loop[IN] + idataZdelta * pos.second;
-                    const float valueI0 = iData[idataZ0], valueI1 = iData[idataZ1];
-                    const float verticalI0 = *(ivertical0 + pos.first), verticalI1 = *(ivertical0 + pos.second);
-                    intFunc(&valueI0, &valueI1, interpolated, 1, verticalI0, verticalI1, verticalOut);
-                } else {
-                    // find_closest_neighbor_distinct_elements failed
-                    *interpolated = MIFI_UNDEFINED_F;
-                }
-            } else {
-                // not a valid z
-                *interpolated = MIFI_UNDEFINED_F;
-            }
+        do {
+            for (size_t a = 0; a < ci.arrayCount; ++a)
+                ci.columns.push_back(loop[a]);
         } while (loop.next());
     }
 
+    switch (pimpl_->verticalInterpolationMethod) {
+    case MIFI_VINT_METHOD_LIN: interpolateColumns<&mifi_get_values_linear_f>(ci); break;
+    case MIFI_VINT_METHOD_LIN_WEAK_EXTRA: interpolateColumns<&mifi_get_values_linear_weak_extrapol_f>(ci); break;
+    case MIFI_VINT_METHOD_LIN_NO_EXTRA: interpolateColumns<&mifi_get_values_linear_no_extrapol_f>(ci); break;
+    case MIFI_VINT_METHOD_LIN_CONST_EXTRA: interpolateColumns<&mifi_get_values_linear_const_extrapol_f>(ci); break;
+    case MIFI_VINT_METHOD_LOG: interpolateColumns<&mifi_get_values_log_f>(ci); break;
+    case MIFI_VINT_METHOD_LOGLOG: interpolateColumns<&mifi_get_values_log_log_f>(ci); break;
+    case MIFI_VINT_METHOD_NN: interpolateColumns<&mifi_get_values_nearest_f>(ci); break;
+    }
+
     // correct data going out of bounds
     const double valid_min = cdm_->getValidMin(varName);
     const double valid_max = cdm_->getValidMax(varName);
@@ -79,7 +79,7 @@ DataPtr C_CDMReader::getDataSlice(const std::string & varName, size_t unLimDimPo
     doubleDatasliceCallbackPtr callback = callbackIt->second;
 
     // this reader should never have in-memory data, since it is not accessible from C
-    assert(cdm_->getVariable(varName).hasData() == false);
+    assert(getCDM().getVariable(varName).hasData() == false);
     DataPtr data = dataReader_->getScaledDataSlice(varName, unLimDimPos);
 
     // wrap the object as a mifi_cdm_reader for C-usage
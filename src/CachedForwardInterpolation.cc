@@ -33,8 +33,9 @@
 #include "fimex/interpolation.h"
 #include "fimex/min_max.h"
 
-#include <numeric>
 #include <algorithm>
+#include <limits>
+#include <numeric>
 
 using namespace std;
 
@@ -49,23 +50,18 @@ namespace {
 
 const size_t INVALID = ~0u;
 
-} // namespace
+// aggregators are used per thread and called without virtual dispatch
 
-struct Aggregator
-{
-    virtual ~Aggregator();
-    virtual void push(float f) = 0;
-    virtual float get_and_reset() = 0;
-};
-
-Aggregator::~Aggregator() {}
-
-struct AggSimple : Aggregator
+struct AggSimple
 {
     size_t count;
     float val;
-    AggSimple() { reset(0); }
-    float get_and_reset() override { return reset(val); }
+    AggSimple(size_t)
+        : count(0)
+        , val(0)
+    {
+    }
+    float get_and_reset() { return reset(val); }
     float reset(float v)
     {
         val = 0;
@@ -78,7 +74,11 @@ struct AggSimple : Aggregator
 
 struct AggSum : AggSimple
 {
-    void push(float f) override
+    AggSum(size_t n)
+        : AggSimple(n)
+    {
+    }
+    void push(float f)
     {
         count += 1;
         val += f;
@@ -87,12 +87,20 @@ struct AggSum : AggSimple
 
 struct AggMean : AggSum
 {
-    float get_and_reset() override { return reset(count > 0 ? val / count : 0); }
+    AggMean(size_t n)
+        : AggSum(n)
+    {
+    }
+    float get_and_reset() { return reset(count > 0 ? val / count : 0); }
 };
 
 struct AggMin : AggSimple
 {
-    void push(float f) override
+    AggMin(size_t n)
+        : AggSimple(n)
+    {
+    }
+    void push(float f)
     {
         if (count == 0 || f < val)
             val = f;
@@ -102,7 +110,11 @@ struct AggMin : AggSimple
 
 struct AggMax : AggSimple
 {
-    void push(float f) override
+    AggMax(size_t n)
+        : AggSimple(n)
+    {
+    }
+    void push(float f)
     {
         if (count == 0 || f > val)
             val = f;
@@ -110,12 +122,12 @@ struct AggMax : AggSimple
     }
 };
 
-struct AggMedian : Aggregator
+struct AggMedian
 {
     std::vector<float> values;
     AggMedian(size_t n) { values.reserve(n); }
-    void push(float f) override { values.push_back(f); }
-    float get_and_reset() override;
+    void push(float f) { values.push_back(f); }
+    float get_and_reset();
 };
 
 float AggMedian::get_and_reset()
@@ -129,15 +141,57 @@ float AggMedian::get_and_reset()
     return median;
 }
 
+//! number of output points aggregated in one task
+const size_t TILE_SIZE = 16384;
+
+template <class Agg>
+void aggregateLayers(const float* inData, size_t inLayerSize, size_t inZ, float* outData, size_t outLayerSize, const size_t* offsets, const std::uint32_t* points,
+                     size_t maxPointsInIn, bool undefAggr)
+{
+    const size_t tiles = (outLayerSize + TILE_SIZE - 1) / TILE_SIZE;
+    const long long tasks = tiles * inZ;
+#ifdef _OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+        Agg agg(maxPointsInIn);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (long long t = 0; t < tasks; ++t) {
+            const size_t z = t / tiles, o0 = (t % tiles) * TILE_SIZE;
+            const size_t o1 = std::min(o0 + TILE_SIZE, outLayerSize);
+            const float* inDataZ = &inData[z * inLayerSize];
+            float* outDataZ = &outData[z * outLayerSize];
+            for (size_t o = o0; o < o1; o++) {
+                for (size_t p = offsets[o]; p < offsets[o + 1]; ++p) {
+                    const float val = inDataZ[points[p]];
+                    if (undefAggr || !mifi_isnan(val))
+                        agg.push(val);
+                }
+                outDataZ[o] = agg.get_and_reset();
+            }
+        }
+    }
+}
+
+} // namespace
+
 // pointsOnXAxis map each point in inData[y*inX+x] to a x-position in outData
 CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimName, const std::string& yDimName, int funcType, shared_array<double> pOnX,
                                                        shared_array<double> pOnY, size_t inx, size_t iny, size_t outx, size_t outy)
     : CachedInterpolationInterface(xDimName, yDimName, inx, iny, outx, outy)
 {
     const size_t outLayerSize = outX * outY;
-    pointsInIn = make_shared_array<vector<size_t>>(outLayerSize);
+    const size_t inLayerSize = inX * inY;
+    if (inLayerSize > std::numeric_limits<std::uint32_t>::max())
+        throw CDMException("forward interpolation input too large: " + type2string(inLayerSize));
+
+    // output point for each input point
+    std::vector<size_t> pointsInOut(inLayerSize, INVALID);
+    pointsInInOffsets = std::vector<size_t>(outLayerSize + 1, 0);
     size_t minInX = 0, maxInX = 0, minInY = 0, maxInY = 0;
-    maxPointsInIn = 0;
+    bool haveInput = false;
     const RoundAndClamp roundX(0, outX - 1, INVALID);
     const RoundAndClamp roundY(0, outY - 1, INVALID);
     for (size_t iy = 0; iy < inY; ++iy) {
@@ -145,19 +199,36 @@ CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimNa
             const size_t i = iy * inX + ix;
             const size_t px = roundX(pOnX[i]), py = roundY(pOnY[i]);
             if (px != INVALID && py != INVALID) {
-                if (maxPointsInIn == 0) {
+                if (!haveInput) {
                     minInX = maxInX = ix;
                     minInY = maxInY = iy;
+                    haveInput = true;
                 } else {
                     minimaximize(minInY, maxInY, iy);
                     minimaximize(minInX, maxInX, ix);
                 }
-                std::vector<size_t>& pi = pointsInIn[py * outX + px];
-                pi.push_back(i);
-                maximize(maxPointsInIn, pi.size());
+                const size_t o = py * outX + px;
+                pointsInOut[i] = o;
+                pointsInInOffsets[o + 1] += 1;
             }
         }
     }
+
+    // count to offsets, then fill the input points in the order of the input
+    maxPointsInIn = 0;
+    for (size_t o = 0; o < outLayerSize; ++o) {
+        maximize(maxPointsInIn, pointsInInOffsets[o + 1]);
+        pointsInInOffsets[o + 1] += pointsInInOffsets[o];
+    }
+    pointsInIn.resize(pointsInInOffsets[outLayerSize]);
+    {
+        std::vector<size_t> next(pointsInInOffsets.begin(), pointsInInOffsets.end() - 1);
+        for (size_t i = 0; i < inLayerSize; ++i) {
+            const size_t o = pointsInOut[i];
+            if (o != INVALID)
+                pointsInIn[next[o]++] = i;
+        }
+    }
     LOG4FIMEX(logger, Logger::DEBUG, "maxPointsInIn=" << maxPointsInIn);
 
     // allow additional cells for pre/postprocessing
@@ -169,11 +240,9 @@ CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimNa
     if ((minInX > 0 || minInY > 0 || maxInX < inX - 1 || maxInY < inY - 1) && (minInX + 2 * EXTEND <= maxInX) && (minInY + 2 * EXTEND <= maxInY)) {
         const size_t redInX = maxInX - minInX + 1;
         const size_t redInY = maxInY - minInY + 1;
-        for (size_t o = 0; o < outLayerSize; ++o) {
-            for (size_t& i : pointsInIn[o]) {
-                const size_t iy = i / inX - minInY, ix = i % inX - minInX;
-                i = iy * redInX + ix;
-            }
+        for (std::uint32_t& i : pointsInIn) {
+            const size_t iy = i / inX - minInY, ix = i % inX - minInX;
+            i = iy * redInX + ix;
         }
 
         reducedDomain_ = std::make_shared<ReducedInterpolationDomain>(xDimName, yDimName, minInX, minInY);
@@ -185,16 +254,16 @@ CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimNa
     undefAggr = false;
     // clang-format off
     switch (funcType) {
-    case MIFI_INTERPOL_FORWARD_UNDEF_SUM: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_SUM: agg.reset(new AggSum()); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MEAN: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MEAN: agg.reset(new AggMean()); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MEDIAN: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MEDIAN: agg.reset(new AggMedian(maxPointsInIn)); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MAX: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MAX: agg.reset(new AggMax()); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MIN: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MIN: agg.reset(new AggMin()); break;
+    case MIFI_INTERPOL_FORWARD_UNDEF_SUM: undefAggr = true; aggregation = MIFI_INTERPOL_FORWARD_SUM; break;
+    case MIFI_INTERPOL_FORWARD_UNDEF_MEAN: undefAggr = true; aggregation = MIFI_INTERPOL_FORWARD_MEAN; break;
+    case MIFI_INTERPOL_FORWARD_UNDEF_MEDIAN: undefAggr = true; aggregation = MIFI_INTERPOL_FORWARD_MEDIAN; break;
+    case MIFI_INTERPOL_FORWARD_UNDEF_MAX: undefAggr = true; aggregation = MIFI_INTERPOL_FORWARD_MAX; break;
+    case MIFI_INTERPOL_FORWARD_UNDEF_MIN: undefAggr = true; aggregation = MIFI_INTERPOL_FORWARD_MIN; break;
+    case MIFI_INTERPOL_FORWARD_SUM:
+    case MIFI_INTERPOL_FORWARD_MEAN:
+    case MIFI_INTERPOL_FORWARD_MEDIAN:
+    case MIFI_INTERPOL_FORWARD_MAX:
+    case MIFI_INTERPOL_FORWARD_MIN: aggregation = funcType; break;
     default: throw CDMException("unknown forward interpolation method: " + type2string(funcType));
     }
     // clang-format on
@@ -204,22 +273,25 @@ CachedForwardInterpolation::~CachedForwardInterpolation() {}
 
 shared_array<float> CachedForwardInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
 {
-    size_t outLayerSize = outX*outY;
-    size_t inLayerSize = inX * inY;
-    size_t inZ = size / inLayerSize;
-    newSize = outLayerSize*inZ;
+    const size_t outLayerSize = outX * outY;
+    const size_t inLayerSize = inX * inY;
+    const size_t inZ = size / inLayerSize;
+    newSize = outLayerSize * inZ;
     auto outData = make_shared_array<float>(newSize);
-    for (size_t z = 0; z < inZ; ++z) {
-        float* outDataIt = &outData[z*outLayerSize];
-        for (size_t i = 0; i < outLayerSize; i++) {
-            for (size_t ii : pointsInIn[i]) {
-                const float val = inData[ii];
-                if (undefAggr || !mifi_isnan(val))
-                    agg->push(val);
-            }
-            *outDataIt++ = agg->get_and_reset();
-        }
+
+    const float* in = inData.get();
+    float* out = outData.get();
+    const size_t* offsets = &pointsInInOffsets[0];
+    const std::uint32_t* points = pointsInIn.empty() ? 0 : &pointsInIn[0];
+    // clang-format off
+    switch (aggregation) {
+    case MIFI_INTERPOL_FORWARD_SUM: aggregateLayers<AggSum>(in, inLayerSize, inZ, out, outLayerSize, offsets, points, maxPointsInIn, undefAggr); break;
+    case MIFI_INTERPOL_FORWARD_MEAN: aggregateLayers<AggMean>(in, inLayerSize, inZ, out, outLayerSize, offsets, points, maxPointsInIn, undefAggr); break;
+    case MIFI_INTERPOL_FORWARD_MEDIAN: aggregateLayers<AggMedian>(in, inLayerSize, inZ, out, outLayerSize, offsets, points, maxPointsInIn, undefAggr); break;
+    case MIFI_INTERPOL_FORWARD_MAX: aggregateLayers<AggMax>(in, inLayerSize, inZ, out, outLayerSize, offsets, points, maxPointsInIn, undefAggr); break;
+    case MIFI_INTERPOL_FORWARD_MIN: aggregateLayers<AggMin>(in, inLayerSize, inZ, out, outLayerSize, offsets, points, maxPointsInIn, undefAggr); break;
     }
+    // clang-format on
     return outData;
 }
 
@@ -29,16 +29,20 @@
 
 #include "fimex/CachedInterpolation.h"
 
-namespace MetNoFimex {
+#include <cstdint>
+#include <vector>
 
-struct Aggregator;
+namespace MetNoFimex {
 
 class CachedForwardInterpolation : public CachedInterpolationInterface
 {
 private:
-    shared_array<std::vector<size_t>> pointsInIn;
+    // compressed sparse rows: the input points of output point o are
+    // pointsInIn[pointsInInOffsets[o]] ... pointsInIn[pointsInInOffsets[o+1]-1]
+    std::vector<size_t> pointsInInOffsets;
+    std::vector<std::uint32_t> pointsInIn;
     size_t maxPointsInIn;
-    std::unique_ptr<Aggregator> agg;
+    int aggregation;
     bool undefAggr;
 
 public:
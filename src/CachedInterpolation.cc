@@ -35,10 +35,26 @@
 
 #include "fimex/Logger.h"
 
+#include <algorithm>
+#include <cmath>
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+// the kernels are vectorized also at -O2 and cloned for avx2, selected at
+// runtime; fp-contract=off keeps the results identical to interpolation.c
+#if defined(__GNUC__) && !defined(__clang__)
+#define FIMEX_INTERPOLATION_VECTORIZE __attribute__((optimize("tree-vectorize", "vect-cost-model=cheap", "fp-contract=off")))
+#else
+#define FIMEX_INTERPOLATION_VECTORIZE
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 6) && defined(__x86_64__) && defined(__linux__)
+#define FIMEX_INTERPOLATION_KERNEL __attribute__((target_clones("avx2", "default"))) FIMEX_INTERPOLATION_VECTORIZE
+#else
+#define FIMEX_INTERPOLATION_KERNEL FIMEX_INTERPOLATION_VECTORIZE
+#endif
+
 namespace MetNoFimex
 {
 
@@ -153,57 +169,205 @@ CachedInterpolation::CachedInterpolation(const std::string& xDimName, const std:
     , pointsOnYAxis(pointsOnYAxis)
 {
     // we do not round pointsOnXYAxis values here:
-    // * mifi_get_values_bilinear_f and mifi_get_values_bicubic_f use floor/fraction
+    // * bilinear and bicubic use floor/fraction
 
     switch (funcType) {
-    case MIFI_INTERPOL_BILINEAR: this->func = mifi_get_values_bilinear_f; break;
-    case MIFI_INTERPOL_BICUBIC:  this->func = mifi_get_values_bicubic_f; break;
-#if 0
-    case MIFI_INTERPOL_NEAREST_NEIGHBOR:
-    case MIFI_INTERPOL_COORD_NN:
-    case MIFI_INTERPOL_COORD_NN_KD: this->func = mifi_get_values_f; break;
-#endif
+    case MIFI_INTERPOL_BILINEAR:
+    case MIFI_INTERPOL_BICUBIC: this->funcType = funcType; break;
     default:
         throw CDMException("CachedInterpolation supports only bilinear and bicubic, not: " + type2string(funcType));
     }
 
     createReducedDomain(xDimName, yDimName);
+    createStencils();
 }
 
-shared_array<float> CachedInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
-{
-    const size_t outLayerSize = outX * outY;
-    const size_t inZ = size / (inX*inY);
-    newSize = outLayerSize*inZ;
-    auto outfield = make_shared_array<float>(newSize);
+namespace {
+
+//! size of the blocks of output points processed by one thread
+const size_t BLOCK_SIZE = 4096;
 
+/* out = wy0*(wx0*s00 + wx1*s01) + wy1*(wx0*s10 + wx1*s11), in the order of mifi_get_values_bilinear_f */
+FIMEX_INTERPOLATION_KERNEL void bilinearKernel(const float* in, size_t n, const size_t* i00, const size_t* i01, const size_t* i10, const size_t* i11,
+                                               const float* wx0, const float* wx1, const float* wy0, const float* wy1, float* out)
+{
 #ifdef _OPENMP
-#pragma omp parallel default(shared)
-    {
+#pragma omp simd
 #endif
-        bool error = false;
-        std::unique_ptr<float[]> zValues(new float[inZ]);
+    for (size_t o = 0; o < n; ++o) {
+        out[o] = wy0[o] * (wx0[o] * in[i00[o]] + wx1[o] * in[i01[o]]) + wy1[o] * (wx0[o] * in[i10[o]] + wx1[o] * in[i11[o]]);
+    }
+}
+
+/* sum over rows of (weights-x * row) * weight-y, in the order of mifi_get_values_bicubic_f */
+FIMEX_INTERPOLATION_KERNEL void bicubicKernel(const float* in, size_t inX, size_t n, const size_t* i00, const double* wx0, const double* wx1, const double* wx2,
+                                              const double* wx3, const double* wy0, const double* wy1, const double* wy2, const double* wy3, float* out)
+{
 #ifdef _OPENMP
-#pragma omp for
+#pragma omp simd
 #endif
-    for (size_t xy = 0; xy < outLayerSize; ++xy) {
-        if (!error) {
-            float* outPos = &outfield[xy];
-            if (func(inData.get(), zValues.get(), pointsOnXAxis[xy], pointsOnYAxis[xy], inX, inY, inZ) != MIFI_ERROR) {
-                for (size_t z = 0; z < inZ; ++z) {
-                    *outPos = zValues[z];
-                    outPos += outLayerSize;
+    for (size_t o = 0; o < n; ++o) {
+        const float* row0 = &in[i00[o]];
+        const float* row1 = row0 + inX;
+        const float* row2 = row1 + inX;
+        const float* row3 = row2 + inX;
+        float value = 0;
+        value += (wx0[o] * row0[0] + wx1[o] * row0[1] + wx2[o] * row0[2] + wx3[o] * row0[3]) * wy0[o];
+        value += (wx0[o] * row1[0] + wx1[o] * row1[1] + wx2[o] * row1[2] + wx3[o] * row1[3]) * wy1[o];
+        value += (wx0[o] * row2[0] + wx1[o] * row2[1] + wx2[o] * row2[2] + wx3[o] * row2[3]) * wy2[o];
+        value += (wx0[o] * row3[0] + wx1[o] * row3[1] + wx2[o] * row3[2] + wx3[o] * row3[3]) * wy3[o];
+        out[o] = value;
+    }
+}
+
+//! weights of the 4 points of the cubic convolution (a = -0.5) at position frac
+void bicubicWeights(double frac, double weights[4])
+{
+    double M[4][4] = {{ 0, 2, 0, 0},
+                      {-1, 0, 1, 0},
+                      { 2,-5, 4,-1},
+                      {-1, 3,-3, 1}};
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            M[i][j] *= .5;
+
+    double X[4];
+    X[0] = 1;
+    X[1] = frac;
+    X[2] = frac * frac;
+    X[3] = X[2] * frac;
+    for (int i = 0; i < 4; i++) {
+        weights[i] = 0;
+        for (int j = 0; j < 4; j++) {
+            weights[i] += X[j] * M[j][i];
+        }
+    }
+}
+
+} // namespace
+
+void CachedInterpolation::createStencils()
+{
+    const size_t outLayerSize = outX * outY;
+    const float nan = MIFI_UNDEFINED_F;
+    const long long ix = inX, iy = inY;
+
+    if (funcType == MIFI_INTERPOL_BILINEAR) {
+        for (int i = 0; i < 4; i++)
+            stencilIndex[i].resize(outLayerSize);
+        for (int i = 0; i < 2; i++) {
+            bilinearWeightX[i].resize(outLayerSize);
+            bilinearWeightY[i].resize(outLayerSize);
+        }
+        for (size_t xy = 0; xy < outLayerSize; ++xy) {
+            const double x = pointsOnXAxis[xy], y = pointsOnYAxis[xy];
+            long long x0 = 0, y0 = 0, dx = 0, dy = 0;
+            float xfrac = 0, yfrac = 0;
+            bool valid = !(std::isnan(x) || std::isnan(y));
+            if (valid) {
+                x0 = std::floor(x);
+                xfrac = x - x0;
+                y0 = std::floor(y);
+                yfrac = y - y0;
+                const bool linearY = (0 <= y0) && (y0 + 1 < iy);
+                if ((0 <= x0) && (x0 + 1 < ix)) {
+                    dx = 1;
+                } else {
+                    // nearest neighbor in x
+                    x0 = std::llround(x);
+                    valid = (0 <= x0) && (x0 < ix);
+                }
+                if (linearY) {
+                    dy = ix;
+                } else {
+                    // nearest neighbor in y
+                    y0 = std::llround(y);
+                    valid &= (0 <= y0) && (y0 < iy);
+                }
+            }
+            if (valid) {
+                const size_t pos = y0 * ix + x0;
+                stencilIndex[0][xy] = pos;
+                stencilIndex[1][xy] = pos + dx;
+                stencilIndex[2][xy] = pos + dy;
+                stencilIndex[3][xy] = pos + dy + dx;
+                // weights 1, 0 for nearest neighbor; the stencil then repeats the same points
+                bilinearWeightX[0][xy] = dx ? (1.f - xfrac) : 1.f;
+                bilinearWeightX[1][xy] = dx ? xfrac : 0.f;
+                bilinearWeightY[0][xy] = dy ? (1.f - yfrac) : 1.f;
+                bilinearWeightY[1][xy] = dy ? yfrac : 0.f;
+            } else {
+                // nan weights give MIFI_UNDEFINED_F
+                for (int i = 0; i < 4; i++)
+                    stencilIndex[i][xy] = 0;
+                for (int i = 0; i < 2; i++)
+                    bilinearWeightX[i][xy] = bilinearWeightY[i][xy] = nan;
+            }
+        }
+    } else {
+        stencilIndex[0].resize(outLayerSize);
+        for (int i = 0; i < 4; i++) {
+            bicubicWeightX[i].resize(outLayerSize);
+            bicubicWeightY[i].resize(outLayerSize);
+        }
+        for (size_t xy = 0; xy < outLayerSize; ++xy) {
+            const double x = pointsOnXAxis[xy], y = pointsOnYAxis[xy];
+            const double fx0 = std::floor(x), fy0 = std::floor(y);
+            // nan fails the comparisons
+            if ((1 <= fx0) && (fx0 + 2 < ix) && (1 <= fy0) && (fy0 + 2 < iy)) {
+                const long long x0 = fx0, y0 = fy0;
+                double wx[4], wy[4];
+                bicubicWeights(x - x0, wx);
+                bicubicWeights(y - y0, wy);
+                stencilIndex[0][xy] = (y0 - 1) * ix + (x0 - 1);
+                for (int i = 0; i < 4; i++) {
+                    bicubicWeightX[i][xy] = wx[i];
+                    bicubicWeightY[i][xy] = wy[i];
                 }
             } else {
-                error = true;
+                // border cases, nan weights give MIFI_UNDEFINED_F
+                stencilIndex[0][xy] = 0;
+                for (int i = 0; i < 4; i++)
+                    bicubicWeightX[i][xy] = bicubicWeightY[i][xy] = nan;
             }
         }
     }
-    if (error)
-        throw CDMException("error during interpolation");
-#ifdef _OPENMP
+}
+
+shared_array<float> CachedInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
+{
+    const size_t outLayerSize = outX * outY;
+    const size_t inLayerSize = inX * inY;
+    const size_t inZ = size / inLayerSize;
+    newSize = outLayerSize * inZ;
+    auto outfield = make_shared_array<float>(newSize);
+
+    if (funcType == MIFI_INTERPOL_BICUBIC && (inX < 4 || inY < 4)) {
+        // all points are border cases, and the stencil does not fit into the layer
+        std::fill(outfield.get(), outfield.get() + newSize, MIFI_UNDEFINED_F);
+        return outfield;
     }
+
+    const size_t blocks = (outLayerSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+#ifdef _OPENMP
+#pragma omp parallel for default(shared) schedule(static)
 #endif
+    for (size_t b = 0; b < blocks; ++b) {
+        const size_t o0 = b * BLOCK_SIZE;
+        const size_t n = std::min(BLOCK_SIZE, outLayerSize - o0);
+        // the stencils of a block stay in cache while looping over the layers
+        for (size_t z = 0; z < inZ; ++z) {
+            const float* in = &inData[z * inLayerSize];
+            float* out = &outfield[z * outLayerSize + o0];
+            if (funcType == MIFI_INTERPOL_BILINEAR) {
+                bilinearKernel(in, n, &stencilIndex[0][o0], &stencilIndex[1][o0], &stencilIndex[2][o0], &stencilIndex[3][o0], &bilinearWeightX[0][o0],
+                               &bilinearWeightX[1][o0], &bilinearWeightY[0][o0], &bilinearWeightY[1][o0], out);
+            } else {
+                bicubicKernel(in, inX, n, &stencilIndex[0][o0], &bicubicWeightX[0][o0], &bicubicWeightX[1][o0], &bicubicWeightX[2][o0],
+                              &bicubicWeightX[3][o0], &bicubicWeightY[0][o0], &bicubicWeightY[1][o0], &bicubicWeightY[2][o0], &bicubicWeightY[3][o0], out);
+            }
+        }
+    }
 
     return outfield;
 }
@@ -29,6 +29,8 @@
 
 #include "fimex/reproject.h"
 
+#include <algorithm>
+
 namespace MetNoFimex {
 
 static Logger_p logger = getLogger("fimex.CachedVectorReprojection");
@@ -52,4 +54,20 @@ void CachedVectorReprojection::reprojectDirectionValues(shared_array<float>& ang
     reproject::vector_reproject_direction_by_matrix_f(matrix, &angles[0], oz);
 }
 
+std::shared_ptr<CachedVectorReprojection> CachedVectorReprojection::subset(size_t xStart, size_t xSize, size_t yStart, size_t ySize) const
+{
+    if (xStart + xSize > ox || yStart + ySize > oy)
+        throw CDMException("subset outside of vector reprojection matrix");
+
+    std::shared_ptr<reproject::Matrix> sub = std::make_shared<reproject::Matrix>(xSize, ySize);
+    const size_t stride = reproject::Matrix::stride;
+    const double* mtx = matrix->mtx();
+    double* subMtx = sub->mtx();
+    for (size_t y = 0; y < ySize; ++y) {
+        const double* row = mtx + ((yStart + y) * ox + xStart) * stride;
+        std::copy(row, row + xSize * stride, subMtx + y * xSize * stride);
+    }
+    return std::make_shared<CachedVectorReprojection>(sub);
+}
+
 } // namespace MetNoFimex
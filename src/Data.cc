@@ -115,6 +115,11 @@ DataPtr createData(CDMDataType datatype, size_t length, double val)
     return data;
 }
 
+DataPtr createDataUninitialized(CDMDataType datatype, size_t length)
+{
+    return createDataPtr_(datatype, length);
+}
+
 DataPtr createData(const std::string& value)
 {
     return std::make_shared<StringData>(value);
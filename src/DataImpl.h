@@ -288,10 +288,10 @@ shared_array<OUT> convertArrayType(const shared_array<IN>& inData, size_t length
     auto outData = make_shared_array<OUT>(length);
     if (!unitsConverter) {
         ScaleValue<IN, OUT> sv(oldFill, oldScale, oldOffset, newFill, newScale, newOffset);
-        std::transform(&inData[0], &inData[length], &outData[0], sv);
+        scaleValues(&inData[0], &inData[0] + length, &outData[0], sv);
     } else {
         ScaleValueUnits<IN, OUT> sv(oldFill, oldScale, oldOffset, unitsConverter, newFill, newScale, newOffset);
-        std::transform(&inData[0], &inData[length], &outData[0], sv);
+        sv(&inData[0], &inData[0] + length, &outData[0]);
     }
     return outData;
 }
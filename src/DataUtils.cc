@@ -6,8 +6,113 @@
 #include "fimex/String2Type.h"
 #include "fimex/StringUtils.h"
 
+#include <cmath>
+#include <limits>
+
+// without trapping-math gcc can convert the fill-value selection of the
+// scale-kernels to a vector blend, and the cheap cost-model vectorizes them
+// also at -O2; the kernels are cloned for avx2 and selected at runtime
+#if defined(__GNUC__) && !defined(__clang__)
+#define FIMEX_SCALE_VECTORIZE __attribute__((optimize("no-trapping-math", "tree-vectorize", "vect-cost-model=cheap")))
+#else
+#define FIMEX_SCALE_VECTORIZE
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 6) && defined(__x86_64__) && defined(__linux__)
+#define FIMEX_SCALE_KERNEL __attribute__((target_clones("avx2", "default"))) FIMEX_SCALE_VECTORIZE
+#else
+#define FIMEX_SCALE_KERNEL FIMEX_SCALE_VECTORIZE
+#endif
+
 namespace MetNoFimex {
 
+namespace {
+
+/* conversion of the scaled double to OUT, as data_caster<OUT, double> */
+template <typename OUT>
+FIMEX_SCALE_VECTORIZE inline OUT scaledCast(double d)
+{
+    return static_cast<OUT>(d);
+}
+
+template <>
+FIMEX_SCALE_VECTORIZE inline short scaledCast<short>(double d)
+{
+    // round half away from zero like lround, written so that it can be vectorized;
+    // saturate to the short range before the cast, also lanes with fill-values are converted
+    double r = std::trunc(d);
+    r += (std::fabs(d - r) >= 0.5) ? std::copysign(1.0, d) : 0.0;
+    const double lo = std::numeric_limits<short>::min(), hi = std::numeric_limits<short>::max();
+    r = (r > lo) ? ((r < hi) ? r : hi) : lo; // also maps nan to lo
+    return static_cast<short>(r);
+}
+
+/* branch-free version of ScaleValue, all values are scaled and fill-values replaced afterwards */
+template <typename IN, typename OUT>
+FIMEX_SCALE_VECTORIZE inline void scaleKernel(const IN* in, size_t n, OUT* out, IN oldFill, double scale, double offset, OUT newFill)
+{
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (size_t i = 0; i < n; ++i) {
+        const IN v = in[i];
+        const OUT o = scaledCast<OUT>(scale * v + offset);
+        const bool isFill = (v == oldFill) | (v != v); // v != v for nan, no short-circuit to allow vectorization
+        out[i] = isFill ? newFill : o;
+    }
+}
+
+FIMEX_SCALE_KERNEL void scaleKernelShortFloat(const short* in, size_t n, float* out, short oldFill, double scale, double offset, float newFill)
+{
+    scaleKernel(in, n, out, oldFill, scale, offset, newFill);
+}
+
+FIMEX_SCALE_KERNEL void scaleKernelShortDouble(const short* in, size_t n, double* out, short oldFill, double scale, double offset, double newFill)
+{
+    scaleKernel(in, n, out, oldFill, scale, offset, newFill);
+}
+
+FIMEX_SCALE_KERNEL void scaleKernelFloatDouble(const float* in, size_t n, double* out, float oldFill, double scale, double offset, double newFill)
+{
+    scaleKernel(in, n, out, oldFill, scale, offset, newFill);
+}
+
+FIMEX_SCALE_KERNEL void scaleKernelDoubleFloat(const double* in, size_t n, float* out, double oldFill, double scale, double offset, float newFill)
+{
+    scaleKernel(in, n, out, oldFill, scale, offset, newFill);
+}
+
+FIMEX_SCALE_KERNEL void scaleKernelFloatShort(const float* in, size_t n, short* out, float oldFill, double scale, double offset, short newFill)
+{
+    scaleKernel(in, n, out, oldFill, scale, offset, newFill);
+}
+
+} // namespace
+
+void scaleValues(const short* begin, const short* end, float* out, const ScaleValue<short, float>& sv)
+{
+    scaleKernelShortFloat(begin, end - begin, out, sv.oldFill(), sv.scale(), sv.offset(), sv.newFill());
+}
+
+void scaleValues(const short* begin, const short* end, double* out, const ScaleValue<short, double>& sv)
+{
+    scaleKernelShortDouble(begin, end - begin, out, sv.oldFill(), sv.scale(), sv.offset(), sv.newFill());
+}
+
+void scaleValues(const float* begin, const float* end, double* out, const ScaleValue<float, double>& sv)
+{
+    scaleKernelFloatDouble(begin, end - begin, out, sv.oldFill(), sv.scale(), sv.offset(), sv.newFill());
+}
+
+void scaleValues(const double* begin, const double* end, float* out, const ScaleValue<double, float>& sv)
+{
+    scaleKernelDoubleFloat(begin, end - begin, out, sv.oldFill(), sv.scale(), sv.offset(), sv.newFill());
+}
+
+void scaleValues(const float* begin, const float* end, short* out, const ScaleValue<float, short>& sv)
+{
+    scaleKernelFloatShort(begin, end - begin, out, sv.oldFill(), sv.scale(), sv.offset(), sv.newFill());
+}
+
 /* init data arrays for all types */
 template <typename T>
 DataPtr initDataArray(const std::vector<std::string>& values)
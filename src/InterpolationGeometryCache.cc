@@ -0,0 +1,342 @@
+/*
+ * Fimex, InterpolationGeometryCache.cc
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "InterpolationGeometryCache.h"
+
+#include "fimex/Logger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MetNoFimex {
+
+namespace {
+
+Logger_p logger = getLogger("fimex.InterpolationGeometryCache");
+
+const char MAGIC[8] = {'F', 'I', 'G', 'E', 'O', 'C', 'A', 'C'};
+const uint32_t VERSION = 2;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const char EXTENSION[] = ".figeo";
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+enum EntryType { ENTRY_POINTS = 1, ENTRY_MATRIX = 2 };
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint64_t keyHash;
+    /// size of the serialized key following the header, padded to 8 bytes
+    uint64_t keyBytes;
+    uint32_t entryType;
+    uint32_t padding;
+    /// the data are arrayCount arrays of sizeX*sizeY doubles following the key
+    uint64_t sizeX;
+    uint64_t sizeY;
+    uint64_t arrayCount;
+};
+
+// the doubles following the header are 8-byte aligned
+static_assert(sizeof(Header) % 8 == 0, "Header size not aligned");
+
+/// private, writable memory-map of a whole file, changes are not written back
+class MappedFile
+{
+public:
+    MappedFile(void* data, size_t size)
+        : data_(data)
+        , size_(size)
+    {
+    }
+    ~MappedFile() { munmap(data_, size_); }
+
+    char* data() const { return static_cast<char*>(data_); }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void* data_;
+    size_t size_;
+};
+
+typedef std::shared_ptr<MappedFile> MappedFile_p;
+
+uint64_t align8(uint64_t size)
+{
+    return (size + 7) & ~uint64_t(7);
+}
+
+/// offset of the data arrays in the file
+uint64_t dataOffset(const Header& h)
+{
+    return sizeof(Header) + align8(h.keyBytes);
+}
+
+Header makeHeader(const InterpolationGeometryCache::Key& key, EntryType type, uint64_t sizeX, uint64_t sizeY, uint64_t arrayCount)
+{
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.byteOrderMark = BYTE_ORDER_MARK;
+    h.keyHash = key.hash();
+    h.keyBytes = key.bytes().size();
+    h.entryType = type;
+    h.sizeX = sizeX;
+    h.sizeY = sizeY;
+    h.arrayCount = arrayCount;
+    return h;
+}
+
+/// check the size of the data following the header without overflow
+bool hasDataSize(const Header& h, uint64_t dataBytes)
+{
+    if (dataBytes % sizeof(double) != 0)
+        return false;
+    const uint64_t values = dataBytes / sizeof(double);
+    if (h.sizeX == 0 || h.sizeY == 0 || h.arrayCount == 0)
+        return values == 0;
+    return values % h.arrayCount == 0 && (values / h.arrayCount) % h.sizeY == 0 && values / h.arrayCount / h.sizeY == h.sizeX;
+}
+
+/**
+ * Map the file and check that it contains an entry for the key.
+ *
+ * @return the mapping, or null if the file is missing or does not match
+ */
+MappedFile_p mapEntry(const std::string& path, const InterpolationGeometryCache::Key& key, EntryType type, Header& h)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT)
+            LOG4FIMEX(logger, Logger::WARN, "cannot open geometry cache file '" << path << "': " << strerror(errno));
+        return MappedFile_p();
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+        ::close(fd);
+        LOG4FIMEX(logger, Logger::WARN, "ignoring truncated geometry cache file '" << path << "'");
+        return MappedFile_p();
+    }
+    const size_t size = st.st_size;
+    void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        LOG4FIMEX(logger, Logger::WARN, "cannot map geometry cache file '" << path << "': " << strerror(errno));
+        return MappedFile_p();
+    }
+    MappedFile_p mapped = std::make_shared<MappedFile>(data, size);
+
+    memcpy(&h, mapped->data(), sizeof(h));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION || h.byteOrderMark != BYTE_ORDER_MARK || h.entryType != (uint32_t)type ||
+        h.keyBytes > size - sizeof(Header) || dataOffset(h) > size || !hasDataSize(h, size - dataOffset(h))) {
+        LOG4FIMEX(logger, Logger::WARN, "ignoring invalid geometry cache file '" << path << "'");
+        return MappedFile_p();
+    }
+    if (h.keyHash != key.hash() || h.keyBytes != key.bytes().size() || memcmp(mapped->data() + sizeof(Header), key.bytes().data(), h.keyBytes) != 0) {
+        LOG4FIMEX(logger, Logger::WARN, "geometry cache file '" << path << "' belongs to a different key");
+        return MappedFile_p();
+    }
+    return mapped;
+}
+
+/// alias into the mapping, keeping the mapping alive as long as the array is used
+shared_array<double> mappedArray(const MappedFile_p& mapped, const Header& h, size_t index, size_t size)
+{
+    double* values = reinterpret_cast<double*>(mapped->data() + dataOffset(h)) + index * size;
+    return shared_array<double>(mapped, values);
+}
+
+/// write the entry to a temporary file and rename it, such that readers never see partial files
+void writeEntry(const std::string& directory, const std::string& path, const Header& h, const std::string& key, const double* const* arrays,
+                size_t arraySize)
+{
+    if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) {
+        LOG4FIMEX(logger, Logger::WARN, "cannot create geometry cache directory '" << directory << "': " << strerror(errno));
+        return;
+    }
+    // unique name for each writer, also for threads of one process
+    std::string tmpPath = path + ".tmpXXXXXX";
+    const int fd = mkstemp(&tmpPath[0]);
+    if (fd < 0) {
+        LOG4FIMEX(logger, Logger::WARN, "cannot create temporary geometry cache file for '" << path << "': " << strerror(errno));
+        return;
+    }
+    fchmod(fd, 0644);
+    ::close(fd);
+    {
+        std::ofstream os(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+        os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        os.write(key.data(), key.size());
+        const char zeros[8] = {0};
+        os.write(zeros, align8(key.size()) - key.size());
+        for (size_t i = 0; i < h.arrayCount; ++i)
+            os.write(reinterpret_cast<const char*>(arrays[i]), arraySize * sizeof(double));
+        os.close();
+        if (!os) {
+            LOG4FIMEX(logger, Logger::WARN, "cannot write geometry cache file '" << tmpPath << "'");
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG4FIMEX(logger, Logger::WARN, "cannot rename geometry cache file to '" << path << "': " << strerror(errno));
+        std::remove(tmpPath.c_str());
+        return;
+    }
+    LOG4FIMEX(logger, Logger::DEBUG, "stored geometry cache file '" << path << "'");
+}
+
+} // namespace
+
+InterpolationGeometryCache::Key::Key(const std::string& kind)
+    : kind_(kind)
+    , hash_(FNV_OFFSET)
+{
+    add(kind);
+}
+
+void InterpolationGeometryCache::Key::addBytes(const void* data, size_t size)
+{
+    // FNV-1a
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash_ ^= bytes[i];
+        hash_ *= FNV_PRIME;
+    }
+    bytes_.append(static_cast<const char*>(data), size);
+}
+
+InterpolationGeometryCache::Key& InterpolationGeometryCache::Key::add(const std::string& value)
+{
+    // the length separates consecutive strings
+    add(value.size());
+    addBytes(value.data(), value.size());
+    return *this;
+}
+
+InterpolationGeometryCache::Key& InterpolationGeometryCache::Key::add(long long value)
+{
+    const int64_t v = value;
+    addBytes(&v, sizeof(v));
+    return *this;
+}
+
+InterpolationGeometryCache::Key& InterpolationGeometryCache::Key::add(double value)
+{
+    addBytes(&value, sizeof(value));
+    return *this;
+}
+
+InterpolationGeometryCache::Key& InterpolationGeometryCache::Key::add(const double* values, size_t size)
+{
+    add(size);
+    addBytes(values, size * sizeof(double));
+    return *this;
+}
+
+InterpolationGeometryCache::InterpolationGeometryCache(const std::string& directory)
+    : directory_(directory)
+{
+}
+
+std::string InterpolationGeometryCache::getPath(const Key& key) const
+{
+    std::ostringstream path;
+    path << directory_ << '/' << key.kind() << '-' << std::hex << std::setw(16) << std::setfill('0') << key.hash() << EXTENSION;
+    return path.str();
+}
+
+bool InterpolationGeometryCache::loadPoints(const Key& key, size_t size, shared_array<double>& pointsOnXAxis, shared_array<double>& pointsOnYAxis) const
+{
+    const std::string path = getPath(key);
+    Header h;
+    MappedFile_p mapped = mapEntry(path, key, ENTRY_POINTS, h);
+    if (!mapped)
+        return false;
+    if (h.sizeX != size || h.sizeY != 1 || h.arrayCount != 2) {
+        LOG4FIMEX(logger, Logger::WARN, "geometry cache file '" << path << "' has unexpected size " << h.sizeX << ", expected " << size);
+        return false;
+    }
+    pointsOnXAxis = mappedArray(mapped, h, 0, size);
+    pointsOnYAxis = mappedArray(mapped, h, 1, size);
+    LOG4FIMEX(logger, Logger::DEBUG, "loaded geometry cache file '" << path << "'");
+    return true;
+}
+
+void InterpolationGeometryCache::storePoints(const Key& key, size_t size, const shared_array<double>& pointsOnXAxis,
+                                             const shared_array<double>& pointsOnYAxis) const
+{
+    const double* arrays[2] = {pointsOnXAxis.get(), pointsOnYAxis.get()};
+    writeEntry(directory_, getPath(key), makeHeader(key, ENTRY_POINTS, size, 1, 2), key.bytes(), arrays, size);
+}
+
+reproject::Matrix_cp InterpolationGeometryCache::loadMatrix(const Key& key) const
+{
+    const std::string path = getPath(key);
+    Header h;
+    MappedFile_p mapped = mapEntry(path, key, ENTRY_MATRIX, h);
+    if (!mapped)
+        return reproject::Matrix_cp();
+    if (h.arrayCount != reproject::Matrix::stride || h.sizeX > (uint64_t)std::numeric_limits<int>::max() ||
+        h.sizeY > (uint64_t)std::numeric_limits<int>::max()) {
+        LOG4FIMEX(logger, Logger::WARN, "ignoring invalid matrix in geometry cache file '" << path << "'");
+        return reproject::Matrix_cp();
+    }
+    std::shared_ptr<reproject::Matrix> matrix = std::make_shared<reproject::Matrix>(0, 0);
+    matrix->size_x = h.sizeX;
+    matrix->size_y = h.sizeY;
+    matrix->matrix = mappedArray(mapped, h, 0, 0);
+    LOG4FIMEX(logger, Logger::DEBUG, "loaded geometry cache file '" << path << "'");
+    return matrix;
+}
+
+void InterpolationGeometryCache::storeMatrix(const Key& key, reproject::Matrix_cp matrix) const
+{
+    // the matrix is stored as one array, which is split in 'stride' parts for the header
+    const size_t size = static_cast<size_t>(matrix->size_x) * matrix->size_y;
+    const double* arrays[reproject::Matrix::stride];
+    for (size_t i = 0; i < reproject::Matrix::stride; ++i)
+        arrays[i] = matrix->mtx() + i * size;
+    writeEntry(directory_, getPath(key), makeHeader(key, ENTRY_MATRIX, matrix->size_x, matrix->size_y, reproject::Matrix::stride), key.bytes(), arrays,
+               size);
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,121 @@
+/*
+ * Fimex, InterpolationGeometryCache.h
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef INTERPOLATIONGEOMETRYCACHE_H_
+#define INTERPOLATIONGEOMETRYCACHE_H_
+
+#include "fimex/SharedArray.h"
+#include "fimex/reproject.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MetNoFimex {
+
+/**
+ * Directory of binary files with the geometry of horizontal
+ * interpolations, i.e. the positions of the output points in the input
+ * grid and the matrices for vector reprojection.
+ *
+ * The files are memory-mapped when loading, such that repeated
+ * interpolations between the same grids do not need to call proj or
+ * search for neighbours again. Files are written to a temporary name and
+ * renamed, so several processes may share one directory.
+ *
+ * Errors when reading or writing are logged and otherwise ignored, the
+ * caller will then compute the geometry.
+ */
+class InterpolationGeometryCache
+{
+public:
+    /**
+     * Identification of a cache entry, built from everything the
+     * geometry depends on (projection strings, axis values, method, ...).
+     *
+     * The hash names the file, the complete key is stored in the file and
+     * compared when loading, so hash collisions cannot return wrong data.
+     */
+    class Key
+    {
+    public:
+        /// @param kind short name of the geometry kind, used in the filename
+        explicit Key(const std::string& kind);
+
+        Key& add(const std::string& value);
+        Key& add(int value) { return add(static_cast<long long>(value)); }
+        Key& add(size_t value) { return add(static_cast<long long>(value)); }
+        Key& add(long long value);
+        Key& add(double value);
+        Key& add(const double* values, size_t size);
+        Key& add(const std::vector<double>& values) { return add(values.empty() ? nullptr : &values[0], values.size()); }
+
+        const std::string& kind() const { return kind_; }
+        uint64_t hash() const { return hash_; }
+        /// the serialized key
+        const std::string& bytes() const { return bytes_; }
+
+    private:
+        void addBytes(const void* data, size_t size);
+
+        std::string kind_;
+        uint64_t hash_;
+        std::string bytes_;
+    };
+
+    /**
+     * @param directory directory for the cache files, it will be created
+     *        if it does not exist, but not its parent directories
+     */
+    explicit InterpolationGeometryCache(const std::string& directory);
+
+    const std::string& getDirectory() const { return directory_; }
+
+    /// @return the path of the file for the key
+    std::string getPath(const Key& key) const;
+
+    /**
+     * Load output positions in the input grid.
+     *
+     * The arrays are private mappings of the file and may be modified.
+     *
+     * @return false if there is no valid entry for the key and size
+     */
+    bool loadPoints(const Key& key, size_t size, shared_array<double>& pointsOnXAxis, shared_array<double>& pointsOnYAxis) const;
+
+    /// store output positions in the input grid
+    void storePoints(const Key& key, size_t size, const shared_array<double>& pointsOnXAxis, const shared_array<double>& pointsOnYAxis) const;
+
+    /// @return the cached vector reprojection matrix, or null if there is no valid entry for the key
+    reproject::Matrix_cp loadMatrix(const Key& key) const;
+
+    /// store a vector reprojection matrix
+    void storeMatrix(const Key& key, reproject::Matrix_cp matrix) const;
+
+private:
+    std::string directory_;
+};
+
+} // namespace MetNoFimex
+
+#endif /* INTERPOLATIONGEOMETRYCACHE_H_ */
@@ -110,6 +110,7 @@ NcmlAggregationReader::NcmlAggregationReader(const XMLInput& ncml)
         }
 
         // find sources from location, scan, ...
+        std::vector<AggregationReader::LazyReader> members;
         size_t idx = 0;
         for (auto node : XPathNodeSet(doc, "./nc:netcdf", nodesAgg[0])) {
             // open <netcdf /> tags recursively
@@ -128,9 +129,14 @@ NcmlAggregationReader::NcmlAggregationReader(const XMLInput& ncml)
             if (!timeUnitsChange.empty()) {
                 LOG4FIMEX(logger, Logger::WARN, "ncml aggregation timeUnitsChange not implemented");
             }
-            agg->addReader(std::make_shared<NcmlCDMReader>(XMLInputString(current, id)), id, coordValue);
+            AggregationReader::LazyReader member;
+            member.open = [current, id]() { return std::make_shared<NcmlCDMReader>(XMLInputString(current, id)); };
+            member.id = id;
+            member.coordValue = coordValue;
+            members.push_back(member);
             idx += 1;
         }
+        agg->addReaders(members, false);
 
         // open reader by scan
         idx = 0;
@@ -156,17 +162,18 @@ NcmlAggregationReader::NcmlAggregationReader(const XMLInput& ncml)
             }
             std::vector<std::string> files;
             scanFiles(files, dir, depth, std::regex(regExp), true);
-            std::string coordValue;
+            members.clear();
             for (const auto& fileName : files) {
-                LOG4FIMEX(logger, Logger::DEBUG, "scanned file '" << fileName << "'");
-                try {
-                    if (aggJoinNew)
-                        coordValue = "location_" + type2string(idx);
-                    agg->addReader(CDMFileReaderFactory::create(type, fileName, config), fileName, coordValue);
-                } catch (CDMException& ex) {
-                    LOG4FIMEX(logger, Logger::ERROR, "cannot read scanned file '" << fileName << "' type: " << type << ", config: " << config);
-                }
+                LOG4FIMEX(logger, Logger::DEBUG, "scanned file '" << fileName << "' type: " << type << ", config: " << config);
+                AggregationReader::LazyReader member;
+                member.open = [type, fileName, config]() { return CDMFileReaderFactory::create(type, fileName, config); };
+                member.id = fileName;
+                if (aggJoinNew)
+                    member.coordValue = "location_" + type2string(idx);
+                members.push_back(member);
             }
+            // unreadable scanned files are skipped
+            agg->addReaders(members, true);
             idx += 1;
         }
         agg->initAggregation();
@@ -30,6 +30,7 @@
 
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
+#include "fimex/CDMReaderUtils.h"
 #include "fimex/Data.h"
 #include "fimex/DataUtils.h"
 #include "fimex/Logger.h"
@@ -533,7 +534,7 @@ DataPtr NcmlCDMReader::getDataSlice(const std::string& varName, size_t unLimDimP
 {
     SliceBuilder sb(*cdm_, varName);
     if (const CDMDimension* unlimDim = cdm_->getUnlimitedDim()) {
-        if (cdm_->getVariable(varName).checkDimension(unlimDim->getName()))
+        if (getCDM().getVariable(varName).checkDimension(unlimDim->getName()))
             sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
     }
     return getDataSlice(varName, sb);
@@ -544,7 +545,7 @@ DataPtr NcmlCDMReader::getDataSlice(const std::string& varName, const SliceBuild
     LOG4FIMEX(logger, Logger::DEBUG, "getDataSlice(var,sb): (" << varName << ", " << sb << ")");
 
     // return unchanged data from this CDM
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         LOG4FIMEX(logger, Logger::DEBUG, "fetching data from memory");
         return getDataSliceFromMemory(variable, sb);
@@ -582,6 +583,13 @@ DataPtr NcmlCDMReader::getDataSlice(const std::string& varName, const SliceBuild
     return applyVariableTypeChange(data, varName, orgVarName);
 }
 
+std::vector<std::size_t> NcmlCDMReader::getChunkShape(const std::string& varName) const
+{
+    map<string, string>::const_iterator vit = variableNameChanges.find(varName);
+    const std::string& orgVarName = (vit != variableNameChanges.end()) ? vit->second : varName;
+    return forwardChunkShape(*dataReader, orgVarName, getCDM(), varName);
+}
+
 DataPtr NcmlCDMReader::applyVariableTypeChange(DataPtr data, const std::string& varName, const std::string& orgVarName)
 {
     // eventually, change the type from the old type to the new type
@@ -136,8 +136,8 @@ TimeSpec::TimeSpec(const string& timeSpec, const FimexTime& startTime, const Fim
         string timeDoubles = timeString2timeUnitString(timeStepStr, tu);
         vector<double> timeDoubleVec = tokenizeDotted<double>(timeDoubles, ",");
         // add the times as fimexTimes to timeSteps
-        std::transform(timeDoubleVec.begin(), timeDoubleVec.end(), std::back_inserter(timeSteps),
-                       std::bind(std::mem_fn(&TimeUnit::unitTime2fimexTime), tu, std::placeholders::_1));
+        const vector<FimexTime> fiTimes = tu.unitTimes2fimexTimes(timeDoubleVec);
+        timeSteps.insert(timeSteps.end(), fiTimes.begin(), fiTimes.end());
     } else {
         // including x
         // relative times
@@ -168,8 +168,8 @@ TimeSpec::TimeSpec(const string& timeSpec, const FimexTime& startTime, const Fim
         string timeDoubles = join(times.begin(), times.end(), ",");
         vector<double> timeDoubleVec = tokenizeDotted<double>(timeDoubles, ",");
         // add the times as fimexTimes to timeSteps
-        std::transform(timeDoubleVec.begin(), timeDoubleVec.end(), std::back_inserter(timeSteps),
-                       std::bind(std::mem_fn(&TimeUnit::unitTime2fimexTime), tu, std::placeholders::_1));
+        const vector<FimexTime> fiTimes = tu.unitTimes2fimexTimes(timeDoubleVec);
+        timeSteps.insert(timeSteps.end(), fiTimes.begin(), fiTimes.end());
     }
 
     LOG4FIMEX(logger, Logger::DEBUG, "got parameters unit:" << outputUnit << ";relativeUnit:" << relativeUnit << ";steps:" << timeStepStr);
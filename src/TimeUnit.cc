@@ -36,18 +36,62 @@
 #include "udunits2.h"
 #include "converter.h"
 
-// TODO: make thread-safe with mifi_units lock
-
 namespace MetNoFimex
 {
 /// only use for internals, exported from Units.cc
 extern OmpMutex& getUnitsMutex();
 
-static void void_ut_free(void* ptr)
+namespace {
+
+void void_ut_free(void* ptr)
 {
     ut_free(reinterpret_cast<ut_unit*>(ptr));
 }
 
+void void_cv_free(void* ptr)
+{
+    cv_free(reinterpret_cast<cv_converter*>(ptr));
+}
+
+FimexTime encodedTime2fimexTime(double encodedTime)
+{
+    FimexTime fiTime;
+    int year, month, mday, hour, minute;
+    double res, sec;
+    ut_decode_time(encodedTime, &year, &month, &mday, &hour, &minute, &sec, &res);
+    const float second = static_cast<float>(sec);
+    fiTime.setYear(static_cast<unsigned int>(year));
+    fiTime.setMonth(static_cast<char>(month));
+    fiTime.setMDay(static_cast<char>(mday));
+    fiTime.setHour(static_cast<char>(hour));
+    fiTime.setMinute(static_cast<char>(minute));
+    fiTime.setSecond(static_cast<char>(second));
+    fiTime.setMSecond(static_cast<unsigned int>((second - fiTime.getSecond())*1000));
+    return fiTime;
+}
+
+// returns true and sets unitTime if fiTime does not need conversion
+bool specialFimexTime2unitTime(const FimexTime& fiTime, double invalidValue, double& unitTime)
+{
+    if (!fiTime.invalid())
+        return false;
+    if (fiTime == FimexTime(FimexTime::min_date_time))
+        unitTime = std::numeric_limits<double>::lowest();
+    else if (fiTime == FimexTime(FimexTime::max_date_time))
+        unitTime = std::numeric_limits<double>::max();
+    else
+        unitTime = invalidValue;
+    return true;
+}
+
+double fimexTime2encodedTime(const FimexTime& fiTime)
+{
+    const float second = fiTime.getSecond() + (fiTime.getMSecond()/1000.);
+    return ut_encode_time(fiTime.getYear(), fiTime.getMonth(), fiTime.getMDay(), fiTime.getHour(), fiTime.getMinute(), second);
+}
+
+} // namespace
+
 void TimeUnit::init(const std::string& timeUnitString)
 {
     Units units; // unit initialization
@@ -56,9 +100,18 @@ void TimeUnit::init(const std::string& timeUnitString)
     } else {
         units.convert(timeUnitString, "seconds since 1970-01-01 00:00:00 +00:00", epochSlope, epochOffset);
         OmpScopedLock lock(getUnitsMutex());
-        pUnit = std::shared_ptr<void>(
-            reinterpret_cast<void*>(ut_parse(reinterpret_cast<const ut_system*>(units.exposeInternals()), timeUnitString.c_str(), UT_UTF8)), void_ut_free);
+        const ut_system* system = reinterpret_cast<const ut_system*>(units.exposeInternals());
+        ut_unit* unit = ut_parse(system, timeUnitString.c_str(), UT_UTF8);
+        pUnit = std::shared_ptr<void>(reinterpret_cast<void*>(unit), void_ut_free);
         handleUdUnitError(ut_get_status(), "parsing " + timeUnitString);
+
+        // the converters are kept for the lifetime of the TimeUnit, creating them is much more expensive than converting
+        std::shared_ptr<ut_unit> baseTime(ut_get_unit_by_name(system, "second"), ut_free);
+        handleUdUnitError(ut_get_status(), "parsing unit seconds");
+        pToSeconds = std::shared_ptr<void>(reinterpret_cast<void*>(ut_get_converter(unit, baseTime.get())), void_cv_free);
+        handleUdUnitError(ut_get_status(), "converting double to calendar");
+        pFromSeconds = std::shared_ptr<void>(reinterpret_cast<void*>(ut_get_converter(baseTime.get(), unit)), void_cv_free);
+        handleUdUnitError(ut_get_status(), "converter calendar to double");
     }
 }
 
@@ -87,50 +140,45 @@ double TimeUnit::epochSeconds2unitTime(double epochSeconds) const
 
 FimexTime TimeUnit::unitTime2fimexTime(double unitTime) const
 {
-    Units units; // unit initialization
-    FimexTime fiTime;
-    float second;
-    int year, month, mday, hour, minute;
     OmpScopedLock lock(getUnitsMutex());
-    std::shared_ptr<ut_unit> baseTime(ut_get_unit_by_name(reinterpret_cast<const ut_system*>(units.exposeInternals()), "second"), ut_free);
-    handleUdUnitError(ut_get_status(), "parsing unit seconds");
-    std::shared_ptr<cv_converter> conv(ut_get_converter(reinterpret_cast<ut_unit*>(pUnit.get()), baseTime.get()), cv_free);
+    ut_set_status(UT_SUCCESS); // the status is not reset by successful conversions
+    const double encodedTime = cv_convert_double(reinterpret_cast<const cv_converter*>(pToSeconds.get()), unitTime);
     handleUdUnitError(ut_get_status(), "converting double to calendar");
-    double encodedTime = cv_convert_double(conv.get(), unitTime);
-    double res, sec;
-    ut_decode_time(encodedTime, &year, &month, &mday, &hour, &minute, &sec, &res);
-    second = static_cast<float>(sec);
-    fiTime.setYear(static_cast<unsigned int>(year));
-    fiTime.setMonth(static_cast<char>(month));
-    fiTime.setMDay(static_cast<char>(mday));
-    fiTime.setHour(static_cast<char>(hour));
-    fiTime.setMinute(static_cast<char>(minute));
-    fiTime.setSecond(static_cast<char>(second));
-    fiTime.setMSecond(static_cast<unsigned int>((second - fiTime.getSecond())*1000));
-
-    return fiTime;
+    return encodedTime2fimexTime(encodedTime);
 }
 
-double TimeUnit::fimexTime2unitTime(const FimexTime& fiTime, double invalidValue) const
+std::vector<FimexTime> TimeUnit::unitTimes2fimexTimes(const double* unitTimes, size_t n) const
 {
-    if (fiTime.invalid()) {
-        if (fiTime == FimexTime(FimexTime::min_date_time))
-            return std::numeric_limits<double>::lowest();
-        else if (fiTime == FimexTime(FimexTime::max_date_time))
-            return std::numeric_limits<double>::max();
-        return invalidValue;
+    std::vector<double> encodedTimes(n);
+    OmpScopedLock lock(getUnitsMutex());
+    if (n > 0) {
+        ut_set_status(UT_SUCCESS);
+        cv_convert_doubles(reinterpret_cast<const cv_converter*>(pToSeconds.get()), unitTimes, n, &encodedTimes[0]);
+        handleUdUnitError(ut_get_status(), "converting doubles to calendar");
     }
+    std::vector<FimexTime> fiTimes;
+    fiTimes.reserve(n);
+    for (double encodedTime : encodedTimes)
+        fiTimes.push_back(encodedTime2fimexTime(encodedTime));
+    return fiTimes;
+}
 
-    Units units; // unit initialization
-    float second = fiTime.getSecond() + (fiTime.getMSecond()/1000.);
+std::vector<FimexTime> TimeUnit::unitTimes2fimexTimes(const std::vector<double>& unitTimes) const
+{
+    return unitTimes2fimexTimes(unitTimes.data(), unitTimes.size());
+}
+
+double TimeUnit::fimexTime2unitTime(const FimexTime& fiTime, double invalidValue) const
+{
     double unitTime;
+    if (specialFimexTime2unitTime(fiTime, invalidValue, unitTime))
+        return unitTime;
+
     OmpScopedLock lock(getUnitsMutex());
-    std::shared_ptr<ut_unit> baseTime(ut_get_unit_by_name(reinterpret_cast<const ut_system*>(units.exposeInternals()), "second"), ut_free);
-    double encodedTime = ut_encode_time(fiTime.getYear(), fiTime.getMonth(), fiTime.getMDay(), fiTime.getHour(), fiTime.getMinute(), second);
+    ut_set_status(UT_SUCCESS); // the status is not reset by successful conversions
+    const double encodedTime = fimexTime2encodedTime(fiTime);
     handleUdUnitError(ut_get_status(), "encoding fimexTime");
-    std::shared_ptr<cv_converter> conv(ut_get_converter(baseTime.get(), reinterpret_cast<ut_unit*>(pUnit.get())), cv_free);
-    handleUdUnitError(ut_get_status(), "converter calendar to double");
-    unitTime = cv_convert_double(conv.get(), encodedTime);
+    unitTime = cv_convert_double(reinterpret_cast<const cv_converter*>(pFromSeconds.get()), encodedTime);
     handleUdUnitError(ut_get_status(), "converting calendar to double");
     return unitTime;
 }
@@ -140,4 +188,24 @@ double TimeUnit::fimexTime2unitTime(const FimexTime& fiTime) const
     return fimexTime2unitTime(fiTime, std::nan(""));
 }
 
+std::vector<double> TimeUnit::fimexTimes2unitTimes(const std::vector<FimexTime>& fiTimes, double invalidValue) const
+{
+    const cv_converter* conv = reinterpret_cast<const cv_converter*>(pFromSeconds.get());
+    std::vector<double> unitTimes(fiTimes.size());
+    OmpScopedLock lock(getUnitsMutex());
+    ut_set_status(UT_SUCCESS);
+    for (size_t i = 0; i < fiTimes.size(); ++i) {
+        if (!specialFimexTime2unitTime(fiTimes[i], invalidValue, unitTimes[i]))
+            unitTimes[i] = cv_convert_double(conv, fimexTime2encodedTime(fiTimes[i]));
+    }
+    // udunits keeps a failure status, so checking once after the loop catches errors in any element
+    handleUdUnitError(ut_get_status(), "converting calendar to doubles");
+    return unitTimes;
+}
+
+std::vector<double> TimeUnit::fimexTimes2unitTimes(const std::vector<FimexTime>& fiTimes) const
+{
+    return fimexTimes2unitTimes(fiTimes, std::nan(""));
+}
+
 } // namespace MetNoFimex
@@ -70,6 +70,18 @@ void handleUdUnitError(int unitErrCode, const std::string& message)
     }
 }
 
+void UnitsConverter::convert(const double* from, double* to, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        to[i] = convert(from[i]);
+}
+
+void UnitsConverter::convert(const float* from, float* to, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        to[i] = convert(from[i]);
+}
+
 class LinearUnitsConverter : public UnitsConverter{
     double dscale_;
     double doffset_;
@@ -87,6 +99,16 @@ public:
     ~LinearUnitsConverter() {}
     double convert(double from) override { return dscale_ * from + doffset_; }
     float convert(float from) override { return fscale_ * from + foffset_; }
+    void convert(const double* from, double* to, size_t count) override
+    {
+        for (size_t i = 0; i < count; ++i)
+            to[i] = dscale_ * from[i] + doffset_;
+    }
+    void convert(const float* from, float* to, size_t count) override
+    {
+        for (size_t i = 0; i < count; ++i)
+            to[i] = fscale_ * from[i] + foffset_;
+    }
     bool isLinear() override { return true; }
     void getScaleOffset(double& scale, double& offset) override
     {
@@ -118,6 +140,20 @@ public:
         }
         return retval;
     }
+    void convert(const double* from, double* to, size_t count) override
+    {
+#pragma omp critical(cv_converter)
+        {
+            cv_convert_doubles(conv_, from, count, to);
+        }
+    }
+    void convert(const float* from, float* to, size_t count) override
+    {
+#pragma omp critical(cv_converter)
+        {
+            cv_convert_floats(conv_, from, count, to);
+        }
+    }
     bool isLinear() override
     {
         // check some points
@@ -0,0 +1,101 @@
+/*
+ * Fimex, VectorPairCache.cc
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "VectorPairCache.h"
+
+#include "fimex/SliceBuilder.h"
+
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace MetNoFimex {
+
+VectorPairCache::VectorPairCache(size_t maxEntries)
+    : maxEntries_(maxEntries)
+{
+    if (maxEntries_ == 0) {
+#ifdef _OPENMP
+        maxEntries_ = 2 * omp_get_max_threads();
+#else
+        maxEntries_ = 2;
+#endif
+    }
+}
+
+std::string VectorPairCache::sliceKey(size_t unLimDimPos)
+{
+    std::ostringstream key;
+    key << "unLimDimPos=" << unLimDimPos;
+    return key.str();
+}
+
+std::string VectorPairCache::sliceKey(const SliceBuilder& sb)
+{
+    const std::vector<std::string> names = sb.getDimensionNames();
+    const std::vector<size_t>& start = sb.getDimensionStartPositions();
+    const std::vector<size_t>& size = sb.getDimensionSizes();
+    std::ostringstream key;
+    for (size_t i = 0; i < names.size(); ++i)
+        key << names[i] << '=' << start[i] << '+' << size[i] << ';';
+    return key.str();
+}
+
+void VectorPairCache::put(const std::string& varName, const std::string& sliceKey, DataPtr data)
+{
+    const std::string key = varName + '\n' + sliceKey;
+    OmpScopedLock lock(mutex_);
+    for (std::list<std::pair<std::string, DataPtr>>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->first == key) {
+            entries_.erase(it);
+            break;
+        }
+    }
+    entries_.push_front(std::make_pair(key, data));
+    while (entries_.size() > maxEntries_)
+        entries_.pop_back();
+}
+
+DataPtr VectorPairCache::take(const std::string& varName, const std::string& sliceKey)
+{
+    const std::string key = varName + '\n' + sliceKey;
+    OmpScopedLock lock(mutex_);
+    for (std::list<std::pair<std::string, DataPtr>>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->first == key) {
+            DataPtr data = it->second;
+            entries_.erase(it);
+            return data;
+        }
+    }
+    return DataPtr();
+}
+
+void VectorPairCache::clear()
+{
+    OmpScopedLock lock(mutex_);
+    entries_.clear();
+}
+
+} // namespace MetNoFimex
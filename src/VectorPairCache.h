@@ -0,0 +1,77 @@
+/*
+ * Fimex, VectorPairCache.h
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef VECTORPAIRCACHE_H_
+#define VECTORPAIRCACHE_H_
+
+#include "fimex/DataDecl.h"
+#include "fimex/MutexLock.h"
+
+#include <list>
+#include <string>
+#include <utility>
+
+namespace MetNoFimex {
+
+class SliceBuilder;
+
+/**
+ * Short-lived cache for the second component of vector pairs.
+ *
+ * Rotating a vector requires both components, so when one component is
+ * requested, the rotated counterpart is stored here and served once when
+ * it is requested for the same slice, without reading and rotating again.
+ * Only a few entries are kept, the oldest are dropped if the counterpart
+ * is never requested.
+ */
+class VectorPairCache
+{
+public:
+    /// @param maxEntries maximum number of entries, 0 for twice the number of OpenMP threads
+    explicit VectorPairCache(size_t maxEntries = 0);
+
+    /// @return the key for a slice along the unlimited dimension
+    static std::string sliceKey(size_t unLimDimPos);
+
+    /// @return the key for a slice, built from the dimension names, start positions and sizes
+    static std::string sliceKey(const SliceBuilder& sb);
+
+    /// store the rotated data of varName
+    void put(const std::string& varName, const std::string& sliceKey, DataPtr data);
+
+    /// @return the rotated data of varName and remove it from the cache, or null if not cached
+    DataPtr take(const std::string& varName, const std::string& sliceKey);
+
+    /// remove all entries
+    void clear();
+
+private:
+    OmpMutex mutex_;
+    // most recent first
+    std::list<std::pair<std::string, DataPtr>> entries_;
+    size_t maxEntries_;
+};
+
+} // namespace MetNoFimex
+
+#endif /* VECTORPAIRCACHE_H_ */
@@ -26,6 +26,9 @@
 
 #include "fimex/XMLUtils.h"
 
+#include "GribBinaryIndex.h"
+#include "GribFileIndex.h"
+
 #include <mi_programoptions.h>
 
 #include <libxml/xmlreader.h>
@@ -41,6 +44,7 @@ namespace po = miutil::program_options;
 static void writeUsage(ostream& out, const po::option_set& options)
 {
     out << "usage: fiGrbmlCat --outputFile=OUTFILE.grbml file1.grml [file2.grbml ...] [--inputFile=fileX.grbml] " << endl;
+    out << "  Inputs may be grbml or binary indices, with --binary a binary index is written instead of grbml." << endl;
     out << endl;
     options.help(out);
 }
@@ -132,21 +136,51 @@ void grbmlExtract(const string& fileName, ostream& os)
     }
 }
 
+void binaryExtract(const string& fileName, ostream& os)
+{
+    const MetNoFimex::GribFileIndex gfi(fileName);
+    if (first) {
+        os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl;
+        os << "<gribFileIndex url=\"" << gfi.getUrl() << "\" xmlns=\"http://www.met.no/schema/fimex/gribFileIndex\">" << endl;
+        first = false;
+    }
+    for (const auto& gfm : gfi.listMessages())
+        os << gfm;
+}
+
 void extractToStream(std::ostream& out, const std::vector<std::string>& files)
 {
-    for (size_t i = 0; i < files.size(); ++i)
-        grbmlExtract(files[i], out);
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (MetNoFimex::GribBinaryIndex::isBinaryIndex(files[i]))
+            binaryExtract(files[i], out);
+        else
+            grbmlExtract(files[i], out);
+    }
     if (!first)
         out << "</gribFileIndex>" << endl;
 }
 
+void extractToBinary(const std::string& outputFile, const std::vector<std::string>& files)
+{
+    std::string url;
+    std::vector<MetNoFimex::GribFileMessage> messages;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const MetNoFimex::GribFileIndex gfi(files[i]);
+        if (i == 0)
+            url = gfi.getUrl();
+        messages.insert(messages.end(), gfi.listMessages().begin(), gfi.listMessages().end());
+    }
+    MetNoFimex::GribBinaryIndex::write(outputFile, url, messages);
+}
+
 int main(int argc, char* args[])
 {
     const po::option op_outputFile = po::option("outputFile", "output grbml").set_shortkey("o");
     const po::option op_inputFile = po::option("inputFile", "input grbml, possibly many").set_composing().set_shortkey("i");
+    const po::option op_binary = po::option("binary", "write a binary, memory-mappable index instead of grbml").set_narg(0);
 
     po::option_set options;
-    options << op_outputFile << op_inputFile;
+    options << op_outputFile << op_inputFile << op_binary;
 
     // read the options
     po::string_v positional;
@@ -163,7 +197,14 @@ int main(int argc, char* args[])
 
     const vector<string>& files = vm.values(op_inputFile);
     const std::string& outputFile = vm.value(op_outputFile);
-    if (outputFile != "-") {
+    if (vm.is_set(op_binary)) {
+        if (outputFile == "-") {
+            cerr << "binary index cannot be written to stdout" << endl;
+            writeUsage(cerr, options);
+            return 1;
+        }
+        extractToBinary(outputFile, files);
+    } else if (outputFile != "-") {
         std::ofstream outputStream(outputFile, std::ios::binary);
         extractToStream(outputStream, files);
     } else {
@@ -28,6 +28,7 @@
 #include "fimex/CDMconstants.h"
 
 #include "fimex/Logger.h"
+#include "fimex/String2Type.h"
 #include "fimex/StringUtils.h"
 #include "fimex/ThreadPool.h"
 #include "fimex/XMLInputFile.h"
@@ -35,6 +36,7 @@
 #define MIFI_IO_READER_SUPPRESS_DEPRECATED
 #include "GribCDMReader.h"
 #undef MIFI_IO_READER_SUPPRESS_DEPRECATED
+#include "GribBinaryIndex.h"
 #include "GribFileIndex.h"
 
 #include <mi_programoptions.h>
@@ -60,6 +62,8 @@ void writeUsage(ostream& out, const po::option_set& options)
     out << "  When creating, one or more input file(s) must be specified." << endl;
     out << "usage: fiIndexGribs -a/--appendFile GRBML_NAME [-c/--readerConfig gribreaderconfig.xml] [-i] gribFile" << endl;
     out << "  When appending, exactly one input file must be specified." << endl;
+    out << "  With --threads=N, messages are decoded by N threads, the index does not depend on N." << endl;
+    out << "  With --binary, a binary index (GRBBIN_NAME, default gribFile.grbbin) is written instead of grbml." << endl;
     out << endl;
     options.help(out);
 }
@@ -107,12 +111,24 @@ GribIndexWriter::~GribIndexWriter()
 }
 
 void indexGribs(const std::vector<std::string>& inputs, const std::string& output, vector<string> extraKeys, string config,
-                vector<string> memberOptions)
+                vector<string> memberOptions, bool binary)
 {
     std::map<std::string, std::string> options;
     std::vector<std::pair<std::string, std::regex>> members;
     initOptions(options, members, extraKeys, config, memberOptions);
 
+    if (binary) {
+        // the binary index is written in one go, with shared string- and grid-tables
+        std::vector<GribFileMessage> messages;
+        for (const auto& input : inputs) {
+            LOG4FIMEX(logger, Logger::DEBUG, "Start processing '" << input << "'");
+            const GribFileIndex gfi(input, "", members, options);
+            messages.insert(messages.end(), gfi.listMessages().begin(), gfi.listMessages().end());
+        }
+        GribBinaryIndex::write(output, "file:" + inputs.front(), messages);
+        return;
+    }
+
     GribIndexWriter w(output, "file:" + inputs.front());
     for (const auto& input : inputs) {
         LOG4FIMEX(logger, Logger::DEBUG, "Start processing '" << input << "'");
@@ -122,7 +138,8 @@ void indexGribs(const std::vector<std::string>& inputs, const std::string& outpu
     }
 }
 
-void indexGribAppend(const std::string& input, const std::string& append, vector<string> extraKeys, string config, vector<string> memberOptions)
+void indexGribAppend(const std::string& input, const std::string& append, vector<string> extraKeys, string config, vector<string> memberOptions,
+                     bool binary)
 {
     std::map<std::string, std::string> options;
     std::vector<std::pair<std::string, std::regex>> members;
@@ -132,6 +149,10 @@ void indexGribAppend(const std::string& input, const std::string& append, vector
     const GribFileIndex gfi(input, append, members, options);
 
     LOG4FIMEX(logger, Logger::DEBUG, "Writing to '" << append << "'");
+    if (binary) {
+        GribBinaryIndex::write(append, "file:" + input, gfi.listMessages());
+        return;
+    }
     GribIndexWriter w(append, "file:" + input);
     for (const auto& gfm : gfi.listMessages())
         w.os << gfm;
@@ -141,9 +162,6 @@ void indexGribAppend(const std::string& input, const std::string& append, vector
 
 int main(int argc, char* args[])
 {
-    // only use one thread
-    mifi_setNumThreads(1);
-
     const po::option op_help = po::option("help", "help message").set_shortkey("h").set_narg(0);
     const po::option op_debug = po::option("debug", "debug option").set_narg(0);
     const po::option op_version = po::option("version", "program version").set_narg(0);
@@ -153,6 +171,8 @@ int main(int argc, char* args[])
     const po::option op_inputFile = po::option("inputFile", "input gribFile").set_shortkey("i").set_composing();
     const po::option op_input_optional = po::option("input.optional", "optional arguments for grib-files as in fimex, i.e. memberRegex: , memberName: pairs").set_composing();
     const po::option op_appendFile = po::option("appendFile", "append output new index to a grbml-file").set_shortkey("a");
+    const po::option op_binary = po::option("binary", "write a binary, memory-mappable index instead of grbml").set_narg(0);
+    const po::option op_threads = po::option("threads", "number of threads to decode messages with, 0 for all processors (default 1)");
 
     po::option_set options;
     options
@@ -165,6 +185,8 @@ int main(int argc, char* args[])
         << op_inputFile
         << op_input_optional
         << op_appendFile
+        << op_binary
+        << op_threads
         ;
 
     // read the options
@@ -183,16 +205,23 @@ int main(int argc, char* args[])
         return 0;
     }
 
+    // the index is the same for any number of threads, default to one thread
+    int threads = 1;
+    if (vm.is_set(op_threads))
+        threads = string2type<int>(vm.value(op_threads));
+    mifi_setNumThreads(threads);
+
     vector<string> inputs;
     if (vm.is_set(op_inputFile))
         inputs = vm.values(op_inputFile);
     inputs.insert(inputs.end(), positional.begin(), positional.end());
 
+    const bool binary = vm.is_set(op_binary);
     std::string outputFile;
     if (vm.is_set(op_outputFile))
         outputFile = vm.value(op_outputFile);
     else if (!inputs.empty())
-        outputFile = inputs.front() + ".grbml";
+        outputFile = inputs.front() + (binary ? std::string(".") + GribBinaryIndex::EXTENSION : std::string(".grbml"));
 
     vector<string> extraKeys;
     if (vm.is_set(op_extraKey)) {
@@ -214,14 +243,14 @@ int main(int argc, char* args[])
             return 1;
         }
         outputFile = appendFile = vm.value(op_appendFile);
-        indexGribAppend(inputs.front(), appendFile, extraKeys, readerConfig, members);
+        indexGribAppend(inputs.front(), appendFile, extraKeys, readerConfig, members, binary);
     } else {
         if (inputs.empty()) {
             cerr << "missing input file" << endl;
             writeUsage(cout, options);
             return 1;
         }
-        indexGribs(inputs, outputFile, extraKeys, readerConfig, members);
+        indexGribs(inputs, outputFile, extraKeys, readerConfig, members, binary);
     }
     return 0;
 }
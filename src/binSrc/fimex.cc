@@ -165,10 +165,11 @@ const po::option op_interpolate_yAxisUnit = po::option("interpolate.yAxisUnit",
 const po::option op_interpolate_xAxisType = po::option("interpolate.xAxisType", "datatype of x-axis (double,float,int,short)").set_default_value("double");
 const po::option op_interpolate_yAxisType = po::option("interpolate.yAxisType", "datatype of y-axis").set_default_value("double");
 const po::option op_interpolate_distanceOfInterest = po::option("interpolate.distanceOfInterest", "optional distance of interest used differently depending on method");
+const po::option op_interpolate_geometryCacheDirectory = po::option("interpolate.geometryCacheDirectory", "optional directory to keep the interpolation geometry between runs, default from FIMEX_INTERPOLATION_CACHE_DIR");
 const po::option op_interpolate_latitudeName = po::option("interpolate.latitudeName", "name for auto-generated projection coordinate latitude");
 const po::option op_interpolate_longitudeName = po::option("interpolate.longitudeName", "name for auto-generated projection coordinate longitude");
-const po::option op_interpolate_preprocess = po::option("interpolate.preprocess", "add a 2d preprocess before the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100)\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"");
-const po::option op_interpolate_postprocess = po::option("interpolate.postprocess", "add a 2d postprocess after the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100)\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"");
+const po::option op_interpolate_preprocess = po::option("interpolate.preprocess", "add a 2d preprocess before the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100[,method=sor|redblack|multigrid])\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"");
+const po::option op_interpolate_postprocess = po::option("interpolate.postprocess", "add a 2d postprocess after the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100[,method=sor|redblack|multigrid])\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"");
 const po::option op_interpolate_latitudeValues = po::option("interpolate.latitudeValues",
         "latitude values, in degrees north, of a list of points to interpolate to, e.g. 60.5,70,90"
         " (use with 'longitudeValues' -- to produce a grid, use 'projString', 'xAxisValues', 'yAxisValues', ...)");
@@ -663,12 +664,21 @@ CDMReader_p getCDMVerticalInterpolator(const po::value_set& vm, CDMReader_p data
 std::shared_ptr<InterpolatorProcess2d> parseProcess(const string& procString, const string& logProcess)
 {
     std::smatch what;
-    if (std::regex_match(procString, what, std::regex("\\s*fill2d\\(([^, ]+), *([^, ]+), *([^ )]+)\\).*"))) {
+    if (std::regex_match(procString, what, std::regex("\\s*fill2d\\(([^, ]+), *([^, ]+), *([^, )]+)(?:, *(?:method=)?([^, )]+))?\\).*"))) {
         double critx = string2type<double>(what[1]);
         double cor = string2type<double>(what[2]);
         size_t maxLoop = string2type<size_t>(what[3]);
-        LOG4FIMEX(logger, Logger::DEBUG, "running interpolate " << logProcess << ": fill2d(" << critx << "," << cor << "," << maxLoop << ")");
-        return std::make_shared<InterpolatorFill2d>(critx, cor, maxLoop);
+        int method = MIFI_FILL2D_SOR;
+        const std::string methodName = what[4].matched ? what[4].str() : std::string("sor");
+        if (methodName == "redblack") {
+            method = MIFI_FILL2D_REDBLACK;
+        } else if (methodName == "multigrid") {
+            method = MIFI_FILL2D_MULTIGRID;
+        } else if (methodName != "sor") {
+            throw CDMException("unknown fill2d method '" + methodName + "', expected sor, redblack or multigrid");
+        }
+        LOG4FIMEX(logger, Logger::DEBUG, "running interpolate " << logProcess << ": fill2d(" << critx << "," << cor << "," << maxLoop << "," << methodName << ")");
+        return std::make_shared<InterpolatorFill2d>(critx, cor, maxLoop, method);
     } else if (std::regex_match(procString, what, std::regex("\\s*creepfill2d\\((.+)\\).*"))) {
         vector<string> vals = tokenize(what[1], ",");
         if (vals.size() == 2) {
@@ -700,6 +710,9 @@ CDMInterpolator_p createCDMInterpolator(const po::value_set& vm, CDMReader_p dat
         interpolator->setLongitudeName(value);
     }
 
+    if (getOption(op_interpolate_geometryCacheDirectory, vm, value)) {
+        interpolator->setGeometryCacheDirectory(value);
+    }
     if (getOption(op_interpolate_preprocess, vm, value)) {
         interpolator->addPreprocess(parseProcess(value, "preprocess"));
     }
@@ -965,6 +978,7 @@ int run(int argc, char* args[])
         << op_interpolate_xAxisType
         << op_interpolate_yAxisType
         << op_interpolate_distanceOfInterest
+        << op_interpolate_geometryCacheDirectory
         << op_interpolate_latitudeName
         << op_interpolate_longitudeName
         << op_interpolate_preprocess
@@ -284,6 +284,8 @@ CoordinateSystem_cp_v CF1_xCoordSysBuilder::listCoordinateSystems(CDM& cdm)
     // step 1: find all coordinate axes, that are dimensions and coordinates
     map<string, CoordinateAxis_p> coordinateAxes;
     {
+        // read only, the non-const getters change the structure version of the cdm
+        const CDM& ccdm = cdm;
         set<string> tmpCoordinateAxes;
         const CDM::DimVec& dims = cdm.getDimensions();
         for (CDM::DimVec::const_iterator dim = dims.begin(); dim != dims.end(); ++dim) {
@@ -291,13 +293,13 @@ CoordinateSystem_cp_v CF1_xCoordSysBuilder::listCoordinateSystems(CDM& cdm)
         }
         vector<string> vars = cdm.findVariables("coordinates", ".*");
         for (vector<string>::iterator varIt = vars.begin(); varIt != vars.end(); ++varIt) {
-            vector<string> coordinates = tokenize(cdm.getAttribute(*varIt, "coordinates").getStringValue(), " ");
+            vector<string> coordinates = tokenize(ccdm.getAttribute(*varIt, "coordinates").getStringValue(), " ");
             tmpCoordinateAxes.insert(coordinates.begin(), coordinates.end());
         }
         // create CoordinateAxis
         for (set<string>::iterator coord = tmpCoordinateAxes.begin(); coord != tmpCoordinateAxes.end(); ++coord) {
             if (cdm.hasVariable(*coord)) {
-                coordinateAxes[*coord] = std::make_shared<CoordinateAxis>(cdm.getVariable(*coord));
+                coordinateAxes[*coord] = std::make_shared<CoordinateAxis>(ccdm.getVariable(*coord));
             } else {
                 // add a dimension without a variable with a 'virtual' variable
                 vector<string> shape(1, *coord);
@@ -552,19 +554,21 @@ static void enhanceVectors(CDM& cdm, const std::string& xsn, const std::string&
 {
     vector<string> xVars = cdm.findVariables("standard_name", regex_escape(xsn) + ".*");
     vector<string> yVars = cdm.findVariables("standard_name", regex_escape(ysn) + ".*");
+    // only take non-const references when changing, they change the structure version
+    const CDM& ccdm = cdm;
     for (vector<string>::iterator xVar = xVars.begin(); xVar != xVars.end(); ++xVar) {
-        CDMVariable& xv = cdm.getVariable(*xVar);
+        const CDMVariable& xv = ccdm.getVariable(*xVar);
         if (xv.isSpatialVector())
             continue;
         const vector<string>& xSh = xv.getShape();
         for (vector<string>::iterator yVar = yVars.begin(); yVar != yVars.end(); ++yVar) {
-            CDMVariable& yv = cdm.getVariable(*yVar);
+            const CDMVariable& yv = ccdm.getVariable(*yVar);
             if (yv.isSpatialVector())
                 continue;
             const vector<string>& ySh = yv.getShape();
             if (xSh == ySh) {
-                xv.setAsSpatialVector(*yVar, CDMVariable::vectorDirectionFromString(xdir));
-                yv.setAsSpatialVector(*xVar, CDMVariable::vectorDirectionFromString(ydir));
+                cdm.getVariable(*xVar).setAsSpatialVector(*yVar, CDMVariable::vectorDirectionFromString(xdir));
+                cdm.getVariable(*yVar).setAsSpatialVector(*xVar, CDMVariable::vectorDirectionFromString(ydir));
                 LOG4FIMEX(logger, Logger::INFO, "making "<< *xVar << "," << *yVar << " a vector");
                 break;
             }
@@ -460,6 +460,10 @@ CoordinateSystem_cp_v listCoordinateSystems(CDM& cdm)
 {
     // the return value
     CoordinateSystem_cp_v coordSystems;
+    if (cdm.getCachedCoordinateSystems(false, coordSystems)) {
+        LOG4FIMEX(logger, Logger::DEBUG, "cached conventions: " << coordSystems.size());
+        return coordSystems;
+    }
 
     const CoordSysBuilder_pv builders = createBuilders();
     for (CoordSysBuilder_p builder : builders) {
@@ -478,6 +482,7 @@ CoordinateSystem_cp_v listCoordinateSystems(CDM& cdm)
     }
 
     LOG4FIMEX(logger, Logger::DEBUG, "total conventions found: " << coordSystems.size());
+    cdm.setCachedCoordinateSystems(false, coordSystems);
     return coordSystems;
 }
 
@@ -485,6 +490,12 @@ CoordinateSystem_cp_v listCoordinateSystems(CDMReader_p reader)
 {
     // the return value
     CoordinateSystem_cp_v coordSystems;
+    // builders may add information to the internal cdm, the cache is valid for the cdm after that
+    CDM& cdm = reader->getInternalCDM();
+    if (cdm.getCachedCoordinateSystems(true, coordSystems)) {
+        LOG4FIMEX(logger, Logger::DEBUG, "cached conventions: " << coordSystems.size());
+        return coordSystems;
+    }
 
     const CoordSysBuilder_pv builders = createBuilders();
     for (CoordSysBuilder_p builder : builders) {
@@ -503,6 +514,7 @@ CoordinateSystem_cp_v listCoordinateSystems(CDMReader_p reader)
     }
 
     LOG4FIMEX(logger, Logger::DEBUG, "total conventions found: " << coordSystems.size());
+    cdm.setCachedCoordinateSystems(true, coordSystems);
     return coordSystems;
 }
 
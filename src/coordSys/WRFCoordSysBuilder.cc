@@ -80,10 +80,11 @@ void WRFCoordSysBuilder::enhanceVectorProperties(CDMReader_p reader)
     xy_vectors.push_back(std::make_pair("UAH", "VAH"));
     for (size_t i = 0; i < xy_vectors.size(); i++) {
         if (cdm.hasVariable(xy_vectors.at(i).first) && cdm.hasVariable(xy_vectors.at(i).second)) {
+            const CDM& ccdm = cdm; // the non-const getters change the structure version
+            if (ccdm.getVariable(xy_vectors.at(i).first).isSpatialVector()) continue;
+            if (ccdm.getVariable(xy_vectors.at(i).second).isSpatialVector()) continue;
             CDMVariable& xv = cdm.getVariable(xy_vectors.at(i).first);
             CDMVariable& yv = cdm.getVariable(xy_vectors.at(i).second);
-            if (xv.isSpatialVector()) continue;
-            if (yv.isSpatialVector()) continue;
             xv.setAsSpatialVector(yv.getName(), CDMVariable::SPATIAL_VECTOR_X);
             yv.setAsSpatialVector(xv.getName(), CDMVariable::SPATIAL_VECTOR_Y);
             LOG4FIMEX(logger, Logger::INFO, "making "<< xv.getName() << "," << yv.getName() << " a vector");
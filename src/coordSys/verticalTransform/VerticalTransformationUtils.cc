@@ -430,6 +430,16 @@ DataPtr verticalData4D(CoordinateSystem_cp cs, CDMReader_p reader, size_t unLimD
     return verticalData4D(verticalConverter(cs, reader, verticalType), reader->getCDM(), unLimDimPos);
 }
 
+DataPtr verticalData4D(VerticalConverter_p converter, const CDM& cdm, const SliceBuilder& sb)
+{
+    return converter->getDataSlice(adaptSliceBuilder(cdm, converter, sb));
+}
+
+DataPtr verticalData4D(CoordinateSystem_cp cs, CDMReader_p reader, const SliceBuilder& sb, int verticalType)
+{
+    return verticalData4D(verticalConverter(cs, reader, verticalType), reader->getCDM(), sb);
+}
+
 DataPtr checkSize(DataPtr data, size_t expected, const std::string& what)
 {
     if (data && data->size() != expected)
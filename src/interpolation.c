@@ -545,12 +545,20 @@ int mifi_get_values_log_log_f(const float* infieldA, const float* infieldB, floa
 
 }
 
-int mifi_fill2d_f(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop, size_t* nChanged) {
+/**
+ * Fill undefined values with the average and set up the weights for the
+ * relaxation: corrEff for undefined inner values, 1 for undefined border
+ * values, 0 for defined values.
+ *
+ * @return the allocated weight-field, or NULL if there is nothing to fill
+ */
+static float* mifi_fill2d_init_(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t* nChanged, double* crit)
+{
     size_t totalSize = nx*ny;
-    if (totalSize == 0) return MIFI_OK;
+    *nChanged = 0;
+    if (totalSize == 0) return NULL;
 
     double sum = 0;
-    *nChanged = 0;
 
     float* fieldPos = field;
     // calculate sum and number of valid values
@@ -563,7 +571,7 @@ int mifi_fill2d_f(size_t nx, size_t ny, float* field, float relaxCrit, float cor
     }
     size_t nUnchanged = totalSize - *nChanged;
     if (nUnchanged == 0 || *nChanged == 0) {
-        return MIFI_OK; // nothing to do
+        return NULL; // nothing to do
     }
 
     // working field
@@ -596,20 +604,47 @@ int mifi_fill2d_f(size_t nx, size_t ny, float* field, float relaxCrit, float cor
     }
     stddev /= nUnchanged;
 
-    double crit = relaxCrit * stddev;
+    *crit = relaxCrit * stddev;
 
     //fprintf(stderr, "crit %f, stddev %f", crit, stddev);
 
-    // starting the iterative method, border-values are left at average, nx,ny >=1
-    size_t nxm1 = (size_t)(nx - 1);
-    size_t nym1 = (size_t)(ny - 1);
-
     // initialize a variational field from the border
-    for (size_t y = 1; y < nym1; y++) {
-        for (size_t x = 1; x < nxm1; x++) {
+    for (size_t y = 1; y + 1 < ny; y++) {
+        for (size_t x = 1; x + 1 < nx; x++) {
             wField[y*nx +x] *= corrEff;
         }
     }
+    return wField;
+}
+
+/**
+ * Relax the undefined border values towards their inner neighbours,
+ * i.e. Neumann boundary conditions.
+ */
+static void mifi_fill2d_borders_(size_t nx, size_t ny, float* field, const float* wField)
+{
+    size_t nym1 = ny - 1;
+    for (size_t y = 1; y < nym1; y++) {
+        field[y*nx+0] += (field[y*nx+1] - field[y*nx+0]) * wField[y*nx+0];
+        field[y*nx+(nx-1)] += (field[y*nx+(nx-2)] - field[y*nx+(nx-1)]) * wField[y*nx+(nx-1)];
+    }
+    for (size_t x = 0; x < nx; x++) {
+        field[0*nx +x] += (field[1*nx+x] - field[0*nx+x]) * wField[0*nx+x];
+        field[nym1*nx+x] += (field[(nym1-1)*nx+x] - field[nym1*nx+x]) * wField[nym1*nx+x];
+    }
+}
+
+int mifi_fill2d_f(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop, size_t* nChanged) {
+    double crit = 0;
+    float* wField = mifi_fill2d_init_(nx, ny, field, relaxCrit, corrEff, nChanged, &crit);
+    if (wField == NULL) {
+        return MIFI_OK; // nothing to do
+    }
+    size_t totalSize = nx*ny;
+
+    // starting the iterative method, border-values are left at average, nx,ny >=1
+    size_t nxm1 = (size_t)(nx - 1);
+    size_t nym1 = (size_t)(ny - 1);
 
     // error field
     float* eField = malloc(totalSize*sizeof(float));
@@ -657,17 +692,251 @@ int mifi_fill2d_f(size_t nx, size_t ny, float* field, float relaxCrit, float cor
         }
 
         // some work on the borders
-        for (size_t y = 1; y < nym1; y++) {
-            field[y*nx+0] += (field[y*nx+1] - field[y*nx+0]) * wField[y*nx+0];
-            field[y*nx+(nx-1)] += (field[y*nx+(nx-2)] - field[y*nx+(nx-1)]) * wField[y*nx+(nx-1)];
+        mifi_fill2d_borders_(nx, ny, field, wField);
+    }
+
+    free(eField);
+    free(wField);
+    return MIFI_OK;
+}
+
+/**
+ * One relaxation sweep over the inner points of one colour of the
+ * checkerboard, i.e. (x+y)%2 == colour. Points of one colour only depend
+ * on points of the other colour, so rows can be processed in parallel.
+ *
+ * @param rhs right-hand side of the equation, or NULL for Laplace's equation
+ * @return the maximum absolute change
+ */
+static float mifi_fill2d_redblack_sweep_(size_t nx, size_t ny, float* field, const float* wField, const float* rhs, size_t colour)
+{
+    float maxChange = 0;
+    long long nym1 = (long long)ny - 1;
+#ifdef _OPENMP
+#pragma omp parallel for default(shared) reduction(max:maxChange) if (nx*ny > 65536)
+#endif
+    for (long long y = 1; y < nym1; y++) {
+        float* f = &field[y*nx];
+        const float* w = &wField[y*nx];
+        const float* r = rhs ? &rhs[y*nx] : NULL;
+        for (size_t x = 1 + ((y + 1 + colour) % 2); x + 1 < nx; x += 2) {
+            float e = (f[x+1] + f[x-1] + f[x+nx] + f[x-nx])*0.25 - f[x];
+            if (r)
+                e += r[x];
+            const float change = fabsf(e * w[x]);
+            f[x] += e * w[x];
+            if (change > maxChange)
+                maxChange = change;
         }
+    }
+    return maxChange;
+}
+
+/**
+ * Red-black ordered relaxation, using the same convergence test as the
+ * row-by-row relaxation in mifi_fill2d_f.
+ *
+ * @return number of iterations
+ */
+static size_t mifi_fill2d_redblack_iterate_(size_t nx, size_t ny, float* field, const float* wField, double crit, float corrEff, size_t maxLoop)
+{
+    const float crtest = crit*corrEff;
+    size_t n;
+    for (n = 0; n < maxLoop; n++) {
+        const float changeRed = mifi_fill2d_redblack_sweep_(nx, ny, field, wField, NULL, 0);
+        const float changeBlack = mifi_fill2d_redblack_sweep_(nx, ny, field, wField, NULL, 1);
+        if ((n < (maxLoop-5)) && (n%10 == 0) && changeRed <= crtest && changeBlack <= crtest) {
+            break; // convergence
+        }
+        mifi_fill2d_borders_(nx, ny, field, wField);
+    }
+    return n;
+}
+
+int mifi_fill2d_redblack_f(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop, size_t* nChanged)
+{
+    double crit = 0;
+    float* wField = mifi_fill2d_init_(nx, ny, field, relaxCrit, corrEff, nChanged, &crit);
+    if (wField == NULL) {
+        return MIFI_OK; // nothing to do
+    }
+    mifi_fill2d_redblack_iterate_(nx, ny, field, wField, crit, corrEff, maxLoop);
+    free(wField);
+    return MIFI_OK;
+}
+
+//! grids smaller than this in one direction are not coarsened further by the multigrid fill
+static const size_t MIFI_FILL2D_MIN_GRID = 8;
+//! maximum number of sweeps on the coarsest grid of the multigrid fill
+static const size_t MIFI_FILL2D_MAX_COARSE_SWEEPS = 1000;
+
+static float* mifi_fill2d_alloc_(size_t nx, size_t ny)
+{
+    float* f = calloc(nx*ny, sizeof(float));
+    if (f == NULL) {
+        fprintf(stderr, "error allocating memory of float(%zd*%zd)", nx, ny);
+        exit(1);
+    }
+    return f;
+}
+
+/**
+ * Residual of the inner unknown values, i.e. the change a Gauss-Seidel step would make.
+ *
+ * @return the maximum absolute residual
+ */
+static float mifi_fill2d_residual_(size_t nx, size_t ny, const float* field, const float* mask, const float* rhs, float* residual)
+{
+    float maxResidual = 0;
+#ifdef _OPENMP
+#pragma omp parallel for default(shared) reduction(max:maxResidual) if (nx*ny > 65536)
+#endif
+    for (long long y = 0; y < (long long)ny; y++) {
         for (size_t x = 0; x < nx; x++) {
-            field[0*nx +x] += (field[1*nx+x] - field[0*nx+x]) * wField[0*nx+x];
-            field[nym1*nx+x] += (field[(nym1-1)*nx+x] - field[nym1*nx+x]) * wField[nym1*nx+x];
+            const size_t i = y*nx + x;
+            float r = 0;
+            if (mask[i] != 0 && y > 0 && x > 0 && y + 1 < (long long)ny && x + 1 < nx) {
+                r = (field[i+1] + field[i-1] + field[i+nx] + field[i-nx])*0.25 - field[i];
+                if (rhs)
+                    r += rhs[i];
+            }
+            residual[i] = r;
+            if (fabsf(r) > maxResidual)
+                maxResidual = fabsf(r);
         }
     }
+    return maxResidual;
+}
 
-    free(eField);
+/**
+ * Add the bilinear interpolation of a field of half resolution to the unknown
+ * values of field. Coarse cell c covers the fine cells 2c and 2c+1.
+ */
+static void mifi_fill2d_prolongate_add_(size_t nx, size_t ny, float* field, const float* mask, size_t cnx, size_t cny, const float* cField)
+{
+#ifdef _OPENMP
+#pragma omp parallel for default(shared) if (nx*ny > 65536)
+#endif
+    for (long long y = 0; y < (long long)ny; y++) {
+        double cyPos = (y - 0.5) / 2;
+        if (cyPos < 0) cyPos = 0;
+        if (cyPos > cny - 1) cyPos = cny - 1;
+        const size_t cy0 = (size_t)cyPos;
+        const size_t cy1 = (cy0 + 1 < cny) ? cy0 + 1 : cy0;
+        const double fy = cyPos - cy0;
+        for (size_t x = 0; x < nx; x++) {
+            if (mask[y*nx+x] == 0)
+                continue;
+            double cxPos = (x - 0.5) / 2;
+            if (cxPos < 0) cxPos = 0;
+            if (cxPos > cnx - 1) cxPos = cnx - 1;
+            const size_t cx0 = (size_t)cxPos;
+            const size_t cx1 = (cx0 + 1 < cnx) ? cx0 + 1 : cx0;
+            const double fx = cxPos - cx0;
+            field[y*nx+x] += (1-fy) * ((1-fx) * cField[cy0*cnx+cx0] + fx * cField[cy0*cnx+cx1])
+                           + fy * ((1-fx) * cField[cy1*cnx+cx0] + fx * cField[cy1*cnx+cx1]);
+        }
+    }
+}
+
+/**
+ * Gauss-Seidel smoothing sweeps in red-black order, including the borders.
+ *
+ * @return the maximum absolute change of the inner values in the last sweep
+ */
+static float mifi_fill2d_smooth_(size_t nx, size_t ny, float* field, const float* mask, const float* rhs, size_t sweeps)
+{
+    float change = 0;
+    for (size_t n = 0; n < sweeps; n++) {
+        const float changeRed = mifi_fill2d_redblack_sweep_(nx, ny, field, mask, rhs, 0);
+        const float changeBlack = mifi_fill2d_redblack_sweep_(nx, ny, field, mask, rhs, 1);
+        mifi_fill2d_borders_(nx, ny, field, mask);
+        change = (changeRed > changeBlack) ? changeRed : changeBlack;
+    }
+    return change;
+}
+
+/**
+ * One multigrid V-cycle for Laplace's equation (rhs == NULL) or its
+ * correction equation on the unknown values (mask != 0). The correction
+ * is solved on a grid with half the resolution, where a cell is unknown
+ * if all its fine cells are unknown, i.e. the correction vanishes at cells
+ * containing defined values.
+ */
+static void mifi_fill2d_vcycle_(size_t nx, size_t ny, float* field, const float* mask, const float* rhs)
+{
+    const size_t nu = 2; // pre- and post-smoothing sweeps
+    if (nx < 2*MIFI_FILL2D_MIN_GRID || ny < 2*MIFI_FILL2D_MIN_GRID) {
+        // coarsest grid, solve by relaxation
+        const size_t sweeps = (4*(nx + ny) < MIFI_FILL2D_MAX_COARSE_SWEEPS) ? 4*(nx + ny) : MIFI_FILL2D_MAX_COARSE_SWEEPS;
+        mifi_fill2d_smooth_(nx, ny, field, mask, rhs, sweeps);
+        return;
+    }
+
+    mifi_fill2d_smooth_(nx, ny, field, mask, rhs, nu);
+
+    float* residual = mifi_fill2d_alloc_(nx, ny);
+    mifi_fill2d_residual_(nx, ny, field, mask, rhs, residual);
+
+    // restriction, the factor 4 is due to the doubled grid distance
+    const size_t cnx = (nx + 1) / 2;
+    const size_t cny = (ny + 1) / 2;
+    float* cField = mifi_fill2d_alloc_(cnx, cny);
+    float* cMask = mifi_fill2d_alloc_(cnx, cny);
+    float* cRhs = mifi_fill2d_alloc_(cnx, cny);
+    for (size_t cy = 0; cy < cny; cy++) {
+        for (size_t cx = 0; cx < cnx; cx++) {
+            double sum = 0;
+            size_t count = 0;
+            int unknown = 1;
+            for (size_t y = 2*cy; y < 2*cy + 2 && y < ny; y++) {
+                for (size_t x = 2*cx; x < 2*cx + 2 && x < nx; x++) {
+                    sum += residual[y*nx+x];
+                    count++;
+                    if (mask[y*nx+x] == 0)
+                        unknown = 0;
+                }
+            }
+            const size_t c = cy*cnx + cx;
+            cMask[c] = unknown;
+            cRhs[c] = unknown ? 4 * sum / count : 0;
+        }
+    }
+    free(residual);
+
+    mifi_fill2d_vcycle_(cnx, cny, cField, cMask, cRhs);
+    mifi_fill2d_prolongate_add_(nx, ny, field, mask, cnx, cny, cField);
+    free(cRhs);
+    free(cMask);
+    free(cField);
+
+    mifi_fill2d_smooth_(nx, ny, field, mask, rhs, nu);
+}
+
+int mifi_fill2d_multigrid_f(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop, size_t* nChanged)
+{
+    double crit = 0;
+    float* wField = mifi_fill2d_init_(nx, ny, field, relaxCrit, corrEff, nChanged, &crit);
+    if (wField == NULL) {
+        return MIFI_OK; // nothing to do
+    }
+    const size_t totalSize = nx*ny;
+    float* mask = mifi_fill2d_alloc_(nx, ny);
+    for (size_t i = 0; i < totalSize; i++)
+        mask[i] = (wField[i] != 0);
+
+    // V-cycles until a relaxation step would not change more than the criterion
+    float* residual = mifi_fill2d_alloc_(nx, ny);
+    for (size_t n = 0; n < maxLoop; n++) {
+        mifi_fill2d_vcycle_(nx, ny, field, mask, NULL);
+        if (mifi_fill2d_residual_(nx, ny, field, mask, NULL, residual) <= crit)
+            break;
+    }
+    free(residual);
+    free(mask);
+
+    // finish with the same relaxation and convergence test as mifi_fill2d_redblack_f
+    mifi_fill2d_redblack_iterate_(nx, ny, field, wField, crit, corrEff, maxLoop);
     free(wField);
     return MIFI_OK;
 }
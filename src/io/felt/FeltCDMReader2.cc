@@ -337,9 +337,8 @@ CDMDimension FeltCDMReader2::initAddTimeDimensionFromXML(const XMLDoc& doc)
     CDMDataType timeDataType = string2datatype(timeType);
     CDMVariable timeVar(timeName, timeDataType, timeShape);
     timeVec = feltfile_->getFeltTimes();
-    vector<double> timeUnitVec;
     TimeUnit tu(timeUnits);
-    std::transform(timeVec.begin(), timeVec.end(), std::back_inserter(timeUnitVec), [tu](const FimexTime& tp) { return tu.fimexTime2unitTime(tp); });
+    const vector<double> timeUnitVec = tu.fimexTimes2unitTimes(timeVec);
     DataPtr timeData = createData(timeDataType, timeUnitVec.begin(), timeUnitVec.end());
     timeVar.setData(timeData);
     cdm_->addVariable(timeVar);
@@ -623,7 +622,7 @@ void FeltCDMReader2::initAddVariablesFromXML(const XMLDoc& doc, const string& pr
 DataPtr FeltCDMReader2::getDataSlice(const string& varName, size_t unLimDimPos)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "reading var: " << varName << " slice: " << unLimDimPos);
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
     if (variable.hasData()) {
         return getDataSliceFromMemory(variable, unLimDimPos);
     }
@@ -638,7 +637,7 @@ DataPtr FeltCDMReader2::getDataSlice(const string& varName, size_t unLimDimPos)
     const CDMDimension* ensembleDim = 0;
     size_t xy_size = 1;
     for (vector<string>::const_iterator it = dims.begin(); it != dims.end(); ++it) {
-        CDMDimension& dim = cdm_->getDimension(*it);
+        const CDMDimension& dim = getCDM().getDimension(*it);
         if (dim.getName() != xDim.getName() && dim.getName() != yDim.getName() && !dim.isUnlimited()) {
             if (dim.getName() == "ensemble_member") {
                 ensembleDim = &dim;
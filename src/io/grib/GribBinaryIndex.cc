@@ -0,0 +1,450 @@
+/*
+ * Fimex, GribBinaryIndex.cc
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "GribBinaryIndex.h"
+
+#include "GribFileIndex.h"
+
+#include "fimex/CDMException.h"
+#include "fimex/Logger.h"
+#include "fimex/Type2String.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MetNoFimex {
+
+using namespace std;
+
+namespace {
+
+Logger_p logger = getLogger("fimex.GribBinaryIndex");
+
+const char MAGIC[8] = {'F', 'I', 'G', 'R', 'B', 'I', 'D', 'X'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t headerSize;
+    uint32_t gridRecordSize;
+    uint32_t extraKeyRecordSize;
+    uint32_t messageRecordSize;
+    /// offsets into the file, the string table has stringCount+1 offsets relative to stringDataOffset
+    uint64_t stringCount;
+    uint64_t stringOffset;
+    uint64_t stringDataOffset;
+    uint64_t gridCount;
+    uint64_t gridOffset;
+    uint64_t extraKeyCount;
+    uint64_t extraKeyOffset;
+    uint64_t messageCount;
+    uint64_t messageOffset;
+    uint64_t fileSize;
+    uint32_t url;
+    uint32_t padding;
+};
+
+struct GridRecord
+{
+    uint32_t projDefinition;
+    uint32_t isDegree;
+    uint64_t xSize;
+    uint64_t ySize;
+    double xIncr;
+    double yIncr;
+    double xStart;
+    double yStart;
+    double lonStart;
+    double latStart;
+    /// negative if the lon/lat start was not available
+    double lonLatResolution;
+    int32_t scanMode;
+    uint32_t padding;
+};
+
+struct ExtraKeyRecord
+{
+    uint32_t name;
+    uint32_t padding;
+    int64_t value;
+};
+
+struct MessageRecord
+{
+    int64_t filePos;
+    uint64_t msgPos;
+    uint32_t fileURL;
+    uint32_t parameterName;
+    uint32_t shortName;
+    uint32_t stepType;
+    uint32_t typeOfGrid;
+    uint32_t grid;
+    int64_t gridParameterIds[3];
+    int64_t edition;
+    int64_t dataTime;
+    int64_t dataDate;
+    int64_t stepUnits;
+    int64_t stepStart;
+    int64_t stepEnd;
+    int64_t timeRangeIndicator;
+    int64_t typeOfStatisticalProcessing;
+    int64_t levelType;
+    int64_t levelNo;
+    int64_t perturbationNo;
+    int64_t totalNumberOfEnsembles;
+    uint64_t extraKeyStart;
+    uint32_t extraKeyCount;
+    uint32_t padding;
+};
+
+// all tables are 8-byte aligned
+static_assert(sizeof(Header) % 8 == 0, "Header size not aligned");
+static_assert(sizeof(GridRecord) % 8 == 0, "GridRecord size not aligned");
+static_assert(sizeof(ExtraKeyRecord) % 8 == 0, "ExtraKeyRecord size not aligned");
+static_assert(sizeof(MessageRecord) % 8 == 0, "MessageRecord size not aligned");
+
+uint64_t align8(uint64_t size)
+{
+    return (size + 7) & ~uint64_t(7);
+}
+
+/// assign each distinct string a number, in order of appearance
+class StringTable
+{
+public:
+    uint32_t intern(const std::string& s)
+    {
+        std::map<std::string, uint32_t>::const_iterator it = ids_.find(s);
+        if (it != ids_.end())
+            return it->second;
+        const uint32_t id = strings_.size();
+        ids_.insert(std::make_pair(s, id));
+        strings_.push_back(s);
+        return id;
+    }
+    const std::vector<std::string>& strings() const { return strings_; }
+
+private:
+    std::map<std::string, uint32_t> ids_;
+    std::vector<std::string> strings_;
+};
+
+/// read-only memory-map of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+        : data_(0)
+        , size_(0)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw CDMException("cannot open binary grib-index '" + path + "': " + strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw CDMException("cannot stat binary grib-index '" + path + "': " + strerror(errno));
+        }
+        size_ = st.st_size;
+        if (size_ > 0) {
+            void* data = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED)
+                throw CDMException("cannot map binary grib-index '" + path + "': " + strerror(errno));
+            data_ = static_cast<const char*>(data);
+        } else {
+            ::close(fd);
+        }
+    }
+    ~MappedFile()
+    {
+        if (data_)
+            munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data_;
+    size_t size_;
+};
+
+void checkTable(const std::string& path, const Header& h, uint64_t offset, uint64_t count, uint64_t recordSize, const char* table)
+{
+    if (offset % 8 != 0 || offset > h.fileSize || count > (h.fileSize - offset) / recordSize)
+        throw CDMException("corrupt " + std::string(table) + " table in binary grib-index '" + path + "'");
+}
+
+} // namespace
+
+const char GribBinaryIndex::EXTENSION[] = "grbbin";
+const unsigned int GribBinaryIndex::VERSION = 2;
+const size_t GribBinaryIndex::MAGIC_SIZE = sizeof(MAGIC);
+
+bool GribBinaryIndex::isBinaryIndexMagic(const char* magic, size_t count)
+{
+    return count >= sizeof(MAGIC) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool GribBinaryIndex::isBinaryIndex(const std::string& path)
+{
+    std::ifstream is(path.c_str(), std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    if (!is.read(magic, sizeof(magic)))
+        return false;
+    return isBinaryIndexMagic(magic, sizeof(magic));
+}
+
+void GribBinaryIndex::write(const std::string& path, const std::string& url, const std::vector<GribFileMessage>& messages)
+{
+    StringTable strings;
+    Header h;
+    memset(&h, 0, sizeof(h));
+    h.url = strings.intern(url);
+
+    // grids are shared by many messages, identify them by their record bytes
+    std::map<std::string, uint32_t> gridIds;
+    std::vector<GridRecord> grids;
+    std::vector<ExtraKeyRecord> extraKeys;
+    std::vector<MessageRecord> records;
+    records.reserve(messages.size());
+    for (const GribFileMessage& gfm : messages) {
+        const GridDefinition& gd = gfm.gridDefinition_;
+        GridRecord gr;
+        memset(&gr, 0, sizeof(gr));
+        gr.projDefinition = strings.intern(gd.getProjDefinition());
+        gr.isDegree = gd.isDegree() ? 1 : 0;
+        gr.xSize = gd.getXSize();
+        gr.ySize = gd.getYSize();
+        gr.xIncr = gd.getXIncrement();
+        gr.yIncr = gd.getYIncrement();
+        gr.xStart = gd.getXStart();
+        gr.yStart = gd.getYStart();
+        gr.lonStart = gd.getLonStart();
+        gr.latStart = gd.getLatStart();
+        gr.lonLatResolution = gd.getLonLatResolution();
+        gr.scanMode = gd.getScanMode();
+        const std::string gridKey(reinterpret_cast<const char*>(&gr), sizeof(gr));
+        std::map<std::string, uint32_t>::const_iterator git = gridIds.find(gridKey);
+        if (git == gridIds.end()) {
+            git = gridIds.insert(std::make_pair(gridKey, static_cast<uint32_t>(grids.size()))).first;
+            grids.push_back(gr);
+        }
+
+        MessageRecord mr;
+        memset(&mr, 0, sizeof(mr));
+        mr.filePos = gfm.filePos_;
+        mr.msgPos = gfm.msgPos_;
+        mr.fileURL = strings.intern(gfm.fileURL_);
+        mr.parameterName = strings.intern(gfm.parameterName_);
+        mr.shortName = strings.intern(gfm.shortName_);
+        mr.stepType = strings.intern(gfm.stepType_);
+        mr.typeOfGrid = strings.intern(gfm.typeOfGrid_);
+        mr.grid = git->second;
+        if (gfm.gridParameterIds_.size() != 3)
+            throw CDMException("cannot write grib-message without parameter ids to binary index");
+        for (size_t i = 0; i < 3; ++i)
+            mr.gridParameterIds[i] = gfm.gridParameterIds_[i];
+        mr.edition = gfm.edition_;
+        mr.dataTime = gfm.dataTime_;
+        mr.dataDate = gfm.dataDate_;
+        mr.stepUnits = gfm.stepUnits_;
+        mr.stepStart = gfm.stepStart_;
+        mr.stepEnd = gfm.stepEnd_;
+        mr.timeRangeIndicator = gfm.timeRangeIndicator_;
+        mr.typeOfStatisticalProcessing = gfm.typeOfStatisticalProcessing_;
+        mr.levelType = gfm.levelType_;
+        mr.levelNo = gfm.levelNo_;
+        mr.perturbationNo = gfm.perturbationNo_;
+        mr.totalNumberOfEnsembles = gfm.totalNumberOfEnsembles_;
+        mr.extraKeyStart = extraKeys.size();
+        mr.extraKeyCount = gfm.otherKeys_.size();
+        for (const auto& ok : gfm.otherKeys_) {
+            ExtraKeyRecord er;
+            memset(&er, 0, sizeof(er));
+            er.name = strings.intern(ok.first);
+            er.value = ok.second;
+            extraKeys.push_back(er);
+        }
+        records.push_back(mr);
+    }
+
+    // string table: offsets followed by the concatenated strings
+    const std::vector<std::string>& stringList = strings.strings();
+    std::vector<uint64_t> stringOffsets;
+    stringOffsets.reserve(stringList.size() + 1);
+    uint64_t stringDataSize = 0;
+    for (const std::string& s : stringList) {
+        stringOffsets.push_back(stringDataSize);
+        stringDataSize += s.size();
+    }
+    stringOffsets.push_back(stringDataSize);
+
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.byteOrderMark = BYTE_ORDER_MARK;
+    h.headerSize = sizeof(Header);
+    h.gridRecordSize = sizeof(GridRecord);
+    h.extraKeyRecordSize = sizeof(ExtraKeyRecord);
+    h.messageRecordSize = sizeof(MessageRecord);
+    h.stringCount = stringList.size();
+    h.stringOffset = sizeof(Header);
+    h.stringDataOffset = h.stringOffset + stringOffsets.size() * sizeof(uint64_t);
+    h.gridCount = grids.size();
+    h.gridOffset = align8(h.stringDataOffset + stringDataSize);
+    h.extraKeyCount = extraKeys.size();
+    h.extraKeyOffset = h.gridOffset + grids.size() * sizeof(GridRecord);
+    h.messageCount = records.size();
+    h.messageOffset = h.extraKeyOffset + extraKeys.size() * sizeof(ExtraKeyRecord);
+    h.fileSize = h.messageOffset + records.size() * sizeof(MessageRecord);
+
+    std::ofstream os(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!os)
+        throw CDMException("cannot write binary grib-index '" + path + "'");
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    os.write(reinterpret_cast<const char*>(&stringOffsets[0]), stringOffsets.size() * sizeof(uint64_t));
+    for (const std::string& s : stringList)
+        os.write(s.data(), s.size());
+    const char zeros[8] = {0};
+    os.write(zeros, h.gridOffset - (h.stringDataOffset + stringDataSize));
+    if (!grids.empty())
+        os.write(reinterpret_cast<const char*>(&grids[0]), grids.size() * sizeof(GridRecord));
+    if (!extraKeys.empty())
+        os.write(reinterpret_cast<const char*>(&extraKeys[0]), extraKeys.size() * sizeof(ExtraKeyRecord));
+    if (!records.empty())
+        os.write(reinterpret_cast<const char*>(&records[0]), records.size() * sizeof(MessageRecord));
+    os.close();
+    if (!os)
+        throw CDMException("error writing binary grib-index '" + path + "'");
+    LOG4FIMEX(logger, Logger::DEBUG,
+              "wrote " << records.size() << " messages with " << grids.size() << " grids and " << stringList.size() << " strings to '" << path << "'");
+}
+
+std::string GribBinaryIndex::read(const std::string& path, std::vector<GribFileMessage>& messages)
+{
+    const MappedFile file(path);
+    if (file.size() < sizeof(Header))
+        throw CDMException("binary grib-index '" + path + "' too short");
+
+    Header h;
+    memcpy(&h, file.data(), sizeof(h));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw CDMException("'" + path + "' is not a binary grib-index");
+    if (h.byteOrderMark != BYTE_ORDER_MARK)
+        throw CDMException("binary grib-index '" + path + "' has a different byte-order, please re-create it");
+    if (h.version != VERSION || h.headerSize != sizeof(Header) || h.gridRecordSize != sizeof(GridRecord) ||
+        h.extraKeyRecordSize != sizeof(ExtraKeyRecord) || h.messageRecordSize != sizeof(MessageRecord))
+        throw CDMException("binary grib-index '" + path + "' has unsupported version " + type2string(h.version) + ", please re-create it");
+    if (h.fileSize != file.size())
+        throw CDMException("binary grib-index '" + path + "' truncated");
+
+    checkTable(path, h, h.stringOffset, h.stringCount + 1, sizeof(uint64_t), "string");
+    checkTable(path, h, h.gridOffset, h.gridCount, sizeof(GridRecord), "grid");
+    checkTable(path, h, h.extraKeyOffset, h.extraKeyCount, sizeof(ExtraKeyRecord), "extra-key");
+    checkTable(path, h, h.messageOffset, h.messageCount, sizeof(MessageRecord), "message");
+
+    // intern each string and grid once, messages only copy them
+    const uint64_t* stringOffsets = reinterpret_cast<const uint64_t*>(file.data() + h.stringOffset);
+    std::vector<std::string> strings;
+    strings.reserve(h.stringCount);
+    for (uint64_t i = 0; i < h.stringCount; ++i) {
+        const uint64_t start = stringOffsets[i], end = stringOffsets[i + 1];
+        if (start > end || end > h.fileSize - h.stringDataOffset)
+            throw CDMException("corrupt string table in binary grib-index '" + path + "'");
+        strings.push_back(std::string(file.data() + h.stringDataOffset + start, end - start));
+    }
+    struct StringAt
+    {
+        const std::string& path;
+        const std::vector<std::string>& strings;
+        const std::string& operator()(uint32_t id) const
+        {
+            if (id >= strings.size())
+                throw CDMException("invalid string reference in binary grib-index '" + path + "'");
+            return strings[id];
+        }
+    } stringAt = {path, strings};
+
+    const GridRecord* gridRecords = reinterpret_cast<const GridRecord*>(file.data() + h.gridOffset);
+    std::vector<GridDefinition> grids;
+    grids.reserve(h.gridCount);
+    for (uint64_t i = 0; i < h.gridCount; ++i) {
+        const GridRecord& gr = gridRecords[i];
+        grids.push_back(GridDefinition(stringAt(gr.projDefinition), gr.isDegree != 0, gr.xSize, gr.ySize, gr.xIncr, gr.yIncr, gr.xStart, gr.yStart,
+                                       gr.lonStart, gr.latStart, gr.lonLatResolution, static_cast<GridDefinition::Orientation>(gr.scanMode)));
+    }
+
+    const ExtraKeyRecord* extraKeys = reinterpret_cast<const ExtraKeyRecord*>(file.data() + h.extraKeyOffset);
+    const MessageRecord* records = reinterpret_cast<const MessageRecord*>(file.data() + h.messageOffset);
+    messages.reserve(messages.size() + h.messageCount);
+    for (uint64_t i = 0; i < h.messageCount; ++i) {
+        const MessageRecord& mr = records[i];
+        if (mr.grid >= grids.size() || mr.extraKeyStart > h.extraKeyCount || mr.extraKeyCount > h.extraKeyCount - mr.extraKeyStart)
+            throw CDMException("corrupt message " + type2string(i) + " in binary grib-index '" + path + "'");
+
+        messages.push_back(GribFileMessage());
+        GribFileMessage& gfm = messages.back();
+        gfm.fileURL_ = stringAt(mr.fileURL);
+        gfm.filePos_ = mr.filePos;
+        gfm.msgPos_ = mr.msgPos;
+        gfm.parameterName_ = stringAt(mr.parameterName);
+        gfm.shortName_ = stringAt(mr.shortName);
+        gfm.gridParameterIds_.assign(mr.gridParameterIds, mr.gridParameterIds + 3);
+        gfm.edition_ = mr.edition;
+        gfm.dataTime_ = mr.dataTime;
+        gfm.dataDate_ = mr.dataDate;
+        gfm.stepUnits_ = mr.stepUnits;
+        gfm.stepType_ = stringAt(mr.stepType);
+        gfm.stepStart_ = mr.stepStart;
+        gfm.stepEnd_ = mr.stepEnd;
+        gfm.timeRangeIndicator_ = mr.timeRangeIndicator;
+        gfm.typeOfStatisticalProcessing_ = mr.typeOfStatisticalProcessing;
+        gfm.levelType_ = mr.levelType;
+        gfm.levelNo_ = mr.levelNo;
+        gfm.perturbationNo_ = mr.perturbationNo;
+        gfm.totalNumberOfEnsembles_ = mr.totalNumberOfEnsembles;
+        for (uint64_t k = mr.extraKeyStart; k < mr.extraKeyStart + mr.extraKeyCount; ++k)
+            gfm.otherKeys_[stringAt(extraKeys[k].name)] = extraKeys[k].value;
+        gfm.typeOfGrid_ = stringAt(mr.typeOfGrid);
+        gfm.gridDefinition_ = grids[mr.grid];
+    }
+    LOG4FIMEX(logger, Logger::DEBUG, "read " << h.messageCount << " messages with " << h.gridCount << " grids from '" << path << "'");
+    return stringAt(h.url);
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,94 @@
+/*
+ * Fimex, GribBinaryIndex.h
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef GRIBBINARYINDEX_H_
+#define GRIBBINARYINDEX_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace MetNoFimex {
+
+class GribFileMessage;
+
+/**
+ * Binary index of grib-messages, an alternative to the grbml xml-format
+ * which can be memory-mapped and read without parsing.
+ *
+ * The file consists of a header with magic, version and byte-order mark,
+ * followed by a table of interned strings, a table of grid-definitions
+ * shared by all messages, a table of extra keys and one fixed-size record
+ * per message. All numbers are stored in native byte-order, files with a
+ * different byte-order or version are rejected.
+ */
+class GribBinaryIndex
+{
+public:
+    /// file-name extension of binary grib-indices
+    static const char EXTENSION[];
+
+    /// current version of the format
+    static const unsigned int VERSION;
+
+    /// size of the magic at the start of a binary index
+    static const size_t MAGIC_SIZE;
+
+    /**
+     * Check if the first bytes of a file are the magic of a binary index.
+     */
+    static bool isBinaryIndexMagic(const char* magic, size_t count);
+
+    /**
+     * Check if a file starts with the magic of a binary index.
+     * @return false if the file is not a binary index or cannot be read
+     */
+    static bool isBinaryIndex(const std::string& path);
+
+    /**
+     * Write messages to a binary index.
+     *
+     * @param path output file
+     * @param url url of the index, see GribFileIndex::getUrl()
+     * @param messages the messages to write
+     */
+    static void write(const std::string& path, const std::string& url, const std::vector<GribFileMessage>& messages);
+
+    /**
+     * Read messages from a binary index.
+     *
+     * All messages are copied to GribFileMessage objects, the mapping is
+     * released when reading is done. Memory use is therefore the same as
+     * for a grbml index, only the parsing is avoided.
+     *
+     * @param path input file
+     * @param messages the messages from the index are appended here
+     * @return the url of the index
+     * @throw CDMException if the file is not a valid binary index
+     */
+    static std::string read(const std::string& path, std::vector<GribFileMessage>& messages);
+};
+
+} // namespace MetNoFimex
+
+#endif /* GRIBBINARYINDEX_H_ */
@@ -28,6 +28,7 @@
 #include "GribCDMReader.h"
 #undef MIFI_IO_READER_SUPPRESS_DEPRECATED
 #include "GribFileIndex.h"
+#include "GribFilePool.h"
 
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
@@ -37,7 +38,6 @@
 #include "fimex/GridDefinition.h"
 #include "fimex/Logger.h"
 #include "fimex/MathUtils.h"
-#include "fimex/MutexLock.h"
 #include "fimex/RecursiveSliceCopy.h"
 #include "fimex/ReplaceStringTemplateObject.h"
 #include "fimex/ReplaceStringTimeObject.h"
@@ -55,6 +55,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <exception>
 #include <functional>
 #include <limits>
 #include <map>
@@ -81,10 +82,11 @@ struct GribCDMReader::Impl
 {
     string configId;
     vector<GribFileMessage> indices;
+    // open grib-files and index of multi-messages, shared by all reads
+    GribFilePool filePool;
     XMLDoc_p doc;
     map<int, vector<xmlNodePtr>> nodeIdx1;
     map<int, vector<xmlNodePtr>> nodeIdx2;
-    OmpMutex mutex;
     map<GridDefinition, ProjectionInfo> gridProjection;
     string timeDimName;
     string ensembleDimName;
@@ -545,7 +547,7 @@ vector<double> GribCDMReader::readVarPv_(string exampleVar, bool asimofHeader)
     // example gribFileMessage
     size_t gfiPos = p_->varTimeLevelEnsembleGFIBox[exampleVar].begin()->second.begin()->second.begin()->second;
     // Read asimof header if true
-    size_t count = p_->indices.at(gfiPos).readLevelData(pv, MIFI_FILL_DOUBLE, asimofHeader);
+    size_t count = p_->indices.at(gfiPos).readLevelData(p_->filePool, pv, MIFI_FILL_DOUBLE, asimofHeader);
     if (count <= 0) {
         LOG4FIMEX(logger, Logger::WARN, "could not find extra level data (PV)");
     }
@@ -753,8 +755,7 @@ void GribCDMReader::initAddTimeDimension()
         cdm_->addAttribute(timeVar.getName(), tunit);
     }
     const TimeUnit tu(tunit.getStringValue());
-    vector<double> timeVecLong;
-    std::transform(p_->times.begin(), p_->times.end(), std::back_inserter(timeVecLong), [tu](const FimexTime& tp) { return tu.fimexTime2unitTime(tp); });
+    const vector<double> timeVecLong = tu.fimexTimes2unitTimes(p_->times);
     DataPtr timeData = createData(timeDataType, timeVecLong.begin(), timeVecLong.end());
     cdm_->getVariable(timeVar.getName()).setData(timeData);
 
@@ -1195,6 +1196,11 @@ void GribCDMReader::initAddVariables()
 
 GribCDMReader::~GribCDMReader() {}
 
+GribFilePool::Statistics GribCDMReader::getFilePoolStatistics() const
+{
+    return p_->filePool.getStatistics();
+}
+
 size_t GribCDMReader::getVariableMaxEnsembles(const string& varName) const
 {
     size_t ensembles;
@@ -1254,7 +1260,7 @@ vector<size_t> createVector(size_t id, const vector<size_t>& dimStart, const vec
 DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& sb)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "fetching slicebuilder for variable " << varName);
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
 
     if (variable.getDataType() == CDM_NAT) {
         return createData(CDM_INT, 0); // empty
@@ -1353,51 +1359,65 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& s
     }
     fill(&doubleArray[0], &doubleArray[sliceSize], missingValue);
     DataPtr data = createData(sliceSize, doubleArray);
-    size_t dataCurrentPos = 0;
 
     const bool xyslice = (maxXySize != xySliceSize);
 
-    // storage for one layer, required only if making xy-slice
-    shared_array<double> full_data_array;
     vector<size_t> orgSizes, orgSliceSize, newStart, newSizes;
     if (xyslice) {
         LOG4FIMEX(logger, Logger::DEBUG, "need xy slicing");
-        full_data_array = make_shared_array<double>(maxXySize);
-
         orgSizes = {maxSizes.at(0), maxSizes.at(1)};
         orgSliceSize = {1, maxSizes.at(0)};
         newStart = {dimStart.at(0), dimStart.at(1)};
         newSizes = {dimSizes.at(0), dimSizes.at(1)};
     }
 
-    for (const auto& gfm : slices) {
-        // join the data of the different levels
-        if (gfm.isValid()) {
-            double* data_out = &doubleArray[dataCurrentPos];
-            double* grib_out = xyslice ? full_data_array.get() : data_out;
-            LOG4FIMEX(logger, Logger::DEBUG,
-                      "start reading variable " << gfm.getShortName() << ", level " << gfm.getLevelNumber() << ", store at " << dataCurrentPos);
-            size_t dataRead;
-            {
-#ifndef HAVE_GRIB_THREADSAFE
-                OmpScopedLock lock(p_->mutex);
+    // each message is decoded into its own xy-slice, so messages can be read in parallel;
+    // without thread-safe grib_api, only the file-reading is parallel and decoding is serialized
+    const long nSlices = slices.size();
+    std::exception_ptr error;
+#ifdef _OPENMP
+#pragma omp parallel default(shared) if (nSlices > 1)
+#endif
+    {
+        // storage for one layer, required only if making xy-slice
+        vector<double> full_data_array(xyslice ? maxXySize : 0);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
 #endif
-                dataRead = gfm.readData(grib_out, maxXySize, missingValue);
+        for (long i = 0; i < nSlices; ++i) {
+            const GribFileMessage& gfm = slices[i];
+            const size_t dataCurrentPos = i * xySliceSize; // always forward a complete slice
+            if (!gfm.isValid()) {
+                LOG4FIMEX(logger, Logger::DEBUG,
+                          "skipping variable " << varName << ", 1 level, "
+                                               << " size " << xySliceSize);
+                continue;
             }
-            LOG4FIMEX(logger, Logger::DEBUG, "done reading variable");
-            if (dataRead != maxXySize) {
-                LOG4FIMEX(logger, Logger::WARN, "unexpected data size " << dataRead << ", setting to missingValue");
-                fill(data_out, data_out + xySliceSize, missingValue);
-            } else if (xyslice) { // slicing on xy-data
-                recursiveCopyMultiDimData(&full_data_array[0], data_out, orgSizes, orgSliceSize, newStart, newSizes);
+            try {
+                double* data_out = &doubleArray[dataCurrentPos];
+                double* grib_out = xyslice ? &full_data_array[0] : data_out;
+                LOG4FIMEX(logger, Logger::DEBUG,
+                          "start reading variable " << gfm.getShortName() << ", level " << gfm.getLevelNumber() << ", store at " << dataCurrentPos);
+                const size_t dataRead = gfm.readData(p_->filePool, grib_out, maxXySize, missingValue);
+                LOG4FIMEX(logger, Logger::DEBUG, "done reading variable");
+                if (dataRead != maxXySize) {
+                    LOG4FIMEX(logger, Logger::WARN, "unexpected data size " << dataRead << ", setting to missingValue");
+                    fill(data_out, data_out + xySliceSize, missingValue);
+                } else if (xyslice) { // slicing on xy-data
+                    recursiveCopyMultiDimData(&full_data_array[0], data_out, orgSizes, orgSliceSize, newStart, newSizes);
+                }
+            } catch (...) {
+#ifdef _OPENMP
+#pragma omp critical(GribCDMReaderError)
+#endif
+                if (!error)
+                    error = std::current_exception();
             }
-        } else {
-            LOG4FIMEX(logger, Logger::DEBUG,
-                      "skipping variable " << varName << ", 1 level, "
-                                           << " size " << xySliceSize);
         }
-        dataCurrentPos += xySliceSize; // always forward a complete slice
     }
+    if (error)
+        std::rethrow_exception(error);
+
     std::map<string, std::pair<double, double>>::const_iterator it = p_->varPrecision.find(varName);
     if (it != p_->varPrecision.end()) {
         const double scale = it->second.first;
@@ -1418,7 +1438,7 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& s
 DataPtr GribCDMReader::getDataSlice(const string& varName, size_t unLimDimPos)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "fetching unlim-slice " << unLimDimPos << " for variable " << varName);
-    const CDMVariable& variable = cdm_->getVariable(varName);
+    const CDMVariable& variable = getCDM().getVariable(varName);
 
     if (variable.getDataType() == CDM_NAT) {
         return createData(CDM_INT, 0); // empty
@@ -1429,7 +1449,7 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, size_t unLimDimPos)
     // only time can be unLimDim for grib
     SliceBuilder sb(*cdm_, varName);
     if (cdm_->hasUnlimitedDim(variable)) {
-        if (unLimDimPos >= cdm_->getDimension(p_->timeDimName).getLength()) {
+        if (unLimDimPos >= getCDM().getDimension(p_->timeDimName).getLength()) {
             throw CDMException("requested time outside data-region");
         }
         sb.setStartAndSize(p_->timeDimName, unLimDimPos, 1);
@@ -38,6 +38,7 @@
 #endif
 
 #include "GribFileIndex.h"
+#include "GribFilePool.h"
 
 #include "fimex/CDMReader.h"
 #include "fimex/ReplaceStringObject.h"
@@ -65,6 +66,11 @@ public:
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos) override;
     DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
 
+    /**
+     * Counters of the open grib-files and of the multi-message index, mainly for debugging.
+     */
+    GribFilePool::Statistics getFilePoolStatistics() const;
+
     /**
      * Read a initialized cdmGribReader xml-document
      * @param configXML
@@ -26,6 +26,8 @@
 
 #include "GribFileIndex.h"
 
+#include "GribBinaryIndex.h"
+#include "GribFilePool.h"
 #include "GribUtils.h"
 
 #include "fimex/CDMException.h"
@@ -41,11 +43,14 @@
 
 #include "fimex/reproject.h"
 
+#include "fimex_grib_config.h"
+
 #include <date/date.h>
 
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
 #include <iostream>
 
 #include <libxml/tree.h>
@@ -253,11 +258,6 @@ std::string getEarthsFigure(long edition, grib_handle_p gh)
     return earth;
 }
 
-double lonLatResolutionForEdition(long edition)
-{
-    return edition == 1 ? 1e-3 : 1e-6;
-}
-
 GridDefinition getGridDefRegularLL(long edition, grib_handle_p gh)
 {
     long sizeX, sizeY, ijDirectionIncrementGiven;
@@ -296,7 +296,7 @@ GridDefinition getGridDefRegularLL(long edition, grib_handle_p gh)
     string proj = "+proj=longlat " + getEarthsFigure(edition, gh) + " +no_defs";
 
     LOG4FIMEX(logger, Logger::DEBUG, "getting griddefinition: " << proj << ": (" << startX << "," << startY << "), (" << incrX << "," << incrY << ")");
-    return GridDefinition(proj, true, sizeX, sizeY, incrX, incrY, startX, startY, startX, startY, lonLatResolutionForEdition(edition), orient);
+    return GridDefinition(proj, true, sizeX, sizeY, incrX, incrY, startX, startY, startX, startY, gribLonLatResolutionForEdition(edition), orient);
 }
 
 GridDefinition getGridDefRotatedLL(long edition, grib_handle_p gh)
@@ -334,7 +334,7 @@ GridDefinition getGridDefRotatedLL(long edition, grib_handle_p gh)
     oss << " " << getEarthsFigure(edition, gh) << " +no_defs";
     string proj = oss.str();
 
-    return GridDefinition(proj, true, sizeX, sizeY, incrX, incrY, startX, startY, startX, startY, lonLatResolutionForEdition(edition), orient);
+    return GridDefinition(proj, true, sizeX, sizeY, incrX, incrY, startX, startY, startX, startY, gribLonLatResolutionForEdition(edition), orient);
 }
 
 struct GribMetricDef
@@ -385,7 +385,7 @@ GridDefinition getGridDefMercator(long edition, grib_handle_p gh)
     projConvert(proj, gmd.startLon, gmd.startLat, startX, startY);
 
     return GridDefinition(proj, false, gmd.sizeX, gmd.sizeY, gmd.incrX, gmd.incrY, startX, startY, gmd.startLon, gmd.startLat,
-                          lonLatResolutionForEdition(edition), gribGetGridOrientation(gh));
+                          gribLonLatResolutionForEdition(edition), gribGetGridOrientation(gh));
 }
 
 GridDefinition getGridDefLambert(long edition, grib_handle_p gh)
@@ -414,7 +414,7 @@ GridDefinition getGridDefLambert(long edition, grib_handle_p gh)
     LOG4FIMEX(logger, Logger::DEBUG,
               "startpos: (lon,lat) " << gmd.startLon << ", " << gmd.startLat << "  (x,y)= " << startX << "," << startY << " projStr" << proj);
     return GridDefinition(proj, false, gmd.sizeX, gmd.sizeY, gmd.incrX, gmd.incrY, startX, startY, gmd.startLon, gmd.startLat,
-                          lonLatResolutionForEdition(edition), gribGetGridOrientation(gh));
+                          gribLonLatResolutionForEdition(edition), gribGetGridOrientation(gh));
 }
 
 GridDefinition getGridDefPolarStereographic(long edition, grib_handle_p gh)
@@ -448,7 +448,7 @@ GridDefinition getGridDefPolarStereographic(long edition, grib_handle_p gh)
     projConvert(proj, gmd.startLon, gmd.startLat, startX, startY);
 
     return GridDefinition(proj, false, gmd.sizeX, gmd.sizeY, gmd.incrX, gmd.incrY, startX, startY, gmd.startLon, gmd.startLat,
-                          lonLatResolutionForEdition(edition), gribGetGridOrientation(gh));
+                          gribLonLatResolutionForEdition(edition), gribGetGridOrientation(gh));
 }
 
 const char GK_dataDate[] = "dataDate";
@@ -765,7 +765,7 @@ GribFileMessage::GribFileMessage(XMLDoc_p doc, string nsPrefix, xmlNodePtr node)
             const double startLon = !xmlStartLon.empty() ? string2type<double>(xmlStartLon) : 1000;
             const std::string xmlStartLat = getXmlProp(lNode, "startLat");
             const double startLat = !xmlStartLat.empty() ? string2type<double>(xmlStartLat) : 1000;
-            const double lonLatResolution = (!xmlStartLon.empty() && !xmlStartLat.empty()) ? lonLatResolutionForEdition(edition_) : -1;
+            const double lonLatResolution = (!xmlStartLon.empty() && !xmlStartLat.empty()) ? gribLonLatResolutionForEdition(edition_) : -1;
 
             GridDefinition::Orientation scanMode = static_cast<GridDefinition::Orientation>(string2type<long>(getXmlProp(lNode, "scanMode")));
             gridDefinition_ = GridDefinition(proj4, isDegree, static_cast<size_t>(sizeX), static_cast<size_t>(sizeY), incrX, incrY, startX, startY, startLon,
@@ -973,7 +973,7 @@ GribFileMessage::GribFileMessage(xmlTextReaderPtr reader, const std::string& fil
                         scanMode = static_cast<GridDefinition::Orientation>(value.to_long());
                     }
                 }
-                const double lonLatResolution = (haveStartLon && haveStartLat) ? lonLatResolutionForEdition(edition_) : -1;
+                const double lonLatResolution = (haveStartLon && haveStartLat) ? gribLonLatResolutionForEdition(edition_) : -1;
                 gridDefinition_ = GridDefinition(proj4, isDegree, sizeX, sizeY, incrX, incrY, startX, startY, startLon, startLat, lonLatResolution, scanMode);
             } else {
                 LOG4FIMEX(logger, Logger::WARN, "unknown node in file :" << fileName << " name: " << name);
@@ -1234,17 +1234,24 @@ string GribFileMessage::toString() const
     return string(reinterpret_cast<const char*>(buffer->content));
 }
 
-grib_handle_p GribFileMessage::createGribHandle(bool asimofHeader) const
+grib_handle_p GribFileMessage::createGribHandle(bool asimofHeader, GribFilePool* pool) const
 {
     const string url = getFileURL().substr(5); // remove 'file:' prefix, needs to be improved when streams are allowed
     const size_t position = asimofHeader ? 0 : getFilePosition();
+    const size_t message = asimofHeader ? 0 : getMessageNumber();
+
+    if (pool) {
+        // seek directly to the field, without parsing the previous fields of a multi-message
+        if (grib_handle_p gh = pool->createGribHandle(url, position, message))
+            return gh;
+    }
+
     FILE_p fh = file_open_seek(url, position);
 
     // enable multi-messages
     grib_multi_support_on(0);
 
     int err = 0;
-    const size_t message = asimofHeader ? 0 : getMessageNumber();
     for (size_t i = 0; i < message; i++) {
         // forward to correct multimessage
         grib_handle_p gh = make_grib_handle(fh, err);
@@ -1267,8 +1274,27 @@ size_t GribFileMessage::readData(double* data, size_t data_size, double missingV
     if (!isValid())
         return 0;
 
-    grib_handle_p gh = createGribHandle(false);
+    return readData(createGribHandle(false, nullptr), data, data_size, missingValue);
+}
+
+size_t GribFileMessage::readData(GribFilePool& pool, double* data, size_t data_size, double missingValue) const
+{
+    if (!isValid())
+        return 0;
+
+    // reading the message does not need grib_api, only decoding might need to be serialized
+    std::vector<unsigned char> fieldMessage;
+    const bool haveField = pool.readField(getFileURL().substr(5), getFilePosition(), getMessageNumber(), fieldMessage);
 
+#ifndef HAVE_GRIB_THREADSAFE
+    OmpScopedLock lock(gribMutex());
+#endif
+    grib_handle_p gh = haveField ? GribFilePool::decode(fieldMessage) : createGribHandle(false, nullptr);
+    return readData(gh, data, data_size, missingValue);
+}
+
+size_t GribFileMessage::readData(grib_handle_p gh, double* data, size_t data_size, double missingValue) const
+{
     LOG4FIMEX(logger, Logger::DEBUG, "set missing = " << missingValue);
     MIFI_GRIB_CHECK(grib_set_double(gh.get(), "missingValue", missingValue), 0);
     LOG4FIMEX(logger, Logger::DEBUG, "retrieve values");
@@ -1282,8 +1308,22 @@ size_t GribFileMessage::readLevelData(std::vector<double>& levelData, double mis
     if (!isValid())
         return 0;
 
-    grib_handle_p gh = createGribHandle(asimofHeader);
+    return readLevelData(createGribHandle(asimofHeader, nullptr), levelData, missingValue);
+}
 
+size_t GribFileMessage::readLevelData(GribFilePool& pool, std::vector<double>& levelData, double missingValue, bool asimofHeader) const
+{
+    if (!isValid())
+        return 0;
+
+#ifndef HAVE_GRIB_THREADSAFE
+    OmpScopedLock lock(gribMutex());
+#endif
+    return readLevelData(createGribHandle(asimofHeader, &pool), levelData, missingValue);
+}
+
+size_t GribFileMessage::readLevelData(grib_handle_p gh, std::vector<double>& levelData, double missingValue) const
+{
     size_t size = 0;
     long pvpresent = 0;
     grib_get(gh, "PVPresent", pvpresent);
@@ -1316,7 +1356,7 @@ GribFileIndex::GribFileIndex(const std::string& gribFilePath, const std::string&
 
 GribFileIndex::GribFileIndex(const std::string& grbmlFilePath)
 {
-    if (!initByXMLReader(grbmlFilePath))
+    if (!initByIndexFile(grbmlFilePath))
         throw runtime_error("error reading grbml-file: '" + grbmlFilePath + "'");
 }
 
@@ -1334,7 +1374,7 @@ void GribFileIndex::init(const std::string& gribFilePath, const std::string& grb
 {
     if (!grbmlFilePath.empty()) {
         // append to existing grbml-file
-        initByXMLReader(grbmlFilePath);
+        initByIndexFile(grbmlFilePath);
         // but remove existing messages for the same file
         messages_.erase(std::remove_if(messages_.begin(), messages_.end(), HasSameUrl("file:" + gribFilePath)), messages_.end());
     }
@@ -1358,6 +1398,68 @@ void GribFileIndex::initByGrib(const std::string& gribFilePath, const std::vecto
                                const std::vector<std::string>& extraKeys)
 {
     url_ = "file:" + gribFilePath;
+
+    // find message boundaries without decoding, then decode the messages in parallel
+    GribFilePool pool(1);
+    std::vector<off_t> positions;
+    if (!pool.scanMessages(gribFilePath, positions)) {
+        LOG4FIMEX(logger, Logger::DEBUG, "cannot scan messages of '" << gribFilePath << "', indexing sequentially");
+        initByGribSequential(gribFilePath, members, extraKeys);
+        return;
+    }
+
+    const long nMessages = positions.size();
+    std::vector<std::vector<GribFileMessage>> messages(nMessages);
+    std::vector<char> supported(nMessages, 1);
+    std::exception_ptr error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (nMessages > 1)
+#endif
+    for (long i = 0; i < nMessages; ++i) {
+        try {
+            std::vector<std::vector<unsigned char>> fields;
+            if (!pool.readFields(gribFilePath, positions[i], fields)) {
+                supported[i] = 0;
+                continue;
+            }
+            for (size_t f = 0; f < fields.size(); ++f) {
+#ifndef HAVE_GRIB_THREADSAFE
+                OmpScopedLock lock(gribMutex());
+#endif
+                grib_handle_p gh = GribFilePool::decode(fields[f]);
+                try {
+                    messages[i].push_back(GribFileMessage(gh, url_, positions[i], f, members, extraKeys));
+                } catch (CDMException& ex) {
+                    LOG4FIMEX(logger, Logger::WARN, "ignoring grib-message at byte " << positions[i] << ": " << ex.what());
+                }
+            }
+        } catch (...) {
+#ifdef _OPENMP
+#pragma omp critical(GribFileIndexError)
+#endif
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    if (std::find(supported.begin(), supported.end(), 0) != supported.end()) {
+        LOG4FIMEX(logger, Logger::DEBUG, "unsupported message in '" << gribFilePath << "', indexing sequentially");
+        initByGribSequential(gribFilePath, members, extraKeys);
+        return;
+    }
+
+    // join in file order, independent of the number of threads
+    for (const auto& m : messages)
+        messages_.insert(messages_.end(), m.begin(), m.end());
+}
+
+void GribFileIndex::initByGribSequential(const std::string& gribFilePath, const std::vector<std::pair<std::string, std::regex>>& members,
+                                         const std::vector<std::string>& extraKeys)
+{
     std::shared_ptr<FILE> fh = file_open_seek(gribFilePath, 0);
     // enable multi-messages
     grib_multi_support_on(0);
@@ -1467,6 +1569,16 @@ bool GribFileIndex::initByXMLReader(const std::string& grbmlFilePath)
     }
 }
 
+bool GribFileIndex::initByIndexFile(const std::string& indexFilePath)
+{
+    if (GribBinaryIndex::isBinaryIndex(indexFilePath)) {
+        LOG4FIMEX(logger, Logger::DEBUG, "reading binary GribFile-index :" << indexFilePath);
+        url_ = GribBinaryIndex::read(indexFilePath, messages_);
+        return true;
+    }
+    return initByXMLReader(indexFilePath);
+}
+
 void GribFileIndex::initByXML(const std::string& grbmlFilePath)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "reading GribFile-index :" << grbmlFilePath);
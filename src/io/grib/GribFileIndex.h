@@ -47,6 +47,8 @@ typedef std::shared_ptr<grib_handle> grib_handle_p;
 
 namespace MetNoFimex {
 
+class GribFilePool;
+
 extern const char GK_discipline[];
 extern const char GK_gribTablesVersionNo[];
 extern const char GK_identificationOfOriginatingGeneratingCentre[];
@@ -127,6 +129,13 @@ public:
      */
     size_t readData(double* data, std::size_t data_size, double missingValue) const;
 
+    /**
+     * Read the data like readData(double*, std::size_t, double), using open files and the
+     * message-index of the pool.
+     * @param pool the pool of grib-files
+     */
+    size_t readData(GribFilePool& pool, double* data, std::size_t data_size, double missingValue) const;
+
     /**
      * Read the level-data from the underlying source to the vector levelData. In contrast to readData(), the
      * levelData does not need to be pre-allocated, since levelData usually are small (a few hundred (in grib1 limited to 256)).
@@ -136,8 +145,19 @@ public:
      */
     size_t readLevelData(std::vector<double>& levelData, double missingValue, bool asimofHeader = false) const;
 
+    /**
+     * Read the level-data like readLevelData(std::vector<double>&, double, bool), using open
+     * files and the message-index of the pool.
+     * @param pool the pool of grib-files
+     */
+    size_t readLevelData(GribFilePool& pool, std::vector<double>& levelData, double missingValue, bool asimofHeader = false) const;
+
 private:
-    grib_handle_p createGribHandle(bool asimofHeader) const;
+    friend class GribBinaryIndex;
+
+    grib_handle_p createGribHandle(bool asimofHeader, GribFilePool* pool) const;
+    size_t readData(grib_handle_p gh, double* data, std::size_t data_size, double missingValue) const;
+    size_t readLevelData(grib_handle_p gh, std::vector<double>& levelData, double missingValue) const;
 
 private:
     std::string fileURL_;
@@ -205,7 +225,7 @@ public:
      * @li xml-file: 0.1s
      *
      * @param gribFilePath path to first filename (or empty)
-     * @param grbmlFilePath path to gribml to append information from
+     * @param grbmlFilePath path to gribml or binary index to append information from
      * @param members translation of members to filenames
      * @param options map with several string options, currently, only earthfigure = proj4-string is allowed
      */
@@ -213,7 +233,7 @@ public:
                   std::map<std::string, std::string> options = std::map<std::string, std::string>());
 
     /**
-     * Create an index from gribml.
+     * Create an index from gribml, or from a binary index written by GribBinaryIndex.
      *
      * Initialize the gribFileIndex for the gribFile gribFilePath.
      * If ignoreExistingXml = false, searches for existing indexes in
@@ -227,7 +247,7 @@ public:
      * @li file completely in memory: 1.1s
      * @li xml-file: 0.1s
      *
-     * @param gribmlFilePath path to gribml to append information from
+     * @param gribmlFilePath path to gribml or binary index to read information from
      */
     GribFileIndex(const std::string& gribmlFilePath);
 
@@ -244,8 +264,12 @@ private:
 
     void init(const std::string& gribFilePath, const std::string& grbmlFilePath, const std::vector<std::pair<std::string, std::regex>>& members);
     void initByGrib(const std::string& gribFilePath, const std::vector<std::pair<std::string, std::regex>>& members, const std::vector<std::string>& extraKeys);
+    void initByGribSequential(const std::string& gribFilePath, const std::vector<std::pair<std::string, std::regex>>& members,
+                              const std::vector<std::string>& extraKeys);
     void initByXML(const std::string& xmlFilePath);
     bool initByXMLReader(const std::string& xmlFilePath);
+    /// read a grbml or a binary index, depending on the file content
+    bool initByIndexFile(const std::string& indexFilePath);
 };
 
 /// outputstream for a GribFileMessage
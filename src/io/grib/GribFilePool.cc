@@ -0,0 +1,424 @@
+/*
+ * Fimex, GribFilePool.cc
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "GribFilePool.h"
+
+#include "fimex/CDMException.h"
+#include "fimex/Logger.h"
+#include "fimex/Type2String.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "grib_api.h"
+
+namespace MetNoFimex {
+
+using namespace std;
+
+namespace {
+
+Logger_p logger = getLogger("fimex.GribFilePool");
+
+// maximum number of messages in the index before it is reset
+const size_t MAX_INDEX_SIZE = 65536;
+
+const size_t GRIB_SECTION0_LENGTH = 16;
+
+uint64_t readBigEndian(const unsigned char* bytes, size_t n)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; ++i)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+void writeBigEndian(uint64_t value, unsigned char* bytes, size_t n)
+{
+    for (size_t i = n; i > 0; --i) {
+        bytes[i - 1] = static_cast<unsigned char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+} // namespace
+
+// ========================================================================
+
+class GribFilePool::File
+{
+public:
+    File(const std::string& path)
+        : path_(path)
+        , fd_(::open(path.c_str(), O_RDONLY))
+    {
+        if (fd_ < 0)
+            throw CDMException("cannot open file '" + path + "': " + strerror(errno));
+    }
+    ~File() { ::close(fd_); }
+
+    /// read exactly length bytes at position, return false at end of file
+    bool read(off_t position, size_t length, unsigned char* buffer) const { return readAtMost(position, length, buffer) == length; }
+
+    /// read up to length bytes at position, return the number of bytes read, less than length only at end of file
+    size_t readAtMost(off_t position, size_t length, unsigned char* buffer) const
+    {
+        size_t total = 0;
+        while (total < length) {
+            const ssize_t n = ::pread(fd_, buffer + total, length - total, position + total);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw CDMException("cannot read file '" + path_ + "' at " + type2string(position) + ": " + strerror(errno));
+            }
+            if (n == 0)
+                break;
+            total += n;
+        }
+        return total;
+    }
+
+private:
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    std::string path_;
+    int fd_;
+};
+
+// ========================================================================
+
+GribFilePool::Statistics::Statistics()
+    : fileRequests(0)
+    , fileHits(0)
+    , fileEvictions(0)
+    , indexRequests(0)
+    , indexHits(0)
+{
+}
+
+GribFilePool::GribFilePool(size_t maxOpenFiles)
+    : maxOpenFiles_(std::max(maxOpenFiles, size_t(1)))
+{
+}
+
+GribFilePool::~GribFilePool()
+{
+    LOG4FIMEX(logger, Logger::DEBUG,
+              "files: " << stats_.fileHits << " hits of " << stats_.fileRequests << " requests, " << stats_.fileEvictions << " evictions; "
+                        << "message-index: " << stats_.indexHits << " hits of " << stats_.indexRequests << " requests");
+}
+
+GribFilePool::Statistics GribFilePool::getStatistics() const
+{
+    OmpScopedLock lock(mutex_);
+    return stats_;
+}
+
+GribFilePool::File_p GribFilePool::openFile(const std::string& path)
+{
+    {
+        OmpScopedLock lock(mutex_);
+        stats_.fileRequests += 1;
+        for (std::list<std::pair<std::string, File_p>>::iterator it = files_.begin(); it != files_.end(); ++it) {
+            if (it->first == path) {
+                stats_.fileHits += 1;
+                files_.splice(files_.begin(), files_, it);
+                return files_.front().second;
+            }
+        }
+    }
+
+    // open outside the lock, opening may be slow on network filesystems
+    File_p file = std::make_shared<File>(path);
+
+    OmpScopedLock lock(mutex_);
+    files_.push_front(std::make_pair(path, file));
+    while (files_.size() > maxOpenFiles_) {
+        // readers still using the evicted file keep it open until they are done
+        files_.pop_back();
+        stats_.fileEvictions += 1;
+    }
+    return file;
+}
+
+bool GribFilePool::indexMessage(const File_p& file, off_t position, MessageIndex& index, std::vector<unsigned char>& message)
+{
+    unsigned char sec0[GRIB_SECTION0_LENGTH];
+    if (!file->read(position, GRIB_SECTION0_LENGTH, sec0) || memcmp(sec0, "GRIB", 4) != 0)
+        return false;
+
+    const int edition = sec0[7];
+    size_t length;
+    if (edition == 1) {
+        length = readBigEndian(sec0 + 4, 3);
+        if (length & 0x800000)
+            return false; // large grib1 messages with special length-coding
+    } else if (edition == 2) {
+        length = readBigEndian(sec0 + 8, 8);
+    } else {
+        return false;
+    }
+    if (length <= GRIB_SECTION0_LENGTH)
+        return false;
+
+    message.resize(length);
+    std::copy(sec0, sec0 + GRIB_SECTION0_LENGTH, message.begin());
+    if (!file->read(position + GRIB_SECTION0_LENGTH, length - GRIB_SECTION0_LENGTH, &message[GRIB_SECTION0_LENGTH]))
+        return false;
+
+    index.fields.clear();
+    index.multi = false;
+    if (edition == 1) {
+        index.fields.push_back(std::vector<Range>(1, Range(0, length)));
+        return true;
+    }
+
+    // grib2: 0 1 [2] [3] 4 5 6 7 ... 8, sections 2-7 may be repeated
+    Range sec1, sec2, sec3, lastBitmap;
+    std::vector<Range> field;
+    size_t offset = GRIB_SECTION0_LENGTH;
+    while (offset + 4 <= length && memcmp(&message[offset], "7777", 4) != 0) {
+        if (offset + 5 > length)
+            return false;
+        const size_t secLength = readBigEndian(&message[offset], 4);
+        const int secNumber = message[offset + 4];
+        if (secLength < 5 || offset + secLength > length)
+            return false;
+        Range sec(offset, secLength);
+        switch (secNumber) {
+        case 1:
+            sec1 = sec;
+            break;
+        case 2:
+            sec2 = sec;
+            break;
+        case 3:
+            sec3 = sec;
+            break;
+        case 4:
+            if (!field.empty())
+                index.fields.push_back(field);
+            field.clear();
+            field.push_back(Range(0, GRIB_SECTION0_LENGTH));
+            field.push_back(sec1);
+            if (sec2.second > 0)
+                field.push_back(sec2);
+            field.push_back(sec3);
+            field.push_back(sec);
+            break;
+        case 6:
+            if (secLength > 5 && message[offset + 5] == 254) {
+                // bitmap defined in an earlier field
+                if (lastBitmap.second == 0)
+                    return false;
+                sec = lastBitmap;
+            } else if (secLength > 5 && message[offset + 5] == 0) {
+                lastBitmap = sec;
+            }
+            field.push_back(sec);
+            break;
+        default:
+            field.push_back(sec);
+            break;
+        }
+        offset += secLength;
+    }
+    if (field.empty())
+        return false;
+    index.fields.push_back(field);
+
+    if (index.fields.size() == 1) {
+        // no need to join sections
+        index.fields.front() = std::vector<Range>(1, Range(0, length));
+    } else {
+        index.multi = true;
+    }
+    return true;
+}
+
+bool GribFilePool::findIndex(const File_p& file, const std::string& path, off_t position, MessageIndex& index, std::vector<unsigned char>& message)
+{
+    const MessageKey key(path, position);
+    {
+        OmpScopedLock lock(mutex_);
+        stats_.indexRequests += 1;
+        std::map<MessageKey, MessageIndex>::const_iterator it = index_.find(key);
+        if (it != index_.end()) {
+            stats_.indexHits += 1;
+            index = it->second;
+            return !index.fields.empty(); // empty if known to be unsupported
+        }
+    }
+
+    const bool indexed = indexMessage(file, position, index, message);
+    if (!indexed)
+        index.fields.clear();
+    {
+        OmpScopedLock lock(mutex_);
+        if (index_.size() >= MAX_INDEX_SIZE)
+            index_.clear();
+        index_[key] = index;
+    }
+    if (!indexed)
+        LOG4FIMEX(logger, Logger::DEBUG, "no index for message at " << path << ":" << position);
+    return indexed;
+}
+
+void GribFilePool::joinField(const File_p& file, const std::string& path, off_t position, const MessageIndex& index, size_t field,
+                             const std::vector<unsigned char>& message, std::vector<unsigned char>& fieldMessage)
+{
+    if (field >= index.fields.size())
+        throw CDMException("no field " + type2string(field) + " in grib message at " + path + ":" + type2string(position));
+    const std::vector<Range>& ranges = index.fields[field];
+
+    // join the ranges of the field to one message
+    size_t length = 0;
+    for (const Range& r : ranges)
+        length += r.second;
+    if (index.multi)
+        length += 4; // '7777'
+
+    fieldMessage.resize(length);
+    size_t fieldPos = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        // join contiguous ranges to a single read
+        size_t rangeLength = ranges[i].second;
+        while (i + 1 < ranges.size() && ranges[i + 1].first == ranges[i].first + ranges[i].second) {
+            ++i;
+            rangeLength += ranges[i].second;
+        }
+        const size_t rangeStart = ranges[i].first + ranges[i].second - rangeLength;
+        if (!message.empty()) {
+            std::copy(&message[rangeStart], &message[rangeStart] + rangeLength, &fieldMessage[fieldPos]);
+        } else if (!file->read(position + rangeStart, rangeLength, &fieldMessage[fieldPos])) {
+            throw CDMException("unexpected end of file in grib message at " + path + ":" + type2string(position));
+        }
+        fieldPos += rangeLength;
+    }
+    if (index.multi) {
+        std::copy("7777", "7777" + 4, &fieldMessage[fieldPos]);
+        writeBigEndian(length, &fieldMessage[8], 8);
+    }
+}
+
+bool GribFilePool::readField(const std::string& path, off_t position, size_t field, std::vector<unsigned char>& fieldMessage)
+{
+    File_p file = openFile(path);
+
+    MessageIndex index;
+    std::vector<unsigned char> message;
+    if (!findIndex(file, path, position, index, message))
+        return false;
+
+    joinField(file, path, position, index, field, message, fieldMessage);
+    return true;
+}
+
+bool GribFilePool::readFields(const std::string& path, off_t position, std::vector<std::vector<unsigned char>>& fieldMessages)
+{
+    File_p file = openFile(path);
+
+    MessageIndex index;
+    std::vector<unsigned char> message;
+    if (!findIndex(file, path, position, index, message))
+        return false;
+
+    fieldMessages.resize(index.fields.size());
+    for (size_t field = 0; field < index.fields.size(); ++field) {
+        if (!index.multi && !message.empty())
+            fieldMessages[field].swap(message); // single field is the whole message
+        else
+            joinField(file, path, position, index, field, message, fieldMessages[field]);
+    }
+    return true;
+}
+
+bool GribFilePool::scanMessages(const std::string& path, std::vector<off_t>& positions)
+{
+    File_p file = openFile(path);
+
+    const size_t bufferSize = 64 * 1024;
+    std::vector<unsigned char> buffer(bufferSize);
+    off_t position = 0;
+    while (true) {
+        const size_t n = file->readAtMost(position, bufferSize, &buffer[0]);
+        if (n < GRIB_SECTION0_LENGTH)
+            return true; // end of file, trailing bytes cannot be a message
+
+        // find the next 'GRIB' marker
+        const unsigned char* marker = std::search(&buffer[0], &buffer[0] + n, "GRIB", "GRIB" + 4);
+        const size_t skip = marker - &buffer[0];
+        if (skip + GRIB_SECTION0_LENGTH > n) {
+            // marker not found or section 0 incomplete, continue just before the end of the buffer
+            if (n < bufferSize)
+                return true;
+            position += std::min(skip, n - GRIB_SECTION0_LENGTH + 1);
+            continue;
+        }
+        position += skip;
+
+        const unsigned char* sec0 = marker;
+        const int edition = sec0[7];
+        uint64_t length = 0;
+        if (edition == 1) {
+            length = readBigEndian(sec0 + 4, 3);
+            if (length & 0x800000)
+                return false; // large grib1 messages with special length-coding
+        } else if (edition == 2) {
+            length = readBigEndian(sec0 + 8, 8);
+        } else {
+            // 'GRIB' within other data, continue behind the marker
+            position += 4;
+            continue;
+        }
+        if (length <= GRIB_SECTION0_LENGTH)
+            return false;
+
+        positions.push_back(position);
+        position += length;
+    }
+}
+
+grib_handle_p GribFilePool::decode(const std::vector<unsigned char>& fieldMessage)
+{
+    grib_handle_p gh(grib_handle_new_from_message_copy(0, &fieldMessage[0], fieldMessage.size()), grib_handle_delete);
+    if (!gh)
+        throw CDMException("cannot decode grib message");
+    return gh;
+}
+
+grib_handle_p GribFilePool::createGribHandle(const std::string& path, off_t position, size_t field)
+{
+    std::vector<unsigned char> fieldMessage;
+    if (!readField(path, position, field, fieldMessage))
+        return grib_handle_p();
+    return decode(fieldMessage);
+}
+
+} // namespace MetNoFimex
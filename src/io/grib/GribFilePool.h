@@ -0,0 +1,167 @@
+/*
+ * Fimex, GribFilePool.h
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef GRIBFILEPOOL_H_
+#define GRIBFILEPOOL_H_
+
+#include "fimex/MutexLock.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+// forward decl of grib_api
+struct grib_handle;
+typedef std::shared_ptr<grib_handle> grib_handle_p;
+
+namespace MetNoFimex {
+
+/**
+ * Bounded pool of open grib-files together with an index of the
+ * (multi-)messages read from them.
+ *
+ * Files are read with positioned reads, so a file-descriptor can be
+ * shared between threads. The message index stores the sections of each
+ * field of a multi-message, so that a field can be decoded without
+ * parsing the previous fields of the same message.
+ */
+class GribFilePool
+{
+public:
+    /// counters for the use of the pool
+    struct Statistics
+    {
+        Statistics();
+        /// number of file requests
+        size_t fileRequests;
+        /// number of file requests served by an already open file
+        size_t fileHits;
+        /// number of files closed to keep the pool bounded
+        size_t fileEvictions;
+        /// number of message-index requests
+        size_t indexRequests;
+        /// number of message-index requests served from the index
+        size_t indexHits;
+    };
+
+    /**
+     * @param maxOpenFiles maximum number of files kept open, at least 1
+     */
+    explicit GribFilePool(size_t maxOpenFiles = 16);
+    ~GribFilePool();
+
+    /**
+     * Create a grib_handle for a field of a message.
+     *
+     * @param path path to the grib-file
+     * @param position start of the message in the file
+     * @param field number of the field within a multi-message
+     * @return the grib_handle, or a null pointer if the message is not
+     *  supported by the pool, i.e. if it does not start at position
+     */
+    grib_handle_p createGribHandle(const std::string& path, off_t position, size_t field);
+
+    /**
+     * Read a field of a message as a self-contained grib-message. This
+     * does not call grib_api and can be used concurrently also with a
+     * grib_api which is not thread-safe.
+     *
+     * @param path path to the grib-file
+     * @param position start of the message in the file
+     * @param field number of the field within a multi-message
+     * @param fieldMessage the grib-message of the field
+     * @return false if the message is not supported by the pool
+     */
+    bool readField(const std::string& path, off_t position, size_t field, std::vector<unsigned char>& fieldMessage);
+
+    /**
+     * Read all fields of a message as self-contained grib-messages, like readField().
+     *
+     * @param path path to the grib-file
+     * @param position start of the message in the file
+     * @param fieldMessages the grib-messages of the fields, in order
+     * @return false if the message is not supported by the pool
+     */
+    bool readFields(const std::string& path, off_t position, std::vector<std::vector<unsigned char>>& fieldMessages);
+
+    /**
+     * Find the start of all messages in a file from the 'GRIB' marker and the
+     * total length in section 0, without decoding the messages. Bytes between
+     * messages are skipped.
+     *
+     * @param path path to the grib-file
+     * @param positions the start of each message, in file order
+     * @return false if the length of a message cannot be determined, e.g. for large grib1 messages
+     */
+    bool scanMessages(const std::string& path, std::vector<off_t>& positions);
+
+    /**
+     * Decode a message read by readField().
+     */
+    static grib_handle_p decode(const std::vector<unsigned char>& fieldMessage);
+
+    /// get a copy of the current counters
+    Statistics getStatistics() const;
+
+private:
+    class File;
+    typedef std::shared_ptr<File> File_p;
+
+    /// byte-range (offset relative to message-start, length)
+    typedef std::pair<size_t, size_t> Range;
+    struct MessageIndex
+    {
+        /// for each field, the ranges to join to a single grib-message
+        std::vector<std::vector<Range>> fields;
+        /// true if the fields are parts of a grib2 multi-message
+        bool multi;
+    };
+    typedef std::pair<std::string, off_t> MessageKey;
+
+    File_p openFile(const std::string& path);
+    bool indexMessage(const File_p& file, off_t position, MessageIndex& index, std::vector<unsigned char>& message);
+    /// get the index from the cache or by indexMessage, message is only filled in the latter case
+    bool findIndex(const File_p& file, const std::string& path, off_t position, MessageIndex& index, std::vector<unsigned char>& message);
+    /// join the ranges of a field, from message if not empty, otherwise from file
+    void joinField(const File_p& file, const std::string& path, off_t position, const MessageIndex& index, size_t field,
+                   const std::vector<unsigned char>& message, std::vector<unsigned char>& fieldMessage);
+
+    GribFilePool(const GribFilePool&) = delete;
+    GribFilePool& operator=(const GribFilePool&) = delete;
+
+    size_t maxOpenFiles_;
+    /// open files, most recently used first
+    std::list<std::pair<std::string, File_p>> files_;
+    std::map<MessageKey, MessageIndex> index_;
+    Statistics stats_;
+    mutable OmpMutex mutex_;
+};
+
+} // namespace MetNoFimex
+
+#endif /* GRIBFILEPOOL_H_ */
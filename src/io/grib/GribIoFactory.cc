@@ -34,11 +34,13 @@
 #include "GribApiCDMWriter.h"
 #include "GribCDMReader.h"
 #undef MIFI_IO_READER_SUPPRESS_DEPRECATED
+#include "GribBinaryIndex.h"
 
 #include "fimex/FileUtils.h"
 #include "fimex/IoPlugin.h"
 #include "fimex/StringUtils.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace MetNoFimex {
@@ -47,6 +49,11 @@ namespace {
 
 const char GRBML[] = "grbml";
 
+bool isIndexType(const std::string& type)
+{
+    return (type == GRBML || type == GribBinaryIndex::EXTENSION);
+}
+
 bool isGrib2Type(const std::string& type)
 {
     return (type == "grb2" || type == "grib2");
@@ -85,20 +92,22 @@ void parseGribArgs(const std::vector<std::string>& args, std::vector<std::pair<s
 
 size_t GribIoFactory::matchMagicSize()
 {
-    return 4;
+    return std::max(size_t(4), GribBinaryIndex::MAGIC_SIZE);
 }
 
 int GribIoFactory::matchMagic(const char* magic, size_t count)
 {
     if (count >= 4 && strncmp(magic, "GRIB", 4) == 0)
         return 1;
+    if (GribBinaryIndex::isBinaryIndexMagic(magic, count))
+        return 1;
     // TODO check for GRBML
     return 0;
 }
 
 int GribIoFactory::matchFileTypeName(const std::string& type)
 {
-    if (type == GRBML) {
+    if (isIndexType(type)) {
         // actually correct only for reading
         return 1;
     }
@@ -108,7 +117,7 @@ int GribIoFactory::matchFileTypeName(const std::string& type)
 CDMReader_p GribIoFactory::createReader(const std::string& fileTypeName, const std::string& fileName, const XMLInput& configXML,
                                         const std::vector<std::string>& args)
 {
-    if (fileTypeName == GRBML || getExtension(fileName) == GRBML) {
+    if (isIndexType(fileTypeName) || isIndexType(getExtension(fileName)) || GribBinaryIndex::isBinaryIndex(fileName)) {
         std::vector<std::pair<std::string, std::string>> members;
         std::vector<std::string> files; // files not used for grbml
         parseGribArgs(args, members, files);
@@ -137,7 +146,7 @@ CDMReader_p GribIoFactory::createReader(const std::string& fileTypeName, const s
 
 void GribIoFactory::createWriter(CDMReader_p input, const std::string& fileTypeName, const std::string& fileName, const XMLInput& config)
 {
-    if (fileTypeName == GRBML || getExtension(fileName) == GRBML)
+    if (isIndexType(fileTypeName) || isIndexType(getExtension(fileName)))
         throw CDMException("cannot write grbml-files");
 
     int gribVersion = 0;
@@ -48,6 +48,17 @@ void mifi_grib_check(int error, const char* msg, int line, const char* file)
 
 namespace MetNoFimex {
 
+OmpMutex& gribMutex()
+{
+    static OmpMutex mutex;
+    return mutex;
+}
+
+double gribLonLatResolutionForEdition(long edition)
+{
+    return edition == 1 ? 1e-3 : 1e-6;
+}
+
 GridDefinition::Orientation gribGetGridOrientation(std::shared_ptr<grib_handle> gh)
 {
     unsigned long mode = 0;
@@ -28,6 +28,7 @@
 #define GRIBUTILS_H_
 
 #include "fimex/GridDefinition.h"
+#include "fimex/MutexLock.h"
 
 #include <stdexcept>
 
@@ -46,6 +47,17 @@ void mifi_grib_check(int error, const char* msg, int line, const char* file);
 
 namespace MetNoFimex {
 
+/**
+ * Process-wide mutex to serialize calls to a grib_api / ecCodes
+ * which is not thread-safe (i.e. HAVE_GRIB_THREADSAFE not defined).
+ */
+OmpMutex& gribMutex();
+
+/**
+ * Resolution of the longitude / latitude of the first grid-point, as stored in grib edition 1 or 2.
+ */
+double gribLonLatResolutionForEdition(long edition);
+
 /**
  * get the orientation of the data
  * @param gh grib-handle
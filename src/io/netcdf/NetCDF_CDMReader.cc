@@ -36,6 +36,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <vector>
 
 namespace MetNoFimex {
 
@@ -59,9 +60,27 @@ NetCDF_CDMReader::NetCDF_CDMReader(const std::string& filename, bool writeable)
     }
     ncFile->filename = filename;
 
-    OmpScopedLock lock(Nc::getMutex());
-    ncCheck(nc_open(ncFile->filename.c_str(), writeable ? NC_WRITE : NC_NOWRITE, &ncFile->ncId), "opening " + ncFile->filename);
-    ncFile->isOpen = true;
+    {
+        OmpScopedLock lock(Nc::getMutex());
+        ncCheck(nc_open(ncFile->filename.c_str(), writeable ? NC_WRITE : NC_NOWRITE, &ncFile->ncId), "opening " + ncFile->filename);
+        ncFile->isOpen = true;
+        ncCheck(nc_inq_format(ncFile->ncId, &ncFile->format));
+    }
+    if (!writeable) {
+        if (char* readHandlesChar = getenv("FIMEX_NETCDF_READ_HANDLES")) {
+            const size_t readHandles = string2type<size_t>(readHandlesChar);
+#ifdef HAVE_NETCDF_THREADSAFE
+            if (readHandles > 0) {
+                LOG4FIMEX(logger, Logger::DEBUG, "using up to " << readHandles << " additional read handles for " << ncFile->filename);
+                readPool.reset(new NcReadPool(ncFile->filename, readHandles));
+            }
+#else
+            LOG4FIMEX(logger, Logger::DEBUG, "ignoring " << readHandles << " read handles, netcdf library is not thread-safe");
+#endif
+        }
+    }
+
+    OmpScopedLock lock(ncFile->mutex());
 
     // investigate the dimensions
     {
@@ -76,7 +95,7 @@ NetCDF_CDMReader::NetCDF_CDMReader(const std::string& filename, bool writeable)
             size_t dimlen;
             ncCheck(nc_inq_dimname(ncFile->ncId, i, ncName));
             ncCheck(nc_inq_dimlen(ncFile->ncId, i, &dimlen));
-            OmpScopedUnlock unlock(Nc::getMutex());
+            OmpScopedUnlock unlock(ncFile->mutex());
             CDMDimension d(string(ncName), dimlen);
             d.setUnlimited(recid == i);
             cdm_->addDimension(d);
@@ -103,7 +122,7 @@ NetCDF_CDMReader::NetCDF_CDMReader(const std::string& filename, bool writeable)
                 shape.push_back(dimName);
             }
             {
-                OmpScopedUnlock unlock(Nc::getMutex());
+                OmpScopedUnlock unlock(ncFile->mutex());
                 CDMDataType type = ncType2cdmDataType(dtype);
                 cdm_->addVariable(CDMVariable(ncName, type, shape));
             }
@@ -132,43 +151,42 @@ NetCDF_CDMReader::~NetCDF_CDMReader() {}
 
 DataPtr NetCDF_CDMReader::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
-    const CDMVariable& var = cdm_->getVariable(varName);
+    const CDMVariable& var = getCDM().getVariable(varName);
     if (var.hasData()) {
         return getDataSliceFromMemory(var, unLimDimPos);
     }
 
-    OmpScopedLock lock(Nc::getMutex());
     ncFile->reopen_if_forked();
     int varid;
-    ncCheck(nc_inq_varid(ncFile->ncId, var.getName().c_str(), &varid));
     nc_type dtype;
-    ncCheck(nc_inq_vartype(ncFile->ncId, varid, &dtype));
     int dimLen;
-    ncCheck(nc_inq_varndims(ncFile->ncId, varid, &dimLen));
-    int dimIds[dimLen];
-    ncCheck(nc_inq_vardimid(ncFile->ncId, varid, &dimIds[0]));
-    size_t count[dimLen];
-    size_t start[dimLen];
-    for (int i = 0; i < dimLen; ++i) {
-        start[i] = 0;
-        ncCheck(nc_inq_dimlen(ncFile->ncId, dimIds[i], &count[i]));
+    std::vector<size_t> count, start;
+    {
+        OmpScopedLock lock(ncFile->mutex());
+        ncCheck(nc_inq_varid(ncFile->ncId, var.getName().c_str(), &varid));
+        ncCheck(nc_inq_vartype(ncFile->ncId, varid, &dtype));
+        ncCheck(nc_inq_varndims(ncFile->ncId, varid, &dimLen));
+        std::vector<int> dimIds(dimLen);
+        if (dimLen > 0)
+            ncCheck(nc_inq_vardimid(ncFile->ncId, varid, &dimIds[0]));
+        count.resize(dimLen);
+        start.resize(dimLen, 0);
+        for (int i = 0; i < dimLen; ++i)
+            ncCheck(nc_inq_dimlen(ncFile->ncId, dimIds[i], &count[i]));
     }
     if (cdm_->hasUnlimitedDim(var)) {
         // unlimited dim always at 0
         start[0] = unLimDimPos;
         count[0] = 1;
     }
-    {
-        OmpScopedUnlock unlock(Nc::getMutex());
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "ncGetValues for " << varName << ": (" << join(start, start + dimLen) << ") size (" << join(count, count + dimLen) << ")");
-    }
-    return ncGetValues(ncFile->ncId, varid, dtype, static_cast<size_t>(dimLen), start, count);
+    LOG4FIMEX(logger, Logger::DEBUG,
+              "ncGetValues for " << varName << ": (" << join(start.begin(), start.end()) << ") size (" << join(count.begin(), count.end()) << ")");
+    return readValues(varid, dtype, start, count);
 }
 
 DataPtr NetCDF_CDMReader::getDataSlice(const std::string& varName, const SliceBuilder& sb)
 {
-    const CDMVariable& var = cdm_->getVariable(varName);
+    const CDMVariable& var = getCDM().getVariable(varName);
     if (var.hasData()) {
         return var.getData()->slice(sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
     }
@@ -178,7 +196,7 @@ DataPtr NetCDF_CDMReader::getDataSlice(const std::string& varName, const SliceBu
     int varid, dimLen;
     nc_type dtype;
     {
-        OmpScopedLock lock(Nc::getMutex());
+        OmpScopedLock lock(ncFile->mutex());
         ncCheck(nc_inq_varid(ncFile->ncId, var.getName().c_str(), &varid));
         ncCheck(nc_inq_vartype(ncFile->ncId, varid, &dtype));
         ncCheck(nc_inq_varndims(ncFile->ncId, varid, &dimLen));
@@ -193,13 +211,52 @@ DataPtr NetCDF_CDMReader::getDataSlice(const std::string& varName, const SliceBu
     LOG4FIMEX(logger, Logger::DEBUG,
               "ncGetValues SB for " << varName << ": (" << join(start.begin(), start.end()) << ") size (" << join(count.begin(), count.end()) << ")");
 
-    OmpScopedLock lock(Nc::getMutex());
-    return ncGetValues(ncFile->ncId, varid, dtype, static_cast<size_t>(dimLen), &start[0], &count[0]);
+    return readValues(varid, dtype, start, count);
+}
+
+DataPtr NetCDF_CDMReader::readValues(int varid, int dtype, const std::vector<size_t>& start, const std::vector<size_t>& count)
+{
+    const size_t* startP = start.empty() ? nullptr : &start[0];
+    const size_t* countP = count.empty() ? nullptr : &count[0];
+    if (readPool) {
+        // read with an additional handle, in parallel to readers of the main handle
+        NcReadPool::Handle handle(*readPool);
+        if (Nc* nc = handle.get()) {
+            nc->reopen_if_forked();
+            OmpScopedLock lock(nc->mutex());
+            return ncGetValues(nc->ncId, varid, dtype, start.size(), startP, countP);
+        }
+    }
+    OmpScopedLock lock(ncFile->mutex());
+    return ncGetValues(ncFile->ncId, varid, dtype, start.size(), startP, countP);
+}
+
+std::vector<std::size_t> NetCDF_CDMReader::getChunkShape(const std::string& varName) const
+{
+    std::vector<std::size_t> chunkShape;
+#ifdef NC_NETCDF4
+    if (ncFile->format == NC_FORMAT_NETCDF4 || ncFile->format == NC_FORMAT_NETCDF4_CLASSIC) {
+        const CDMVariable& var = getCDM().getVariable(varName);
+        const size_t rank = var.getShape().size();
+        if (rank > 0) {
+            OmpScopedLock lock(ncFile->mutex());
+            int varid, storage;
+            std::vector<size_t> ncChunks(rank);
+            ncCheck(nc_inq_varid(ncFile->ncId, var.getName().c_str(), &varid));
+            ncCheck(nc_inq_var_chunking(ncFile->ncId, varid, &storage, &ncChunks[0]));
+            if (storage == NC_CHUNKED) {
+                // netcdf has the fastest moving dimension last, cdm first
+                chunkShape.assign(ncChunks.rbegin(), ncChunks.rend());
+            }
+        }
+    }
+#endif
+    return chunkShape;
 }
 
 void NetCDF_CDMReader::sync()
 {
-    OmpScopedLock lock(Nc::getMutex());
+    OmpScopedLock lock(ncFile->mutex());
     ncCheck(nc_sync(ncFile->ncId));
 }
 
@@ -207,7 +264,7 @@ void NetCDF_CDMReader::putDataSlice(const std::string& varName, size_t unLimDimP
 {
     CDMVariable& var = cdm_->getVariable(varName);
 
-    OmpScopedLock lock(Nc::getMutex()); // FIXME abusing ncMutex as a little bit of protection for "var.setData"
+    OmpScopedLock lock(ncFile->mutex()); // FIXME abusing ncMutex as a little bit of protection for "var.setData"
     if (var.hasData()) {
         var.setData(DataPtr());
     }
@@ -230,7 +287,7 @@ void NetCDF_CDMReader::putDataSlice(const std::string& varName, size_t unLimDimP
         ncCheck(nc_inq_dimlen(ncFile->ncId, dimIds[i], &count[i]));
     }
     {
-        OmpScopedUnlock unlock(Nc::getMutex());
+        OmpScopedUnlock unlock(ncFile->mutex());
         if (cdm_->hasUnlimitedDim(var)) {
             // unlimited dim always at 0
             start[0] = unLimDimPos;
@@ -256,7 +313,7 @@ void NetCDF_CDMReader::putDataSlice(const std::string& varName, const SliceBuild
     int varid, dimLen;
     nc_type dtype;
     {
-        OmpScopedLock lock(Nc::getMutex());
+        OmpScopedLock lock(ncFile->mutex());
         ncCheck(nc_inq_varid(ncFile->ncId, var.getName().c_str(), &varid));
         ncCheck(nc_inq_vartype(ncFile->ncId, varid, &dtype));
         ncCheck(nc_inq_varndims(ncFile->ncId, varid, &dimLen));
@@ -273,7 +330,7 @@ void NetCDF_CDMReader::putDataSlice(const std::string& varName, const SliceBuild
     LOG4FIMEX(logger, Logger::DEBUG,
               "ncPutValues SB for " << varName << ": (" << join(start.begin(), start.end()) << ") size (" << join(count.begin(), count.end()) << ")");
 
-    OmpScopedLock lock(Nc::getMutex());
+    OmpScopedLock lock(ncFile->mutex());
     ncPutValues(data, ncFile->ncId, varid, dtype, static_cast<size_t>(dimLen), &start[0], &count[0]);
 }
 
@@ -283,7 +340,7 @@ void NetCDF_CDMReader::addAttribute(const std::string& varName, int varid, const
     ncCheck(nc_inq_atttype(ncFile->ncId, varid, attName.c_str(), &dtype));
     DataPtr attrData = ncGetAttValues(ncFile->ncId, varid, attName, dtype);
 
-    OmpScopedUnlock unlock(Nc::getMutex());
+    OmpScopedUnlock unlock(ncFile->mutex());
     cdm_->addAttribute(varName, CDMAttribute(attName, attrData));
 }
 
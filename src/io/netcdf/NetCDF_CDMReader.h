@@ -39,6 +39,7 @@
 namespace MetNoFimex {
 // forward decl
 class Nc;
+class NcReadPool;
 
 /**
  * @headerfile "fimex/NetCDF_CDMReader.h"
@@ -47,18 +48,23 @@ class Nc;
 class NetCDF_CDMReader : public CDMReaderWriter
 {
     const std::unique_ptr<Nc> ncFile;
+    /// additional read-only handles, see FIMEX_NETCDF_READ_HANDLES
+    std::unique_ptr<NcReadPool> readPool;
 
 public:
     NetCDF_CDMReader(const std::string& fileName, bool writable = false);
     ~NetCDF_CDMReader();
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos) override;
     DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
+    std::vector<std::size_t> getChunkShape(const std::string& varName) const override;
     void sync() override;
     void putDataSlice(const std::string& varName, size_t unLimDimPos, const DataPtr data) override;
     void putDataSlice(const std::string& varName, const SliceBuilder& sb, const DataPtr data) override;
 
 private:
     void addAttribute(const std::string& varName, int varid, const std::string& attName);
+    /// read values from the main handle or a handle of the read-pool
+    DataPtr readValues(int varid, int dtype, const std::vector<size_t>& start, const std::vector<size_t>& count);
 };
 
 } // namespace MetNoFimex
@@ -39,9 +39,20 @@
 
 #include "NetCDF_Utils.h"
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <numeric>
+#include <sstream>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace MetNoFimex {
 
@@ -91,14 +102,54 @@ int getNcVersion(int version, XMLDoc_p doc)
     return retVal;
 }
 
-int ncDimId(int ncId, const CDMDimension* unLimDim)
+/// shape of a variable in the output file
+struct NcWriteVariable
+{
+    int varId;
+    std::vector<size_t> start;
+    std::vector<size_t> count;
+    /// position of the unlimited dimension in start/count, or -1
+    int unLimDimIdx;
+};
+
+/// a variable (index into the cdm-variables) at a position of the unlimited dimension, or -1
+struct NcWriteTask
+{
+    size_t vi;
+    long long unLimDimPos;
+};
+
+/// maximum number of bytes read ahead of the writer, from FIMEX_WRITE_QUEUE_SIZE, default 256MB, at least 1
+size_t writeQueueSize()
+{
+    size_t queueSize = 256 * 1024 * 1024;
+    if (const char* queueSizeChar = getenv("FIMEX_WRITE_QUEUE_SIZE"))
+        queueSize = string2type<size_t>(queueSizeChar);
+    return std::max<size_t>(queueSize, 1);
+}
+
+int ncDimId(Nc& nc, const CDMDimension* unLimDim)
 {
     int unLimDimId = -1;
     if (unLimDim)
-        NCMUTEX_LOCKED(ncCheck(nc_inq_dimid(ncId, unLimDim->getName().c_str(), &unLimDimId)));
+        NCFILE_LOCKED(nc, ncCheck(nc_inq_dimid(nc.ncId, unLimDim->getName().c_str(), &unLimDimId)));
     return unLimDimId;
 }
 
+NetCDF_CDMWriter::ChunkingPolicy string2chunking(const std::string& chunking)
+{
+    const std::string c = string2lowerCase(chunking);
+    if (c == "auto")
+        return NetCDF_CDMWriter::CHUNKING_AUTO;
+    else if (c == "source")
+        return NetCDF_CDMWriter::CHUNKING_SOURCE;
+    else if (c == "map")
+        return NetCDF_CDMWriter::CHUNKING_MAP;
+    else if (c == "timeseries")
+        return NetCDF_CDMWriter::CHUNKING_TIMESERIES;
+    throw CDMException("unknown chunking: " + chunking);
+}
+
 void checkDoc(std::unique_ptr<XMLDoc>& doc, const std::string& filename)
 {
     XPathNodeSet nodes(doc, "/cdm_ncwriter_config");
@@ -111,6 +162,7 @@ void checkDoc(std::unique_ptr<XMLDoc>& doc, const std::string& filename)
 NetCDF_CDMWriter::NetCDF_CDMWriter(CDMReader_p reader, const std::string& outputFile, const XMLInput& config, int version)
     : CDMWriter(reader, outputFile)
     , ncFile(new Nc())
+    , defaultChunking(CHUNKING_AUTO)
 {
     const auto& doc = config.getXMLDoc();
     const int ncVersion = getNcVersion(version, doc);
@@ -127,7 +179,7 @@ NetCDF_CDMWriter::NetCDF_CDMWriter(CDMReader_p reader, const std::string& output
     }
     ncFile->isOpen = true;
 
-    NCMUTEX_LOCKED(ncCheck(nc_inq_format(ncFile->ncId, &ncFile->format)));
+    NCFILE_LOCKED(*ncFile, ncCheck(nc_inq_format(ncFile->ncId, &ncFile->format)));
 #ifdef NC_NETCDF4
     if ((ncFile->format == NC_FORMAT_NETCDF4) || (ncFile->format == NC_FORMAT_NETCDF4_CLASSIC)) {
         if ((ncVersion & NC_CLASSIC_MODEL) != 0)
@@ -142,7 +194,7 @@ NetCDF_CDMWriter::NetCDF_CDMWriter(CDMReader_p reader, const std::string& output
     if (ncFile->format < 3) {
         // using nofill for netcdf3 (2times io) -- does not affect netcdf4
         int oldFill;
-        NCMUTEX_LOCKED(nc_set_fill(ncFile->ncId, NC_NOFILL, &oldFill));
+        NCFILE_LOCKED(*ncFile, nc_set_fill(ncFile->ncId, NC_NOFILL, &oldFill));
     }
     initNcmlReader(doc);
     cdm = cdmReader->getCDM();
@@ -300,6 +352,23 @@ void NetCDF_CDMWriter::initFillRenameVariable(XMLDoc_p doc)
             const unsigned int chunkSize = string2type<unsigned int>(getXmlProp(node, "chunkSize"));
             dimensionChunkSize[name] = chunkSize;
         }
+        XPathNodeSet nodes(doc, "/cdm_ncwriter_config/default[@chunking]");
+        if (nodes.size()) {
+            defaultChunking = string2chunking(getXmlProp(nodes[0], "chunking"));
+        }
+        for (auto node : XPathNodeSet(doc, "/cdm_ncwriter_config/variable[@chunking]")) {
+            const std::string name = getXmlProp(node, "name");
+            variableChunking[name] = string2chunking(getXmlProp(node, "chunking"));
+        }
+        for (auto node : XPathNodeSet(doc, "/cdm_ncwriter_config/variable[@chunkShape]")) {
+            const std::string name = getXmlProp(node, "name");
+            const std::vector<std::string> sizes = tokenize(getXmlProp(node, "chunkShape"), ", ");
+            std::vector<size_t>& chunks = variableChunkShape[name];
+            for (const std::string& sz : sizes)
+                chunks.push_back(string2type<size_t>(sz));
+            if (cdm.hasVariable(name) && chunks.size() != cdm.getVariable(name).getShape().size())
+                throw CDMException("chunkShape of variable '" + name + "' does not match the number of dimensions");
+        }
     }
 }
 
@@ -365,7 +434,7 @@ NetCDF_CDMWriter::NcDimIdMap NetCDF_CDMWriter::defineDimensions()
         // NcDim is organized by NcFile, no need to clean
         // change the name written to the file according to getDimensionName
         int dimId;
-        NCMUTEX_LOCKED(ncCheck(nc_def_dim(ncFile->ncId, getDimensionName(dim.getName()).c_str(), length, &dimId)));
+        NCFILE_LOCKED(*ncFile, ncCheck(nc_def_dim(ncFile->ncId, getDimensionName(dim.getName()).c_str(), length, &dimId)));
         ncDimMap[dim.getName()] = dimId;
         LOG4FIMEX(logger, Logger::DEBUG, "DimId of " << dim.getName() << " = " << dimId);
     }
@@ -395,7 +464,7 @@ NetCDF_CDMWriter::NcVarIdMap NetCDF_CDMWriter::defineVariables(const NcDimIdMap&
         LOG4FIMEX(logger, Logger::DEBUG,
                   "defining variable " << var.getName() << " with shape '" << join(shape.begin(), shape.end())
                                        << "' = " << join(&ncshape[0], &ncshape[0] + shape.size()));
-        NCMUTEX_LOCKED(
+        NCFILE_LOCKED(*ncFile,
             ncCheck(nc_def_var(ncFile->ncId, getVariableName(var.getName()).c_str(), cdmDataType2ncType(datatype), shape.size(), &ncshape[0], &varId)));
         ncVarMap[var.getName()] = varId;
 #ifdef NC_NETCDF4
@@ -416,44 +485,18 @@ NetCDF_CDMWriter::NcVarIdMap NetCDF_CDMWriter::defineVariables(const NcDimIdMap&
                         shuffle = 1;
                     }
                 }
-                if (compression > 0 && !shape.empty()) { // non-scalar variables
-                    // create a chunk-strategy: continuous in last dimensions, max MAX_CHUNK
-                    const size_t DEFAULT_CHUNK = 2 << 20; // good chunk up to 1M *sizeof(type)
-                    const size_t MIN_CHUNK = 2 << 16;     // chunks should be at least reasonably sized, e.g. 64k*sizeof(type)
-                    std::unique_ptr<size_t[]> ncChunk(new size_t[shape.size()]);
-                    size_t chunkSize = 1;
-                    for (size_t i = 0; i < shape.size(); i++) {
-                        // revert order, cdm requires fastest moving first, netcdf-c requires fastest moving last
-                        const CDMDimension& dim = cdm.getDimension(shape[i]);
-                        const unsigned int dimSize = dim.isUnlimited() ? 1 : dim.getLength();
-                        std::map<std::string, unsigned int>::const_iterator defaultChunk = dimensionChunkSize.find(shape[i]);
-                        if (defaultChunk != dimensionChunkSize.end()) {
-                            unsigned int chunkDim = clamp(1u, dimSize, defaultChunk->second);
-                            chunkSize *= chunkDim;
-                            ncChunk[shape.size() - 1 - i] = chunkDim;
-                        } else {
-                            const size_t lastChunkSize = chunkSize;
-                            chunkSize *= dimSize;
-                            if (chunkSize < DEFAULT_CHUNK) {
-                                ncChunk[shape.size() - 1 - i] = dimSize;
-                            } else {
-                                size_t thisChunk = 1;
-                                if (dimSize > 1 && (lastChunkSize < (MIN_CHUNK))) {
-                                    // create a chunk-size which makes the total chunk ~= MIN_CHUNK
-                                    thisChunk =
-                                        clamp(1u, (unsigned int)floor(chunkSize / MIN_CHUNK), dimSize); // a number > 2^4 since chunkSize > DEFAULT_CHUNK
-                                }
-                                ncChunk[shape.size() - 1 - i] = thisChunk;
-                            }
-                        }
-                    }
-                    if (chunkSize > 0) {
-                        LOG4FIMEX(logger, Logger::DEBUG, "chunk variable " << var.getName() << " to " << join(&ncChunk[0], &ncChunk[0] + shape.size(), "x"));
-                        NCMUTEX_LOCKED(ncCheck(nc_def_var_chunking(ncFile->ncId, varId, NC_CHUNKED, ncChunk.get())));
+                const bool explicitChunking = variableChunkShape.count(var.getName()) || variableChunking.count(var.getName()) || defaultChunking != CHUNKING_AUTO;
+                if ((compression > 0 || explicitChunking) && !shape.empty()) { // non-scalar variables
+                    const std::vector<size_t> ncChunk = chunkShape(var);
+                    if (std::find(ncChunk.begin(), ncChunk.end(), 0) == ncChunk.end()) {
+                        LOG4FIMEX(logger, Logger::DEBUG, "chunk variable " << var.getName() << " to " << join(ncChunk.begin(), ncChunk.end(), "x"));
+                        NCFILE_LOCKED(*ncFile, ncCheck(nc_def_var_chunking(ncFile->ncId, varId, NC_CHUNKED, &ncChunk[0])));
                     }
+                }
+                if (compression > 0 && !shape.empty()) {
                     // start compression
                     LOG4FIMEX(logger, Logger::DEBUG, "compressing variable " << var.getName() << " with level " << compression << " and shuffle=" << shuffle);
-                    NCMUTEX_LOCKED(ncCheck(nc_def_var_deflate(ncFile->ncId, varId, shuffle, 1, compression)));
+                    NCFILE_LOCKED(*ncFile, ncCheck(nc_def_var_deflate(ncFile->ncId, varId, shuffle, 1, compression)));
                 }
             }
         }
@@ -462,9 +505,125 @@ NetCDF_CDMWriter::NcVarIdMap NetCDF_CDMWriter::defineVariables(const NcDimIdMap&
     return ncVarMap;
 }
 
+std::vector<size_t> NetCDF_CDMWriter::chunkShape(const CDMVariable& var) const
+{
+    // create a chunk-strategy: continuous in last dimensions, max MAX_CHUNK
+    const size_t DEFAULT_CHUNK = 2 << 20; // good chunk up to 1M *sizeof(type)
+    const size_t MIN_CHUNK = 2 << 16;     // chunks should be at least reasonably sized, e.g. 64k*sizeof(type)
+    const size_t MAX_CHUNK = 2 << 24;     // limit for complete maps, 32M *sizeof(type)
+    const size_t UNLIMITED_CHUNK = 128;   // time-series length of unlimited dimensions, their final length is unknown while writing
+
+    const std::vector<std::string>& shape = var.getShape();
+    const size_t rank = shape.size();
+    std::vector<size_t> chunk(rank, 1); // in cdm order, reverted at the end
+
+    const std::map<std::string, std::vector<size_t>>::const_iterator explicitShape = variableChunkShape.find(var.getName());
+    if (explicitShape != variableChunkShape.end()) {
+        // already in netcdf order
+        std::vector<size_t> ncChunk = explicitShape->second;
+        if (ncChunk.size() != rank)
+            throw CDMException("chunkShape of variable '" + var.getName() + "' does not match the number of dimensions");
+        for (size_t i = 0; i < rank; i++) {
+            const CDMDimension& dim = cdm.getDimension(shape[rank - 1 - i]);
+            const size_t dimSize = dim.isUnlimited() ? ncChunk[i] : dim.getLength();
+            ncChunk[i] = clamp(size_t(1), ncChunk[i], std::max(size_t(1), dimSize));
+        }
+        return ncChunk;
+    }
+
+    const std::map<std::string, ChunkingPolicy>::const_iterator varChunking = variableChunking.find(var.getName());
+    ChunkingPolicy policy = (varChunking != variableChunking.end()) ? varChunking->second : defaultChunking;
+
+    if (policy == CHUNKING_SOURCE) {
+        const std::vector<size_t> sourceChunk = cdmReader->getChunkShape(var.getName());
+        if (sourceChunk.size() == rank && cdmReader->getCDM().getVariable(var.getName()).getShape() == shape) {
+            for (size_t i = 0; i < rank; i++) {
+                const CDMDimension& dim = cdm.getDimension(shape[i]);
+                const size_t dimSize = dim.isUnlimited() ? sourceChunk[i] : dim.getLength();
+                chunk[i] = clamp(size_t(1), sourceChunk[i], std::max(size_t(1), dimSize));
+            }
+        } else {
+            LOG4FIMEX(logger, Logger::DEBUG, "no chunk shape of input variable " << var.getName() << ", using auto chunking");
+            policy = CHUNKING_AUTO;
+        }
+    }
+
+    if (policy == CHUNKING_AUTO) {
+        size_t chunkSize = 1;
+        for (size_t i = 0; i < rank; i++) {
+            const CDMDimension& dim = cdm.getDimension(shape[i]);
+            const unsigned int dimSize = dim.isUnlimited() ? 1 : dim.getLength();
+            std::map<std::string, unsigned int>::const_iterator defaultChunk = dimensionChunkSize.find(shape[i]);
+            if (defaultChunk != dimensionChunkSize.end()) {
+                unsigned int chunkDim = clamp(1u, dimSize, defaultChunk->second);
+                chunkSize *= chunkDim;
+                chunk[i] = chunkDim;
+            } else {
+                const size_t lastChunkSize = chunkSize;
+                chunkSize *= dimSize;
+                if (chunkSize < DEFAULT_CHUNK) {
+                    chunk[i] = dimSize;
+                } else {
+                    size_t thisChunk = 1;
+                    if (dimSize > 1 && (lastChunkSize < (MIN_CHUNK))) {
+                        // create a chunk-size which makes the total chunk ~= MIN_CHUNK
+                        thisChunk = clamp(1u, (unsigned int)floor(chunkSize / MIN_CHUNK), dimSize); // a number > 2^4 since chunkSize > DEFAULT_CHUNK
+                    }
+                    chunk[i] = thisChunk;
+                }
+            }
+        }
+    } else {
+        if (policy == CHUNKING_MAP) {
+            // complete field of the two fastest moving dimensions, reduce the second if too large
+            size_t chunkSize = 1;
+            for (size_t i = 0; i < std::min(rank, size_t(2)); i++) {
+                const CDMDimension& dim = cdm.getDimension(shape[i]);
+                if (!dim.isUnlimited()) {
+                    chunk[i] = clamp(size_t(1), std::max(size_t(1), MAX_CHUNK / chunkSize), std::max(size_t(1), dim.getLength()));
+                    chunkSize *= chunk[i];
+                }
+            }
+        } else if (policy == CHUNKING_TIMESERIES) {
+            // the complete time-axis, and square tiles of the two fastest moving dimensions to get ~MIN_CHUNK values per chunk
+            size_t timeIdx = rank - 1;
+            for (size_t i = 0; i < rank; i++) {
+                if (cdm.getDimension(shape[i]).isUnlimited())
+                    timeIdx = i;
+            }
+            const CDMDimension& timeDim = cdm.getDimension(shape[timeIdx]);
+            std::map<std::string, unsigned int>::const_iterator timeChunk = dimensionChunkSize.find(timeDim.getName());
+            if (timeChunk != dimensionChunkSize.end())
+                chunk[timeIdx] = std::max(1u, timeChunk->second);
+            else if (timeDim.isUnlimited())
+                chunk[timeIdx] = UNLIMITED_CHUNK;
+            else
+                chunk[timeIdx] = clamp(size_t(1), timeDim.getLength(), MIN_CHUNK);
+            const size_t tile = std::max(size_t(1), (size_t)floor(sqrt(double(MIN_CHUNK / chunk[timeIdx]))));
+            for (size_t i = 0; i < std::min(rank, size_t(2)); i++) {
+                const CDMDimension& dim = cdm.getDimension(shape[i]);
+                if (i != timeIdx && !dim.isUnlimited())
+                    chunk[i] = clamp(size_t(1), tile, std::max(size_t(1), dim.getLength()));
+            }
+        }
+        // explicit dimension chunk sizes
+        for (size_t i = 0; i < rank; i++) {
+            std::map<std::string, unsigned int>::const_iterator defaultChunk = dimensionChunkSize.find(shape[i]);
+            if (defaultChunk != dimensionChunkSize.end()) {
+                const CDMDimension& dim = cdm.getDimension(shape[i]);
+                const size_t dimSize = dim.isUnlimited() ? defaultChunk->second : dim.getLength();
+                chunk[i] = clamp(size_t(1), size_t(defaultChunk->second), std::max(size_t(1), dimSize));
+            }
+        }
+    }
+
+    // revert order, cdm requires fastest moving first, netcdf-c requires fastest moving last
+    return std::vector<size_t>(chunk.rbegin(), chunk.rend());
+}
+
 void NetCDF_CDMWriter::writeAttributes(const NcVarIdMap& ncVarMap)
 {
-    OmpScopedLock lock(Nc::getMutex());
+    OmpScopedLock lock(ncFile->mutex());
     for (const auto& nmsp_att : cdm.getAttributes()) {
         int varId;
         if (nmsp_att.first == CDM::globalAttributeNS()) {
@@ -576,10 +735,46 @@ DataPtr NetCDF_CDMWriter::convertData(const CDMVariable& var, DataPtr data)
     return data;
 }
 
+DataPtr NetCDF_CDMWriter::readVariableData(const CDMVariable& var, long long unLimDimPos, size_t fillSize)
+{
+    DataPtr data;
+    if (unLimDimPos < 0)
+        data = cdmReader->getData(var.getName());
+    else
+        data = cdmReader->getDataSlice(var.getName(), unLimDimPos);
+    if (data)
+        data = convertData(var, data);
+
+    if ((!data || data->size() == 0) && ncFile->format < 3) {
+        // need to write data with _FillValue,
+        // since we are using NC_NOFILL for nc3 format files = NC_FORMAT_CLASSIC(1) NC_FORMAT_64BIT(2))
+        data = createData(var.getDataType(), fillSize, cdm.getFillValue(var.getName()));
+    }
+    return data;
+}
+
+void NetCDF_CDMWriter::writeVariableData(const CDMVariable& var, int varId, DataPtr data, const std::vector<size_t>& start, const std::vector<size_t>& count)
+{
+    const int n_dims = start.size();
+    LOG4FIMEX(logger, Logger::DEBUG,
+              "writing variable " << var.getName() << " dimLen= " << n_dims << " start=" << join(start.begin(), start.end())
+                                  << " count=" << join(count.begin(), count.end()));
+    OmpScopedLock ncLock(ncFile->mutex());
+    try {
+        ncPutValues(data, ncFile->ncId, varId, cdmDataType2ncType(var.getDataType()), n_dims, start.empty() ? 0 : &start[0], count.empty() ? 0 : &count[0]);
+    } catch (std::exception& ex) {
+        OmpScopedUnlock ncUnlock(ncFile->mutex());
+        LOG4FIMEX(logger, Logger::ERROR, "exception " << ex.what() << " while writing variable " << var.getName());
+    } catch (...) {
+        OmpScopedUnlock ncUnlock(ncFile->mutex());
+        LOG4FIMEX(logger, Logger::ERROR, "unknown exception while writing variable " << var.getName());
+    }
+}
+
 void NetCDF_CDMWriter::writeData(const NcVarIdMap& ncVarMap)
 {
     const CDMDimension* unLimDim = cdm.getUnlimitedDim();
-    const int unLimDimId = ncDimId(ncFile->ncId, unLimDim);
+    const int unLimDimId = ncDimId(*ncFile, unLimDim);
     const long long maxUnLim = (unLimDim == 0) ? 0 : unLimDim->getLength();
     const CDM::VarVec& cdmVars = cdm.getVariables();
 
@@ -588,149 +783,208 @@ void NetCDF_CDMWriter::writeData(const NcVarIdMap& ncVarMap)
     const bool using_mpi = (mifi_mpi_initialized() && mifi_mpi_size > 1);
 #endif
 
+    // shape of the variables in the output file
+    std::vector<NcWriteVariable> writeVars(cdmVars.size());
+    {
+        OmpScopedLock ncLock(ncFile->mutex());
+        for (size_t vi = 0; vi < cdmVars.size(); ++vi) {
+            NcWriteVariable& wv = writeVars[vi];
+            wv.varId = ncVarMap.find(cdmVars[vi].getName())->second;
+#ifdef HAVE_MPI
+            if (using_mpi)
+                ncCheck(nc_var_par_access(ncFile->ncId, wv.varId, NC_INDEPENDENT));
+#endif
+            int n_dims;
+            ncCheck(nc_inq_varndims(ncFile->ncId, wv.varId, &n_dims));
+            std::vector<int> dim_ids(n_dims);
+            if (n_dims > 0)
+                ncCheck(nc_inq_vardimid(ncFile->ncId, wv.varId, &dim_ids[0]));
+            wv.start.resize(n_dims, 0);
+            wv.count.resize(n_dims);
+            wv.unLimDimIdx = -1;
+            for (int i = 0; i < n_dims; ++i) {
+                if (dim_ids[i] == unLimDimId)
+                    wv.unLimDimIdx = i;
+                ncCheck(nc_inq_dimlen(ncFile->ncId, dim_ids[i], &wv.count[i]));
+            }
+            OmpScopedUnlock ncUnlock(ncFile->mutex());
+            LOG4FIMEX(logger, Logger::DEBUG, "dimids of " << cdmVars[vi].getName() << ": " << join(dim_ids.begin(), dim_ids.end()));
+        }
+    }
+
     // read data along unLimDim and then variables, otherwise netcdf3 reading might get very slow
     // see http://www.unidata.ucar.edu/support/help/MailArchives/netcdf/msg10905.html
     // use unLimDimPos = -1 for variables without unlimited dimension
-
-    bool exceptions = false;
-#ifdef _OPENMP
-#if (defined(__GNUC__) && __GNUC__ >= 9) || defined(__clang__)
-#pragma omp parallel for default(none) shared(logger, cdmVars, ncVarMap, maxUnLim, unLimDimId, exceptions)
-#elif !defined(__INTEL_COMPILER) || (__INTEL_COMPILER >= 1800)
-#pragma omp parallel for default(none) shared(logger, cdmVars, ncVarMap, exceptions)
-#endif // __INTEL_COMPILER
-#endif // _OPENMP
+    std::vector<NcWriteTask> tasks;
     for (long long unLimDimPos = -1; unLimDimPos < maxUnLim; ++unLimDimPos) {
 #ifdef HAVE_MPI
-        if (using_mpi) {
-            if (sliceAlongUnlimited) { // MPI-slices along unlimited dimension
-                // only work on variables which belong to this mpi-process (modulo-base)
-                if ((unLimDimPos % mifi_mpi_size) != mifi_mpi_rank) {
-                    LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " skipping unLimDimPos " << unLimDimPos);
-                    continue;
-                } else {
-                    LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " working on unLimDimPos " << unLimDimPos);
-                }
+        if (using_mpi && sliceAlongUnlimited) { // MPI-slices along unlimited dimension
+            // only work on variables which belong to this mpi-process (modulo-base)
+            if ((unLimDimPos % mifi_mpi_size) != mifi_mpi_rank) {
+                LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " skipping unLimDimPos " << unLimDimPos);
+                continue;
             }
         }
 #endif
         for (size_t vi = 0; vi < cdmVars.size(); ++vi) {
-            if (exceptions)
-                continue;
-            const CDMVariable& cdmVar = cdmVars[vi];
-            const std::string& varName = cdmVar.getName();
-            const int varId = ncVarMap.find(varName)->second;
 #ifdef HAVE_MPI
-            if (using_mpi) {
-                NCMUTEX_LOCKED(ncCheck(nc_var_par_access(ncFile->ncId, varId, NC_INDEPENDENT)));
-                if (!sliceAlongUnlimited) { // MPI-slices along unlimited dimension
-                    // only work on variables which belong to this mpi-process (modulo-base along variable-ids)
-                    if ((vi % mifi_mpi_size) != mifi_mpi_rank) {
-                        LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " skipping variable " << varName << "'");
-                        continue;
-                    } else {
-                        LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " working on variable '" << varName << "'");
-                    }
-                }
+            if (using_mpi && !sliceAlongUnlimited) {
+                // only work on variables which belong to this mpi-process (modulo-base along variable-ids)
+                if ((vi % mifi_mpi_size) != mifi_mpi_rank)
+                    continue;
             }
 #endif
-            int n_dims;
-            std::unique_ptr<int[]> dim_ids;
-            std::unique_ptr<size_t[]> count;
-            std::unique_ptr<size_t[]> start;
-            int unLimDimIdx = -1;
-            {
-                OmpScopedLock ncLock(Nc::getMutex());
-
-                ncCheck(nc_inq_varndims(ncFile->ncId, varId, &n_dims));
-
-                dim_ids.reset(new int[n_dims]);
-                ncCheck(nc_inq_vardimid(ncFile->ncId, varId, dim_ids.get()));
+            const bool hasUnLim = cdm.hasUnlimitedDim(cdmVars[vi]);
+            const bool no_unlim = (unLimDimPos == -1 && writeVars[vi].unLimDimIdx == -1 && !hasUnLim);
+            const bool with_unlim = (unLimDimPos != -1 && writeVars[vi].unLimDimIdx >= 0 && hasUnLim);
+            if (no_unlim || with_unlim) {
+                NcWriteTask task;
+                task.vi = vi;
+                task.unLimDimPos = unLimDimPos;
+                tasks.push_back(task);
+            }
+        }
+    }
 
-                start.reset(new size_t[n_dims]);
-                count.reset(new size_t[n_dims]);
-                for (int i = 0; i < n_dims; ++i) {
-                    if (dim_ids[i] == unLimDimId)
-                        unLimDimIdx = i;
+    bool exceptions = false;
 
-                    size_t dim_len;
-                    ncCheck(nc_inq_dimlen(ncFile->ncId, dim_ids[i], &dim_len));
-                    start[i] = 0;
-                    count[i] = dim_len;
-                }
+    // read and convert the data of a task, returns false on error
+    auto readTask = [&](size_t ti, DataPtr& data) -> bool {
+        const NcWriteTask& task = tasks[ti];
+        const CDMVariable& cdmVar = cdmVars[task.vi];
+        const NcWriteVariable& wv = writeVars[task.vi];
+        std::vector<size_t> count = wv.count;
+        if (wv.unLimDimIdx >= 0)
+            count[wv.unLimDimIdx] = 1; // just one slice
+        const size_t fillSize = count.empty() ? 1 : product(count);
+        try {
+            data = readVariableData(cdmVar, task.unLimDimPos, fillSize);
+            return true;
+        } catch (std::exception& ex) {
+            std::ostringstream msg;
+            msg << "exception while reading variable '" << cdmVar.getName() << "'";
+            if (task.unLimDimPos >= 0)
+                msg << " at unlimited dim position " << task.unLimDimPos;
+            msg << "; will stop writing data";
+            msg << "; message: " << ex.what();
+            LOG4FIMEX(logger, Logger::ERROR, msg.str());
+        } catch (...) {
+            std::ostringstream msg;
+            msg << "exception while reading variable '" << cdmVar.getName() << "'";
+            if (task.unLimDimPos >= 0)
+                msg << " at unlimited dim position " << task.unLimDimPos;
+            msg << "; will stop writing data";
+            LOG4FIMEX(logger, Logger::ERROR, msg.str());
+        }
+        return false;
+    };
+
+    // write the data of a task and sync after the last variable of each unlimited step
+    auto writeTask = [&](size_t ti, DataPtr data) {
+        const NcWriteTask& task = tasks[ti];
+        const NcWriteVariable& wv = writeVars[task.vi];
+        if (data && data->size() > 0) {
+            std::vector<size_t> start = wv.start, count = wv.count;
+            if (task.unLimDimPos >= 0) {
+                count[wv.unLimDimIdx] = 1;
+                start[wv.unLimDimIdx] = task.unLimDimPos;
             }
-            LOG4FIMEX(logger, Logger::DEBUG, "dimids of " << varName << ": " << join(&dim_ids[0], &dim_ids[0] + n_dims));
+            writeVariableData(cdmVars[task.vi], wv.varId, data, start, count);
+        }
+#ifndef HAVE_MPI
+        if (task.unLimDimPos >= 0 && (ti + 1 == tasks.size() || tasks[ti + 1].unLimDimPos != task.unLimDimPos)) {
+            NCFILE_LOCKED(*ncFile, ncCheck(nc_sync(ncFile->ncId))); // sync every 'time/unlimited' step (does not work with MPI)
+        }
+#endif
+    };
 
-            const bool no_unlim = (unLimDimPos == -1 && unLimDimIdx == -1 && !cdm.hasUnlimitedDim(cdmVar));
-            const bool with_unlim = (unLimDimPos != -1 && unLimDimIdx >= 0 && cdm.hasUnlimitedDim(cdmVar));
+    auto writeSequential = [&]() {
+        for (size_t ti = 0; ti < tasks.size(); ++ti) {
             DataPtr data;
-            try {
-                if (no_unlim) {
-                    data = cdmReader->getData(varName);
-                } else if (with_unlim) {
-                    data = cdmReader->getDataSlice(varName, unLimDimPos);
-                } else {
-                    continue; // FIXME
-                }
-                if (data)
-                    data = convertData(cdmVar, data);
-            } catch (std::exception& ex) {
-                std::ostringstream msg;
-                msg << "exception while reading variable '" << varName << "'";
-                if (!no_unlim)
-                    msg << " at unlimited dim position " << unLimDimPos;
-                msg << "; will stop writing data";
-                msg << "; message: " << ex.what();
-                LOG4FIMEX(logger, Logger::ERROR, msg.str());
-                data = nullptr;
-                exceptions = true;
-            } catch (...) {
-                std::ostringstream msg;
-                msg << "exception while reading variable '" << varName << "'";
-                if (!no_unlim)
-                    msg << " at unlimited dim position " << unLimDimPos;
-                msg << "; will stop writing data";
-                LOG4FIMEX(logger, Logger::ERROR, msg.str());
-                data = nullptr;
+            if (!readTask(ti, data)) {
                 exceptions = true;
+                break;
             }
-            if (exceptions)
-                continue;
+            writeTask(ti, data);
+        }
+    };
 
-            if ((!data || data->size() == 0) && ncFile->format < 3) {
-                // need to write data with _FillValue,
-                // since we are using NC_NOFILL for nc3 format files = NC_FORMAT_CLASSIC(1) NC_FORMAT_64BIT(2))
-                if (with_unlim)
-                    count[unLimDimIdx] = 1; // just one slice
-                size_t size = (n_dims > 0) ? product(count.get(), n_dims) : 1;
-                data = createData(cdmVar.getDataType(), size, cdm.getFillValue(varName));
-            }
-            if (data && data->size() > 0) {
-                if (with_unlim) {
-                    count[unLimDimIdx] = 1;
-                    start[unLimDimIdx] = unLimDimPos;
+#ifdef _OPENMP
+    if (tasks.size() > 1 && omp_get_max_threads() > 1) {
+        // pipeline: the writer (thread 0) writes the slices in task order, while workers read and convert
+        // the following slices; workers stop taking tasks while more than maxQueued bytes wait for writing,
+        // but always take a task when the queue is empty, so slices larger than maxQueued are written, too
+        const size_t maxQueued = writeQueueSize();
+        std::vector<DataPtr> queue(tasks.size());
+        std::vector<bool> ready(tasks.size(), false);
+        size_t queuedBytes = 0;
+        size_t nextTask = 0;
+        std::mutex queueMutex;
+        // signalled when a worker has put a slice into the queue, or failed
+        std::condition_variable sliceReady;
+        // signalled when the writer has taken a slice from the queue, or a worker failed
+        std::condition_variable queueSpace;
+#pragma omp parallel
+        {
+            if (omp_get_num_threads() == 1) {
+                // e.g. nested parallelism disabled
+                writeSequential();
+            } else if (omp_get_thread_num() == 0) {
+                // writer
+                for (size_t ti = 0; ti < tasks.size(); ++ti) {
+                    DataPtr data;
+                    {
+                        std::unique_lock<std::mutex> lock(queueMutex);
+                        sliceReady.wait(lock, [&] { return ready[ti] || exceptions; });
+                        if (!ready[ti])
+                            break;
+                        std::swap(data, queue[ti]);
+                        if (data)
+                            queuedBytes -= data->size() * data->bytes_for_one();
+                    }
+                    queueSpace.notify_all();
+                    writeTask(ti, data);
                 }
-                LOG4FIMEX(logger, Logger::DEBUG,
-                          "writing variable " << varName << " dimLen= " << n_dims << " start=" << join(&start[0], &start[0] + n_dims)
-                                              << " count=" << join(&count[0], &count[0] + n_dims));
-                OmpScopedLock ncLock(Nc::getMutex());
-                try {
-                    ncPutValues(data, ncFile->ncId, varId, cdmDataType2ncType(cdmVar.getDataType()), n_dims, start.get(), count.get());
-                } catch (std::exception& ex) {
-                    OmpScopedUnlock ncUnlock(Nc::getMutex());
-                    LOG4FIMEX(logger, Logger::ERROR, "exception " << ex.what() << " while writing variable " << varName);
-                } catch (...) {
-                    OmpScopedUnlock ncUnlock(Nc::getMutex());
-                    LOG4FIMEX(logger, Logger::ERROR, "unknown exception while writing variable " << varName);
+            } else {
+                // worker
+                while (true) {
+                    size_t ti;
+                    {
+                        std::unique_lock<std::mutex> lock(queueMutex);
+                        queueSpace.wait(lock, [&] { return exceptions || nextTask >= tasks.size() || queuedBytes == 0 || queuedBytes < maxQueued; });
+                        if (exceptions || nextTask >= tasks.size())
+                            break;
+                        ti = nextTask++;
+                    }
+
+                    DataPtr data;
+                    const bool ok = readTask(ti, data);
+                    {
+                        std::lock_guard<std::mutex> lock(queueMutex);
+                        if (ok) {
+                            if (data)
+                                queuedBytes += data->size() * data->bytes_for_one();
+                            queue[ti] = data;
+                            ready[ti] = true;
+                        } else {
+                            exceptions = true;
+                        }
+                    }
+                    sliceReady.notify_all();
+                    if (!ok) {
+                        queueSpace.notify_all();
+                        break;
+                    }
                 }
             }
         }
-#ifndef HAVE_MPI
-        if (unLimDimPos >= 0) {
-            NCMUTEX_LOCKED(ncCheck(nc_sync(ncFile->ncId))); // sync every 'time/unlimited' step (does not work with MPI)
-        }
-#endif
+    } else {
+        writeSequential();
     }
+#else
+    writeSequential();
+#endif
+
     if (exceptions)
         throw CDMException("netcdf writing failed with ERRORs");
 }
@@ -741,7 +995,7 @@ void NetCDF_CDMWriter::init()
     const NcDimIdMap ncDimIdMap = defineDimensions();
     const NcVarIdMap ncVarIdMap = defineVariables(ncDimIdMap);
     writeAttributes(ncVarIdMap);
-    NCMUTEX_LOCKED(ncCheck(nc_enddef(ncFile->ncId)));
+    NCFILE_LOCKED(*ncFile, ncCheck(nc_enddef(ncFile->ncId)));
 
     // write data
     writeData(ncVarIdMap);
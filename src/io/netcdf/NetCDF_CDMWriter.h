@@ -31,6 +31,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace MetNoFimex {
 
@@ -44,6 +45,23 @@ class NetCDF_CDMWriter : public CDMWriter
     typedef std::map<std::string, int> NcVarIdMap;
 
 public:
+    /**
+     * Strategies to choose the chunk shape of netcdf-4 variables, set in the
+     * config with <default chunking="..." /> or <variable name="..." chunking="..." />.
+     * Dimensions with a chunkSize in the config always use that size.
+     */
+    enum ChunkingPolicy {
+        /// "auto": contiguous in the fastest moving dimensions, up to about 2M values
+        CHUNKING_AUTO,
+        /// "source": the chunk shape of the input variable, if known, otherwise CHUNKING_AUTO
+        CHUNKING_SOURCE,
+        /// "map": one complete field of the two fastest moving dimensions (usually x and y) per chunk
+        CHUNKING_MAP,
+        /// "timeseries": long chunks of the unlimited (or slowest) dimension and small tiles of the two fastest moving dimensions;
+        /// unlimited dimensions use 128 steps per chunk unless the dimension has a chunkSize
+        CHUNKING_TIMESERIES
+    };
+
     /**
      * @param cdmReader dataSource
      * @param outputFile file-name to write to
@@ -86,7 +104,20 @@ private:
     void writeAttributes(const NcVarIdMap& varMap);
     void writeData(const NcVarIdMap& varMap);
 
+    /**
+     * chunk shape of a variable, in netcdf order (fastest moving last)
+     * @param var the variable, in the output cdm
+     */
+    std::vector<size_t> chunkShape(const CDMVariable& var) const;
+
     DataPtr convertData(const CDMVariable& var, DataPtr data);
+    /**
+     * read and convert the data of a variable, or of one slice of the unlimited dimension
+     * @param unLimDimPos position on the unlimited dimension, or -1 to read the complete variable
+     * @param fillSize size of the data written instead of missing data to nc3 files
+     */
+    DataPtr readVariableData(const CDMVariable& var, long long unLimDimPos, size_t fillSize);
+    void writeVariableData(const CDMVariable& var, int varId, DataPtr data, const std::vector<size_t>& start, const std::vector<size_t>& count);
 
 private:
     CDM cdm; /* local storage of the changed cdm-outline, except variable name changes */
@@ -95,6 +126,10 @@ private:
     std::map<std::string, CDMDataType> variableTypeChanges;
     std::map<std::string, unsigned int> variableCompression;
     std::map<std::string, unsigned int> dimensionChunkSize;
+    ChunkingPolicy defaultChunking;
+    std::map<std::string, ChunkingPolicy> variableChunking;
+    /// explicit chunk shapes from the config, in netcdf order
+    std::map<std::string, std::vector<size_t>> variableChunkShape;
     std::map<std::string, std::string> dimensionNameChanges;
 };
 
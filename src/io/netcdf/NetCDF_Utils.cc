@@ -106,12 +106,17 @@ Nc::~Nc()
 
 void Nc::reopen_if_forked()
 {
+    // pid and ncId may be used concurrently by other threads reading this file
+    OmpScopedLock lock(mutex());
     pid_t this_pid = getpid();
     if (pid != this_pid) {
         pid = this_pid;
         LOG4FIMEX(logger, Logger::DEBUG, "reopening file " << filename << " after fork to " << pid << " '" << ncId << "' ");
 
-        OmpScopedLock lock(ncMutex);
+#ifdef HAVE_NETCDF_THREADSAFE
+        // mutex() is the per-file lock, opening / closing needs the global one
+        OmpScopedLock openLock(ncMutex);
+#endif
         // reopen file so file descriptions (e.g. offset) are not shared
         ncCheck(nc_close(ncId), "closing parent filehandle");
         ncCheck(nc_open(filename.c_str(), NC_NOWRITE, &ncId), "re-opening '" + filename + "' after fork");
@@ -123,6 +128,75 @@ OmpMutex& Nc::getMutex()
     return ncMutex;
 }
 
+OmpMutex& Nc::mutex()
+{
+#ifdef HAVE_NETCDF_THREADSAFE
+    return mutex_;
+#else
+    return ncMutex;
+#endif
+}
+
+NcReadPool::Handle::Handle(NcReadPool& pool)
+    : pool_(pool)
+    , nc_(pool.acquire())
+{
+}
+
+NcReadPool::Handle::~Handle()
+{
+    if (nc_)
+        pool_.release(std::move(nc_));
+}
+
+NcReadPool::NcReadPool(const std::string& filename, size_t maxHandles)
+    : filename_(filename)
+    , maxHandles_(maxHandles)
+    , openHandles_(0)
+{
+}
+
+NcReadPool::~NcReadPool()
+{
+    LOG4FIMEX(logger, Logger::DEBUG, "closing " << free_.size() << " read handles of '" << filename_ << "'");
+}
+
+std::unique_ptr<Nc> NcReadPool::acquire()
+{
+    {
+        OmpScopedLock lock(mutex_);
+        if (!free_.empty()) {
+            std::unique_ptr<Nc> nc = std::move(free_.back());
+            free_.pop_back();
+            return nc;
+        }
+        if (openHandles_ >= maxHandles_)
+            return std::unique_ptr<Nc>();
+        openHandles_ += 1;
+    }
+
+    std::unique_ptr<Nc> nc(new Nc());
+    nc->filename = filename_;
+    try {
+        OmpScopedLock lock(ncMutex);
+        ncCheck(nc_open(nc->filename.c_str(), NC_NOWRITE, &nc->ncId), "opening read handle " + nc->filename);
+        nc->isOpen = true;
+        ncCheck(nc_inq_format(nc->ncId, &nc->format));
+    } catch (...) {
+        OmpScopedLock lock(mutex_);
+        openHandles_ -= 1;
+        throw;
+    }
+    LOG4FIMEX(logger, Logger::DEBUG, "opened read handle " << openHandles_ << " of '" << filename_ << "'");
+    return nc;
+}
+
+void NcReadPool::release(std::unique_ptr<Nc> nc)
+{
+    OmpScopedLock lock(mutex_);
+    free_.push_back(std::move(nc));
+}
+
 nc_type cdmDataType2ncType(CDMDataType dt)
 {
     switch (dt) {
@@ -29,6 +29,8 @@
 #include "fimex/MutexLock.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "fimex_netcdf_config.h"
 #ifndef HAVE_NETCDF_HDF5_LIB
@@ -53,6 +55,13 @@ extern "C" {
         x;                                                                                                                                                     \
     } while (0)
 
+/// like NCMUTEX_LOCKED, but only locking the file nc if the netcdf library is thread-safe
+#define NCFILE_LOCKED(nc, x)                                                                                                                                   \
+    do {                                                                                                                                                       \
+        OmpScopedLock lock((nc).mutex());                                                                                                                      \
+        x;                                                                                                                                                     \
+    } while (0)
+
 namespace MetNoFimex {
 
 /// storage class for netcdf-file pointer
@@ -61,14 +70,77 @@ class Nc
 public:
     Nc();
     ~Nc();
-    static OmpMutex& getMutex(); // lock against common reading/writing in nc4
+    static OmpMutex& getMutex(); // lock against common reading/writing in nc4, and for opening / closing files
+    /**
+     * Lock for reading / writing this file. This is the global getMutex() unless
+     * the netcdf and hdf5 libraries are thread-safe (HAVE_NETCDF_THREADSAFE).
+     */
+    OmpMutex& mutex();
     std::string filename;
     int ncId;
     int format;
     bool isOpen;
     pid_t pid;
+    /// Reopen the file if the process forked since opening it; locks mutex(), so do not call while holding it.
     void reopen_if_forked();
     bool supports_nc_string() const { return format == NC_FORMAT_NETCDF4; }
+
+private:
+    Nc(const Nc&) = delete;
+    Nc& operator=(const Nc&) = delete;
+
+#ifdef HAVE_NETCDF_THREADSAFE
+    OmpMutex mutex_;
+#endif
+};
+
+/**
+ * Additional read-only handles of a netcdf-file, so that several threads can
+ * read the same file concurrently. Handles are opened on demand up to a
+ * maximum and reused afterwards.
+ *
+ * The pool is only useful if the netcdf library is thread-safe, otherwise
+ * all handles share the global mutex.
+ */
+class NcReadPool
+{
+public:
+    /// a handle of the pool, returned to the pool on destruction
+    class Handle
+    {
+    public:
+        explicit Handle(NcReadPool& pool);
+        ~Handle();
+        /// the netcdf-file, null if all handles are in use
+        Nc* get() const { return nc_.get(); }
+
+    private:
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        NcReadPool& pool_;
+        std::unique_ptr<Nc> nc_;
+    };
+
+    /**
+     * @param filename the file to open read-only
+     * @param maxHandles maximum number of handles opened in addition to the main handle
+     */
+    NcReadPool(const std::string& filename, size_t maxHandles);
+    ~NcReadPool();
+
+private:
+    std::unique_ptr<Nc> acquire();
+    void release(std::unique_ptr<Nc> nc);
+
+    NcReadPool(const NcReadPool&) = delete;
+    NcReadPool& operator=(const NcReadPool&) = delete;
+
+    std::string filename_;
+    size_t maxHandles_;
+    size_t openHandles_;
+    std::vector<std::unique_ptr<Nc>> free_;
+    OmpMutex mutex_;
 };
 
 /**
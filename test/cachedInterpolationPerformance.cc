@@ -0,0 +1,105 @@
+/*
+ * cachedInterpolationPerformance.cc
+ *
+ * Compare the per-point mifi_get_values_bilinear_f/mifi_get_values_bicubic_f
+ * functions with the precomputed stencils of CachedInterpolation, e.g. built with
+ *   g++ -O2 -fopenmp -Iinclude test/cachedInterpolationPerformance.cc -Lbuild/src -lfimex
+ *
+ * usage: cachedInterpolationPerformance [outX outY inZ]
+ */
+
+#include "fimex/CachedInterpolation.h"
+#include "fimex/interpolation.h"
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+using namespace std;
+using namespace MetNoFimex;
+
+namespace {
+
+double now()
+{
+    timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + (tv.tv_usec / 1000000.);
+}
+
+void compare(const string& name, int method, size_t outX, size_t outY, size_t inZ)
+{
+    const size_t inX = outX / 2 + 10, inY = outY / 2 + 10;
+    const size_t outLayerSize = outX * outY, inLayerSize = inX * inY;
+
+    // rotated and scaled grid, partly outside of the input domain
+    auto pointsOnXAxis = make_shared_array<double>(outLayerSize);
+    auto pointsOnYAxis = make_shared_array<double>(outLayerSize);
+    for (size_t y = 0; y < outY; y++) {
+        for (size_t x = 0; x < outX; x++) {
+            pointsOnXAxis[y * outX + x] = -3 + 0.49 * x + 0.07 * y;
+            pointsOnYAxis[y * outX + x] = -2 + 0.51 * y - 0.05 * x;
+        }
+    }
+    auto inData = make_shared_array<float>(inLayerSize * inZ);
+    for (size_t i = 0; i < inLayerSize * inZ; i++)
+        inData[i] = (i % 101 == 0) ? MIFI_UNDEFINED_F : std::sin(0.001 * i);
+
+    // the previous path of CachedInterpolation::interpolateValues
+    const double startFunc = now();
+    auto outFunc = make_shared_array<float>(outLayerSize * inZ);
+    vector<float> zValues(inZ);
+    for (size_t xy = 0; xy < outLayerSize; ++xy) {
+        if (method == MIFI_INTERPOL_BILINEAR)
+            mifi_get_values_bilinear_f(inData.get(), &zValues[0], pointsOnXAxis[xy], pointsOnYAxis[xy], inX, inY, inZ);
+        else
+            mifi_get_values_bicubic_f(inData.get(), &zValues[0], pointsOnXAxis[xy], pointsOnYAxis[xy], inX, inY, inZ);
+        for (size_t z = 0; z < inZ; ++z)
+            outFunc[z * outLayerSize + xy] = zValues[z];
+    }
+    const double tFunc = now() - startFunc;
+
+    // copy the axes, CachedInterpolation modifies them when reducing the domain
+    auto cachedXAxis = make_shared_array<double>(outLayerSize);
+    auto cachedYAxis = make_shared_array<double>(outLayerSize);
+    std::copy(pointsOnXAxis.get(), pointsOnXAxis.get() + outLayerSize, cachedXAxis.get());
+    std::copy(pointsOnYAxis.get(), pointsOnYAxis.get() + outLayerSize, cachedYAxis.get());
+    double start = now();
+    CachedInterpolation ci("x", "y", method, cachedXAxis, cachedYAxis, inX, inY, outX, outY);
+    const double tStencils = now() - start;
+
+    start = now();
+    size_t newSize = 0;
+    auto outCached = ci.interpolateValues(inData, inLayerSize * inZ, newSize);
+    const double tCached = now() - start;
+
+    size_t differ = 0;
+    for (size_t i = 0; i < newSize; i++) {
+        const bool bothNan = std::isnan(outFunc[i]) && std::isnan(outCached[i]);
+        if (!bothNan && outFunc[i] != outCached[i])
+            differ++;
+    }
+    cout << name << ": per-point " << tFunc * 1000 << "ms stencils " << tStencils * 1000 << "ms cached " << tCached * 1000 << "ms speedup "
+         << tFunc / tCached << " differences " << differ << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t outX = 1000, outY = 1000, inZ = 80;
+    if (argc > 3) {
+        stringstream ss;
+        ss << argv[1] << " " << argv[2] << " " << argv[3];
+        ss >> outX >> outY >> inZ;
+    }
+    cout << outX << "x" << outY << "x" << inZ << endl;
+    compare("bilinear", MIFI_INTERPOL_BILINEAR, outX, outY, inZ);
+    compare("bicubic", MIFI_INTERPOL_BICUBIC, outX, outY, inZ);
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * scaleValuePerformance.cc
+ *
+ * Compare std::transform with ScaleValue and the vectorized scaleValues kernels
+ * used by Data::convertDataType, e.g. built with
+ *   g++ -O2 -fopenmp -Iinclude test/scaleValuePerformance.cc -Lbuild/src -lfimex
+ *
+ * usage: scaleValuePerformance [size]
+ */
+
+#include "fimex/DataUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+using namespace std;
+using namespace MetNoFimex;
+
+namespace {
+
+double now()
+{
+    timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + (tv.tv_usec / 1000000.);
+}
+
+template <typename IN, typename OUT>
+void compare(const string& name, size_t size, double oldFill, double oldScale, double oldOffset, double newFill, double newScale, double newOffset)
+{
+    vector<IN> in(size);
+    for (size_t i = 0; i < size; i++)
+        in[i] = (i % 97 == 0) ? static_cast<IN>(oldFill) : static_cast<IN>(static_cast<int>(i % 2000) - 1000);
+    vector<OUT> outTransform(size), outKernel(size);
+    const ScaleValue<IN, OUT> sv(oldFill, oldScale, oldOffset, newFill, newScale, newOffset);
+
+    const int repeat = 20;
+    double start = now();
+    for (int r = 0; r < repeat; r++)
+        std::transform(&in[0], &in[0] + size, &outTransform[0], sv);
+    const double tTransform = (now() - start) / repeat;
+
+    start = now();
+    for (int r = 0; r < repeat; r++)
+        scaleValues(&in[0], &in[0] + size, &outKernel[0], sv);
+    const double tKernel = (now() - start) / repeat;
+
+    size_t differ = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (outTransform[i] != outKernel[i])
+            differ++;
+    }
+    cout << name << ": transform " << tTransform * 1000 << "ms kernel " << tKernel * 1000 << "ms speedup " << tTransform / tKernel << " differences "
+         << differ << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t size = 10 * 1000 * 1000;
+    if (argc > 1) {
+        stringstream ss;
+        ss << argv[1];
+        ss >> size;
+    }
+    cout << size << endl;
+    compare<short, float>("short->float", size, -32767, 0.01, 273.15, 1e30, 1, 0);
+    compare<short, double>("short->double", size, -32767, 0.01, 273.15, 1e30, 1, 0);
+    compare<float, double>("float->double", size, -32767, 1, 0, 1e30, 0.5, 3);
+    compare<double, float>("double->float", size, -32767, 1, 0, 1e30, 0.5, 3);
+    compare<float, short>("float->short", size, -32767, 1, 0, -32767, 0.1, 0);
+    return 0;
+}
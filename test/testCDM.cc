@@ -25,6 +25,7 @@
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
 #include "fimex/Data.h"
+#include "fimex/Type2String.h"
 #include "fimex/coordSys/CoordinateSystem.h"
 
 using namespace std;
@@ -55,6 +56,49 @@ TEST4FIMEX_TEST_CASE(test_variable)
     cdm.removeVariable(newName);
 }
 
+TEST4FIMEX_TEST_CASE(test_variable_lookup)
+{
+    CDM cdm;
+    const size_t n = 100;
+    for (size_t i = 0; i < n; ++i) {
+        const string name = "v" + type2string(i);
+        cdm.addDimension(CDMDimension("d" + type2string(i), i + 1));
+        cdm.addVariable(CDMVariable(name, CDM_INT, vector<string>(1, "d" + type2string(i))));
+    }
+
+    // removing from the middle keeps the others reachable and in order
+    cdm.removeVariable("v10");
+    TEST4FIMEX_CHECK(cdm.removeDimension("d10"));
+    TEST4FIMEX_CHECK(!cdm.hasVariable("v10"));
+    TEST4FIMEX_CHECK(!cdm.hasDimension("d10"));
+    TEST4FIMEX_REQUIRE_EQ(cdm.getVariables().size(), n - 1);
+    TEST4FIMEX_CHECK_EQ(cdm.getVariables()[10].getName(), "v11");
+    TEST4FIMEX_CHECK_EQ(cdm.getDimensions()[10].getName(), "d11");
+    for (size_t i = 0; i < n; ++i) {
+        if (i == 10)
+            continue;
+        TEST4FIMEX_CHECK_EQ(cdm.getVariable("v" + type2string(i)).getName(), "v" + type2string(i));
+        TEST4FIMEX_CHECK_EQ(cdm.getDimension("d" + type2string(i)).getLength(), i + 1);
+    }
+
+    // renaming
+    TEST4FIMEX_CHECK(cdm.renameVariable("v20", "w20"));
+    TEST4FIMEX_CHECK(!cdm.hasVariable("v20"));
+    TEST4FIMEX_CHECK_EQ(cdm.getVariable("w20").getName(), "w20");
+    TEST4FIMEX_CHECK_EQ(cdm.getVariables()[19].getName(), "w20");
+    TEST4FIMEX_CHECK(cdm.renameDimension("d30", "e30"));
+    TEST4FIMEX_CHECK(!cdm.hasDimension("d30"));
+    TEST4FIMEX_CHECK_EQ(cdm.getDimension("e30").getLength(), 31);
+    TEST4FIMEX_CHECK_EQ(cdm.getVariable("v30").getShape()[0], "e30");
+
+    // copies have their own index
+    CDM copy = cdm;
+    copy.removeVariable("v0");
+    TEST4FIMEX_CHECK(cdm.hasVariable("v0"));
+    TEST4FIMEX_CHECK(!copy.hasVariable("v0"));
+    TEST4FIMEX_CHECK_EQ(copy.getVariable("v99").getName(), "v99");
+}
+
 TEST4FIMEX_TEST_CASE(test_attribute_types)
 {
     TEST4FIMEX_CHECK_EQ(CDM_FLOAT, CDMAttribute("att1", 1.0f).getDataType());
@@ -27,6 +27,7 @@
 #include "testinghelpers.h"
 
 #include "fimex/CDM.h"
+#include "fimex/CDMExtractor.h"
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMReaderUtils.h"
 #include "fimex/Data.h"
@@ -211,6 +212,66 @@ TEST4FIMEX_TEST_CASE(test_coordSys)
     TEST4FIMEX_CHECK_EQ(refTime, FimexTime(2000, 1, 1, 10, 0, 0));
 }
 
+TEST4FIMEX_TEST_CASE(test_coordSys_cached)
+{
+    const string fileName = pathTest("coordTest.nc");
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", fileName);
+
+    const CoordinateSystem_cp_v coordSys = listCoordinateSystems(reader);
+    TEST4FIMEX_REQUIRE_EQ(coordSys.size(), 3);
+    const unsigned long version = reader->getCDM().getStructureVersion();
+
+    // unchanged cdm, same coordinate systems
+    const CoordinateSystem_cp_v cached = listCoordinateSystems(reader);
+    TEST4FIMEX_REQUIRE_EQ(cached.size(), coordSys.size());
+    for (size_t i = 0; i < coordSys.size(); ++i)
+        TEST4FIMEX_CHECK(cached[i] == coordSys[i]);
+    TEST4FIMEX_CHECK_EQ(reader->getCDM().getStructureVersion(), version);
+
+    // a copy of the cdm, here in an extractor, does not share the cache
+    CDMReader_p copy = std::make_shared<CDMExtractor>(reader);
+    TEST4FIMEX_CHECK_EQ(copy->getCDM().getStructureVersion(), reader->getCDM().getStructureVersion());
+    const CoordinateSystem_cp_v copyCoordSys = listCoordinateSystems(copy);
+    TEST4FIMEX_REQUIRE_EQ(copyCoordSys.size(), coordSys.size());
+    TEST4FIMEX_CHECK(copyCoordSys[0] != coordSys[0]);
+    TEST4FIMEX_CHECK(listCoordinateSystems(reader)[0] == coordSys[0]);
+
+    // structural change
+    CDM& cdm = reader->getInternalCDM();
+    cdm.removeVariable("altitude");
+    TEST4FIMEX_CHECK(cdm.getStructureVersion() != version);
+    const CoordinateSystem_cp_v changed = listCoordinateSystems(reader);
+    TEST4FIMEX_REQUIRE(!changed.empty());
+    TEST4FIMEX_CHECK(changed[0] != coordSys[0]);
+    TEST4FIMEX_CHECK(!findCompleteCoordinateSystemFor(changed, "altitude"));
+    TEST4FIMEX_CHECK(listCoordinateSystems(reader)[0] == changed[0]);
+
+    // dimension changed through reference
+    cdm.getDimension("x").setLength(cdm.getDimension("x").getLength() + 1);
+    TEST4FIMEX_CHECK(listCoordinateSystems(reader)[0] != changed[0]);
+}
+
+TEST4FIMEX_TEST_CASE(test_coordSys_cached_attribute)
+{
+    const string fileName = pathTest("coordTest.nc");
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", fileName);
+
+    CoordinateSystem_cp cs = findCompleteCoordinateSystemFor(listCoordinateSystems(reader), "air_temperature");
+    TEST4FIMEX_REQUIRE(cs);
+    TEST4FIMEX_CHECK(cs->hasProjection());
+
+    // grid_mapping changed through the non-const attribute reference
+    CDM& cdm = reader->getInternalCDM();
+    const unsigned long version = cdm.getStructureVersion();
+    for (const std::string& varName : cdm.findVariables("grid_mapping", "projection_1"))
+        cdm.getAttribute(varName, "grid_mapping") = CDMAttribute("grid_mapping", "no_such_projection");
+    TEST4FIMEX_CHECK(cdm.getStructureVersion() != version);
+
+    cs = findCompleteCoordinateSystemFor(listCoordinateSystems(reader), "air_temperature");
+    TEST4FIMEX_REQUIRE(cs);
+    TEST4FIMEX_CHECK(!cs->hasProjection());
+}
+
 TEST4FIMEX_TEST_CASE(test_vTrans)
 {
     const string fileName = pathTest("verticalOceanSG2.nc");
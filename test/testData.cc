@@ -23,8 +23,10 @@
 
 #include "testinghelpers.h"
 #include "fimex/Data.h"
+#include "fimex/DataUtils.h"
 #include "../src/DataImpl.h"
 #include "fimex/IndexedData.h"
+#include "fimex/mifi_constants.h"
 
 using namespace std;
 using namespace MetNoFimex;
@@ -233,3 +235,51 @@ TEST4FIMEX_TEST_CASE(test_rounding)
         TEST4FIMEX_CHECK_MESSAGE(asI[j] == expect, "int:   i=" << i << " have == " << asI[j] << " expected " << expect);
     }
 }
+
+TEST4FIMEX_TEST_CASE(test_convert_kernels)
+{
+    // covers the vectorized kernels of convertDataType, compare with the ScaleValue functor
+    const size_t n = 1001;
+    DataPtr dataFloat(new DataImpl<float>(n));
+    for (size_t i = 0; i < n; i++)
+        dataFloat->setValue(i, (static_cast<int>(i) - 500) * 0.25);
+    dataFloat->setValue(3, -999);
+    dataFloat->setValue(7, MIFI_UNDEFINED_F);
+
+    DataPtr dataShort = dataFloat->convertDataType(-999, 1, 0, CDM_SHORT, -32767, 0.5, 0);
+    auto asS = dataShort->asShort();
+    auto inF = dataFloat->asFloat();
+    const ScaleValue<float, short> svShort(-999, 1, 0, -32767, 0.5, 0);
+    for (size_t i = 0; i < n; i++)
+        TEST4FIMEX_CHECK_EQ(svShort(inF[i]), asS[i]);
+    TEST4FIMEX_CHECK_EQ(-32767, asS[3]);
+    TEST4FIMEX_CHECK_EQ(-32767, asS[7]);
+    TEST4FIMEX_CHECK_EQ(-1, asS[499]);  // -0.25 / 0.5 = -0.5, rounded away from zero
+    TEST4FIMEX_CHECK_EQ(1, asS[501]);   // 0.5
+    TEST4FIMEX_CHECK_EQ(-3, asS[495]);  // -2.5
+
+    // values outside the short range saturate
+    DataPtr dataWide(new DataImpl<float>(4));
+    dataWide->setValue(0, 40000);
+    dataWide->setValue(1, -40000);
+    dataWide->setValue(2, 1e20);
+    dataWide->setValue(3, -70000);
+    auto asWide = dataWide->convertDataType(-999, 1, 0, CDM_SHORT, -32767, 1, 0)->asShort();
+    TEST4FIMEX_CHECK_EQ(32767, asWide[0]);
+    TEST4FIMEX_CHECK_EQ(-32768, asWide[1]);
+    TEST4FIMEX_CHECK_EQ(32767, asWide[2]);
+    TEST4FIMEX_CHECK_EQ(-32768, asWide[3]);
+
+    DataPtr dataDouble = dataShort->convertDataType(-32767, 0.5, 0, CDM_DOUBLE, -1e30, 1, 10);
+    auto asD = dataDouble->asDouble();
+    TEST4FIMEX_CHECK_EQ(-1e30, asD[3]);
+    TEST4FIMEX_CHECK_EQ(0.5 * 1 - 10, asD[501]);
+    DataPtr dataFloat2 = dataDouble->convertDataType(-1e30, 1, 10, CDM_FLOAT, -2, 1, 0);
+    auto asF = dataFloat2->asFloat();
+    for (size_t i = 0; i < n; i++) {
+        if (i == 3 || i == 7)
+            TEST4FIMEX_CHECK_EQ(-2, asF[i]);
+        else
+            TEST4FIMEX_CHECK_EQ(0.5f * asS[i], asF[i]);
+    }
+}
@@ -191,4 +191,96 @@ TEST4FIMEX_TEST_CASE(test_extract)
     TEST4FIMEX_CHECK(extract->getCDM().hasVariable("relative_humidity"));
     TEST4FIMEX_CHECK_EQ(false, extract->getCDM().hasVariable("precipitation_amount"));
 }
+
+TEST4FIMEX_TEST_CASE(test_extract_chunks)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+    std::shared_ptr<CDMExtractor> extract = std::make_shared<CDMExtractor>(feltReader);
+    extract->reduceDimension("time", 0, 2);
+    extract->reduceDimension("y", 10, 5);
+    extract->reduceDimension("x", 80, 10);
+    auto full = extract->getData("air_temperature")->asFloat();
+
+    // split fastest dimension, nearby and distant positions, unsplit slower dimensions
+    extract = std::make_shared<CDMExtractor>(feltReader);
+    extract->reduceDimension("time", 0, 2);
+    extract->reduceDimension("y", 10, 5);
+    const size_t xPos[] = {80, 81, 83, 89};
+    extract->reduceDimension("x", std::set<size_t>(xPos, xPos + 4));
+    DataPtr data = extract->getData("air_temperature");
+    TEST4FIMEX_REQUIRE(data);
+    TEST4FIMEX_CHECK_EQ(data->size(), 4 * 5 * 2);
+    auto chunked = data->asFloat();
+    for (size_t t = 0; t < 2; t++) {
+        for (size_t y = 0; y < 5; y++) {
+            for (size_t x = 0; x < 4; x++) {
+                TEST4FIMEX_CHECK_EQ(full[mifi_3d_array_position(xPos[x] - 80, y, t, 10, 5, 2)], chunked[mifi_3d_array_position(x, y, t, 4, 5, 2)]);
+            }
+        }
+    }
+}
 #endif // HAVE_FELT
+
+#ifdef HAVE_NETCDF_H
+TEST4FIMEX_TEST_CASE(test_extract_chunks_netcdf)
+{
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", pathTest("coordTest.nc"));
+    const std::string varName = "cloud_area_fraction_in_atmosphere_layer"; // (time=4, sigma=4, y=11, x=11)
+    auto full = reader->getData(varName)->asShort();
+
+    // index sets on several dimensions: merged nearby positions, distant positions split into separate reads
+    const std::vector<size_t> xPos = {1, 2, 4, 10}, yPos = {0, 6, 7, 9}, sigmaPos = {0, 3};
+    std::shared_ptr<CDMExtractor> extract = std::make_shared<CDMExtractor>(reader);
+    extract->reduceDimension("x", std::set<size_t>(xPos.begin(), xPos.end()));
+    extract->reduceDimension("y", std::set<size_t>(yPos.begin(), yPos.end()));
+    extract->reduceDimension("sigma", std::set<size_t>(sigmaPos.begin(), sigmaPos.end()));
+    extract->reduceDimension("time", 1, 2);
+
+    DataPtr data = extract->getData(varName);
+    TEST4FIMEX_REQUIRE(data);
+    TEST4FIMEX_REQUIRE_EQ(data->size(), xPos.size() * yPos.size() * sigmaPos.size() * 2);
+    auto chunked = data->asShort();
+    size_t i = 0;
+    for (size_t t = 1; t < 3; t++) {
+        for (size_t s : sigmaPos) {
+            for (size_t y : yPos) {
+                for (size_t x : xPos) {
+                    TEST4FIMEX_CHECK_EQ(full[x + 11 * (y + 11 * (s + 4 * t))], chunked[i]);
+                    i += 1;
+                }
+            }
+        }
+    }
+
+    // same values when reading a single time slice
+    DataPtr slice = extract->getDataSlice(varName, 1);
+    TEST4FIMEX_REQUIRE(slice);
+    TEST4FIMEX_REQUIRE_EQ(slice->size(), xPos.size() * yPos.size() * sigmaPos.size());
+    auto sliceValues = slice->asShort();
+    for (size_t j = 0; j < slice->size(); j++)
+        TEST4FIMEX_CHECK_EQ(chunked[slice->size() + j], sliceValues[j]);
+}
+
+TEST4FIMEX_TEST_CASE(test_extract_chunks_overread)
+{
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", pathTest("coordTest.nc"));
+    std::shared_ptr<CountingReader> counter = std::make_shared<CountingReader>(reader);
+    const std::string varName = "cloud_area_fraction_in_atmosphere_layer"; // (time=4, sigma=4, y=11, x=11), short
+    const size_t sigmaBytes = 4 * 11 * 11 * sizeof(short);
+
+    // a gap of 2 slow positions with 2 kept would read as many unwanted as wanted values, not merged
+    std::shared_ptr<CDMExtractor> extract = std::make_shared<CDMExtractor>(counter);
+    extract->reduceDimension("sigma", std::set<size_t>{0, 3});
+    TEST4FIMEX_REQUIRE(extract->getData(varName));
+    TEST4FIMEX_CHECK_EQ(2 * sigmaBytes, counter->bytes());
+
+    // a gap of 1 with 3 kept is merged into one read
+    counter->reset();
+    extract = std::make_shared<CDMExtractor>(counter);
+    extract->reduceDimension("sigma", std::set<size_t>{0, 1, 3});
+    TEST4FIMEX_REQUIRE(extract->getData(varName));
+    TEST4FIMEX_CHECK_EQ(4 * sigmaBytes, counter->bytes());
+}
+#endif // HAVE_NETCDF_H
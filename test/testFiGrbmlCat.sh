@@ -26,9 +26,25 @@ if [ $? != 0 -o ! -f cat.grbml ]; then
 fi
 
 NC=`grep -c '</gribFileIndex>' cat.grbml`
-rm -f cat.grb1 cat.grb1.grbml cat.grbml
 if [ "$NC" != 1 ]; then
   echo "unexpected count $NC of closing gribFileIndex tags"
+  rm -f cat.grb1 cat.grb1.grbml cat.grbml
+  exit 1
+fi
+
+# convert to binary index and back
+./fiGrbmlCat.sh --binary -o cat.grbbin cat.grbml
+if [ $? != 0 -o ! -f cat.grbbin ]; then
+  echo "failed writing cat.grbbin"
+  rm -f cat.grb1 cat.grb1.grbml cat.grbml
+  exit 1
+fi
+./fiGrbmlCat.sh -o cat2.grbml cat.grbbin
+NM=`grep -c '<gribMessage' cat.grbml`
+NM2=`grep -c '<gribMessage' cat2.grbml`
+rm -f cat.grb1 cat.grb1.grbml cat.grbml cat.grbbin cat2.grbml
+if [ "$NM" != "$NM2" ]; then
+  echo "unexpected count $NM2 of messages after binary conversion, expected $NM"
   exit 1
 else
     echo "success"
@@ -70,6 +70,33 @@ else
   echo "success"
 fi
 
-rm -f test.grb1.grbml test.grb2.grbml
+# parallel indexing gives the same index
+rm -f test.grb1.grbml test.grb1.t4.grbml
+./fiIndexGribs.sh -i test.grb1 --threads=1 -o test.grb1.grbml
+./fiIndexGribs.sh -i test.grb1 --threads=4 -o test.grb1.t4.grbml
+if cmp -s test.grb1.grbml test.grb1.t4.grbml ; then
+  echo "success"
+else
+  echo "index differs between 1 and 4 threads"
+  exit 1
+fi
+rm -f test.grb1.t4.grbml
+
+# binary index
+rm -f test.grb1.grbbin
+./fiIndexGribs.sh -i test.grb1 --binary
+if [ ! -f test.grb1.grbbin ]; then
+  echo "failed writing test.grb1.grbbin"
+  exit 1
+fi
+./fimex.sh --input.file=test.grb1.grbbin --input.config "${TOP_SRCDIR}/share/etc/cdmGribReaderConfig.xml" --input.printNcML | grep x_wind_10m > /dev/null
+if [ $? != 0 ]; then
+  echo "failed reading test.grb1.grbbin with fimex"
+  exit 1
+else
+  echo "success"
+fi
+
+rm -f test.grb1.grbml test.grb2.grbml test.grb1.grbbin
 exit 0
 
@@ -33,11 +33,15 @@
 #include "fimex/Null_CDMWriter.h"
 #include "fimex/SliceBuilder.h"
 #include "fimex/XMLInputFile.h"
+#include "fimex/mifi_constants.h"
 
+#include "GribBinaryIndex.h"
 #include "GribFileIndex.h"
+#include "GribFilePool.h"
 
 #include "testinghelpers.h"
 
+#include <fstream>
 #include <memory>
 #include <vector>
 
@@ -120,3 +124,91 @@ TEST4FIMEX_TEST_CASE(GribFileIndex_LevelType)
     for (const auto& gfm : gfi.listMessages())
         TEST4FIMEX_CHECK_NE(0, gfm.getLevelType());
 }
+
+TEST4FIMEX_TEST_CASE(GribFilePool_readData)
+{
+    if (!hasTestExtra())
+        return;
+    const std::string grib2file = pathTestExtra("aa_20220211_0900.m1.grib2");
+
+    const GribFileIndex gfi(grib2file, std::vector<std::pair<std::string, std::regex>>());
+    TEST4FIMEX_REQUIRE(!gfi.listMessages().empty());
+
+    GribFilePool pool(2);
+    const size_t n = std::min(gfi.listMessages().size(), size_t(5));
+    for (size_t i = 0; i < n; ++i) {
+        const GribFileMessage& gfm = gfi.listMessages()[i];
+        const size_t size = gfm.getGridDefinition().getXSize() * gfm.getGridDefinition().getYSize();
+        vector<double> direct(size), pooled(size);
+        TEST4FIMEX_CHECK_EQ(size, gfm.readData(&direct[0], size, MIFI_UNDEFINED_D));
+        TEST4FIMEX_CHECK_EQ(size, gfm.readData(pool, &pooled[0], size, MIFI_UNDEFINED_D));
+        for (size_t j = 0; j < size; j += 97) {
+            if (!mifi_isnan(direct[j]))
+                TEST4FIMEX_CHECK_EQ(direct[j], pooled[j]);
+        }
+    }
+    const GribFilePool::Statistics stats = pool.getStatistics();
+    TEST4FIMEX_CHECK_EQ(n, stats.fileRequests);
+    TEST4FIMEX_CHECK_EQ(n - 1, stats.fileHits);
+}
+
+TEST4FIMEX_TEST_CASE(GribBinaryIndex_roundtrip)
+{
+    if (!hasTestExtra())
+        return;
+    const std::string grib2file = pathTestExtra("aa_20220211_0900.m1.grib2");
+    const std::string binFile = "GribBinaryIndex_roundtrip.grbbin";
+
+    const GribFileIndex gfi(grib2file, std::vector<std::pair<std::string, std::regex>>());
+    TEST4FIMEX_REQUIRE(!gfi.listMessages().empty());
+    GribBinaryIndex::write(binFile, gfi.getUrl(), gfi.listMessages());
+    TEST4FIMEX_CHECK(GribBinaryIndex::isBinaryIndex(binFile));
+
+    const GribFileIndex gfiBin(binFile);
+    TEST4FIMEX_CHECK_EQ(gfi.getUrl(), gfiBin.getUrl());
+    TEST4FIMEX_REQUIRE_EQ(gfi.listMessages().size(), gfiBin.listMessages().size());
+    for (size_t i = 0; i < gfi.listMessages().size(); ++i) {
+        const GribFileMessage& gfm = gfi.listMessages()[i];
+        const GribFileMessage& gfmBin = gfiBin.listMessages()[i];
+        TEST4FIMEX_CHECK_EQ(gfm.toString(), gfmBin.toString());
+        TEST4FIMEX_CHECK(gfm.getGridDefinition() == gfmBin.getGridDefinition());
+        TEST4FIMEX_CHECK_EQ(gfm.getGridDefinition().getLonLatResolution(), gfmBin.getGridDefinition().getLonLatResolution());
+    }
+    MetNoFimex::remove(binFile);
+}
+
+TEST4FIMEX_TEST_CASE(GribBinaryIndex_noLonLatStart)
+{
+    const std::string grbmlFile = "GribBinaryIndex_noLonLatStart.grbml";
+    const std::string binFile = "GribBinaryIndex_noLonLatStart.grbbin";
+    {
+        // old grbml-files have no startLon/startLat, the grid is then compared by startX/startY only
+        std::ofstream grbml(grbmlFile.c_str());
+        grbml << "<gribFileIndex url=\"file:test.grb2\" xmlns=\"http://www.met.no/schema/fimex/gribFileIndex\">\n"
+              << "<gribMessage url=\"file:test.grb2\" seekPos=\"0\" messagePos=\"0\">"
+              << "<parameter shortName=\"2t\" name=\"2 metre temperature\"><grib2 parameterNumber=\"0\" parameterCategory=\"0\" discipline=\"0\"/></parameter>"
+              << "<level type=\"103\" no=\"2\"/>"
+              << "<time dataDate=\"20220211\" dataTime=\"900\" stepUnits=\"h\" stepType=\"instant\" timeRangeIndicator=\"0\" "
+                 "typeOfStatisticalProcessing=\"0\" stepStart=\"0\" stepEnd=\"0\"/>"
+              << "<typeOfGrid name=\"regular_ll\"/>"
+              << "<gridDefinition proj4=\"+proj=latlong +R=6371000\" isDegree=\"1\" startX=\"5\" startY=\"55\" incrX=\"0.5\" incrY=\"0.5\" "
+                 "sizeX=\"10\" sizeY=\"20\" scanMode=\"64\"/>"
+              << "</gribMessage>\n"
+              << "</gribFileIndex>\n";
+    }
+
+    const GribFileIndex gfi(grbmlFile);
+    TEST4FIMEX_REQUIRE_EQ(1, gfi.listMessages().size());
+    const GridDefinition& gd = gfi.listMessages()[0].getGridDefinition();
+    TEST4FIMEX_CHECK(gd.getLonLatResolution() < 0);
+
+    GribBinaryIndex::write(binFile, gfi.getUrl(), gfi.listMessages());
+    const GribFileIndex gfiBin(binFile);
+    TEST4FIMEX_REQUIRE_EQ(1, gfiBin.listMessages().size());
+    const GridDefinition& gdBin = gfiBin.listMessages()[0].getGridDefinition();
+    TEST4FIMEX_CHECK_EQ(gd.getLonLatResolution(), gdBin.getLonLatResolution());
+    TEST4FIMEX_CHECK(gd == gdBin);
+
+    MetNoFimex::remove(grbmlFile);
+    MetNoFimex::remove(binFile);
+}
@@ -22,17 +22,22 @@
  */
 
 #include "testinghelpers.h"
+#include "CachedForwardInterpolation.h"
+#include "InterpolationGeometryCache.h"
 #include "fimex/interpolation.h"
 
 #include "fimex/CDMAttribute.h"
+#include "fimex/CachedInterpolation.h"
 #include "fimex/Data.h"
 #include "fimex/MathUtils.h"
 
 #include "fimex/reproject.h"
 
 #include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <string>
+#include <vector>
 
 // #define DEBUG_INTERPOLATION_TESTS 1
 #ifdef DEBUG_INTERPOLATION_TESTS
@@ -151,6 +156,183 @@ TEST4FIMEX_TEST_CASE(mifi_get_values_bicubic_f)
     TEST4FIMEX_CHECK(std::isnan(outvalues[0]));
 }
 
+TEST4FIMEX_TEST_CASE(CachedInterpolation_stencils)
+{
+    // compare the precomputed stencils with mifi_get_values_bilinear_f/mifi_get_values_bicubic_f,
+    // including points near and outside the borders
+    const size_t inX = 6, inY = 5, inZ = 2, outX = 7, outY = 6;
+    const size_t outSize = outX * outY;
+    float infield[inX * inY * inZ];
+    for (size_t i = 0; i < inX * inY * inZ; i++)
+        infield[i] = (i == 14) ? MIFI_UNDEFINED_F : std::sin(0.7 * i);
+
+    const int methods[2] = {MIFI_INTERPOL_BILINEAR, MIFI_INTERPOL_BICUBIC};
+    for (int m = 0; m < 2; m++) {
+        MetNoFimex::shared_array<double> xAxis = MetNoFimex::make_shared_array<double>(outSize);
+        MetNoFimex::shared_array<double> yAxis = MetNoFimex::make_shared_array<double>(outSize);
+        for (size_t i = 0; i < outSize; i++) {
+            xAxis[i] = -0.7 + 1.05 * (i % outX);
+            yAxis[i] = -0.6 + 1.1 * (i / outX);
+        }
+        std::vector<float> expected(outSize * inZ);
+        float zValues[inZ];
+        for (size_t i = 0; i < outSize; i++) {
+            if (methods[m] == MIFI_INTERPOL_BILINEAR)
+                mifi_get_values_bilinear_f(infield, zValues, xAxis[i], yAxis[i], inX, inY, inZ);
+            else
+                mifi_get_values_bicubic_f(infield, zValues, xAxis[i], yAxis[i], inX, inY, inZ);
+            for (size_t z = 0; z < inZ; z++)
+                expected[z * outSize + i] = zValues[z];
+        }
+
+        MetNoFimex::CachedInterpolation ci("x", "y", methods[m], xAxis, yAxis, inX, inY, outX, outY);
+        TEST4FIMEX_REQUIRE_EQ(inX, ci.getInX());
+        TEST4FIMEX_REQUIRE_EQ(inY, ci.getInY());
+        MetNoFimex::shared_array<float> inData = MetNoFimex::make_shared_array<float>(inX * inY * inZ);
+        std::copy(infield, infield + inX * inY * inZ, inData.get());
+        size_t newSize = 0;
+        MetNoFimex::shared_array<float> outData = ci.interpolateValues(inData, inX * inY * inZ, newSize);
+        TEST4FIMEX_REQUIRE_EQ(outSize * inZ, newSize);
+        for (size_t i = 0; i < newSize; i++) {
+            if (std::isnan(expected[i]))
+                TEST4FIMEX_CHECK(std::isnan(outData[i]));
+            else
+                TEST4FIMEX_CHECK_EQ(expected[i], outData[i]);
+        }
+    }
+}
+
+TEST4FIMEX_TEST_CASE(CachedForwardInterpolation_layers)
+{
+    // 3x2 input points onto 2x1 output points, 2 layers
+    const size_t inX = 3, inY = 2, inZ = 2, outX = 2, outY = 1;
+    const double xs[inX * inY] = {0, 0, 1, 1, 1, 5};
+    const double ys[inX * inY] = {0, 0, 0, 0, 0, 0};
+    MetNoFimex::shared_array<double> xAxis = MetNoFimex::make_shared_array<double>(inX * inY);
+    MetNoFimex::shared_array<double> yAxis = MetNoFimex::make_shared_array<double>(inX * inY);
+    std::copy(xs, xs + inX * inY, xAxis.get());
+    std::copy(ys, ys + inX * inY, yAxis.get());
+    const float infield[inX * inY * inZ] = {1, 2, 3, MIFI_UNDEFINED_F, 5, 6, 10, 20, 30, 40, 50, 60};
+    MetNoFimex::shared_array<float> inData = MetNoFimex::make_shared_array<float>(inX * inY * inZ);
+    std::copy(infield, infield + inX * inY * inZ, inData.get());
+
+    size_t newSize = 0;
+    MetNoFimex::CachedForwardInterpolation mean("x", "y", MIFI_INTERPOL_FORWARD_MEAN, xAxis, yAxis, inX, inY, outX, outY);
+    MetNoFimex::shared_array<float> outData = mean.interpolateValues(inData, inX * inY * inZ, newSize);
+    TEST4FIMEX_REQUIRE_EQ(outX * outY * inZ, newSize);
+    TEST4FIMEX_CHECK_EQ(1.5f, outData[0]);
+    TEST4FIMEX_CHECK_EQ(4.f, outData[1]);
+    TEST4FIMEX_CHECK_EQ(15.f, outData[2]);
+    TEST4FIMEX_CHECK_EQ(40.f, outData[3]);
+
+    MetNoFimex::CachedForwardInterpolation undefSum("x", "y", MIFI_INTERPOL_FORWARD_UNDEF_SUM, xAxis, yAxis, inX, inY, outX, outY);
+    outData = undefSum.interpolateValues(inData, inX * inY * inZ, newSize);
+    TEST4FIMEX_CHECK_EQ(3.f, outData[0]);
+    TEST4FIMEX_CHECK(std::isnan(outData[1]));
+    TEST4FIMEX_CHECK_EQ(30.f, outData[2]);
+    TEST4FIMEX_CHECK_EQ(120.f, outData[3]);
+
+    MetNoFimex::CachedForwardInterpolation median("x", "y", MIFI_INTERPOL_FORWARD_MEDIAN, xAxis, yAxis, inX, inY, outX, outY);
+    outData = median.interpolateValues(inData, inX * inY * inZ, newSize);
+    TEST4FIMEX_CHECK_EQ(2.f, outData[0]);
+    TEST4FIMEX_CHECK_EQ(5.f, outData[1]);
+    TEST4FIMEX_CHECK_EQ(20.f, outData[2]);
+    TEST4FIMEX_CHECK_EQ(40.f, outData[3]);
+}
+
+TEST4FIMEX_TEST_CASE(InterpolationGeometryCache_roundtrip)
+{
+    const std::string dir = "test_interpolation_geometry_cache";
+    const MetNoFimex::InterpolationGeometryCache cache(dir);
+    const std::vector<double> axis = {0, 1, 2};
+
+    MetNoFimex::InterpolationGeometryCache::Key key("projection");
+    key.add(MIFI_INTERPOL_BILINEAR).add("+proj=latlon").add(axis);
+    MetNoFimex::InterpolationGeometryCache::Key otherKey("projection");
+    otherKey.add(MIFI_INTERPOL_BICUBIC).add("+proj=latlon").add(axis);
+    std::remove(cache.getPath(key).c_str());
+
+    const size_t size = 4;
+    MetNoFimex::shared_array<double> xIn = MetNoFimex::make_shared_array<double>(size), yIn = MetNoFimex::make_shared_array<double>(size);
+    for (size_t i = 0; i < size; ++i) {
+        xIn[i] = i + 0.5;
+        yIn[i] = -1.0 * i;
+    }
+    MetNoFimex::shared_array<double> xOut, yOut;
+    TEST4FIMEX_CHECK(!cache.loadPoints(key, size, xOut, yOut));
+    cache.storePoints(key, size, xIn, yIn);
+    TEST4FIMEX_REQUIRE(cache.loadPoints(key, size, xOut, yOut));
+    for (size_t i = 0; i < size; ++i) {
+        TEST4FIMEX_CHECK_EQ(xIn[i], xOut[i]);
+        TEST4FIMEX_CHECK_EQ(yIn[i], yOut[i]);
+    }
+    // the loaded arrays are private copies
+    xOut[0] = 100;
+    TEST4FIMEX_REQUIRE(cache.loadPoints(key, size, xOut, yOut));
+    TEST4FIMEX_CHECK_EQ(0.5, xOut[0]);
+
+    TEST4FIMEX_CHECK(!cache.loadPoints(key, size + 1, xOut, yOut));
+    TEST4FIMEX_CHECK(!cache.loadPoints(otherKey, size, xOut, yOut));
+    TEST4FIMEX_CHECK(!cache.loadMatrix(key));
+
+    MetNoFimex::InterpolationGeometryCache::Key matrixKey("vector");
+    matrixKey.add(axis);
+    std::shared_ptr<Matrix> matrix = std::make_shared<Matrix>(3, 2);
+    for (int i = 0; i < 3 * 2 * Matrix::stride; ++i)
+        matrix->mtx()[i] = i * 0.25;
+    cache.storeMatrix(matrixKey, matrix);
+    Matrix_cp loaded = cache.loadMatrix(matrixKey);
+    TEST4FIMEX_REQUIRE(loaded);
+    TEST4FIMEX_CHECK_EQ(3, loaded->size_x);
+    TEST4FIMEX_CHECK_EQ(2, loaded->size_y);
+    for (int i = 0; i < 3 * 2 * Matrix::stride; ++i)
+        TEST4FIMEX_CHECK_EQ(i * 0.25, loaded->mtx()[i]);
+
+    // a file with the same name, but another key (i.e. a hash collision), is ignored
+    cache.storePoints(otherKey, size, xIn, yIn);
+    TEST4FIMEX_REQUIRE_EQ(0, std::rename(cache.getPath(otherKey).c_str(), cache.getPath(key).c_str()));
+    TEST4FIMEX_CHECK(!cache.loadPoints(key, size, xOut, yOut));
+
+    // truncated files are ignored
+    {
+        std::ofstream os(cache.getPath(key).c_str(), std::ios::binary | std::ios::trunc);
+        os << "FIGEOCAC";
+    }
+    TEST4FIMEX_CHECK(!cache.loadPoints(key, size, xOut, yOut));
+
+    std::remove(cache.getPath(key).c_str());
+    std::remove(cache.getPath(matrixKey).c_str());
+    TEST4FIMEX_CHECK_EQ(0, std::remove(dir.c_str()));
+}
+
+TEST4FIMEX_TEST_CASE(mifi_fill2d_methods)
+{
+    const size_t nx = 60, ny = 40, size = nx * ny;
+    std::vector<float> field(size);
+    for (size_t y = 0; y < ny; ++y) {
+        for (size_t x = 0; x < nx; ++x) {
+            const float dx = x - 30.f, dy = y - 20.f;
+            const bool hole = (dx * dx + dy * dy < 150) || (x > 50 && y < 10);
+            field[y * nx + x] = hole ? MIFI_UNDEFINED_F : 10 + 5 * std::sin(x * 0.1f) + 3 * std::cos(y * 0.1f);
+        }
+    }
+
+    std::vector<float> sor = field, redblack = field, multigrid = field;
+    size_t nChanged = 0;
+    TEST4FIMEX_CHECK_EQ(MIFI_OK, mifi_fill2d_f(nx, ny, &sor[0], 1e-5, 1.6, 10000, &nChanged));
+    TEST4FIMEX_CHECK(nChanged > 0);
+    TEST4FIMEX_CHECK_EQ(MIFI_OK, mifi_fill2d_redblack_f(nx, ny, &redblack[0], 1e-5, 1.6, 10000, &nChanged));
+    TEST4FIMEX_CHECK_EQ(MIFI_OK, mifi_fill2d_multigrid_f(nx, ny, &multigrid[0], 1e-5, 1.6, 10000, &nChanged));
+    for (size_t i = 0; i < size; ++i) {
+        TEST4FIMEX_CHECK(!std::isnan(sor[i]));
+        TEST4FIMEX_CHECK(near(sor[i], redblack[i], 0.05));
+        TEST4FIMEX_CHECK(near(sor[i], multigrid[i], 0.05));
+        if (!std::isnan(field[i])) {
+            TEST4FIMEX_CHECK_EQ(field[i], multigrid[i]);
+        }
+    }
+}
+
 TEST4FIMEX_TEST_CASE(mifi_get_values_linear_f)
 {
     const int nr = 4;
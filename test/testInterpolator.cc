@@ -26,8 +26,10 @@
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMInterpolator.h"
 #include "fimex/Data.h"
+#include "fimex/FileUtils.h"
 #include "fimex/MathUtils.h"
 #include "fimex/NcmlCDMReader.h"
+#include "fimex/ThreadPool.h"
 #include "fimex/Type2String.h"
 #include "fimex/XMLInputFile.h"
 #include "fimex/interpolation.h"
@@ -135,6 +137,50 @@ TEST4FIMEX_TEST_CASE(interpolatorSatellite)
     TEST4FIMEX_CHECK_EQ(cmaData2->size(), cmaData->size());
 }
 
+TEST4FIMEX_TEST_CASE(interpolatorKDTreeParts)
+{
+    // results must be identical with one kd-tree and with several kd-trees (one per thread)
+    const string fileName = pathTest("satellite_cma.nc");
+    vector<double> xAxis, yAxis;
+    for (int i = 0; i < 61; i++)
+        xAxis.push_back(-106.7 + i * 0.02);
+    for (int i = 0; i < 47; i++)
+        yAxis.push_back(56.3 + i * 0.01);
+
+    DataPtr cmaData[3];
+    const int threads[3] = {1, 4, 3};
+    for (int run = 0; run < 3; ++run) {
+        mifi_setNumThreads(threads[run]);
+        CDMReader_p reader(CDMFileReaderFactory::create("netcdf", fileName));
+        CDMInterpolator_p interpolator = std::make_shared<CDMInterpolator>(reader);
+        if (run > 0)
+            interpolator->setKDTreePartSize(16);
+        interpolator->changeProjection(MIFI_INTERPOL_COORD_NN_KD, "+proj=latlon +R=" + type2string(MIFI_EARTH_RADIUS_M) + " +e=0", xAxis, yAxis,
+                                       "degrees_east", "degrees_north", CDM_DOUBLE, CDM_DOUBLE);
+        cmaData[run] = interpolator->getDataSlice("cma", 0);
+        TEST4FIMEX_REQUIRE(cmaData[run]);
+    }
+    mifi_setNumThreads(1);
+
+    TEST4FIMEX_REQUIRE_EQ(cmaData[0]->size(), xAxis.size() * yAxis.size());
+    auto cma0 = cmaData[0]->asDouble();
+    size_t defined = 0;
+    for (size_t i = 0; i < cmaData[0]->size(); ++i) {
+        if (!mifi_isnan(cma0[i]))
+            defined += 1;
+    }
+    TEST4FIMEX_CHECK(defined > cmaData[0]->size() / 2);
+    for (int run = 1; run < 3; ++run) {
+        auto cma = cmaData[run]->asDouble();
+        size_t differences = 0;
+        for (size_t i = 0; i < cmaData[0]->size(); ++i) {
+            if (mifi_isnan(cma0[i]) ? !mifi_isnan(cma[i]) : (cma0[i] != cma[i]))
+                differences += 1;
+        }
+        TEST4FIMEX_CHECK_EQ(0, differences);
+    }
+}
+
 TEST4FIMEX_TEST_CASE(interpolator2coords)
 {
     const string proj_stere = "+proj=stere +lat_0=90 +lon_0=0 +lat_ts=60 +ellps=sphere";
@@ -401,4 +447,53 @@ TEST4FIMEX_TEST_CASE(interpolator_forward)
     }
     TEST4FIMEX_CHECK_EQ(0, bad);
 }
+
+TEST4FIMEX_TEST_CASE(interpolator_geometry_cache)
+{
+    const string ncFileName(pathTest("erai.sfc.40N.0.75d.200301011200.nc"));
+    const string cacheDir = "test_interpolator_geometry_cache";
+    const string proj = "+proj=utm +zone=32 +ellps=WGS84 +units=m +no_defs";
+    const vector<double> xAxis = range(200000, 10000, 350000), yAxis = range(6400000, 50000, 7100000);
+
+    vector<string> cacheFiles;
+    globFiles(cacheFiles, cacheDir + "/*");
+    for (const string& f : cacheFiles)
+        remove(f);
+
+    DataPtr data[3];
+    for (int run = 0; run < 3; ++run) {
+        // run 0 without cache, run 1 fills the cache, run 2 reads the geometry from the cache
+        CDMReader_p ncReader(CDMFileReaderFactory::create("netcdf", ncFileName));
+        CDMInterpolator_p interpolator = std::make_shared<CDMInterpolator>(ncReader);
+        interpolator->setGeometryCacheDirectory(run == 0 ? string() : cacheDir);
+        interpolator->changeProjection(MIFI_INTERPOL_BILINEAR, proj, xAxis, yAxis, "m", "m", CDM_DOUBLE, CDM_DOUBLE);
+        data[run] = interpolator->getData("ga_skt");
+        TEST4FIMEX_REQUIRE(data[run]);
+        if (run == 1) {
+            cacheFiles.clear();
+            globFiles(cacheFiles, cacheDir + "/*");
+            TEST4FIMEX_CHECK(!cacheFiles.empty());
+        }
+    }
+
+    TEST4FIMEX_REQUIRE_EQ(data[0]->size(), xAxis.size() * yAxis.size());
+    auto cold = data[1]->asDouble(), warm = data[2]->asDouble(), uncached = data[0]->asDouble();
+    size_t defined = 0, differences = 0;
+    for (size_t i = 0; i < data[0]->size(); ++i) {
+        if (mifi_isnan(uncached[i])) {
+            if (!mifi_isnan(cold[i]) || !mifi_isnan(warm[i]))
+                differences += 1;
+        } else {
+            defined += 1;
+            if (uncached[i] != cold[i] || cold[i] != warm[i])
+                differences += 1;
+        }
+    }
+    TEST4FIMEX_CHECK(defined > 0);
+    TEST4FIMEX_CHECK_EQ(0, differences);
+
+    for (const string& f : cacheFiles)
+        remove(f);
+    remove(cacheDir);
+}
 #endif // HAVE_NETCDF_H
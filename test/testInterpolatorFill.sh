@@ -43,5 +43,43 @@ if [ $? != 0 ]; then
 fi
 echo "success $TESTCASE"
 
+for METHOD in "method=sor" "method=redblack" "method=multigrid" "redblack"; do
+  TESTCASE="interpolator with prefill fill2d $METHOD"
+  echo "testing $TESTCASE"
+  "${TEST_BINDIR}/fimex.sh" \
+      --input.file "$INPUT_FILE" \
+      --output.file "$OUTPUT_FILE" \
+      --interpolate.method nearestneighbor \
+      --interpolate.projString "+proj=stere +lat_0=90 +lon_0=0 +lat_ts=60 +units=m +a=6.371e+06 +e=0 +no_defs" \
+      --interpolate.preprocess "fill2d(0.01, 1.6, 1000, $METHOD)" \
+      --interpolate.xAxisValues "-1705516, -1655353, -1605191, -1555029, -1504867, -1454704, -1404542,-1354380, -1304218, -1254056, -1203893" \
+      --interpolate.yAxisValues "-6872225, -6822063, -6771901, -6721738, -6671576, -6621414, -6571252,-6521089, -6470927, -6420765, -6370603" \
+      --interpolate.xAxisUnit m \
+      --interpolate.yAxisUnit m
+  if [ $? != 0 ]; then
+    echo "failed $TESTCASE"
+    exit 1
+  fi
+  echo "success $TESTCASE"
+done
+
+TESTCASE="interpolator with prefill fill2d unknown method"
+echo "testing $TESTCASE"
+"${TEST_BINDIR}/fimex.sh" \
+    --input.file "$INPUT_FILE" \
+    --output.file "$OUTPUT_FILE" \
+    --interpolate.method nearestneighbor \
+    --interpolate.projString "+proj=stere +lat_0=90 +lon_0=0 +lat_ts=60 +units=m +a=6.371e+06 +e=0 +no_defs" \
+    --interpolate.preprocess "fill2d(0.01, 1.6, 1000, method=jacobi)" \
+    --interpolate.xAxisValues "-1705516, -1655353, -1605191, -1555029, -1504867, -1454704, -1404542,-1354380, -1304218, -1254056, -1203893" \
+    --interpolate.yAxisValues "-6872225, -6822063, -6771901, -6721738, -6671576, -6621414, -6571252,-6521089, -6470927, -6420765, -6370603" \
+    --interpolate.xAxisUnit m \
+    --interpolate.yAxisUnit m > /dev/null 2>&1
+if [ $? = 0 ]; then
+  echo "failed $TESTCASE, expected an error"
+  exit 1
+fi
+echo "success $TESTCASE"
+
 rm -f "$OUTPUT_FILE"
 exit 0
@@ -26,9 +26,12 @@
 
 #include "testinghelpers.h"
 
+#include "fimex/CDMBorderSmoothing_Linear.h"
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMMerger.h"
+#include "fimex/CDMOverlay.h"
 #include "fimex/Data.h"
+#include "fimex/SliceBuilder.h"
 
 #include <memory>
 #include <numeric>
@@ -63,6 +66,74 @@ TEST4FIMEX_TEST_CASE(test_merger)
     }
 }
 
+TEST4FIMEX_TEST_CASE(test_merger_sliceBuilder)
+{
+    CDMReader_p readerI = CDMFileReaderFactory::create("netcdf", pathTest("test_merge_inner.nc"));
+    CDMReader_p readerO = CDMFileReaderFactory::create("netcdf", pathTest("test_merge_outer.nc"));
+
+    std::shared_ptr<CDMMerger> merger = std::make_shared<CDMMerger>(readerI, readerO);
+    merger->setTargetGridFromInner();
+
+    const int NLON = 61, lon0 = 20, nlon = 12, lat = 56;
+    DataPtr sliceM = merger->getDataSlice("ga_2t_1", 0);
+    SliceBuilder sb(merger->getCDM(), "ga_2t_1");
+    sb.setStartAndSize("time", 0, 1);
+    sb.setStartAndSize("longitude", lon0, nlon);
+    sb.setStartAndSize("latitude", lat, 1);
+    DataPtr row = merger->getDataSlice("ga_2t_1", sb);
+    TEST4FIMEX_REQUIRE_EQ(row->size(), nlon);
+    for (int i = 0; i < nlon; ++i) {
+        TEST4FIMEX_CHECK_CLOSE(row->getDouble(i), sliceM->getDouble(lon0 + i + lat * NLON), 1e-4);
+    }
+}
+
+TEST4FIMEX_TEST_CASE(test_overlay_sliceBuilder)
+{
+    CDMReader_p readerI = CDMFileReaderFactory::create("netcdf", pathTest("test_merge_inner.nc"));
+    CDMReader_p readerO = CDMFileReaderFactory::create("netcdf", pathTest("test_merge_outer.nc"));
+    std::shared_ptr<CountingReader> counter = std::make_shared<CountingReader>(readerI);
+
+    // the top reader is not interpolated and must only be read for the requested hyperslab
+    std::shared_ptr<CDMOverlay> overlay = std::make_shared<CDMOverlay>(readerO, counter);
+
+    const int NLON = 21, NLAT = 41, lon0 = 5, nlon = 5, lat = 20;
+    counter->reset();
+    DataPtr sliceM = overlay->getDataSlice("ga_2t_1", 0);
+    const size_t sliceBytes = counter->bytes();
+    TEST4FIMEX_REQUIRE_EQ(sliceM->size(), NLON * NLAT);
+
+    SliceBuilder sb(overlay->getCDM(), "ga_2t_1");
+    sb.setStartAndSize("time", 0, 1);
+    sb.setStartAndSize("longitude", lon0, nlon);
+    sb.setStartAndSize("latitude", lat, 1);
+    counter->reset();
+    DataPtr row = overlay->getDataSlice("ga_2t_1", sb);
+    const size_t rowBytes = counter->bytes();
+    TEST4FIMEX_REQUIRE_EQ(row->size(), nlon);
+    for (int i = 0; i < nlon; ++i) {
+        TEST4FIMEX_CHECK_CLOSE(row->getDouble(i), sliceM->getDouble(lon0 + i + lat * NLON), 1e-4);
+    }
+    TEST4FIMEX_CHECK_MESSAGE(10 * rowBytes < sliceBytes, rowBytes << " bytes for row, " << sliceBytes << " for slice");
+}
+
+TEST4FIMEX_TEST_CASE(test_border_smoothing_linear)
+{
+    CDMBorderSmoothing_Linear smoothing(5, 2);
+    smoothing.setHorizontalSizes(20, 30);
+    TEST4FIMEX_CHECK(smoothing.isLinear());
+
+    // border, inner area and transition
+    TEST4FIMEX_CHECK_EQ(1, smoothing.weight(1, 15));
+    TEST4FIMEX_CHECK_EQ(1, smoothing.weight(10, 28));
+    TEST4FIMEX_CHECK_EQ(0, smoothing.weight(10, 15));
+    TEST4FIMEX_CHECK_CLOSE(0.6, smoothing.weight(4, 15), 1e-12);
+    TEST4FIMEX_CHECK_CLOSE(0.2, smoothing.weight(10, 24), 1e-12);
+
+    TEST4FIMEX_CHECK_EQ(3, smoothing(10, 15, 3, 8));
+    TEST4FIMEX_CHECK_EQ(8, smoothing(1, 15, 3, 8));
+    TEST4FIMEX_CHECK_CLOSE(6, smoothing(4, 15, 3, 8), 1e-12);
+}
+
 TEST4FIMEX_TEST_CASE(test_merge_target)
 {
     const string fileNameB = pathTest("merge_target_base.nc"), fileNameT = pathTest("merge_target_top.nc");
@@ -26,6 +26,7 @@
 
 #include "testinghelpers.h"
 
+#include "fimex/AggregationReader.h"
 #include "fimex/CDM.h"
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMReader.h"
@@ -35,6 +36,9 @@
 
 #include <mi_cpptest_version.h>
 
+#include <algorithm>
+#include <atomic>
+
 #include <unistd.h>
 
 #if !defined(HAVE_BOOST_UNIT_TEST_FRAMEWORK) && (MI_CPPTEST_VERSION_CURRENT_INT >= MI_CPPTEST_VERSION_INT(0, 2, 0))
@@ -90,6 +94,97 @@ TEST4FIMEX_FIXTURE_TEST_CASE(test_joinExisting, TestConfig)
     TEST4FIMEX_CHECK_EQ(reader->getDataSlice("unlim", sb)->asShort()[0], 4);
 }
 
+TEST4FIMEX_FIXTURE_TEST_CASE(test_joinExistingLazy, TestConfig)
+{
+    std::shared_ptr<std::atomic<int>> opened = std::make_shared<std::atomic<int>>(0);
+    std::vector<AggregationReader::LazyReader> members;
+    for (const string fileName : {"joinExistingAgg1.nc", "joinExistingAgg3.nc", "joinExistingAgg4.nc"}) {
+        AggregationReader::LazyReader member;
+        member.open = [fileName, opened]() {
+            *opened += 1;
+            return CDMFileReaderFactory::create("netcdf", fileName);
+        };
+        member.id = fileName;
+        members.push_back(member);
+    }
+
+    std::shared_ptr<AggregationReader> agg = std::make_shared<AggregationReader>("joinExisting");
+    agg->setMaxOpenReaders(1);
+    agg->addReaders(members, false);
+    agg->initAggregation();
+    TEST4FIMEX_CHECK_EQ(*opened, 3);
+    TEST4FIMEX_REQUIRE(agg->getCDM().getUnlimitedDim());
+    TEST4FIMEX_CHECK_EQ(agg->getCDM().getUnlimitedDim()->getLength(), 5);
+
+    // joined coordinate collected while adding the members
+    TEST4FIMEX_CHECK(agg->getCDM().getVariable("unlim").hasData());
+    TEST4FIMEX_CHECK_EQ(agg->getDataSlice("unlim", 3)->asShort()[0], 4);
+    TEST4FIMEX_CHECK_EQ(*opened, 3);
+
+    // members are reopened on demand, and kept open while recently used
+    TEST4FIMEX_CHECK_EQ(agg->getDataSlice("multi", 3)->asShort()[1], -4);
+    TEST4FIMEX_CHECK_EQ(*opened, 4);
+    const size_t sliceSize = agg->getDataSlice("multi", 3)->size();
+    TEST4FIMEX_CHECK_EQ(*opened, 4);
+
+    SliceBuilder sb(agg->getCDM(), "multi");
+    DataPtr data = agg->getDataSlice("multi", sb);
+    TEST4FIMEX_REQUIRE_EQ(data->size(), 5 * sliceSize);
+    TEST4FIMEX_CHECK_EQ(data->asShort()[3 * sliceSize + 1], -4);
+}
+
+TEST4FIMEX_FIXTURE_TEST_CASE(test_joinExistingScanUnreadable, TestConfig)
+{
+    // scanned members are opened in parallel, the unreadable file is skipped
+    const string ncmlName = require("joinExistingAggUnreadable.ncml");
+    CDMReader_p reader(CDMFileReaderFactory::create("ncml", ncmlName));
+    TEST4FIMEX_REQUIRE(reader);
+    TEST4FIMEX_REQUIRE(reader->getCDM().getUnlimitedDim());
+    TEST4FIMEX_CHECK_EQ(reader->getCDM().getUnlimitedDim()->getLength(), 5);
+
+    // one value from each of the three readable members
+    TEST4FIMEX_CHECK_EQ(reader->getDataSlice("multi", 0)->asShort()[1], -1);
+    TEST4FIMEX_CHECK_EQ(reader->getDataSlice("multi", 2)->asShort()[1], -3);
+    TEST4FIMEX_CHECK_EQ(reader->getDataSlice("multi", 3)->asShort()[1], -4);
+}
+
+TEST4FIMEX_FIXTURE_TEST_CASE(test_joinExistingLazyParallel, TestConfig)
+{
+    std::vector<AggregationReader::LazyReader> members;
+    for (const string fileName : {"joinExistingAgg1.nc", "joinExistingAgg3.nc", "joinExistingAgg4.nc"}) {
+        AggregationReader::LazyReader member;
+        member.open = [fileName]() { return CDMFileReaderFactory::create("netcdf", fileName); };
+        member.id = fileName;
+        members.push_back(member);
+    }
+
+    std::shared_ptr<AggregationReader> agg = std::make_shared<AggregationReader>("joinExisting");
+    agg->addReaders(members, false);
+    agg->initAggregation();
+    const size_t unLimSize = agg->getCDM().getUnlimitedDim()->getLength();
+    TEST4FIMEX_REQUIRE_EQ(unLimSize, 5);
+
+    std::vector<DataPtr> expected;
+    for (size_t u = 0; u < unLimSize; ++u)
+        expected.push_back(agg->getDataSlice("multi", u));
+
+    // all threads read from different members, evicting each other's readers
+    agg->setMaxOpenReaders(1);
+    int failures = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+ : failures)
+#endif
+    for (int i = 0; i < 200; ++i) {
+        const size_t u = i % unLimSize;
+        DataPtr data = agg->getDataSlice("multi", u);
+        const auto values = data->asShort();
+        const auto expectedValues = expected[u]->asShort();
+        if (data->size() != expected[u]->size() || !std::equal(&values[0], &values[0] + data->size(), &expectedValues[0]))
+            failures += 1;
+    }
+    TEST4FIMEX_CHECK_EQ(failures, 0);
+}
+
 TEST4FIMEX_FIXTURE_TEST_CASE(test_joinExistingCV, TestConfig)
 {
     const string ncmlName = require("joinExistingCV.ncml");
@@ -0,0 +1,174 @@
+/*
+ * Fimex, testNetCDFChunking.cc
+ *
+ * (C) Copyright 2024, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "testinghelpers.h"
+
+#include "fimex/CDM.h"
+#include "fimex/CDMExtractor.h"
+#include "fimex/CDMFileReaderFactory.h"
+#include "fimex/CDMReader.h"
+#include "fimex/NcmlCDMReader.h"
+#include "fimex/XMLInputString.h"
+
+using namespace std;
+using namespace MetNoFimex;
+
+namespace {
+// dimensions of the variables in test_merge_inner.nc: longitude(21) latitude(41) surface(1) time(unlimited)
+const string inputFile = "test_merge_inner.nc";
+} // namespace
+
+TEST4FIMEX_TEST_CASE(test_chunking_map_and_shape)
+{
+    const string fileName = "test_chunking_map.nc";
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", pathTest(inputFile));
+    TEST4FIMEX_CHECK(reader->getChunkShape("ga_2t_1").empty()); // netcdf3 input
+
+    const string config = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                          "<cdm_ncwriter_config>"
+                          "<default filetype=\"netcdf4\" chunking=\"map\" />"
+                          "<variable name=\"ga_2t_1\" chunkShape=\"1,1,10,7\" />"
+                          "</cdm_ncwriter_config>";
+    CDMFileReaderFactory::createWriter(reader, "netcdf", fileName, XMLInputString(config));
+
+    CDMReader_p chunked = CDMFileReaderFactory::create("netcdf", fileName);
+    const vector<size_t> mapChunk = chunked->getChunkShape("ga_lsp_1");
+    TEST4FIMEX_REQUIRE_EQ(4, mapChunk.size());
+    TEST4FIMEX_CHECK_EQ(21, mapChunk[0]);
+    TEST4FIMEX_CHECK_EQ(41, mapChunk[1]);
+    TEST4FIMEX_CHECK_EQ(1, mapChunk[2]);
+    TEST4FIMEX_CHECK_EQ(1, mapChunk[3]);
+
+    const vector<size_t> explicitChunk = chunked->getChunkShape("ga_2t_1");
+    TEST4FIMEX_REQUIRE_EQ(4, explicitChunk.size());
+    TEST4FIMEX_CHECK_EQ(7, explicitChunk[0]);
+    TEST4FIMEX_CHECK_EQ(10, explicitChunk[1]);
+
+    // inherit the chunking from a netcdf4 input
+    const string fileNameSource = "test_chunking_source.nc";
+    const string configSource = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                                "<cdm_ncwriter_config>"
+                                "<default filetype=\"netcdf4\" chunking=\"source\" />"
+                                "</cdm_ncwriter_config>";
+    CDMFileReaderFactory::createWriter(chunked, "netcdf", fileNameSource, XMLInputString(configSource));
+    CDMReader_p inherited = CDMFileReaderFactory::create("netcdf", fileNameSource);
+    TEST4FIMEX_CHECK(inherited->getChunkShape("ga_2t_1") == explicitChunk);
+    TEST4FIMEX_CHECK(inherited->getChunkShape("ga_lsp_1") == mapChunk);
+
+    remove(fileName);
+    remove(fileNameSource);
+}
+
+TEST4FIMEX_TEST_CASE(test_chunking_source_wrapped)
+{
+    const string fileName = "test_chunking_wrapped_map.nc";
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", pathTest(inputFile));
+    const string config = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                          "<cdm_ncwriter_config>"
+                          "<default filetype=\"netcdf4\" />"
+                          "<variable name=\"ga_2t_1\" chunkShape=\"1,1,10,7\" />"
+                          "</cdm_ncwriter_config>";
+    CDMFileReaderFactory::createWriter(reader, "netcdf", fileName, XMLInputString(config));
+    CDMReader_p chunked = CDMFileReaderFactory::create("netcdf", fileName);
+    const vector<size_t> explicitChunk = chunked->getChunkShape("ga_2t_1");
+    TEST4FIMEX_REQUIRE_EQ(4, explicitChunk.size());
+
+    // ncml forwards the chunk shape to renamed variables and dimensions
+    const string ncml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                        "<netcdf xmlns=\"http://www.unidata.ucar.edu/namespaces/netcdf/ncml-2.2\">"
+                        "<dimension name=\"lon\" orgName=\"longitude\" />"
+                        "<variable name=\"t2m\" orgName=\"ga_2t_1\" />"
+                        "</netcdf>";
+    CDMReader_p ncmlReader = std::make_shared<NcmlCDMReader>(chunked, XMLInputString(ncml));
+    TEST4FIMEX_CHECK(ncmlReader->getChunkShape("t2m") == explicitChunk);
+
+    // the extractor clips the chunk shape to the reduced dimensions
+    std::shared_ptr<CDMExtractor> extract = std::make_shared<CDMExtractor>(ncmlReader);
+    extract->reduceDimension("lon", 0, 5);
+    const vector<size_t> clippedChunk = extract->getChunkShape("t2m");
+    TEST4FIMEX_REQUIRE_EQ(4, clippedChunk.size());
+    TEST4FIMEX_CHECK_EQ(5, clippedChunk[0]);
+    TEST4FIMEX_CHECK_EQ(10, clippedChunk[1]);
+
+    // chunking=source uses the forwarded chunk shape
+    const string fileNameSource = "test_chunking_wrapped_source.nc";
+    const string configSource = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                                "<cdm_ncwriter_config>"
+                                "<default filetype=\"netcdf4\" chunking=\"source\" />"
+                                "</cdm_ncwriter_config>";
+    CDMFileReaderFactory::createWriter(extract, "netcdf", fileNameSource, XMLInputString(configSource));
+    CDMReader_p inherited = CDMFileReaderFactory::create("netcdf", fileNameSource);
+    TEST4FIMEX_CHECK(inherited->getChunkShape("t2m") == clippedChunk);
+
+    remove(fileName);
+    remove(fileNameSource);
+}
+
+TEST4FIMEX_TEST_CASE(test_chunking_timeseries)
+{
+    const string fileName = "test_chunking_timeseries.nc";
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", pathTest(inputFile));
+    TEST4FIMEX_REQUIRE(reader->getCDM().getDimension("time").isUnlimited());
+
+    const string config = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                          "<cdm_ncwriter_config>"
+                          "<default filetype=\"netcdf4\" />"
+                          "<variable name=\"ga_2t_1\" chunking=\"timeseries\" />"
+                          "</cdm_ncwriter_config>";
+    CDMFileReaderFactory::createWriter(reader, "netcdf", fileName, XMLInputString(config));
+
+    // the unlimited time-dimension has a fixed chunk length, independent of the number of time-steps
+    // tiles of 32x32 give 128*32*32 = 2^17 values per chunk
+    CDMReader_p chunked = CDMFileReaderFactory::create("netcdf", fileName);
+    const vector<size_t> chunk = chunked->getChunkShape("ga_2t_1");
+    TEST4FIMEX_REQUIRE_EQ(4, chunk.size());
+    TEST4FIMEX_CHECK_EQ(21, chunk[0]);
+    TEST4FIMEX_CHECK_EQ(32, chunk[1]);
+    TEST4FIMEX_CHECK_EQ(1, chunk[2]);
+    TEST4FIMEX_CHECK_EQ(128, chunk[3]);
+
+    remove(fileName);
+}
+
+TEST4FIMEX_TEST_CASE(test_chunking_timeseries_configured)
+{
+    const string fileName = "test_chunking_timeseries_configured.nc";
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", pathTest(inputFile));
+
+    const string config = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                          "<cdm_ncwriter_config>"
+                          "<default filetype=\"netcdf4\" chunking=\"timeseries\" />"
+                          "<dimension name=\"time\" chunkSize=\"24\" />"
+                          "</cdm_ncwriter_config>";
+    CDMFileReaderFactory::createWriter(reader, "netcdf", fileName, XMLInputString(config));
+
+    CDMReader_p chunked = CDMFileReaderFactory::create("netcdf", fileName);
+    const vector<size_t> chunk = chunked->getChunkShape("ga_2t_1");
+    TEST4FIMEX_REQUIRE_EQ(4, chunk.size());
+    TEST4FIMEX_CHECK_EQ(21, chunk[0]);
+    TEST4FIMEX_CHECK_EQ(41, chunk[1]);
+    TEST4FIMEX_CHECK_EQ(1, chunk[2]);
+    TEST4FIMEX_CHECK_EQ(24, chunk[3]);
+
+    remove(fileName);
+}
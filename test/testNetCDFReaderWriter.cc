@@ -26,9 +26,14 @@
 
 #include "testinghelpers.h"
 
+#include "fimex/CDM.h"
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMReaderWriter.h"
 #include "fimex/Data.h"
+#include "fimex/ThreadPool.h"
+
+#include <cmath>
+#include <cstdlib>
 
 using namespace std;
 using namespace MetNoFimex;
@@ -114,3 +119,53 @@ TEST4FIMEX_TEST_CASE(test_scaled)
         remove(fileName);
     }
 }
+
+TEST4FIMEX_TEST_CASE(test_write_threads)
+{
+    // the parallel read/write pipeline must produce the same file as a single-threaded write
+    CDMReader_p reader = CDMFileReaderFactory::create("netcdf", pathTest("coordTest.nc"));
+    TEST4FIMEX_REQUIRE(reader);
+
+    const string fileName1("test_write_threads_1.nc"), fileName4("test_write_threads_4.nc");
+    mifi_setNumThreads(1);
+    CDMFileReaderFactory::createWriter(reader, "netcdf", fileName1);
+    CDMReader_p r1 = CDMFileReaderFactory::create("netcdf", fileName1);
+    const CDM::VarVec& vars = r1->getCDM().getVariables();
+
+    // tiny queues make the workers wait for the writer after each slice, 0 is used as 1
+    for (const char* queueSize : {"0", "1"}) {
+        mifi_setNumThreads(4);
+        setenv("FIMEX_WRITE_QUEUE_SIZE", queueSize, 1);
+        CDMFileReaderFactory::createWriter(reader, "netcdf", fileName4);
+        unsetenv("FIMEX_WRITE_QUEUE_SIZE");
+        mifi_setNumThreads(0);
+
+        CDMReader_p r4 = CDMFileReaderFactory::create("netcdf", fileName4);
+        TEST4FIMEX_REQUIRE_EQ(vars.size(), r4->getCDM().getVariables().size());
+        for (const CDMVariable& var : vars) {
+            const string& varName = var.getName();
+            DataPtr d1 = r1->getData(varName);
+            DataPtr d4 = r4->getData(varName);
+            TEST4FIMEX_REQUIRE(d1 && d4);
+            TEST4FIMEX_CHECK_EQ(d1->size(), d4->size());
+            if (d1->size() != d4->size())
+                continue;
+            const CDMDataType dt = d1->getDataType();
+            if (dt == CDM_STRING || dt == CDM_STRINGS) {
+                TEST4FIMEX_CHECK_EQ(d1->asString(), d4->asString());
+                continue;
+            }
+            const auto v1 = d1->asDouble();
+            const auto v4 = d4->asDouble();
+            size_t differences = 0;
+            for (size_t i = 0; i < d1->size(); ++i) {
+                if (!(v1[i] == v4[i] || (std::isnan(v1[i]) && std::isnan(v4[i]))))
+                    differences += 1;
+            }
+            TEST4FIMEX_CHECK_MESSAGE(differences == 0, "queue size " << queueSize << ", " << varName << ": " << differences << " differences");
+        }
+        r4.reset();
+        remove(fileName4);
+    }
+    remove(fileName1);
+}
@@ -27,6 +27,7 @@
 #include "fimex/CDM.h"
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMProcessor.h"
+#include "fimex/CDMReader.h"
 #include "fimex/Data.h"
 #include "fimex/SharedArray.h"
 #include "fimex/SliceBuilder.h"
@@ -67,6 +68,71 @@ TEST4FIMEX_TEST_CASE(test_accumulate)
     }
 }
 
+TEST4FIMEX_TEST_CASE(test_accumulate_parallel)
+{
+    const string fileName = pathTest("coordTest.nc");
+    CDMReader_p nc = CDMFileReaderFactory::create("netcdf", fileName);
+    const string accVar = "precipitation_amount", deaccVar = "x_wind_10m";
+
+    // expected values from the original slices
+    const size_t nt = 4;
+    vector<vector<double>> expectedAcc(nt), expectedDeacc(nt);
+    for (size_t t = 0; t < nt; ++t) {
+        auto acc = nc->getDataSlice(accVar, t)->asDouble();
+        auto deacc = nc->getDataSlice(deaccVar, t)->asDouble();
+        const size_t size = nc->getDataSlice(accVar, t)->size();
+        expectedAcc[t].assign(&acc[0], &acc[0] + size);
+        expectedDeacc[t].assign(&deacc[0], &deacc[0] + size);
+        if (t > 0) {
+            auto accP = nc->getDataSlice(accVar, t - 1)->asDouble();
+            auto deaccP = nc->getDataSlice(deaccVar, t - 1)->asDouble();
+            for (size_t i = 0; i < size; ++i) {
+                expectedAcc[t][i] += (t > 1) ? expectedAcc[t - 1][i] : accP[i];
+                expectedDeacc[t][i] -= deaccP[i];
+            }
+        }
+    }
+
+    std::shared_ptr<CDMProcessor> proc = std::make_shared<CDMProcessor>(nc);
+    proc->accumulate(accVar);
+    proc->deAccumulate(deaccVar);
+
+    // out of order from many threads
+    const size_t rounds = 16;
+    vector<DataPtr> acc(nt * rounds), deacc(nt * rounds);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(8)
+#endif
+    for (long long k = 0; k < (long long)(nt * rounds); ++k) {
+        const size_t t = (k * 3) % nt;
+        acc[k] = proc->getDataSlice(accVar, t);
+        deacc[k] = proc->getDataSlice(deaccVar, t);
+    }
+    for (size_t k = 0; k < nt * rounds; ++k) {
+        const size_t t = (k * 3) % nt;
+        TEST4FIMEX_REQUIRE_EQ(acc[k]->size(), expectedAcc[t].size());
+        TEST4FIMEX_REQUIRE_EQ(deacc[k]->size(), expectedDeacc[t].size());
+        for (size_t i = 0; i < expectedAcc[t].size(); ++i) {
+            TEST4FIMEX_CHECK_CLOSE(expectedAcc[t][i], acc[k]->getDouble(i), 1e-4);
+            TEST4FIMEX_CHECK_CLOSE(expectedDeacc[t][i], deacc[k]->getDouble(i), 1e-4);
+        }
+    }
+
+    // the netcdf writer reads the slices in parallel
+    const string outFile = "testProcessor_accumulate.nc";
+    TEST4FIMEX_REQUIRE(writeToFile(proc, outFile, false));
+    CDMReader_p written = CDMFileReaderFactory::create("netcdf", outFile);
+    for (size_t t = 0; t < nt; ++t) {
+        DataPtr writtenAcc = written->getDataSlice(accVar, t), writtenDeacc = written->getDataSlice(deaccVar, t);
+        TEST4FIMEX_REQUIRE_EQ(writtenAcc->size(), expectedAcc[t].size());
+        for (size_t i = 0; i < expectedAcc[t].size(); ++i) {
+            TEST4FIMEX_CHECK_CLOSE(expectedAcc[t][i], writtenAcc->getDouble(i), 1e-4);
+            TEST4FIMEX_CHECK_CLOSE(expectedDeacc[t][i], writtenDeacc->getDouble(i), 1e-4);
+        }
+    }
+    remove(outFile);
+}
+
 TEST4FIMEX_TEST_CASE(test_rotate)
 {
         const string fileName = pathTest("coordTest.nc");
@@ -89,6 +155,82 @@ TEST4FIMEX_TEST_CASE(test_rotate)
         TEST4FIMEX_CHECK_NE(yn, yo);
         TEST4FIMEX_CHECK_CLOSE(xn * xn + yn * yn, xo * xo + yo * yo, 1e-4);
 }
+
+TEST4FIMEX_TEST_CASE(test_sliceBuilder)
+{
+    const string fileName = pathTest("coordTest.nc");
+    CDMReader_p nc = CDMFileReaderFactory::create("netcdf", fileName);
+
+    const size_t nx = 11, nt = 4, x = 1, y = 6;
+    const vector<string> vars = {"precipitation_amount", "x_wind_10m", "y_wind_10m"};
+    for (const string& var : vars) {
+        // separate processors, rotated counterparts of the previous variable would not be read again
+        std::shared_ptr<CountingReader> counter = std::make_shared<CountingReader>(nc);
+        std::shared_ptr<CDMProcessor> proc = std::make_shared<CDMProcessor>(counter);
+        proc->accumulate("precipitation_amount");
+        proc->rotateVectorToLatLon(true, vector<string>(1, "x_wind_10m"), vector<string>(1, "y_wind_10m"));
+
+        // point time-series
+        SliceBuilder sb(proc->getCDM(), var);
+        sb.setStartAndSize("x", x, 1);
+        sb.setStartAndSize("y", y, 1);
+        counter->reset();
+        DataPtr series = proc->getDataSlice(var, sb);
+        const size_t seriesBytes = counter->bytes();
+        TEST4FIMEX_REQUIRE_EQ(series->size(), nt);
+
+        counter->reset();
+        for (size_t t = 0; t < nt; ++t) {
+            DataPtr slice = proc->getDataSlice(var, t);
+            TEST4FIMEX_CHECK_CLOSE(series->getDouble(t), slice->getDouble(y * nx + x), 1e-4);
+        }
+        const size_t sliceBytes = counter->bytes();
+        TEST4FIMEX_CHECK_MESSAGE(10 * seriesBytes < sliceBytes, var << ": " << seriesBytes << " bytes for series, " << sliceBytes << " for slices");
+    }
+}
+
+TEST4FIMEX_TEST_CASE(test_rotate_pair)
+{
+    const string fileName = pathTest("coordTest.nc");
+    CDMReader_p nc = CDMFileReaderFactory::create("netcdf", fileName);
+    std::shared_ptr<CountingReader> counter = std::make_shared<CountingReader>(nc);
+    std::shared_ptr<CDMProcessor> proc = std::make_shared<CDMProcessor>(counter);
+    proc->rotateVectorToLatLon(true, vector<string>(1, "x_wind_10m"), vector<string>(1, "y_wind_10m"));
+    std::shared_ptr<CDMProcessor> ref = std::make_shared<CDMProcessor>(nc);
+    ref->rotateVectorToLatLon(true, vector<string>(1, "x_wind_10m"), vector<string>(1, "y_wind_10m"));
+
+    for (size_t t = 0; t < 2; ++t) {
+        // the second component is rotated with the first and not read again
+        proc->getDataSlice("x_wind_10m", t);
+        counter->reset();
+        DataPtr yRot = proc->getDataSlice("y_wind_10m", t);
+        TEST4FIMEX_CHECK_EQ(counter->bytes(), size_t(0));
+
+        DataPtr yRef = ref->getDataSlice("y_wind_10m", t);
+        TEST4FIMEX_REQUIRE_EQ(yRot->size(), yRef->size());
+        auto yr = yRot->asFloat(), yf = yRef->asFloat();
+        for (size_t i = 0; i < yRef->size(); ++i)
+            TEST4FIMEX_CHECK_EQ(yr[i], yf[i]);
+
+        // served only once
+        counter->reset();
+        proc->getDataSlice("y_wind_10m", t);
+        TEST4FIMEX_CHECK_NE(counter->bytes(), size_t(0));
+    }
+
+    // same with slicebuilder
+    SliceBuilder sb(proc->getCDM(), "x_wind_10m");
+    sb.setStartAndSize("x", 1, 3);
+    proc->getDataSlice("x_wind_10m", sb);
+    counter->reset();
+    DataPtr yRot = proc->getDataSlice("y_wind_10m", sb);
+    TEST4FIMEX_CHECK_EQ(counter->bytes(), size_t(0));
+    DataPtr yRef = ref->getDataSlice("y_wind_10m", sb);
+    TEST4FIMEX_REQUIRE_EQ(yRot->size(), yRef->size());
+    auto yr = yRot->asFloat(), yf = yRef->asFloat();
+    for (size_t i = 0; i < yRef->size(); ++i)
+        TEST4FIMEX_CHECK_EQ(yr[i], yf[i]);
+}
 #endif // HAVE_NETCDF_H
 
 #ifdef HAVE_FELT
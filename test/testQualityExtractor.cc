@@ -27,6 +27,7 @@
 #include "fimex/CDMQualityExtractor.h"
 #include "fimex/Data.h"
 #include "fimex/SharedArray.h"
+#include "fimex/SliceBuilder.h"
 #include "fimex/mifi_constants.h"
 
 #include <memory>
@@ -103,4 +104,32 @@ TEST4FIMEX_TEST_CASE(test_qualityExtract_mask)
     TEST4FIMEX_CHECK(valuesM[offset0] > 1e36);
     TEST4FIMEX_CHECK(fabs(valuesM[offset1] - 35.114) < 0.001);
 }
+
+TEST4FIMEX_TEST_CASE(test_qualityExtract_mask_sliceBuilder)
+{
+    CDMReader_p readerD = CDMFileReaderFactory::create("netcdf", pathTest("testQEmask_data.nc"));
+    std::shared_ptr<CountingReader> counter = std::make_shared<CountingReader>(readerD);
+    std::shared_ptr<CDMQualityExtractor> mask = std::make_shared<CDMQualityExtractor>(counter, "", require("testQEmask.xml"));
+
+    const int NXSI = 21, NETA = 16, N_SRHO = 35, xi = 12, eta = 12;
+    counter->reset();
+    DataPtr sliceM = mask->getDataSlice("salt", 0);
+    const size_t sliceBytes = counter->bytes();
+    TEST4FIMEX_REQUIRE_EQ(sliceM->size(), N_SRHO * NXSI * NETA);
+
+    SliceBuilder sb(mask->getCDM(), "salt");
+    sb.setStartAndSize("xi_rho", xi, 1);
+    sb.setStartAndSize("eta_rho", eta, 1);
+    sb.setStartAndSize("clim_time", 0, 1);
+    counter->reset();
+    DataPtr column = mask->getDataSlice("salt", sb);
+    const size_t columnBytes = counter->bytes();
+    TEST4FIMEX_REQUIRE_EQ(column->size(), N_SRHO);
+    for (int k = 0; k < N_SRHO; ++k) {
+        TEST4FIMEX_CHECK_EQ(column->getDouble(k), sliceM->getDouble(xi + NXSI * (eta + NETA * k)));
+    }
+    TEST4FIMEX_CHECK(fabs(column->getDouble(0) - 35.114) < 0.001);
+    // only the selected column is read from the data reader
+    TEST4FIMEX_CHECK_MESSAGE(10 * columnBytes < sliceBytes, columnBytes << " bytes for column, " << sliceBytes << " for slice");
+}
 #endif /* HAVE_NETCDF_H */
@@ -30,6 +30,7 @@
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMTimeInterpolator.h"
 #include "fimex/Data.h"
+#include "fimex/SliceBuilder.h"
 
 using namespace std;
 using namespace MetNoFimex;
@@ -101,3 +102,36 @@ TEST4FIMEX_TEST_CASE(test_timeInterpolatorRelative)
     }
 }
 #endif // HAVE_FELT && HAVE_NETCDF_H
+
+#ifdef HAVE_NETCDF_H
+TEST4FIMEX_TEST_CASE(test_timeInterpolatorSliceBuilder)
+{
+    CDMReader_p nc = CDMFileReaderFactory::create("netcdf", pathTest("coordTest.nc"));
+    std::shared_ptr<CountingReader> counter = std::make_shared<CountingReader>(nc);
+    std::shared_ptr<CDMTimeInterpolator> timeInterpol = std::make_shared<CDMTimeInterpolator>(counter);
+    timeInterpol->changeTimeAxis("2007-05-16 10:00:00,2007-05-16 10:30:00,...,2007-05-16 12:00:00;unit=seconds since 1970-01-01 00:00:00");
+    const size_t nt = 5, nx = 11, x = 1, y = 6;
+    TEST4FIMEX_REQUIRE_EQ(timeInterpol->getCDM().getDimension("time").getLength(), nt);
+
+    const string var = "precipitation_amount";
+    SliceBuilder sb(timeInterpol->getCDM(), var);
+    sb.setStartAndSize("x", x, 1);
+    sb.setStartAndSize("y", y, 1);
+    counter->reset();
+    DataPtr series = timeInterpol->getDataSlice(var, sb);
+    const size_t seriesBytes = counter->bytes();
+    TEST4FIMEX_REQUIRE_EQ(series->size(), nt);
+    counter->reset();
+    for (size_t t = 0; t < nt; ++t) {
+        DataPtr slice = timeInterpol->getDataSlice(var, t);
+        TEST4FIMEX_CHECK_CLOSE(series->getDouble(t), slice->getDouble(y * nx + x), 1e-4);
+    }
+    const size_t sliceBytes = counter->bytes();
+    // only the selected point is read from the original time-steps
+    TEST4FIMEX_CHECK_MESSAGE(10 * seriesBytes < sliceBytes, seriesBytes << " bytes for series, " << sliceBytes << " for slices");
+    // half-way between the two first original times
+    const double v0 = nc->getDataSlice(var, 0)->getDouble(y * nx + x);
+    const double v1 = nc->getDataSlice(var, 1)->getDouble(y * nx + x);
+    TEST4FIMEX_CHECK_CLOSE(series->getDouble(1), (v0 + v1) / 2, 1e-4);
+}
+#endif // HAVE_NETCDF_H
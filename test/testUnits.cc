@@ -21,6 +21,7 @@
  * USA.
  */
 
+#include "fimex/Data.h"
 #include "fimex/TimeUnit.h"
 #include "fimex/TimeUtils.h"
 #include "fimex/Type2String.h"
@@ -31,6 +32,8 @@
 #include "testinghelpers.h"
 
 #include <cmath>
+#include <limits>
+#include <vector>
 
 using namespace std;
 using namespace MetNoFimex;
@@ -82,6 +85,38 @@ TEST4FIMEX_TEST_CASE(test_LogUnit)
     TEST4FIMEX_CHECK_CLOSE(conv->convert(1000.), 11.512925, 1e-5);
 }
 
+TEST4FIMEX_TEST_CASE(test_LogUnitArray)
+{
+    Units units;
+    UnitsConverter_p conv = units.getConverter("hPa", "ln(re 1Pa)");
+    const size_t n = 10000;
+    vector<double> in(n), out(n);
+    vector<float> inF(n), outF(n);
+    for (size_t i = 0; i < n; ++i) {
+        in[i] = 100 + i * 0.1;
+        inF[i] = in[i];
+    }
+    conv->convert(&in[0], &out[0], n);
+    conv->convert(&inF[0], &outF[0], n);
+    for (size_t i = 0; i < n; i += 7) {
+        TEST4FIMEX_CHECK(fabs(out[i] - conv->convert(in[i])) < 1e-10);
+        TEST4FIMEX_CHECK(fabs(outF[i] - conv->convert(inF[i])) < 1e-5);
+    }
+
+    // scaled data with fill-values, converted in blocks
+    DataPtr data = createData(CDM_SHORT, n);
+    for (size_t i = 0; i < n; ++i)
+        data->setValue(i, (i % 100 == 0) ? -32767 : (1000 + i % 1000));
+    DataPtr converted = data->convertDataType(-32767, 0.1, 0, conv, CDM_FLOAT, -1, 1, 0);
+    auto values = converted->asFloat();
+    for (size_t i = 0; i < n; ++i) {
+        if (i % 100 == 0)
+            TEST4FIMEX_CHECK_EQ(values[i], -1);
+        else
+            TEST4FIMEX_CHECK(fabs(values[i] - log(100 * 0.1 * (1000 + i % 1000))) < 1e-5);
+    }
+}
+
 TEST4FIMEX_TEST_CASE(test_TimeUnit)
 {
     TimeUnit tu("seconds since 1970-01-01 01:00:00");
@@ -126,3 +161,34 @@ TEST4FIMEX_TEST_CASE(test_TimeUnit)
     TEST4FIMEX_CHECK(ft < maxTime);
     TEST4FIMEX_CHECK(ft2 < maxTime);
 }
+
+TEST4FIMEX_TEST_CASE(test_TimeUnit_vector)
+{
+    const TimeUnit tu("hours since 2000-01-01 00:00:00");
+    vector<double> unitTimes;
+    for (int i = 0; i < 1000; ++i)
+        unitTimes.push_back(i * 6.5);
+
+    const vector<FimexTime> fiTimes = tu.unitTimes2fimexTimes(unitTimes);
+    TEST4FIMEX_REQUIRE_EQ(fiTimes.size(), unitTimes.size());
+    for (size_t i = 0; i < unitTimes.size(); ++i)
+        TEST4FIMEX_CHECK_EQ(fiTimes[i], tu.unitTime2fimexTime(unitTimes[i]));
+    TEST4FIMEX_CHECK_EQ(type2string(fiTimes[3]), "2000-01-01T19:30:00");
+
+    const vector<double> back = tu.fimexTimes2unitTimes(fiTimes);
+    TEST4FIMEX_REQUIRE_EQ(back.size(), unitTimes.size());
+    for (size_t i = 0; i < unitTimes.size(); ++i)
+        TEST4FIMEX_CHECK(fabs(back[i] - unitTimes[i]) < 1e-5);
+
+    vector<FimexTime> special;
+    special.push_back(FimexTime(FimexTime::min_date_time));
+    special.push_back(FimexTime(FimexTime::max_date_time));
+    special.push_back(FimexTime(2000, 13, 1)); // invalid month
+    const vector<double> specialUnit = tu.fimexTimes2unitTimes(special, -1);
+    TEST4FIMEX_CHECK_EQ(specialUnit[0], std::numeric_limits<double>::lowest());
+    TEST4FIMEX_CHECK_EQ(specialUnit[1], std::numeric_limits<double>::max());
+    TEST4FIMEX_CHECK_EQ(specialUnit[2], -1);
+    TEST4FIMEX_CHECK(std::isnan(tu.fimexTimes2unitTimes(special)[2]));
+
+    TEST4FIMEX_CHECK(tu.unitTimes2fimexTimes(vector<double>()).empty());
+}
@@ -27,6 +27,7 @@
 
 #include "fimex/CDM.h"
 #include "fimex/CDMFileReaderFactory.h"
+#include "fimex/CDMPressureConversions.h"
 #include "fimex/CDMReader.h"
 #include "fimex/CDMVerticalInterpolator.h"
 #include "fimex/CDMInterpolator.h"
@@ -34,8 +35,11 @@
 #include "fimex/coordSys/verticalTransform/ToVLevelConverter.h"
 #include "fimex/coordSys/verticalTransform/VerticalTransformationUtils.h"
 #include "fimex/Data.h"
+#include "fimex/FindNeighborElements.h"
+#include "fimex/interpolation.h"
 #include "fimex/SliceBuilder.h"
 
+#include <cmath>
 #include <memory>
 
 using namespace MetNoFimex;
@@ -58,6 +62,37 @@ tst_t createVerticalTransformationForTest()
     return tst;
 }
 
+//! replaces some air temperatures and one surface pressure by the fill value
+class MissingValuesReader : public CDMReader
+{
+public:
+    MissingValuesReader(CDMReader_p reader)
+        : reader_(reader)
+    {
+        *cdm_ = reader_->getCDM();
+    }
+
+    using CDMReader::getDataSlice;
+    DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos) override
+    {
+        DataPtr data = reader_->getDataSlice(varName, unLimDimPos);
+        if (varName == "air_temperature_ml") {
+            // slice is (x=2, y=1, hybrid=65)
+            data = data->clone();
+            data->setValue(1 + 2 * 40, cdm_->getFillValue(varName));
+            data->setValue(1 + 2 * 41, cdm_->getFillValue(varName));
+            data->setValue(0 + 2 * 64, cdm_->getFillValue(varName));
+        } else if (varName == "surface_air_pressure" && unLimDimPos == 1) {
+            data = data->clone();
+            data->setValue(0, cdm_->getFillValue(varName));
+        }
+        return data;
+    }
+
+private:
+    CDMReader_p reader_;
+};
+
 } // namespace
 
 TEST4FIMEX_TEST_CASE(test_vlevelconverter_pressure)
@@ -256,6 +291,128 @@ TEST4FIMEX_TEST_CASE(test_pressure_integrator_up)
     TEST4FIMEX_CHECK_CLOSE(5000, va[5], 1);
 }
 
+TEST4FIMEX_TEST_CASE(vertical_interpolator_cache)
+{
+    const std::string fileName = pathTest("testdata_arome_vc.nc");
+    CDMReader_p ncreader(CDMFileReaderFactory::create("netcdf", fileName));
+
+    std::shared_ptr<CDMVerticalInterpolator> reader = std::make_shared<CDMVerticalInterpolator>(ncreader, "pressure", "log");
+    reader->interpolateToFixed({1000, 850, 500});
+
+    DataPtr data0 = reader->getDataSlice("air_temperature_ml", 0);
+    DataPtr data1 = reader->getDataSlice("air_temperature_ml", 0);
+    TEST4FIMEX_REQUIRE(data0 && data1);
+    TEST4FIMEX_REQUIRE_EQ(data0->size(), data1->size());
+    auto values0 = data0->asFloat(), values1 = data1->asFloat();
+    for (size_t i = 0; i < data0->size(); ++i)
+        TEST4FIMEX_CHECK_EQ(values0[i], values1[i]);
+
+    CDMVerticalInterpolator::CacheStatistics stats = reader->getCacheStatistics();
+    TEST4FIMEX_CHECK_EQ(2, stats.requests);
+    TEST4FIMEX_CHECK_EQ(1, stats.hits);
+    TEST4FIMEX_CHECK_EQ(0, stats.evictions);
+
+    reader->setVerticalCacheSize(0);
+    stats = reader->getCacheStatistics();
+    TEST4FIMEX_CHECK_EQ(1, stats.evictions);
+
+    reader->getDataSlice("air_temperature_ml", 0);
+    reader->getDataSlice("air_temperature_ml", 0);
+    stats = reader->getCacheStatistics();
+    TEST4FIMEX_CHECK_EQ(4, stats.requests);
+    TEST4FIMEX_CHECK_EQ(1, stats.hits);
+}
+
+TEST4FIMEX_TEST_CASE(vertical_interpolator_columns)
+{
+    // compare with interpolating each output point separately, as done before the column kernel
+    CDMReader_p ncreader(CDMFileReaderFactory::create("netcdf", pathTest("testdata_arome_vc.nc")));
+    CDMReader_p missing = std::make_shared<MissingValuesReader>(ncreader);
+    CoordinateSystem_cp csI = findCompleteCoordinateSystemFor(MetNoFimex::listCoordinateSystems(missing), "air_temperature_ml");
+    TEST4FIMEX_REQUIRE(csI);
+
+    const std::vector<double> levels = {1020, 990, 975.5, 900, 850, 700, 500, 300, 100, 50, 12, 10, 5};
+    const size_t nx = 2, nzi = 65, nzo = levels.size();
+    typedef int (*intFunc_t)(const float*, const float*, float*, const size_t, const double, const double, const double);
+    const std::vector<std::pair<std::string, intFunc_t>> methods = {{"linear", &mifi_get_values_linear_f},
+                                                                   {"log", &mifi_get_values_log_f},
+                                                                   {"linear_no_extra", &mifi_get_values_linear_no_extrapol_f},
+                                                                   {"nearestneighbor", &mifi_get_values_nearest_f}};
+    for (const auto& method : methods) {
+        std::shared_ptr<CDMVerticalInterpolator> reader = std::make_shared<CDMVerticalInterpolator>(missing, "pressure", method.first);
+        reader->interpolateToFixed(levels);
+
+        size_t nMissing = 0;
+        for (size_t t = 0; t < 2; ++t) {
+            DataPtr iPressure = verticalData4D(csI, missing, t, MIFI_VINT_PRESSURE);
+            DataPtr iData = missing->getScaledDataSlice("air_temperature_ml", t);
+            DataPtr oData = reader->getScaledDataSlice("air_temperature_ml", t);
+            TEST4FIMEX_REQUIRE(iPressure && iData && oData);
+            TEST4FIMEX_REQUIRE_EQ(nx * nzi, iPressure->size());
+            TEST4FIMEX_REQUIRE_EQ(nx * nzo, oData->size());
+            auto iP = iPressure->asFloat();
+            auto iD = iData->asFloat();
+            auto oD = oData->asFloat();
+
+            for (size_t x = 0; x < nx; ++x) {
+                std::vector<float> column(nzi);
+                for (size_t ki = 0; ki < nzi; ++ki)
+                    column[ki] = iP[x + nx * ki];
+                for (size_t k = 0; k < nzo; ++k) {
+                    float expected = MIFI_UNDEFINED_F;
+                    const std::pair<size_t, size_t> pos = find_closest_neighbor_distinct_elements(column.begin(), column.end(), levels[k]);
+                    if (pos.first != pos.second) {
+                        const float v0 = iD[x + nx * pos.first], v1 = iD[x + nx * pos.second];
+                        method.second(&v0, &v1, &expected, 1, column[pos.first], column[pos.second], levels[k]);
+                    }
+                    const float actual = oD[x + nx * k];
+                    if (std::isnan(expected)) {
+                        nMissing += 1;
+                        TEST4FIMEX_CHECK_MESSAGE(std::isnan(actual), method.first << " t=" << t << " x=" << x << " k=" << k << ": " << actual);
+                    } else {
+                        TEST4FIMEX_CHECK_MESSAGE(expected == actual,
+                                                 method.first << " t=" << t << " x=" << x << " k=" << k << ": " << expected << " != " << actual);
+                    }
+                }
+            }
+        }
+        // the missing bottom level at x=0 is used for the highest pressure at least
+        TEST4FIMEX_CHECK_MESSAGE(nMissing > 0, method.first << ": " << nMissing);
+    }
+}
+
+TEST4FIMEX_TEST_CASE(pressure_conversions_sliceBuilder)
+{
+    CDMReader_p ncreader(CDMFileReaderFactory::create("netcdf", pathTest("testdata_arome_vc.nc")));
+    std::shared_ptr<CountingReader> counter = std::make_shared<CountingReader>(ncreader);
+    std::shared_ptr<CDMPressureConversions> reader = std::make_shared<CDMPressureConversions>(counter, std::vector<std::string>(1, "specific2relative"));
+
+    std::string rhName;
+    for (const CDMVariable& v : reader->getCDM().getVariables()) {
+        if (!ncreader->getCDM().hasVariable(v.getName()))
+            rhName = v.getName();
+    }
+    TEST4FIMEX_REQUIRE(!rhName.empty());
+
+    const size_t nx = 2, x = 1, k = 10;
+    counter->reset();
+    DataPtr slice = reader->getDataSlice(rhName, 0);
+    const size_t sliceBytes = counter->bytes();
+    TEST4FIMEX_REQUIRE_EQ(slice->size(), 65 * nx);
+
+    SliceBuilder sb(reader->getCDM(), rhName);
+    sb.setStartAndSize("time", 0, 1);
+    sb.setStartAndSize("hybrid", k, 1);
+    sb.setStartAndSize("x", x, 1);
+    counter->reset();
+    DataPtr point = reader->getDataSlice(rhName, sb);
+    const size_t pointBytes = counter->bytes();
+    TEST4FIMEX_REQUIRE_EQ(point->size(), 1);
+    TEST4FIMEX_CHECK_EQ(point->getDouble(0), slice->getDouble(x + nx * k));
+    // only the selected level and point are read for humidity, temperature and pressure
+    TEST4FIMEX_CHECK_MESSAGE(10 * pointBytes < sliceBytes, pointBytes << " bytes for point, " << sliceBytes << " for slice");
+}
+
 TEST4FIMEX_TEST_CASE(height_altitude_detection)
 {
     if (!hasTestExtra())
@@ -30,7 +30,9 @@
 
 #include "testinghelpers.h"
 
+#include "fimex/CDM.h"
 #include "fimex/CDMFileReaderFactory.h"
+#include "fimex/Data.h"
 #include "fimex/Logger.h"
 
 #include <mi_cpptest_version.h>
@@ -131,6 +133,30 @@ bool writeToFile(CDMReader_p input, const std::string& fileName, bool removeFile
 #endif /* NETCDF */
 }
 
+CountingReader::CountingReader(CDMReader_p reader)
+    : reader_(reader)
+    , bytes_(0)
+{
+    *cdm_ = reader_->getCDM();
+}
+
+DataPtr CountingReader::getDataSlice(const std::string& varName, size_t unLimDimPos)
+{
+    return count(reader_->getDataSlice(varName, unLimDimPos));
+}
+
+DataPtr CountingReader::getDataSlice(const std::string& varName, const SliceBuilder& sb)
+{
+    return count(reader_->getDataSlice(varName, sb));
+}
+
+DataPtr CountingReader::count(DataPtr data)
+{
+    if (data)
+        bytes_ += data->size() * data->bytes_for_one();
+    return data;
+}
+
 } // namespace MetNoFimex
 
 int main(int argc, char* args[])
@@ -32,10 +32,11 @@
 #ifndef FIMEX_TESTINGHELPERS_H
 #define FIMEX_TESTINGHELPERS_H 1
 
-#include "fimex/CDMReaderDecl.h"
+#include "fimex/CDMReader.h"
 
 #include <mi_cpptest.h>
 
+#include <atomic>
 #include <string>
 
 #include "fimex_test_config.h"
@@ -61,6 +62,26 @@ void copyFile(const std::string& from, const std::string& to);
 /*! Write to netcdf file, if compiledwith netcdf support, else "write" to null file. */
 bool writeToFile(CDMReader_p input, const std::string& fileName, bool removeFile=true);
 
+/*! Forwards all reads to another reader and counts the number of bytes read. */
+class CountingReader : public CDMReader
+{
+public:
+    CountingReader(CDMReader_p reader);
+
+    using CDMReader::getDataSlice;
+    DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos) override;
+    DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
+
+    size_t bytes() const { return bytes_; }
+    void reset() { bytes_ = 0; }
+
+private:
+    DataPtr count(DataPtr data);
+
+    CDMReader_p reader_;
+    std::atomic<size_t> bytes_;
+};
+
 } // namespace MetNoFimex
 
 #define TEST4FIMEX_TEST_SUITE(x) MI_CPPTEST_TEST_SUITE(x)